@@ -0,0 +1,55 @@
+#include <conflagrant/SnowSimulation.hh>
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+/**
+ * Times steps of cfl::SnowSimulation, by default for a million particles, with the scalar and the AVX2 kernel on one
+ * thread and on every hardware thread.
+ *
+ * Usage: snow_benchmark [particle count] [steps]
+ */
+double MillisecondsPerStep(size_t count, size_t steps, size_t numThreads, bool allowVectorized) {
+    cfl::SnowSimulationParameters parameters;
+    parameters.emitterTransform = glm::translate(cfl::vec3(0, 10, 0)) * glm::scale(cfl::vec3(10, 1, 10));
+    parameters.timeDelta = 1.0f / 60;
+
+    cfl::SnowParticles particles;
+    particles.Resize(count);
+
+    // the first step respawns every particle, it is not timed
+    parameters.time = parameters.timeDelta;
+    cfl::SnowSimulation::Simulate(particles, parameters, nullptr, numThreads, allowVectorized);
+
+    auto const start = std::chrono::steady_clock::now();
+    for (size_t step = 0; step < steps; ++step) {
+        parameters.time += parameters.timeDelta;
+        cfl::SnowSimulation::Simulate(particles, parameters, nullptr, numThreads, allowVectorized);
+    }
+    std::chrono::duration<double, std::milli> const elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / steps;
+}
+
+int main(int argc, char *argv[]) {
+    size_t const count = argc > 1 ? std::stoul(argv[1]) : 1000000;
+    size_t const steps = argc > 2 ? std::stoul(argv[2]) : 20;
+    size_t const numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << count << " particles, " << steps << " steps, " << numThreads << " hardware threads" << std::endl;
+    if (!cfl::SnowSimulation::IsVectorized()) {
+        std::cout << "AVX2 kernel not available, both rows run the scalar kernel" << std::endl;
+    }
+
+    std::cout << "scalar, 1 thread:     " << MillisecondsPerStep(count, steps, 1, false) << " ms/step" << std::endl;
+    std::cout << "scalar, all threads:  " << MillisecondsPerStep(count, steps, 0, false) << " ms/step" << std::endl;
+    std::cout << "AVX2, 1 thread:       " << MillisecondsPerStep(count, steps, 1, true) << " ms/step" << std::endl;
+    std::cout << "AVX2, all threads:    " << MillisecondsPerStep(count, steps, 0, true) << " ms/step" << std::endl;
+
+    return 0;
+}
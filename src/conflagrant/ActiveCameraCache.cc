@@ -0,0 +1,119 @@
+#include "ActiveCameraCache.hh"
+
+#include <conflagrant/ComponentView.hh>
+#include <conflagrant/events.hh>
+#include <conflagrant/components/Name.hh>
+#include <conflagrant/components/Guid.hh>
+
+#include <cassert>
+
+namespace cfl {
+ActiveCameraCache::ActiveCameraCache(entityx::EntityManager &entities, entityx::EventManager &events)
+        : entities(entities), events(events) {
+    events.subscribe<entityx::ComponentAddedEvent<comp::ActiveCamera>>(*this);
+    events.subscribe<entityx::ComponentAddedEvent<comp::Transform>>(*this);
+    events.subscribe<entityx::ComponentAddedEvent<comp::PerspectiveCamera>>(*this);
+    events.subscribe<entityx::ComponentAddedEvent<comp::OrthographicCamera>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::ActiveCamera>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::Transform>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::PerspectiveCamera>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::OrthographicCamera>>(*this);
+}
+
+void ActiveCameraCache::Resolve() {
+    $
+    isResolving = true;
+    isStale = false;
+
+    entityx::ComponentHandle<comp::ActiveCamera> active;
+    camera = entityx::Entity();
+
+    // 1. Check if we have any Perspective- or OrthographicCamera's with ActiveCamera attached
+    for (auto entity : entities.entities_with_components(transform, active, perspective)) {
+        camera = entity;
+        break;
+    }
+    if (!camera) {
+        for (auto entity : entities.entities_with_components(transform, active, orthographic)) {
+            camera = entity;
+            break;
+        }
+    }
+
+    // 2. Check if we have any Perspective- or OrthographicCamera's without ActiveCamera attached
+    //    => if so, attach ActiveCamera
+    if (!camera) {
+        for (auto entity : entities.entities_with_components(transform, perspective)) {
+            camera = entity;
+            camera.assign<comp::ActiveCamera>();
+            break;
+        }
+    }
+    if (!camera) {
+        for (auto entity : entities.entities_with_components(transform, orthographic)) {
+            camera = entity;
+            camera.assign<comp::ActiveCamera>();
+            break;
+        }
+    }
+
+    if (!camera) {
+        camera = entities.create();
+        camera.assign<comp::Name>()->value = "(auto-created camera)";
+        camera.assign<comp::Guid>();
+        camera.assign<comp::ActiveCamera>();
+
+        transform = camera.assign<comp::Transform>();
+        transform->Position(vec3(0, 0, 10));
+        perspective = camera.assign<comp::PerspectiveCamera>();
+    }
+
+    // a camera with both projections uses the perspective one
+    perspective = camera.component<comp::PerspectiveCamera>();
+    orthographic = perspective ? entityx::ComponentHandle<comp::OrthographicCamera>()
+                               : camera.component<comp::OrthographicCamera>();
+
+    isResolving = false;
+}
+
+uint64_t ActiveCameraCache::ProjectionGeneration() const {
+    return perspective ? perspective->Generation() : orthographic->Generation();
+}
+
+void ActiveCameraCache::Update() {
+    $
+    auto const previous = camera;
+    if (isStale || !camera.valid()) {
+        Resolve();
+    } else if (transform->Generation() == transformGeneration && ProjectionGeneration() == projectionGeneration) {
+        return;
+    }
+
+    transformGeneration = transform->Generation();
+    projectionGeneration = ProjectionGeneration();
+
+    if (perspective) {
+        projection = perspective->GetProjection();
+        frustum = perspective->GetFrustum();
+        zNear = perspective->ZNear();
+        zFar = perspective->ZFar();
+    } else {
+        projection = orthographic->GetProjection();
+        frustum = orthographic->GetFrustum();
+        zNear = orthographic->ZNear();
+        zFar = orthographic->ZFar();
+    }
+
+    auto const &M = transform->GetMatrix();
+    view = glm::inverse(M);
+    frustum = M * frustum;
+
+    events.emit(event::CameraChanged{previous, camera});
+}
+
+ActiveCameraCache &ActiveCameraCache::Of(entityx::EntityManager &entities) {
+    auto const views = ComponentViews::Of(entities);
+    assert(views != nullptr && "the EntityManager has no ComponentViews attached");
+    return views->GetCache<ActiveCameraCache>();
+}
+} // namespace cfl
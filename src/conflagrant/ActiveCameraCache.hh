@@ -0,0 +1,121 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/geometry.hh>
+#include <conflagrant/components/Transform.hh>
+#include <conflagrant/components/ActiveCamera.hh>
+#include <conflagrant/components/PerspectiveCamera.hh>
+#include <conflagrant/components/OrthographicCamera.hh>
+
+#include <entityx/Entity.h>
+#include <entityx/Event.h>
+
+namespace cfl {
+/**
+ * @brief The active camera of the scene along with its projection, view and world space frustum, so that the systems
+ * do not look for the camera every frame.
+ *
+ * The camera is looked up again only when an ActiveCamera is assigned or when the camera loses one of its components,
+ * the matrices are updated only when the generation of the camera's Transform or projection changes. Every update
+ * emits an event::CameraChanged.
+ */
+class ActiveCameraCache : public entityx::Receiver<ActiveCameraCache> {
+    entityx::EntityManager &entities;
+    entityx::EventManager &events;
+
+    entityx::Entity camera;
+    entityx::ComponentHandle<comp::Transform> transform;
+    entityx::ComponentHandle<comp::PerspectiveCamera> perspective;
+    entityx::ComponentHandle<comp::OrthographicCamera> orthographic;
+
+    // set when the camera has to be looked up again
+    bool isStale{true};
+
+    // set while looking up the camera, which assigns components of its own
+    bool isResolving{false};
+
+    // of the components that the matrices were computed from
+    uint64_t transformGeneration{0}, projectionGeneration{0};
+
+    mat4 projection{1}, view{1};
+    geometry::Frustum frustum;
+    float zNear{0}, zFar{0};
+
+    void Resolve();
+
+    uint64_t ProjectionGeneration() const;
+
+    inline void InvalidateIfCamera(entityx::Entity entity) {
+        if (!isResolving && (entity == camera || entity.has_component<comp::ActiveCamera>())) {
+            isStale = true;
+        }
+    }
+
+public:
+    ActiveCameraCache(entityx::EntityManager &entities, entityx::EventManager &events);
+
+    ActiveCameraCache(ActiveCameraCache const &) = delete;
+
+    template<typename C>
+    void receive(entityx::ComponentAddedEvent<C> const &event) {
+        InvalidateIfCamera(event.entity);
+    }
+
+    template<typename C>
+    void receive(entityx::ComponentRemovedEvent<C> const &event) {
+        if (!isResolving && event.entity == camera) {
+            isStale = true;
+        }
+    }
+
+    /**
+     * @brief Looks up the camera if it was invalidated and updates the matrices if its Transform or projection changed,
+     * creating a camera if the scene has none. Other than that, it is O(1).
+     */
+    void Update();
+
+    /**
+     * @returns The ActiveCameraCache of the ComponentViews attached to the EntityManager.
+     */
+    static ActiveCameraCache &Of(entityx::EntityManager &entities);
+
+    inline entityx::Entity Camera() const {
+        return camera;
+    }
+
+    inline entityx::ComponentHandle<comp::Transform> const &Transform() const {
+        return transform;
+    }
+
+    inline entityx::ComponentHandle<comp::PerspectiveCamera> const &Perspective() const {
+        return perspective;
+    }
+
+    inline entityx::ComponentHandle<comp::OrthographicCamera> const &Orthographic() const {
+        return orthographic;
+    }
+
+    inline mat4 const &Projection() const {
+        return projection;
+    }
+
+    inline mat4 const &View() const {
+        return view;
+    }
+
+    /**
+     * @returns The world space frustum.
+     */
+    inline geometry::Frustum const &Frustum() const {
+        return frustum;
+    }
+
+    inline float ZNear() const {
+        return zNear;
+    }
+
+    inline float ZFar() const {
+        return zFar;
+    }
+};
+} // namespace cfl
@@ -0,0 +1,85 @@
+#include "ChangeJournal.hh"
+
+#include <conflagrant/ComponentView.hh>
+#include <conflagrant/components/Transform.hh>
+#include <conflagrant/components/PerspectiveCamera.hh>
+#include <conflagrant/components/OrthographicCamera.hh>
+#include <conflagrant/components/DirectionalLightShadow.hh>
+
+#include <cassert>
+
+namespace cfl {
+void JournaledComponent::RecordChange() {
+    ++generation;
+    if (journal) {
+        journal->Record(entity, type, generation);
+    }
+}
+
+ChangeJournal::ChangeJournal(entityx::EntityManager &entities, entityx::EventManager &events)
+        : entities(entities) {
+    Track<comp::Transform>(events);
+    Track<comp::PerspectiveCamera>(events);
+    Track<comp::OrthographicCamera>(events);
+    Track<comp::DirectionalLightShadow>(events);
+}
+
+ChangeJournal::~ChangeJournal() {
+    for (auto component : boundComponents) {
+        component->journal = nullptr;
+    }
+}
+
+void ChangeJournal::Bind(entityx::Entity::Id entity, TypeId type, JournaledComponent &component) {
+    component.journal = this;
+    component.entity = entity;
+    component.type = type;
+    boundComponents.insert(&component);
+}
+
+void ChangeJournal::Unbind(JournaledComponent &component) {
+    component.journal = nullptr;
+    boundComponents.erase(&component);
+}
+
+void ChangeJournal::NextFrame() {
+    ++frame;
+    currentChanges.clear();
+
+    while (!changes.empty() && changes.front().frame + HistoryFrames < frame) {
+        oldestFrame = changes.front().frame + 1;
+        changes.pop_front();
+        ++erasedChanges;
+    }
+}
+
+void ChangeJournal::Record(entityx::Entity::Id entity, TypeId component, uint64_t generation) {
+    auto const it = currentChanges.find(Key{entity, component});
+    if (it != currentChanges.end()) {
+        changes[it->second - erasedChanges].generation = generation;
+        return;
+    }
+
+    currentChanges.emplace(Key{entity, component}, erasedChanges + changes.size());
+    changes.push_back(Change{entity, component, generation, frame});
+}
+
+bool ChangeJournal::ChangedSince(uint64_t since, std::vector<Change> &out) const {
+    if (since < oldestFrame) {
+        return false;
+    }
+
+    auto const first = std::lower_bound(changes.begin(), changes.end(), since,
+                                        [](Change const &change, uint64_t frame) {
+                                            return change.frame < frame;
+                                        });
+    out.insert(out.end(), first, changes.end());
+    return true;
+}
+
+ChangeJournal &ChangeJournal::Of(entityx::EntityManager &entities) {
+    auto const views = ComponentViews::Of(entities);
+    assert(views != nullptr && "the EntityManager has no ComponentViews attached");
+    return views->GetCache<ChangeJournal>();
+}
+} // namespace cfl
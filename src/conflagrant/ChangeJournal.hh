@@ -0,0 +1,164 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/TypeId.hh>
+#include <conflagrant/JournaledComponent.hh>
+
+#include <entityx/Entity.h>
+#include <entityx/Event.h>
+
+#include <algorithm>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace cfl {
+/**
+ * @brief Records which components of which entities changed in which frame, so that systems can update what depends on
+ * them incrementally instead of recomputing everything.
+ *
+ * Writes to JournaledComponent's are recorded by the components themselves, as are their assignment and removal. Edits
+ * of other components are recorded by whoever makes them, e.g. the entity editor of syst::EcsDebugger. The changes of
+ * the last HistoryFrames frames are kept, multiple changes of the same component within a frame are recorded once.
+ */
+class ChangeJournal : public entityx::Receiver<ChangeJournal> {
+public:
+    struct Change {
+        entityx::Entity::Id entity;
+        TypeId component;
+
+        /**
+         * @brief Of the component after the change, 0 for components that are not journaled.
+         */
+        uint64_t generation;
+
+        uint64_t frame;
+    };
+
+    static constexpr uint64_t HistoryFrames = 256;
+
+private:
+    struct Key {
+        entityx::Entity::Id entity;
+        TypeId component;
+
+        inline bool operator==(Key const &other) const {
+            return entity == other.entity && component == other.component;
+        }
+    };
+
+    struct KeyHash {
+        inline size_t operator()(Key const &key) const {
+            return std::hash<uint64_t>()(key.entity.id() * 31 + key.component);
+        }
+    };
+
+    entityx::EntityManager &entities;
+
+    uint64_t frame{0};
+
+    // the first frame whose changes are all kept
+    uint64_t oldestFrame{0};
+
+    std::deque<Change> changes;
+    size_t erasedChanges{0};
+
+    // index of the change of every component that changed in the current frame, counting the erased changes
+    std::unordered_map<Key, size_t, KeyHash> currentChanges;
+
+    std::unordered_set<JournaledComponent *> boundComponents;
+
+    void Bind(entityx::Entity::Id entity, TypeId type, JournaledComponent &component);
+
+    void Unbind(JournaledComponent &component);
+
+public:
+    ChangeJournal(entityx::EntityManager &entities, entityx::EventManager &events);
+
+    ChangeJournal(ChangeJournal const &) = delete;
+
+    ~ChangeJournal();
+
+    /**
+     * @brief Records the changes of the component type from now on, along with the assignment and removal of the
+     * component. The components that exist already are bound without recording a change.
+     */
+    template<typename C>
+    void Track(entityx::EventManager &events) {
+        static_assert(std::is_base_of<JournaledComponent, C>::value, "only journaled components can be tracked");
+
+        events.subscribe<entityx::ComponentAddedEvent<C>>(*this);
+        events.subscribe<entityx::ComponentRemovedEvent<C>>(*this);
+
+        for (auto entity : entities.entities_with_components<C>()) {
+            Bind(entity.id(), GetComponentTypeId<C>(), *entity.template component<C>());
+        }
+    }
+
+    template<typename C>
+    void receive(entityx::ComponentAddedEvent<C> const &event) {
+        entityx::Entity entity = event.entity;
+        auto &component = *entity.component<C>();
+        Bind(entity.id(), GetComponentTypeId<C>(), component);
+        Record(entity.id(), GetComponentTypeId<C>(), component.Generation());
+    }
+
+    template<typename C>
+    void receive(entityx::ComponentRemovedEvent<C> const &event) {
+        entityx::Entity entity = event.entity;
+        auto &component = *entity.component<C>();
+        Record(entity.id(), GetComponentTypeId<C>(), component.Generation());
+        Unbind(component);
+    }
+
+    /**
+     * @brief Ends the current frame, forgetting the changes that are older than HistoryFrames.
+     */
+    void NextFrame();
+
+    inline uint64_t Frame() const {
+        return frame;
+    }
+
+    void Record(entityx::Entity::Id entity, TypeId component, uint64_t generation = 0);
+
+    template<typename C>
+    inline void Record(entityx::Entity entity) {
+        Record(entity.id(), GetComponentTypeId<C>());
+    }
+
+    /**
+     * @brief Appends the changes recorded in the frame and after it, in the order they were recorded in.
+     * @returns false if the changes of the frame were forgotten already, in which case everything has to be considered
+     * changed.
+     */
+    bool ChangedSince(uint64_t since, std::vector<Change> &out) const;
+
+    /**
+     * @brief Like ChangedSince(), but appends every entity whose component of the type changed once.
+     */
+    template<typename C>
+    bool ChangedSince(uint64_t since, std::vector<entityx::Entity::Id> &out) const {
+        std::vector<Change> all;
+        if (!ChangedSince(since, all)) {
+            return false;
+        }
+
+        auto const begin = out.size();
+        for (auto const &change : all) {
+            if (change.component == GetComponentTypeId<C>()) {
+                out.push_back(change.entity);
+            }
+        }
+
+        std::sort(out.begin() + begin, out.end());
+        out.erase(std::unique(out.begin() + begin, out.end()), out.end());
+        return true;
+    }
+
+    /**
+     * @returns The ChangeJournal of the ComponentViews attached to the EntityManager.
+     */
+    static ChangeJournal &Of(entityx::EntityManager &entities);
+};
+} // namespace cfl
@@ -3,9 +3,11 @@
 #include <conflagrant/types.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/factory_util.hh>
+#include <conflagrant/TypeId.hh>
+#include <conflagrant/JournaledComponent.hh>
+#include <conflagrant/FactoryRegistry.hh>
 
 #include <entityx/Entity.h>
-#include <unordered_map>
 
 namespace cfl {
 struct ComponentFactory {
@@ -24,6 +26,18 @@ struct ComponentFactory {
     virtual bool IsSerializable() const = 0;
 
     virtual bool IsImGuiDrawable() const = 0;
+
+    virtual TypeId GetTypeId() const = 0;
+
+    /**
+     * @returns The entityx family of the component, i.e. its bit in the component mask of an entity.
+     */
+    virtual size_t GetFamily() const = 0;
+
+    /**
+     * @returns true if the component records its own changes in the ChangeJournal.
+     */
+    virtual bool IsJournaled() const = 0;
 };
 
 template<typename TComponent>
@@ -111,10 +125,63 @@ public:
     bool IsImGuiDrawable() const override {
         return HasDrawWithImGui;
     }
+
+    TypeId GetTypeId() const override {
+        return GetComponentTypeId<TComponent>();
+    }
+
+    size_t GetFamily() const override {
+        return entityx::EntityManager::component_family<TComponent>();
+    }
+
+    bool IsJournaled() const override {
+        return std::is_base_of<JournaledComponent, TComponent>::value;
+    }
+};
+
+/**
+ * @brief Like FactoryRegistry, but also finds the factories of the components of an entity through its component mask.
+ */
+class ComponentRegistry : public FactoryRegistry<ComponentFactory> {
+    std::vector<ComponentFactory const *> byFamily;
+
+public:
+    void Register(std::shared_ptr<ComponentFactory> factory) {
+        auto const family = factory->GetFamily();
+        if (family >= byFamily.size()) {
+            byFamily.resize(family + 1, nullptr);
+        }
+
+        byFamily[family] = factory.get();
+        FactoryRegistry<ComponentFactory>::Register(std::move(factory));
+    }
+
+    /**
+     * @brief Calls the function with the factory of every registered component that the entity has, visiting only the
+     * set bits of its component mask.
+     */
+    template<typename Function>
+    void ForEachOf(entityx::Entity entity, Function &&function) const {
+        auto const mask = entity.component_mask();
+        using Mask = std::remove_const_t<decltype(mask)>;
+        Mask const lowWord(~0ull);
+
+        for (size_t word = 0; word < mask.size(); word += 64) {
+            auto bits = ((mask >> word) & lowWord).to_ullong();
+            while (bits) {
+                auto const family = word + static_cast<size_t>(__builtin_ctzll(bits));
+                bits &= bits - 1;
+
+                if (family < byFamily.size() && byFamily[family]) {
+                    function(*byFamily[family]);
+                }
+            }
+        }
+    }
 };
 
-extern std::unordered_map<string, std::shared_ptr<ComponentFactory>> ComponentFactoriesByName;
+extern ComponentRegistry ComponentFactories;
 
-#define REGISTER_COMPONENT(component_t) cfl::ComponentFactoriesByName[component_t::ComponentName] = \
-std::static_pointer_cast<cfl::ComponentFactory>(std::make_shared<cfl::ConcreteComponentFactory<component_t>>())
+#define REGISTER_COMPONENT(component_t) cfl::ComponentFactories.Register( \
+std::static_pointer_cast<cfl::ComponentFactory>(std::make_shared<cfl::ConcreteComponentFactory<component_t>>()))
 } // namespace cfl
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+
+#include <entityx/Entity.h>
+#include <entityx/Event.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <typeindex>
+#include <unordered_map>
+
+namespace cfl {
+/**
+ * @brief The entities that have all of the components, kept up to date from the component and entity events of
+ * entityx. Iterating touches only these entities, in the order of their indices and therefore of their components in
+ * the component pools, instead of testing the component mask of every entity.
+ *
+ * Entities that gain the components while iterating are visited, but an entity that loses them may make the
+ * iteration skip the entity that takes its place.
+ */
+template<typename... Components>
+class ComponentView : public entityx::Receiver<ComponentView<Components...>> {
+    static constexpr uint32_t NoSlot = std::numeric_limits<uint32_t>::max();
+
+    entityx::EntityManager &entities;
+
+    // the members, and the slot of every entity index in it
+    std::vector<entityx::Entity::Id> members;
+    std::vector<uint32_t> slots;
+    bool isSorted{true};
+
+    inline void Insert(entityx::Entity::Id id) {
+        auto const index = id.index();
+        if (index >= slots.size()) {
+            slots.resize(index + 1, NoSlot);
+        }
+        if (slots[index] != NoSlot) {
+            return;
+        }
+
+        if (!members.empty() && members.back().index() > index) {
+            isSorted = false;
+        }
+        slots[index] = static_cast<uint32_t>(members.size());
+        members.push_back(id);
+    }
+
+    inline void Erase(entityx::Entity::Id id) {
+        auto const index = id.index();
+        if (index >= slots.size() || slots[index] == NoSlot) {
+            return;
+        }
+
+        // the last member takes the slot, which breaks the order
+        auto const slot = slots[index];
+        members[slot] = members.back();
+        slots[members[slot].index()] = slot;
+        members.pop_back();
+        slots[index] = NoSlot;
+
+        if (slot < members.size()) {
+            isSorted = false;
+        }
+    }
+
+    inline void Sort() {
+        if (isSorted) {
+            return;
+        }
+
+        std::sort(members.begin(), members.end(), [](entityx::Entity::Id a, entityx::Entity::Id b) {
+            return a.index() < b.index();
+        });
+        for (size_t slot = 0; slot < members.size(); ++slot) {
+            slots[members[slot].index()] = static_cast<uint32_t>(slot);
+        }
+        isSorted = true;
+    }
+
+public:
+    /**
+     * @brief Iterates the members like EntityManager::entities_with_components(), assigning the components of the
+     * current entity to the handles.
+     */
+    class Range {
+        ComponentView &view;
+        std::tuple<entityx::ComponentHandle<Components> &...> handles;
+
+    public:
+        class Iterator {
+            Range *range;
+            size_t slot;
+
+        public:
+            inline Iterator(Range *range, size_t slot) : range(range), slot(slot) {}
+
+            inline entityx::Entity operator*() const {
+                entityx::Entity entity(&range->view.entities, range->view.members[slot]);
+                std::apply([&](auto &... handle) {
+                    (Assign(entity, handle), ...);
+                }, range->handles);
+                return entity;
+            }
+
+            inline Iterator &operator++() {
+                ++slot;
+                return *this;
+            }
+
+            // compares against the current size, so that removals while iterating do not run past the end
+            inline bool operator!=(Iterator const &) const {
+                return slot < range->view.members.size();
+            }
+        };
+
+        template<typename C>
+        inline static void Assign(entityx::Entity entity, entityx::ComponentHandle<C> &handle) {
+            handle = entity.component<C>();
+        }
+
+        inline Range(ComponentView &view, entityx::ComponentHandle<Components> &... handles)
+                : view(view), handles(handles...) {}
+
+        inline Iterator begin() {
+            view.Sort();
+            return Iterator(this, 0);
+        }
+
+        inline Iterator end() {
+            return Iterator(this, 0);
+        }
+    };
+
+    inline ComponentView(entityx::EntityManager &entities, entityx::EventManager &events)
+            : entities(entities) {
+        (events.subscribe<entityx::ComponentAddedEvent<Components>>(*this), ...);
+        (events.subscribe<entityx::ComponentRemovedEvent<Components>>(*this), ...);
+        events.subscribe<entityx::EntityDestroyedEvent>(*this);
+
+        for (auto entity : entities.entities_with_components<Components...>()) {
+            Insert(entity.id());
+        }
+    }
+
+    ComponentView(ComponentView const &) = delete;
+
+    template<typename C>
+    inline void receive(entityx::ComponentAddedEvent<C> const &event) {
+        entityx::Entity entity = event.entity;
+        if ((entity.has_component<Components>() && ...)) {
+            Insert(entity.id());
+        }
+    }
+
+    template<typename C>
+    inline void receive(entityx::ComponentRemovedEvent<C> const &event) {
+        entityx::Entity entity = event.entity;
+        Erase(entity.id());
+    }
+
+    inline void receive(entityx::EntityDestroyedEvent const &event) {
+        auto entity = event.entity;
+        Erase(entity.id());
+    }
+
+    inline size_t Size() const {
+        return members.size();
+    }
+
+    inline Range With(entityx::ComponentHandle<Components> &... handles) {
+        return Range(*this, handles...);
+    }
+};
+
+/**
+ * @brief The ComponentView's of an EntityManager, created on first use. The Engine attaches one to the EntityManager of
+ * every scene.
+ */
+class ComponentViews {
+    entityx::EntityManager &entities;
+    entityx::EventManager &events;
+
+    std::unordered_map<std::type_index, std::shared_ptr<void>> views;
+
+    inline static std::unordered_map<entityx::EntityManager const *, ComponentViews *> &Attached() {
+        static std::unordered_map<entityx::EntityManager const *, ComponentViews *> attached;
+        return attached;
+    }
+
+public:
+    /**
+     * @param events Has to be the EventManager that the EntityManager emits its events to.
+     */
+    inline ComponentViews(entityx::EntityManager &entities, entityx::EventManager &events)
+            : entities(entities), events(events) {
+        Attached()[&entities] = this;
+    }
+
+    ComponentViews(ComponentViews const &) = delete;
+
+    inline ~ComponentViews() {
+        auto const it = Attached().find(&entities);
+        if (it != Attached().end() && it->second == this) {
+            Attached().erase(it);
+        }
+    }
+
+    template<typename... Components>
+    inline ComponentView<Components...> &Get() {
+        auto &view = views[std::type_index(typeid(ComponentView<Components...>))];
+        if (!view) {
+            view = std::make_shared<ComponentView<Components...>>(entities, events);
+        }
+        return *std::static_pointer_cast<ComponentView<Components...>>(view);
+    }
+
+    /**
+     * @brief Like Get(), but for other caches that are maintained from the events, e.g. RenderableStore.
+     * @tparam Cache Constructible from the EntityManager and the EventManager.
+     */
+    template<typename Cache>
+    inline Cache &GetCache() {
+        auto &cache = views[std::type_index(typeid(Cache))];
+        if (!cache) {
+            cache = std::make_shared<Cache>(entities, events);
+        }
+        return *std::static_pointer_cast<Cache>(cache);
+    }
+
+    /**
+     * @returns nullptr if no ComponentViews are attached to the EntityManager.
+     */
+    inline static ComponentViews *Of(entityx::EntityManager const &entities) {
+        auto const it = Attached().find(&entities);
+        return it == Attached().end() ? nullptr : it->second;
+    }
+};
+
+/**
+ * @brief Like EntityManager::entities_with_components(), but iterates the cached ComponentView of the components.
+ */
+template<typename... Components>
+inline typename ComponentView<Components...>::Range EntitiesWith(entityx::EntityManager &entities,
+                                                                 entityx::ComponentHandle<Components> &... handles) {
+    auto const views = ComponentViews::Of(entities);
+    assert(views != nullptr && "the EntityManager has no ComponentViews attached");
+    return views->Get<Components...>().With(handles...);
+}
+} // namespace cfl
@@ -0,0 +1,369 @@
+#include "CpuVoxelizer.hh"
+
+#include <conflagrant/logging.hh>
+#include <conflagrant/ParallelFor.hh>
+#include <conflagrant/SparseVoxelOctree.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+namespace cfl {
+namespace {
+constexpr uint32_t Magic = 0x564c4643; // "CFLV"
+constexpr uint32_t Version = 2;
+
+// a 1024^3 volume is already 4 GiB
+constexpr uint32_t MaxResolution = 1024;
+
+struct VolumeHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t resolution;
+    uint32_t numLevels;
+    float center[3];
+    float halfDimensions;
+    uint64_t contentHash;
+};
+
+/**
+ * @returns The range of voxels [min, max] along one axis that a range of world coordinates touches, or an empty
+ * range (min > max) if it is outside of the volume.
+ */
+std::pair<int, int> VoxelRange(float min, float max, float volumeMin, float voxelSize, int resolution) {
+    auto const first = static_cast<int>(std::floor((min - volumeMin) / voxelSize));
+    auto const last = static_cast<int>(std::floor((max - volumeMin) / voxelSize));
+    return {std::max(first, 0), std::min(last, resolution - 1)};
+}
+} // namespace
+
+VoxelVolume::VoxelVolume(uint32_t resolution, vec3 const &center, float halfDimensions)
+        : resolution(resolution), center(center), halfDimensions(halfDimensions),
+          levels(1, std::vector<uint32_t>(size_t(resolution) * resolution * resolution, 0)) {}
+
+uint32_t VoxelVolume::Resolution() const {
+    return resolution;
+}
+
+vec3 const &VoxelVolume::Center() const {
+    return center;
+}
+
+float VoxelVolume::HalfDimensions() const {
+    return halfDimensions;
+}
+
+uint64_t VoxelVolume::ContentHash() const {
+    return contentHash;
+}
+
+void VoxelVolume::ContentHash(uint64_t hash) {
+    contentHash = hash;
+}
+
+size_t VoxelVolume::NumLevels() const {
+    return levels.size();
+}
+
+void VoxelVolume::SetNumLevels(size_t numLevels) {
+    levels.resize(1);
+    for (size_t level = 1; level < numLevels; ++level) {
+        size_t const side = LevelResolution(level);
+        levels.emplace_back(side * side * side, 0);
+    }
+}
+
+uint32_t VoxelVolume::LevelResolution(size_t level) const {
+    return std::max(1u, resolution >> level);
+}
+
+std::vector<uint32_t> &VoxelVolume::Level(size_t level) {
+    return levels[level];
+}
+
+std::vector<uint32_t> const &VoxelVolume::Level(size_t level) const {
+    return levels[level];
+}
+
+vec4 VoxelVolume::Texel(uvec3 const &voxel, size_t level) const {
+    size_t const side = LevelResolution(level);
+    return SparseVoxelOctree::UnpackColor(levels[level][voxel.x + side * (voxel.y + side * voxel.z)]);
+}
+
+bool VoxelVolume::Matches(uint32_t otherResolution, vec3 const &otherCenter, float otherHalfDimensions) const {
+    return resolution == otherResolution && halfDimensions == otherHalfDimensions &&
+           center.x == otherCenter.x && center.y == otherCenter.y && center.z == otherCenter.z;
+}
+
+void VoxelVolume::GenerateMipmaps(size_t numMipmapLevels, size_t numThreads) {
+    levels.resize(1);
+
+    for (size_t level = 1; level <= numMipmapLevels && LevelResolution(level - 1) > 1; ++level) {
+        size_t const side = LevelResolution(level);
+        size_t const sourceSide = LevelResolution(level - 1);
+        bool const isFirstLevel = level == 1;
+
+        levels.emplace_back(side * side * side, 0);
+        auto const &source = levels[level - 1];
+        auto &mipmap = levels[level];
+
+        ParallelFor(side, numThreads, [&](size_t z) {
+            for (size_t y = 0; y < side; ++y) {
+                for (size_t x = 0; x < side; ++x) {
+                    vec3 color(0, 0, 0);
+                    float alpha = 0;
+                    int count = 0;
+
+                    for (size_t i = 0; i < 8; ++i) {
+                        auto const sx = 2 * x + (i & 1), sy = 2 * y + ((i >> 1) & 1), sz = 2 * z + ((i >> 2) & 1);
+                        auto const texel = SparseVoxelOctree::UnpackColor(
+                                source[sx + sourceSide * (sy + sourceSide * sz)]);
+
+                        if (texel.a > 0) {
+                            color += vec3(texel);
+                            alpha += isFirstLevel ? std::min(255 * texel.a, 1.0f) : texel.a;
+                            count++;
+                        }
+                    }
+
+                    if (count > 0) {
+                        mipmap[x + side * (y + side * z)] = SparseVoxelOctree::PackColor(
+                                vec4(color / static_cast<float>(count), std::min(alpha, 1.0f)));
+                    }
+                }
+            }
+        });
+    }
+}
+
+bool VoxelVolume::Save(string const &path) const {
+    VolumeHeader const header{Magic, Version, resolution, static_cast<uint32_t>(levels.size()),
+                              {center.x, center.y, center.z}, halfDimensions, contentHash};
+
+    // write to a temporary file first so that a failed bake never leaves a truncated volume behind
+    auto const temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_ERROR(cfl::VoxelVolume::Save) << "Failed to open path for writing (" << temporaryPath << ")";
+            return false;
+        }
+
+        file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        for (auto const &level : levels) {
+            file.write(reinterpret_cast<char const *>(level.data()), level.size() * sizeof(uint32_t));
+        }
+
+        if (!file) {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            LOG_ERROR(cfl::VoxelVolume::Save) << "Failed to write voxel volume (" << temporaryPath << ")";
+            return false;
+        }
+    }
+
+    return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+bool VoxelVolume::Load(string const &path, VoxelVolume &out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR(cfl::VoxelVolume::Load) << "Failed to open voxel volume (" << path << ")";
+        return false;
+    }
+
+    VolumeHeader header{};
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+
+    auto const isPowerOfTwo = header.resolution > 0 && (header.resolution & (header.resolution - 1)) == 0;
+    if (!file || header.magic != Magic || header.version != Version || !isPowerOfTwo ||
+        header.resolution > MaxResolution || header.numLevels == 0 || header.numLevels > 11) {
+        LOG_ERROR(cfl::VoxelVolume::Load) << "Not a voxel volume of a supported version (" << path << ")";
+        return false;
+    }
+
+    VoxelVolume volume(header.resolution, vec3(header.center[0], header.center[1], header.center[2]),
+                       header.halfDimensions);
+    volume.contentHash = header.contentHash;
+    volume.levels.resize(header.numLevels);
+    for (size_t level = 0; level < volume.levels.size(); ++level) {
+        size_t const side = volume.LevelResolution(level);
+        volume.levels[level].resize(side * side * side);
+        file.read(reinterpret_cast<char *>(volume.levels[level].data()), side * side * side * sizeof(uint32_t));
+    }
+
+    if (!file) {
+        LOG_ERROR(cfl::VoxelVolume::Load) << "Voxel volume is truncated (" << path << ")";
+        return false;
+    }
+
+    out = std::move(volume);
+    return true;
+}
+
+void CpuVoxelizer::Voxelize(std::vector<VoxelizerTriangle> const &triangles, VoxelShadingFunction const &shade,
+                            VoxelVolume &volume, size_t numThreads) {
+    auto const resolution = static_cast<int>(volume.Resolution());
+    auto const voxelSize = 2 * volume.HalfDimensions() / resolution;
+    auto const volumeMin = volume.Center() - vec3(volume.HalfDimensions());
+    vec3 const voxelHalfDimensions(0.5f * voxelSize);
+
+    struct VoxelBounds {
+        std::pair<int, int> x, y;
+    };
+
+    // sort the triangles into the z slices they touch, so that every thread only visits its own
+    std::vector<std::vector<std::pair<size_t, VoxelBounds>>> slices(static_cast<size_t>(resolution));
+    for (size_t i = 0; i < triangles.size(); ++i) {
+        auto const &positions = triangles[i].positions;
+
+        std::pair<int, int> ranges[3];
+        bool isInside = true;
+        for (int axis = 0; axis < 3; ++axis) {
+            auto const min = std::min({positions[0][axis], positions[1][axis], positions[2][axis]});
+            auto const max = std::max({positions[0][axis], positions[1][axis], positions[2][axis]});
+            ranges[axis] = VoxelRange(min, max, volumeMin[axis], voxelSize, resolution);
+            isInside = isInside && ranges[axis].first <= ranges[axis].second;
+        }
+
+        if (!isInside) {
+            continue;
+        }
+
+        for (int z = ranges[2].first; z <= ranges[2].second; ++z) {
+            slices[z].emplace_back(i, VoxelBounds{ranges[0], ranges[1]});
+        }
+    }
+
+    auto &voxels = volume.Level(0);
+    size_t const side = volume.Resolution();
+
+    ParallelFor(slices.size(), numThreads, [&](size_t z) {
+        for (auto const &entry : slices[z]) {
+            auto const &triangle = triangles[entry.first];
+            auto const &bounds = entry.second;
+
+            for (int y = bounds.y.first; y <= bounds.y.second; ++y) {
+                for (int x = bounds.x.first; x <= bounds.x.second; ++x) {
+                    auto const voxelCenter = volumeMin + (vec3(x, y, z) + vec3(0.5f)) * voxelSize;
+                    if (!Overlaps(triangle.positions, voxelCenter, voxelHalfDimensions)) {
+                        continue;
+                    }
+
+                    auto const weights = ClosestPoint(triangle.positions, voxelCenter);
+                    auto const position = weights.x * triangle.positions[0] + weights.y * triangle.positions[1] +
+                                          weights.z * triangle.positions[2];
+                    auto const normal = weights.x * triangle.normals[0] + weights.y * triangle.normals[1] +
+                                        weights.z * triangle.normals[2];
+
+                    auto const color = shade ? shade(position, normal, triangle) : triangle.diffuse;
+                    AverageInto(voxels[x + side * (y + side * z)], color);
+                }
+            }
+        }
+    });
+}
+
+void CpuVoxelizer::AverageInto(uint32_t &voxel, vec3 const &color) {
+    if (voxel == 0) {
+        voxel = SparseVoxelOctree::PackColor(vec4(color, 1.0f / 255.0f));
+        return;
+    }
+
+    auto const current = SparseVoxelOctree::UnpackColor(voxel);
+    auto const count = static_cast<uint32_t>(current.a * 255.0f);
+    auto const average = (vec3(current) * static_cast<float>(count) + color) / static_cast<float>(count + 1);
+
+    voxel = SparseVoxelOctree::PackColor(vec4(average, (count + 1) / 255.0f));
+}
+
+bool CpuVoxelizer::Overlaps(std::array<vec3, 3> const &triangle, vec3 const &boxCenter,
+                            vec3 const &boxHalfDimensions) {
+    std::array<vec3, 3> const v{triangle[0] - boxCenter, triangle[1] - boxCenter, triangle[2] - boxCenter};
+    std::array<vec3, 3> const edges{v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+
+    // the triangle and the box are separated along the axis if their projections do not overlap
+    auto const isSeparatingAxis = [&](vec3 const &axis) {
+        auto const p0 = glm::dot(v[0], axis), p1 = glm::dot(v[1], axis), p2 = glm::dot(v[2], axis);
+        auto const radius = glm::dot(boxHalfDimensions, glm::abs(axis));
+        return std::min({p0, p1, p2}) > radius || std::max({p0, p1, p2}) < -radius;
+    };
+
+    // the face normals of the box, i.e. the bounding boxes
+    for (int axis = 0; axis < 3; ++axis) {
+        vec3 normal(0, 0, 0);
+        normal[axis] = 1;
+        if (isSeparatingAxis(normal)) {
+            return false;
+        }
+    }
+
+    if (isSeparatingAxis(glm::cross(edges[0], edges[1]))) {
+        return false;
+    }
+
+    for (auto const &edge : edges) {
+        for (int axis = 0; axis < 3; ++axis) {
+            vec3 boxEdge(0, 0, 0);
+            boxEdge[axis] = 1;
+            if (isSeparatingAxis(glm::cross(boxEdge, edge))) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+vec3 CpuVoxelizer::ClosestPoint(std::array<vec3, 3> const &triangle, vec3 const &point) {
+    // Ericson, Real-Time Collision Detection, 5.1.5: find the Voronoi region of the triangle containing the point
+    auto const &a = triangle[0], &b = triangle[1], &c = triangle[2];
+    auto const ab = b - a, ac = c - a, ap = point - a;
+
+    auto const d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0 && d2 <= 0) {
+        return vec3(1, 0, 0);
+    }
+
+    auto const bp = point - b;
+    auto const d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0 && d4 <= d3) {
+        return vec3(0, 1, 0);
+    }
+
+    auto const vc = d1 * d4 - d3 * d2;
+    if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+        auto const t = d1 / (d1 - d3);
+        return vec3(1 - t, t, 0);
+    }
+
+    auto const cp = point - c;
+    auto const d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0 && d5 <= d6) {
+        return vec3(0, 0, 1);
+    }
+
+    auto const vb = d5 * d2 - d1 * d6;
+    if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+        auto const t = d2 / (d2 - d6);
+        return vec3(1 - t, 0, t);
+    }
+
+    auto const va = d3 * d6 - d5 * d4;
+    if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+        auto const t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return vec3(0, 1 - t, t);
+    }
+
+    // degenerate triangles have no interior
+    auto const sum = va + vb + vc;
+    if (sum == 0) {
+        return vec3(1, 0, 0);
+    }
+
+    auto const denominator = 1 / sum;
+    auto const v = vb * denominator, w = vc * denominator;
+    return vec3(1 - v - w, v, w);
+}
+} // namespace cfl
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+
+#include <functional>
+
+namespace cfl {
+/**
+ * @brief A triangle in world space, with everything the voxelization shades it with.
+ */
+struct VoxelizerTriangle {
+    std::array<vec3, 3> positions;
+    std::array<vec3, 3> normals;
+    vec3 diffuse;
+    float radiance;
+};
+
+/**
+ * @brief Computes the color a triangle contributes to a voxel, like voxels/voxelize.frag does per fragment.
+ * @param position The point of the triangle closest to the voxel's center.
+ * @param normal The interpolated vertex normal at that point.
+ */
+using VoxelShadingFunction = std::function<vec3(vec3 const &position, vec3 const &normal,
+                                                VoxelizerTriangle const &triangle)>;
+
+/**
+ * @brief RGBA8 voxels and their mipmap chain, laid out like the dense voxel texture of syst::DeferredRenderer.
+ *
+ * Level 0 stores the average color of the fragments of each voxel and their count in the alpha channel, the other
+ * levels store the filtered color and coverage, see voxels/mipmap.comp.
+ */
+class VoxelVolume {
+    uint32_t resolution{0};
+    vec3 center{0, 0, 0};
+    float halfDimensions{1};
+    uint64_t contentHash{0};
+    std::vector<std::vector<uint32_t>> levels;
+
+public:
+    VoxelVolume() = default;
+
+    /**
+     * @brief An empty volume with only level 0.
+     */
+    VoxelVolume(uint32_t resolution, vec3 const &center, float halfDimensions);
+
+    uint32_t Resolution() const;
+
+    vec3 const &Center() const;
+
+    float HalfDimensions() const;
+
+    /**
+     * @brief A hash of the scene the volume was baked from, stored along with it, so that a stale bake can be told
+     * apart from a current one. 0 if unknown.
+     */
+    uint64_t ContentHash() const;
+
+    void ContentHash(uint64_t hash);
+
+    size_t NumLevels() const;
+
+    /**
+     * @brief Keeps level 0 and replaces the others with numLevels - 1 empty ones.
+     */
+    void SetNumLevels(size_t numLevels);
+
+    uint32_t LevelResolution(size_t level) const;
+
+    /**
+     * @brief The packed texels of a level, x varies fastest and z slowest, like glTexSubImage3D expects them.
+     */
+    std::vector<uint32_t> &Level(size_t level);
+
+    std::vector<uint32_t> const &Level(size_t level) const;
+
+    vec4 Texel(uvec3 const &voxel, size_t level = 0) const;
+
+    /**
+     * @returns true if the volume covers the given region at the given resolution.
+     */
+    bool Matches(uint32_t resolution, vec3 const &center, float halfDimensions) const;
+
+    /**
+     * @brief Replaces all levels above 0 with numMipmapLevels filtered ones, with the same filter as
+     * voxels/mipmap.comp. Stops early at a resolution of 1.
+     */
+    void GenerateMipmaps(size_t numMipmapLevels, size_t numThreads = 0);
+
+    bool Save(string const &path) const;
+
+    static bool Load(string const &path, VoxelVolume &out);
+};
+
+/**
+ * @brief CPU reference of voxels/voxelize.*, for tests and for baking the voxels of static scenes offline.
+ *
+ * The voxelization is conservative: each triangle contributes exactly one fragment to every voxel it overlaps,
+ * shaded at the point of the triangle closest to the voxel's center. The GPU rasterizes the triangles instead, which
+ * can write a voxel several times or miss it for thin triangles, so the fragment counts in the alpha channel of
+ * level 0 differ, while the colors and the coverage of the mipmaps are the same.
+ */
+class CpuVoxelizer {
+    CpuVoxelizer() = delete;
+
+public:
+    /**
+     * @brief Averages the triangles into level 0 of the volume, on top of what it already contains.
+     *
+     * Every thread writes its own z slices of the volume, and the fragments of a voxel are averaged in the order of
+     * the triangles, so the result does not depend on the number of threads.
+     * @param shade nullptr shades every fragment with the diffuse color of its triangle.
+     * @param numThreads 0 uses one thread per hardware thread.
+     */
+    static void Voxelize(std::vector<VoxelizerTriangle> const &triangles, VoxelShadingFunction const &shade,
+                         VoxelVolume &volume, size_t numThreads = 0);
+
+    /**
+     * @brief Adds a color to the running average of a packed RGBA8 voxel, with the same rounding as
+     * ImageAtomicAverageRGBA8 in voxels/common/util.glsl.
+     */
+    static void AverageInto(uint32_t &voxel, vec3 const &color);
+
+    /**
+     * @returns true if the triangle overlaps the axis-aligned box, by the separating axis theorem.
+     */
+    static bool Overlaps(std::array<vec3, 3> const &triangle, vec3 const &boxCenter, vec3 const &boxHalfDimensions);
+
+    /**
+     * @returns The barycentric coordinates of the point of the triangle closest to the given point.
+     */
+    static vec3 ClosestPoint(std::array<vec3, 3> const &triangle, vec3 const &point);
+};
+} // namespace cfl
@@ -3,7 +3,10 @@
 #include "homedirectory.hh"
 
 #include <conflagrant/ComponentFactory.hh>
+#include <conflagrant/ChangeJournal.hh>
+#include <conflagrant/ComponentView.hh>
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 
@@ -134,8 +137,11 @@ bool Engine::LoadScene(std::function<bool(std::shared_ptr<entityx::EntityManager
                                           std::shared_ptr<entityx::SystemManager>)> loadSceneFunction) {
     UnloadScene();
 
+    views = nullptr;
     events = std::make_shared<entityx::EventManager>();
     entities = std::make_shared<entityx::EntityManager>(*events);
+    views = std::make_shared<ComponentViews>(*entities, *events);
+    views->GetCache<ChangeJournal>();
     systems = std::make_shared<entityx::SystemManager>(*entities, *events);
 
     if (!loadSceneFunction(entities, systems)) {
@@ -159,15 +165,15 @@ bool Engine::CreateSystems(Json::Value &json) {
 
         std::string systemName = jsonSystem["name"].asString();
 
-        auto it = SystemFactoriesByName.find(systemName);
-        if (it == SystemFactoriesByName.end()) {
+        auto const &factory = SystemFactories.Find(systemName);
+        if (!factory) {
             LOG_ERROR(cfl::Engine::CreateSystems) << "System with name '" << systemName << "' does not have a factory."
                                                   << " Have you forgot to register the system?";
             return false;
         }
 
-        std::shared_ptr<SystemFactory> factory = it->second;
         orderedSystemFactories.push_back(factory);
+        ResolveActiveRenderer();
 
         auto system = factory->Create(*systems, jsonSystem);
         if (!system) {
@@ -217,15 +223,15 @@ bool Engine::CreateEntity(Json::Value &jsonEntity) {
     // loop through each json object member and try to create a component matching the member's name
     Json::Value::Members const &componentNames = jsonEntity.getMemberNames();
     for (auto const &componentName : componentNames) {
-        auto it = ComponentFactoriesByName.find(componentName);
-        if (it == ComponentFactoriesByName.end()) {
+        auto const &factoryPointer = ComponentFactories.Find(componentName);
+        if (!factoryPointer) {
             LOG_ERROR(cfl::Engine::CreateEntity) << "Component with name '" << componentName
                                                  << "' does not have a factory. "
                                                  << "Have you forgot to register the component?";
             RETURN_ERROR();
         }
 
-        auto &factory = *it->second;
+        auto &factory = *factoryPointer;
         if (!factory.IsSerializable()) {
             LOG_ERROR(cfl::Engine::CreateEntity) << "Component with name '" << componentName
                                                  << "' is not serializable (i.e. do not specify it in your scene file)";
@@ -269,6 +275,10 @@ int Engine::Run(bool singleTimestep) {
             }
         }
 
+        if (entities) {
+            ChangeJournal::Of(*entities).NextFrame();
+        }
+
         if (window) window->BeginFrame();
         std::stringstream ss;
         for (auto &factory : orderedSystemFactories) {
@@ -324,6 +334,39 @@ int Engine::Run(bool singleTimestep) {
     return 0;
 }
 
+void Engine::MoveSystem(std::shared_ptr<SystemFactory> const &factory, bool moveDown) {
+    auto const iter = std::find(orderedSystemFactories.begin(), orderedSystemFactories.end(), factory);
+    if (iter == orderedSystemFactories.end()) {
+        return;
+    }
+
+    if (moveDown) {
+        if (iter + 1 == orderedSystemFactories.end()) {
+            return;
+        }
+
+        std::iter_swap(iter, iter + 1);
+    } else {
+        if (iter == orderedSystemFactories.begin()) {
+            return;
+        }
+
+        std::iter_swap(iter, iter - 1);
+    }
+
+    ResolveActiveRenderer();
+}
+
+void Engine::ResolveActiveRenderer() {
+    activeRenderer = NoTypeId;
+    for (auto const &factory : orderedSystemFactories) {
+        if (factory->IsRenderer()) {
+            activeRenderer = factory->GetTypeId();
+            return;
+        }
+    }
+}
+
 // save scene
 
 bool Engine::SaveScene(Json::Value &json) {
@@ -348,9 +391,13 @@ bool Engine::UnloadScene() {
     }
     systemVector.clear();
     orderedSystemFactories.clear();
+    ResolveActiveRenderer();
 
+    views = nullptr;
     events = std::make_shared<entityx::EventManager>();
     entities = std::make_shared<entityx::EntityManager>(*events);
+    views = std::make_shared<ComponentViews>(*entities, *events);
+    views->GetCache<ChangeJournal>();
     systems = std::make_shared<entityx::SystemManager>(*entities, *events);
 
     return false;
@@ -390,21 +437,19 @@ bool Engine::SaveEntities(Json::Value &json) {
 }
 
 bool Engine::SaveEntity(entityx::Entity &entity, Json::Value &json) {
-    for (auto const &pair : ComponentFactoriesByName) {
-        auto const &name = pair.first;
-        auto const &factory = *pair.second;
-
-        if (!factory.IsSerializable() || !factory.HasComponent(entity)) {
-            continue;
+    bool success = true;
+    ComponentFactories.ForEachOf(entity, [&](ComponentFactory const &factory) {
+        if (!success || !factory.IsSerializable()) {
+            return;
         }
 
-        if (!factory.Serialize(json[name], entity)) {
+        if (!factory.Serialize(json[factory.GetName()], entity)) {
             // todo error message
-            return false;
+            success = false;
         }
-    }
+    });
 
-    return true;
+    return success;
 }
 
 void Engine::ToggleRecording(bool shouldRecord) {
@@ -10,6 +10,8 @@
 #include <conflagrant/SystemFactory.hh>
 
 namespace cfl {
+class ComponentViews;
+
 class Engine {
     std::shared_ptr<entityx::EntityManager> entities;
 
@@ -23,6 +25,11 @@ class Engine {
      */
     std::shared_ptr<entityx::SystemManager> systems;
 
+    /**
+     * Component views of the entity manager, see EntitiesWith()
+     */
+    std::shared_ptr<ComponentViews> views;
+
     std::shared_ptr<Window> const window;
 
     std::shared_ptr<InputManager> input;
@@ -60,6 +67,13 @@ class Engine {
 
     std::vector<std::shared_ptr<System>> systemVector;
 
+    /**
+     * The type of the first renderer in the system order
+     */
+    TypeId activeRenderer{NoTypeId};
+
+    void ResolveActiveRenderer();
+
     std::unique_ptr<Path> currentScenePath{nullptr};
 
 public:
@@ -98,6 +112,19 @@ public:
         return systemVector.size();
     }
 
+    /**
+     * @brief Swaps the system with its neighbour in the system order.
+     */
+    void MoveSystem(std::shared_ptr<SystemFactory> const &factory, bool moveDown);
+
+    /**
+     * @returns true if the system is the first renderer in the system order, which is the only one that renders.
+     */
+    template<typename TSystem>
+    inline bool IsActiveRenderer() const {
+        return activeRenderer == GetSystemTypeId<TSystem>();
+    }
+
     inline void Stop() {
         shouldStop = true;
     }
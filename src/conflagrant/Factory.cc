@@ -2,6 +2,6 @@
 #include "ComponentFactory.hh"
 
 namespace cfl {
-std::unordered_map<string, std::shared_ptr<SystemFactory>> SystemFactoriesByName;
-std::unordered_map<string, std::shared_ptr<ComponentFactory>> ComponentFactoriesByName;
+FactoryRegistry<SystemFactory> SystemFactories;
+ComponentRegistry ComponentFactories;
 } // namespace cfl
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/TypeId.hh>
+
+#include <unordered_map>
+
+namespace cfl {
+/**
+ * @brief The registered factories of a family of types, indexed by the dense TypeId of their type. Looking up factories
+ * by name is only meant for loading scenes.
+ * @tparam TFactory Has GetTypeId() and GetName().
+ */
+template<typename TFactory>
+class FactoryRegistry {
+    std::vector<std::shared_ptr<TFactory>> factories;
+    std::unordered_map<string, TypeId> typeIdsByName;
+
+public:
+    void Register(std::shared_ptr<TFactory> factory) {
+        auto const typeId = factory->GetTypeId();
+        if (typeId >= factories.size()) {
+            factories.resize(typeId + 1);
+        }
+
+        typeIdsByName[factory->GetName()] = typeId;
+        factories[typeId] = std::move(factory);
+    }
+
+    /**
+     * @returns nullptr if no factory of the type is registered.
+     */
+    inline std::shared_ptr<TFactory> const &Get(TypeId typeId) const {
+        static std::shared_ptr<TFactory> const none;
+        return typeId < factories.size() ? factories[typeId] : none;
+    }
+
+    /**
+     * @returns nullptr if no factory with the name is registered.
+     */
+    inline std::shared_ptr<TFactory> const &Find(string const &name) const {
+        static std::shared_ptr<TFactory> const none;
+        auto const it = typeIdsByName.find(name);
+        return it == typeIdsByName.end() ? none : factories[it->second];
+    }
+
+    /**
+     * @brief Calls the function with every registered factory, in the order of their type ids.
+     */
+    template<typename Function>
+    void ForEach(Function &&function) const {
+        for (auto const &factory : factories) {
+            if (factory) {
+                function(*factory);
+            }
+        }
+    }
+};
+} // namespace cfl
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <conflagrant/TypeId.hh>
+
+#include <entityx/Entity.h>
+
+#include <algorithm>
+
+namespace cfl {
+class ChangeJournal;
+
+/**
+ * @brief Base of the components whose writes are recorded in the ChangeJournal of their EntityManager. Derived
+ * components call RecordChange() from their setters, Serialize() and DrawWithImGui().
+ */
+class JournaledComponent {
+    friend class ChangeJournal;
+
+    ChangeJournal *journal{nullptr};
+    entityx::Entity::Id entity;
+    TypeId type{0};
+    uint64_t generation{0};
+
+protected:
+    JournaledComponent() = default;
+
+    // a copy belongs to no entity until it is assigned to one
+    inline JournaledComponent(JournaledComponent const &other) : generation(other.generation) {}
+
+    // the generation of this instance only increases, even when assigning from a component that is behind it
+    inline JournaledComponent &operator=(JournaledComponent const &other) {
+        generation = std::max(generation, other.generation);
+        RecordChange();
+        return *this;
+    }
+
+    void RecordChange();
+
+public:
+    /**
+     * @brief Increases with every recorded change, so that copies of the component can be updated when they are stale.
+     */
+    inline uint64_t Generation() const {
+        return generation;
+    }
+};
+} // namespace cfl
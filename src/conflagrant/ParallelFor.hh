@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace cfl {
+/**
+ * @brief Calls work(i) for every i in [0, count), spread over the given number of threads.
+ * @param numThreads 0 uses one thread per hardware thread.
+ */
+inline void ParallelFor(size_t count, size_t numThreads, std::function<void(size_t)> const &work) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    numThreads = std::min(numThreads, count);
+
+    std::atomic<size_t> next{0};
+    auto const run = [&]() {
+        for (auto i = next++; i < count; i = next++) {
+            work(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i) {
+        threads.emplace_back(run);
+    }
+    run();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+} // namespace cfl
@@ -0,0 +1,77 @@
+#include "RadixSort.hh"
+
+#include <conflagrant/ParallelFor.hh>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace cfl {
+namespace {
+constexpr size_t DigitBits = 8;
+constexpr size_t NumDigits = 1 << DigitBits;
+constexpr size_t BlockSize = 16384;
+
+inline size_t Digit(uint32_t key, size_t shift) {
+    return (key >> shift) & (NumDigits - 1);
+}
+} // namespace
+
+void RadixSort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, size_t numThreads) {
+    assert(keys.size() == values.size());
+
+    auto const count = keys.size();
+    if (count < 2) {
+        return;
+    }
+
+    auto const numBlocks = (count + BlockSize - 1) / BlockSize;
+    std::vector<std::array<size_t, NumDigits>> offsets(numBlocks);
+
+    std::vector<uint32_t> sortedKeys(count), sortedValues(count);
+
+    for (size_t shift = 0; shift < 32; shift += DigitBits) {
+        ParallelFor(numBlocks, numThreads, [&](size_t block) {
+            auto &histogram = offsets[block];
+            histogram.fill(0);
+
+            auto const end = std::min(count, (block + 1) * BlockSize);
+            for (auto i = block * BlockSize; i < end; ++i) {
+                histogram[Digit(keys[i], shift)]++;
+            }
+        });
+
+        // exclusive prefix sum over the digits, and over the blocks within a digit
+        size_t offset = 0;
+        bool haveSameDigit = false;
+        for (size_t digit = 0; digit < NumDigits; ++digit) {
+            auto const digitBegin = offset;
+            for (auto &histogram : offsets) {
+                auto const numKeys = histogram[digit];
+                histogram[digit] = offset;
+                offset += numKeys;
+            }
+            haveSameDigit = haveSameDigit || offset - digitBegin == count;
+        }
+
+        // all keys have the same digit, the pass would not move any of them
+        if (haveSameDigit) {
+            continue;
+        }
+
+        ParallelFor(numBlocks, numThreads, [&](size_t block) {
+            auto &histogram = offsets[block];
+
+            auto const end = std::min(count, (block + 1) * BlockSize);
+            for (auto i = block * BlockSize; i < end; ++i) {
+                auto const destination = histogram[Digit(keys[i], shift)]++;
+                sortedKeys[destination] = keys[i];
+                sortedValues[destination] = values[i];
+            }
+        });
+
+        keys.swap(sortedKeys);
+        values.swap(sortedValues);
+    }
+}
+} // namespace cfl
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cfl {
+/**
+ * @brief Sorts keys ascending and moves values[i] along with keys[i]. The sort is stable, so equal keys keep the order
+ * of their values.
+ *
+ * Least significant digit first, eight bits per pass. Every pass counts the digits of a block of keys per task, and
+ * each block then scatters its keys to the offsets that its counts give, so the result does not depend on the number
+ * of threads. Passes in which all keys have the same digit are skipped.
+ *
+ * @param numThreads 0 uses one thread per hardware thread.
+ */
+void RadixSort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values, size_t numThreads = 0);
+} // namespace cfl
@@ -0,0 +1,362 @@
+#include "RenderGraph.hh"
+#include "gl/StateCache.hh"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace cfl {
+namespace {
+size_t BytesPerPixel(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+            return 2;
+        case GL_RGB8:
+        case GL_DEPTH_COMPONENT24:
+            return 3;
+        case GL_RGBA:
+        case GL_RGBA8:
+        case GL_R32F:
+        case GL_RG16F:
+        case GL_R32UI:
+        case GL_DEPTH_COMPONENT:
+        case GL_DEPTH_COMPONENT32F:
+        case GL_DEPTH24_STENCIL8:
+            return 4;
+        case GL_RGB16F:
+            return 6;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            return 8;
+        case GL_RGB32F:
+            return 12;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4;
+    }
+}
+} // namespace
+
+GLbitfield RenderGraph::BarrierFor(Access access) {
+    switch (access) {
+        case Access::Sample:
+            return GL_TEXTURE_FETCH_BARRIER_BIT;
+        case Access::RenderTarget:
+            return GL_FRAMEBUFFER_BARRIER_BIT;
+        case Access::ImageStore:
+            return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        default:
+            return GL_TEXTURE_UPDATE_BARRIER_BIT;
+    }
+}
+
+size_t RenderGraph::TextureDesc::SizeInBytes() const {
+    return static_cast<size_t>(width) * static_cast<size_t>(height) * BytesPerPixel(internalFormat);
+}
+
+void RenderGraph::Reset() {
+    resources.clear();
+    passes.clear();
+    compiled = false;
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateTexture(string const &name, TextureDesc const &desc) {
+    resources.push_back(Resource{name, desc, nullptr, nullptr, 0, 0, false});
+    return resources.size() - 1;
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportTexture(string const &name,
+                                                       std::shared_ptr<gl::GlTextureBase> const &texture) {
+    resources.push_back(Resource{name, TextureDesc{}, texture, nullptr, 0, 0, false});
+    return resources.size() - 1;
+}
+
+void RenderGraph::AddPass(string const &name, SetupFunction const &setup, ExecuteFunction const &execute) {
+    passes.emplace_back();
+    auto &pass = passes.back();
+    pass.name = name;
+    pass.execute = execute;
+
+    PassBuilder builder(*this, pass);
+    setup(builder);
+}
+
+std::shared_ptr<gl::Texture2D> RenderGraph::AcquireFromPool(TextureDesc const &desc, std::vector<bool> &inUse) {
+    for (size_t i = 0; i < pool.size(); ++i) {
+        if (!inUse[i] && pool[i].desc == desc) {
+            inUse[i] = true;
+            pool[i].usedThisFrame = true;
+            return pool[i].texture;
+        }
+    }
+
+    auto texture = std::make_shared<gl::Texture2D>(desc.width, desc.height, desc.internalFormat, desc.format,
+                                                   desc.type, nullptr);
+    texture->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    texture->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    texture->TexParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    texture->TexParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    pool.push_back(PooledTexture{desc, texture, true});
+    inUse.push_back(true);
+    return texture;
+}
+
+bool RenderGraph::Compile() {
+    $
+    stats = {};
+    stats.passes = passes.size();
+
+    for (auto const &pass : passes) {
+        for (auto const &use : pass.writes) {
+            if (use.access == Access::RenderTarget && resources[use.resource].imported) {
+                LOG_ERROR(cfl::RenderGraph::Compile) << "Pass " << pass.name << " renders into imported texture "
+                                                     << resources[use.resource].name;
+                return false;
+            }
+        }
+    }
+
+    // walk backwards from the passes with side effects, keeping the passes that produce what they consume
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t r = 0; r < resources.size(); ++r) {
+        // imported textures outlive the frame, so writes to them always matter
+        needed[r] = resources[r].imported != nullptr;
+    }
+
+    for (auto pass = passes.rbegin(); pass != passes.rend(); ++pass) {
+        pass->alive = pass->hasSideEffects || std::any_of(pass->writes.begin(), pass->writes.end(),
+                                                          [&](ResourceUse const &use) {
+                                                              return needed[use.resource];
+                                                          });
+        if (!pass->alive) {
+            stats.culledPasses++;
+            continue;
+        }
+
+        for (auto const &use : pass->writes) {
+            // a cleared render target does not depend on what earlier passes wrote to it
+            if (use.access == Access::RenderTarget && use.clear && !resources[use.resource].imported) {
+                needed[use.resource] = false;
+            } else {
+                needed[use.resource] = true;
+            }
+        }
+        for (auto const &use : pass->reads) {
+            needed[use.resource] = true;
+        }
+    }
+
+    // lifetimes of the transient textures, in pass indices
+    std::vector<bool> used(resources.size(), false);
+    for (size_t p = 0; p < passes.size(); ++p) {
+        if (!passes[p].alive) continue;
+
+        auto touch = [&](ResourceUse const &use) {
+            auto &resource = resources[use.resource];
+            if (!used[use.resource]) {
+                used[use.resource] = true;
+                resource.firstUse = p;
+            }
+            resource.lastUse = p;
+        };
+        std::for_each(passes[p].reads.begin(), passes[p].reads.end(), touch);
+        std::for_each(passes[p].writes.begin(), passes[p].writes.end(), touch);
+    }
+
+    // assign pooled textures, a texture is free again once the last pass using its current resource is done
+    for (auto &entry : pool) {
+        entry.usedThisFrame = false;
+    }
+    std::vector<bool> inUse(pool.size(), false);
+
+    for (size_t p = 0; p < passes.size(); ++p) {
+        if (!passes[p].alive) continue;
+
+        for (size_t r = 0; r < resources.size(); ++r) {
+            auto &resource = resources[r];
+            if (used[r] && !resource.imported && resource.firstUse == p) {
+                resource.physical = AcquireFromPool(resource.desc, inUse);
+                stats.transientTextures++;
+                stats.transientBytes += resource.desc.SizeInBytes();
+            }
+        }
+
+        for (size_t r = 0; r < resources.size(); ++r) {
+            auto const &resource = resources[r];
+            if (used[r] && !resource.imported && resource.lastUse == p) {
+                auto it = std::find_if(pool.begin(), pool.end(), [&](PooledTexture const &entry) {
+                    return entry.texture == resource.physical;
+                });
+                inUse[it - pool.begin()] = false;
+            }
+        }
+    }
+
+    // release textures this frame had no use for, along with the framebuffers they are attached to
+    auto const poolSize = pool.size();
+    pool.erase(std::remove_if(pool.begin(), pool.end(), [](PooledTexture const &entry) {
+        return !entry.usedThisFrame;
+    }), pool.end());
+    if (pool.size() != poolSize) {
+        framebuffers.clear();
+    }
+
+    for (auto const &entry : pool) {
+        stats.physicalTextures++;
+        stats.physicalBytes += entry.desc.SizeInBytes();
+    }
+
+    // barriers: image stores have to be made visible to whichever pass touches the texture next
+    std::vector<bool> pendingImageWrite(resources.size(), false);
+    for (auto &pass : passes) {
+        if (!pass.alive) continue;
+
+        pass.barrier = 0;
+        pass.clears.clear();
+        pass.colorTargets.clear();
+        pass.depthTarget = InvalidResource;
+
+        auto sync = [&](ResourceUse const &use) {
+            if (pendingImageWrite[use.resource]) {
+                pass.barrier |= BarrierFor(use.access);
+                pendingImageWrite[use.resource] = false;
+            }
+        };
+        std::for_each(pass.reads.begin(), pass.reads.end(), sync);
+        std::for_each(pass.writes.begin(), pass.writes.end(), sync);
+
+        for (auto const &use : pass.writes) {
+            auto const &resource = resources[use.resource];
+
+            if (use.access == Access::ImageStore) {
+                pendingImageWrite[use.resource] = true;
+            } else if (use.access == Access::RenderTarget) {
+                if (resource.desc.IsDepth()) {
+                    pass.depthTarget = use.resource;
+                } else {
+                    pass.colorTargets.push_back(use.resource);
+                }
+
+                if (use.clear) {
+                    pass.clears.push_back(use.resource);
+                }
+            }
+        }
+
+        if (pass.barrier != 0) {
+            stats.barriers++;
+        }
+    }
+
+    compiled = true;
+    return true;
+}
+
+std::shared_ptr<gl::Framebuffer> RenderGraph::GetFramebuffer(std::vector<ResourceHandle> const &colors,
+                                                             ResourceHandle depth) {
+    std::vector<GLuint> key;
+    key.reserve(colors.size() + 1);
+    for (auto const color : colors) {
+        key.push_back(resources[color].physical->ID());
+    }
+    key.push_back(depth == InvalidResource ? 0 : resources[depth].physical->ID());
+
+    auto it = framebuffers.find(key);
+    if (it != framebuffers.end()) {
+        return it->second;
+    }
+
+    auto const &first = colors.empty() ? resources[depth].physical : resources[colors.front()].physical;
+    auto framebuffer = std::make_shared<gl::Framebuffer>(first->width, first->height);
+    framebuffer->Bind();
+
+    std::vector<GLenum> drawBuffers;
+    for (size_t i = 0; i < colors.size(); ++i) {
+        auto const attachment = static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i);
+        framebuffer->Attach(attachment, resources[colors[i]].physical);
+        drawBuffers.push_back(attachment);
+    }
+    if (depth != InvalidResource) {
+        framebuffer->Attach(GL_DEPTH_ATTACHMENT, resources[depth].physical);
+    }
+
+    if (drawBuffers.empty()) {
+        framebuffer->SetDrawBuffer(GL_NONE);
+        framebuffer->SetReadBuffer(GL_NONE);
+    } else {
+        framebuffer->SetDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+    }
+
+    if (!framebuffer->CheckIsComplete()) {
+        LOG_ERROR(cfl::RenderGraph::GetFramebuffer) << "Framebuffer incomplete";
+    }
+
+    framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+void RenderGraph::Execute(TimerPool *timers) {
+    if (!compiled && !Compile()) {
+        return;
+    }
+
+    for (auto &pass : passes) {
+        if (!pass.alive) continue;
+
+        std::unique_ptr<TimerPool::Scope> timer;
+        if (timers) {
+            timer = std::make_unique<TimerPool::Scope>(timers->Time(pass.name));
+        }
+
+        if (pass.barrier != 0) {
+            OGL(glMemoryBarrier(pass.barrier));
+        }
+
+        for (auto const resource : pass.clears) {
+            auto const &texture = *resources[resource].physical;
+            if (resources[resource].desc.IsDepth()) {
+                GLfloat const one = 1.0f;
+                OGL(glClearTexImage(texture.ID(), 0, GL_DEPTH_COMPONENT, GL_FLOAT, &one));
+            } else {
+                OGL(glClearTexImage(texture.ID(), 0, texture.format, texture.type, nullptr));
+            }
+        }
+
+        if (!pass.colorTargets.empty() || pass.depthTarget != InvalidResource) {
+            auto const framebuffer = GetFramebuffer(pass.colorTargets, pass.depthTarget);
+            framebuffer->Bind();
+            OGL(glViewport(0, 0, framebuffer->width, framebuffer->height));
+        }
+
+        pass.execute(*this);
+    }
+}
+
+gl::GlTextureBase &RenderGraph::Texture(ResourceHandle resource) const {
+    auto const &r = resources[resource];
+    if (r.imported) {
+        return *r.imported;
+    }
+
+    assert(r.physical);
+    return *r.physical;
+}
+
+void RenderGraph::BindFramebuffer(GLenum target, std::vector<ResourceHandle> const &colors, ResourceHandle depth) {
+    GetFramebuffer(colors, depth)->Bind(target);
+}
+
+void RenderGraph::DrawStatsWithImGui() const {
+    ImGui::LabelText("Passes", "%zu (%zu culled)", stats.passes, stats.culledPasses);
+    ImGui::LabelText("Barriers", "%zu", stats.barriers);
+    ImGui::LabelText("Transient textures", "%zu (%.1f MiB)", stats.transientTextures,
+                     stats.transientBytes / (1024.0 * 1024.0));
+    ImGui::LabelText("Physical textures", "%zu (%.1f MiB)", stats.physicalTextures,
+                     stats.physicalBytes / (1024.0 * 1024.0));
+}
+} // namespace cfl
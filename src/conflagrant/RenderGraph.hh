@@ -0,0 +1,199 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/GL.hh>
+#include <conflagrant/Timer.hh>
+#include <conflagrant/gl/Texture.hh>
+#include <conflagrant/gl/Framebuffer.hh>
+
+#include <functional>
+#include <limits>
+#include <map>
+
+namespace cfl {
+/**
+ * @brief Frame graph of render passes that declare which textures they read and write.
+ *
+ * The graph is rebuilt every frame: Reset(), AddPass() for every pass in execution order, Compile() and Execute().
+ * Compiling removes passes whose results are never used, assigns the transient textures to pooled GL textures so
+ * that transients with the same description and non-overlapping lifetimes share storage, and works out which
+ * passes need a memory barrier or a clear before they run. Pooled textures survive between frames and are released
+ * once a frame no longer uses them.
+ */
+class RenderGraph {
+public:
+    using ResourceHandle = size_t;
+    static constexpr ResourceHandle InvalidResource = std::numeric_limits<size_t>::max();
+
+    struct TextureDesc {
+        GLsizei width{0}, height{0};
+        GLenum internalFormat{GL_RGBA8}, format{GL_RGBA}, type{GL_UNSIGNED_BYTE};
+
+        inline bool operator==(TextureDesc const &o) const {
+            return width == o.width && height == o.height && internalFormat == o.internalFormat &&
+                   format == o.format && type == o.type;
+        }
+
+        inline bool IsDepth() const {
+            return format == GL_DEPTH_COMPONENT || format == GL_DEPTH_STENCIL;
+        }
+
+        size_t SizeInBytes() const;
+    };
+
+    class PassBuilder;
+
+    using ExecuteFunction = std::function<void(RenderGraph &graph)>;
+    using SetupFunction = std::function<void(PassBuilder &builder)>;
+
+private:
+    enum class Access : uint8_t {
+        Sample,
+        RenderTarget,
+        ImageStore,
+        Other
+    };
+
+    struct ResourceUse {
+        ResourceHandle resource;
+        Access access;
+        bool clear;
+    };
+
+    struct Resource {
+        string name;
+        TextureDesc desc;
+        std::shared_ptr<gl::GlTextureBase> imported;
+
+        // assigned during compilation
+        std::shared_ptr<gl::Texture2D> physical;
+        size_t firstUse, lastUse;
+        bool cleared;
+    };
+
+    struct Pass {
+        string name;
+        std::vector<ResourceUse> reads, writes;
+        bool hasSideEffects{false};
+        ExecuteFunction execute;
+
+        // assigned during compilation
+        bool alive{false};
+        GLbitfield barrier{0};
+        std::vector<ResourceHandle> clears;
+        std::vector<ResourceHandle> colorTargets;
+        ResourceHandle depthTarget{InvalidResource};
+    };
+
+    struct PooledTexture {
+        TextureDesc desc;
+        std::shared_ptr<gl::Texture2D> texture;
+        bool usedThisFrame;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<PooledTexture> pool;
+    std::map<std::vector<GLuint>, std::shared_ptr<gl::Framebuffer>> framebuffers;
+
+    bool compiled{false};
+
+    struct {
+        size_t passes{0}, culledPasses{0}, barriers{0}, transientTextures{0}, physicalTextures{0};
+        size_t transientBytes{0}, physicalBytes{0};
+    } stats;
+
+    static GLbitfield BarrierFor(Access access);
+
+    std::shared_ptr<gl::Texture2D> AcquireFromPool(TextureDesc const &desc, std::vector<bool> &inUse);
+
+    std::shared_ptr<gl::Framebuffer> GetFramebuffer(std::vector<ResourceHandle> const &colors,
+                                                    ResourceHandle depth);
+
+public:
+    class PassBuilder {
+        RenderGraph &graph;
+        Pass &pass;
+
+        friend class RenderGraph;
+
+        inline PassBuilder(RenderGraph &graph, Pass &pass)
+                : graph(graph), pass(pass) {}
+
+    public:
+        /**
+         * @brief The pass samples the texture.
+         */
+        inline PassBuilder &Read(ResourceHandle resource) {
+            pass.reads.push_back({resource, Access::Sample, false});
+            return *this;
+        }
+
+        /**
+         * @brief The pass renders into the texture. Color targets are attached in declaration order, a texture with
+         * a depth format is attached as the depth buffer. Targets are cleared to zero (depth to one) before their
+         * first write in a frame if clear is set.
+         */
+        inline PassBuilder &Write(ResourceHandle resource, bool clear = false) {
+            pass.writes.push_back({resource, Access::RenderTarget, clear});
+            return *this;
+        }
+
+        /**
+         * @brief The pass writes the texture through image stores, later passes accessing it get a barrier.
+         */
+        inline PassBuilder &WriteImage(ResourceHandle resource) {
+            pass.writes.push_back({resource, Access::ImageStore, false});
+            return *this;
+        }
+
+        /**
+         * @brief The pass modifies the texture by other means, e.g. glClearTexImage or glGenerateMipmap.
+         */
+        inline PassBuilder &Modify(ResourceHandle resource) {
+            pass.writes.push_back({resource, Access::Other, false});
+            return *this;
+        }
+
+        /**
+         * @brief The pass has effects outside of the graph, e.g. it renders to the default framebuffer or uploads
+         * uniforms, and is never culled.
+         */
+        inline PassBuilder &SideEffect() {
+            pass.hasSideEffects = true;
+            return *this;
+        }
+    };
+
+    /**
+     * @brief Clears the passes and resources of the previous frame, the texture pool is kept.
+     */
+    void Reset();
+
+    ResourceHandle CreateTexture(string const &name, TextureDesc const &desc);
+
+    ResourceHandle ImportTexture(string const &name, std::shared_ptr<gl::GlTextureBase> const &texture);
+
+    void AddPass(string const &name, SetupFunction const &setup, ExecuteFunction const &execute);
+
+    bool Compile();
+
+    /**
+     * @brief Runs all passes that survived compilation, timing each of them if a TimerPool is given.
+     */
+    void Execute(TimerPool *timers = nullptr);
+
+    /**
+     * @returns The GL texture backing a resource, only valid while executing.
+     */
+    gl::GlTextureBase &Texture(ResourceHandle resource) const;
+
+    /**
+     * @brief Binds a framebuffer with the given textures attached to target, e.g. to blit from them.
+     */
+    void BindFramebuffer(GLenum target, std::vector<ResourceHandle> const &colors,
+                         ResourceHandle depth = InvalidResource);
+
+    void DrawStatsWithImGui() const;
+};
+} // namespace cfl
@@ -2,6 +2,7 @@
 
 #include <conflagrant/types.hh>
 #include <conflagrant/GL.hh>
+#include <conflagrant/gl/StateCache.hh>
 
 #include <imgui.h>
 
@@ -21,6 +22,9 @@ struct RenderStats {
     size_t MeshesRendered{0};
     size_t MeshesCulled{0};
 
+    size_t StateChangesIssued{0};
+    size_t StateChangesElided{0};
+
     inline void Reset() {
         DrawCalls = 0;
         UniformCalls = 0;
@@ -32,6 +36,17 @@ struct RenderStats {
         ModelsCulled = 0;
         MeshesRendered = 0;
         MeshesCulled = 0;
+        StateChangesIssued = 0;
+        StateChangesElided = 0;
+    }
+
+    /**
+     * @brief Copies the state cache counters accumulated since the last call, i.e. during the previous frame.
+     */
+    inline void CollectStateChanges() {
+        StateChangesIssued = gl::StateCache::CallsIssued();
+        StateChangesElided = gl::StateCache::CallsElided();
+        gl::StateCache::ResetCounters();
     }
 
     inline void DrawWithImGui() const {
@@ -48,6 +63,9 @@ struct RenderStats {
         ImGui::LabelText("Culled models", std::to_string(ModelsCulled).c_str());
         ImGui::LabelText("Rendered meshes", std::to_string(MeshesRendered).c_str());
         ImGui::LabelText("Culled meshes", std::to_string(MeshesCulled).c_str());
+
+        ImGui::LabelText("State changes issued", std::to_string(StateChangesIssued).c_str());
+        ImGui::LabelText("State changes elided", std::to_string(StateChangesElided).c_str());
     }
 };
 } // namespace cfl
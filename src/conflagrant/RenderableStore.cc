@@ -0,0 +1,234 @@
+#include "RenderableStore.hh"
+
+#include <conflagrant/ComponentView.hh>
+#include <conflagrant/ChangeJournal.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace cfl {
+namespace {
+// the generation of a slot whose arrays have to be updated, whatever the generation of its transform
+constexpr uint64_t StaleGeneration = std::numeric_limits<uint64_t>::max();
+
+template<typename... Arrays>
+inline void MoveElements(uint32_t from, uint32_t to, Arrays &... arrays) {
+    ((arrays[to] = arrays[from]), ...);
+}
+
+template<typename... Arrays>
+inline void PopBack(Arrays &... arrays) {
+    (arrays.pop_back(), ...);
+}
+} // namespace
+
+RenderableStore::RenderableStore(entityx::EntityManager &entities, entityx::EventManager &events)
+        : entities(entities) {
+    events.subscribe<entityx::ComponentAddedEvent<comp::Transform>>(*this);
+    events.subscribe<entityx::ComponentAddedEvent<comp::Model>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::Transform>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::Model>>(*this);
+    events.subscribe<entityx::ComponentAddedEvent<comp::BoundingSphere>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::BoundingSphere>>(*this);
+    events.subscribe<entityx::ComponentAddedEvent<comp::VctProperties>>(*this);
+    events.subscribe<entityx::ComponentRemovedEvent<comp::VctProperties>>(*this);
+    events.subscribe<entityx::EntityDestroyedEvent>(*this);
+
+    for (auto entity : entities.entities_with_components<comp::Transform, comp::Model>()) {
+        Insert(entity);
+    }
+}
+
+uint32_t RenderableStore::SlotOf(entityx::Entity::Id id) const {
+    auto const index = id.index();
+    if (index >= slots.size() || slots[index] == NoSlot || ids[slots[index]] != id) {
+        return NoSlot;
+    }
+    return slots[index];
+}
+
+void RenderableStore::Insert(entityx::Entity entity) {
+    if (SlotOf(entity.id()) != NoSlot ||
+        !entity.has_component<comp::Transform>() || !entity.has_component<comp::Model>()) {
+        return;
+    }
+
+    auto const index = entity.id().index();
+    if (index >= slots.size()) {
+        slots.resize(index + 1, NoSlot);
+    }
+    slots[index] = static_cast<uint32_t>(ids.size());
+
+    auto const boundingSphere = entity.component<comp::BoundingSphere>();
+    auto const vct = entity.component<comp::VctProperties>();
+
+    ids.push_back(entity.id());
+    transforms.push_back(entity.component<comp::Transform>().get());
+    models.push_back(entity.component<comp::Model>().get());
+    boundingSpheres.push_back(boundingSphere ? boundingSphere.get() : nullptr);
+    vctProperties.push_back(vct ? vct.get() : nullptr);
+    generations.push_back(StaleGeneration);
+
+    positions.emplace_back(0, 0, 0);
+    rotations.emplace_back(vec3(0, 0, 0));
+    scales.push_back(1);
+    matrices.emplace_back(1);
+    bounds.push_back(geometry::Sphere{vec3(0, 0, 0), 0});
+}
+
+void RenderableStore::MoveSlot(uint32_t from, uint32_t to) {
+    MoveElements(from, to, ids, transforms, models, boundingSpheres, vctProperties, generations,
+                 positions, rotations, scales, matrices, bounds);
+    slots[ids[to].index()] = to;
+}
+
+void RenderableStore::Erase(entityx::Entity::Id id) {
+    auto const slot = SlotOf(id);
+    if (slot == NoSlot) {
+        return;
+    }
+
+    auto const last = static_cast<uint32_t>(ids.size() - 1);
+    if (slot != last) {
+        MoveSlot(last, slot);
+    }
+
+    PopBack(ids, transforms, models, boundingSpheres, vctProperties, generations,
+            positions, rotations, scales, matrices, bounds);
+    slots[id.index()] = NoSlot;
+}
+
+void RenderableStore::receive(entityx::ComponentAddedEvent<comp::Transform> const &event) {
+    Insert(event.entity);
+}
+
+void RenderableStore::receive(entityx::ComponentAddedEvent<comp::Model> const &event) {
+    Insert(event.entity);
+}
+
+void RenderableStore::receive(entityx::ComponentRemovedEvent<comp::Transform> const &event) {
+    entityx::Entity entity = event.entity;
+    Erase(entity.id());
+}
+
+void RenderableStore::receive(entityx::ComponentRemovedEvent<comp::Model> const &event) {
+    entityx::Entity entity = event.entity;
+    Erase(entity.id());
+}
+
+void RenderableStore::receive(entityx::ComponentAddedEvent<comp::BoundingSphere> const &event) {
+    entityx::Entity entity = event.entity;
+    auto const slot = SlotOf(entity.id());
+    if (slot != NoSlot) {
+        boundingSpheres[slot] = entity.component<comp::BoundingSphere>().get();
+        generations[slot] = StaleGeneration;
+    }
+}
+
+void RenderableStore::receive(entityx::ComponentRemovedEvent<comp::BoundingSphere> const &event) {
+    entityx::Entity entity = event.entity;
+    auto const slot = SlotOf(entity.id());
+    if (slot != NoSlot) {
+        boundingSpheres[slot] = nullptr;
+    }
+}
+
+void RenderableStore::receive(entityx::ComponentAddedEvent<comp::VctProperties> const &event) {
+    entityx::Entity entity = event.entity;
+    auto const slot = SlotOf(entity.id());
+    if (slot != NoSlot) {
+        vctProperties[slot] = entity.component<comp::VctProperties>().get();
+    }
+}
+
+void RenderableStore::receive(entityx::ComponentRemovedEvent<comp::VctProperties> const &event) {
+    entityx::Entity entity = event.entity;
+    auto const slot = SlotOf(entity.id());
+    if (slot != NoSlot) {
+        vctProperties[slot] = nullptr;
+    }
+}
+
+void RenderableStore::receive(entityx::EntityDestroyedEvent const &event) {
+    entityx::Entity entity = event.entity;
+    Erase(entity.id());
+}
+
+void RenderableStore::InvalidateEditedSlots() {
+    auto &journal = ChangeJournal::Of(entities);
+
+    changes.clear();
+    if (!journal.ChangedSince(journalFrame, changes)) {
+        std::fill(generations.begin(), generations.end(), StaleGeneration);
+    }
+    journalFrame = journal.Frame();
+
+    for (auto const &change : changes) {
+        auto const slot = SlotOf(change.entity);
+        if (slot == NoSlot) {
+            continue;
+        }
+
+        if (change.component == GetComponentTypeId<comp::Model>()) {
+            // the sphere was fitted to the previous model
+            if (boundingSpheres[slot] && models[slot]->value) {
+                Entity(slot).component<comp::BoundingSphere>()->Reset(*models[slot]);
+            }
+            generations[slot] = StaleGeneration;
+        } else if (change.component == GetComponentTypeId<comp::BoundingSphere>()) {
+            generations[slot] = StaleGeneration;
+        }
+    }
+}
+
+void RenderableStore::Update() {
+    // the transform generation does not change with the BoundingSphere or Model
+    InvalidateEditedSlots();
+
+    for (uint32_t slot = 0; slot < ids.size(); ++slot) {
+        if (!boundingSpheres[slot]) {
+            // a model that is not loaded yet would give it empty bounds
+            if (!models[slot]->value) {
+                continue;
+            }
+
+            // the event makes the slot stale
+            auto boundingSphere = Entity(slot).assign<comp::BoundingSphere>();
+            boundingSphere->Reset(*models[slot]);
+            ChangeJournal::Of(entities).Record<comp::BoundingSphere>(Entity(slot));
+        }
+
+        auto const &transform = *transforms[slot];
+        if (transform.Generation() == generations[slot]) {
+            continue;
+        }
+        generations[slot] = transform.Generation();
+
+        positions[slot] = transform.Position();
+        rotations[slot] = transform.Quaternion();
+        scales[slot] = transform.Scale();
+        matrices[slot] = transform.GetMatrix();
+        bounds[slot] = geometry::Transform(boundingSpheres[slot]->sphere, matrices[slot], scales[slot]);
+    }
+}
+
+void RenderableStore::Cull(geometry::Frustum const *frustum, std::vector<uint32_t> &visible,
+                           std::vector<uint32_t> *culled) const {
+    visible.reserve(visible.size() + bounds.size());
+
+    for (uint32_t slot = 0; slot < bounds.size(); ++slot) {
+        if (!frustum || frustum->ComputeIntersection(bounds[slot]) != geometry::IntersectionType::OUTSIDE) {
+            visible.push_back(slot);
+        } else if (culled) {
+            culled->push_back(slot);
+        }
+    }
+}
+
+RenderableStore &RenderableStore::Of(entityx::EntityManager &entities) {
+    auto const views = ComponentViews::Of(entities);
+    assert(views != nullptr && "the EntityManager has no ComponentViews attached");
+    return views->GetCache<RenderableStore>();
+}
+} // namespace cfl
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/geometry.hh>
+#include <conflagrant/ChangeJournal.hh>
+#include <conflagrant/components/Transform.hh>
+#include <conflagrant/components/Model.hh>
+#include <conflagrant/components/BoundingSphere.hh>
+#include <conflagrant/components/VctProperties.hh>
+
+#include <entityx/Entity.h>
+#include <entityx/Event.h>
+
+#include <limits>
+
+namespace cfl {
+/**
+ * @brief The data that rendering reads of every entity with a Transform and a Model, stored as a structure of arrays
+ * indexed by a dense slot per entity. The transform, culling and draw list stages stream through these arrays instead
+ * of looking up the components of every entity in every pass.
+ *
+ * The slots follow the component events, removing an entity moves the last slot into its place. Update() copies the
+ * transforms that changed since the last update and recomputes the bounds of the entities whose BoundingSphere or Model
+ * the ChangeJournal recorded a change of, so the arrays are only valid after it.
+ */
+class RenderableStore : public entityx::Receiver<RenderableStore> {
+    static constexpr uint32_t NoSlot = std::numeric_limits<uint32_t>::max();
+
+    entityx::EntityManager &entities;
+
+    // the slot of every entity index
+    std::vector<uint32_t> slots;
+
+    // cold: the components, to update the hot arrays from
+    std::vector<entityx::Entity::Id> ids;
+    std::vector<comp::Transform const *> transforms;
+    std::vector<comp::Model *> models;
+    std::vector<comp::BoundingSphere const *> boundingSpheres;
+    std::vector<comp::VctProperties const *> vctProperties;
+    std::vector<uint64_t> generations;
+
+    // hot: copies of the transforms, and what is derived from them
+    std::vector<vec3> positions;
+    std::vector<quat> rotations;
+    std::vector<float> scales;
+    std::vector<mat4> matrices;
+    std::vector<geometry::Sphere> bounds;
+
+    // the journal frame that the last update read the changes of, and a buffer for reading them
+    uint64_t journalFrame{0};
+    std::vector<ChangeJournal::Change> changes;
+
+    uint32_t SlotOf(entityx::Entity::Id id) const;
+
+    void Insert(entityx::Entity entity);
+
+    void Erase(entityx::Entity::Id id);
+
+    void MoveSlot(uint32_t from, uint32_t to);
+
+    void InvalidateEditedSlots();
+
+public:
+    RenderableStore(entityx::EntityManager &entities, entityx::EventManager &events);
+
+    RenderableStore(RenderableStore const &) = delete;
+
+    void receive(entityx::ComponentAddedEvent<comp::Transform> const &event);
+
+    void receive(entityx::ComponentAddedEvent<comp::Model> const &event);
+
+    void receive(entityx::ComponentRemovedEvent<comp::Transform> const &event);
+
+    void receive(entityx::ComponentRemovedEvent<comp::Model> const &event);
+
+    void receive(entityx::ComponentAddedEvent<comp::BoundingSphere> const &event);
+
+    void receive(entityx::ComponentRemovedEvent<comp::BoundingSphere> const &event);
+
+    void receive(entityx::ComponentAddedEvent<comp::VctProperties> const &event);
+
+    void receive(entityx::ComponentRemovedEvent<comp::VctProperties> const &event);
+
+    void receive(entityx::EntityDestroyedEvent const &event);
+
+    /**
+     * @brief Copies the transforms whose generation changed and updates their matrices and world space bounds, which are
+     * also updated for edited BoundingSphere's. Fits the BoundingSphere to the model when the Model is edited and
+     * assigns one to the entities that have none.
+     */
+    void Update();
+
+    /**
+     * @brief Appends the slots whose bounds are not outside of the frustum to visible and the others to culled, if
+     * given. Without a frustum, every slot is visible.
+     */
+    void Cull(geometry::Frustum const *frustum, std::vector<uint32_t> &visible,
+              std::vector<uint32_t> *culled = nullptr) const;
+
+    /**
+     * @returns The RenderableStore of the ComponentViews attached to the EntityManager.
+     */
+    static RenderableStore &Of(entityx::EntityManager &entities);
+
+    inline size_t Size() const {
+        return ids.size();
+    }
+
+    inline entityx::Entity Entity(uint32_t slot) const {
+        return entityx::Entity(&entities, ids[slot]);
+    }
+
+    inline comp::Model &Model(uint32_t slot) const {
+        return *models[slot];
+    }
+
+    inline comp::VctProperties const *VctProperties(uint32_t slot) const {
+        return vctProperties[slot];
+    }
+
+    inline vec3 const &Position(uint32_t slot) const {
+        return positions[slot];
+    }
+
+    inline quat const &Rotation(uint32_t slot) const {
+        return rotations[slot];
+    }
+
+    inline float Scale(uint32_t slot) const {
+        return scales[slot];
+    }
+
+    inline mat4 const &Matrix(uint32_t slot) const {
+        return matrices[slot];
+    }
+
+    /**
+     * @returns The world space bounding sphere.
+     */
+    inline geometry::Sphere const &Bounds(uint32_t slot) const {
+        return bounds[slot];
+    }
+};
+} // namespace cfl
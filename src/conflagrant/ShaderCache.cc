@@ -0,0 +1,198 @@
+#include "ShaderCache.hh"
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace cfl {
+namespace {
+constexpr uint32_t Magic = 0x42464c43; // "CFLB"
+constexpr uint32_t Version = 1;
+
+struct BinaryHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t length;
+};
+
+// 64 bit FNV-1a
+constexpr uint64_t FnvOffsetBasis = 0xcbf29ce484222325ull;
+constexpr uint64_t FnvPrime = 0x100000001b3ull;
+
+void HashBytes(uint64_t &hash, void const *data, size_t size) {
+    auto bytes = static_cast<uint8_t const *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FnvPrime;
+    }
+}
+
+void HashString(uint64_t &hash, string const &str) {
+    // include the length so that the boundaries between concatenated strings matter
+    uint64_t const length = str.size();
+    HashBytes(hash, &length, sizeof(length));
+    HashBytes(hash, str.data(), str.size());
+}
+
+string GetGlString(GLenum name) {
+    OGL(auto const str = glGetString(name));
+    return str ? string(reinterpret_cast<char const *>(str)) : string();
+}
+} // namespace
+
+Path ShaderCache::Directory;
+bool ShaderCache::isEnabled = false;
+string ShaderCache::driverIdentifier;
+size_t ShaderCache::hits = 0;
+size_t ShaderCache::misses = 0;
+size_t ShaderCache::rejected = 0;
+
+bool ShaderCache::SetDirectory(string const &pathToFolder) {
+    Path path(pathToFolder);
+
+    if (!path.exists() && !filesystem::create_directory(path)) {
+        LOG_INFO(cfl::ShaderCache::SetDirectory) << "Failed to create directory (" << path << ")";
+        return false;
+    }
+
+    if (!path.is_directory()) {
+        LOG_INFO(cfl::ShaderCache::SetDirectory) << "Path is not a directory (" << path << ")";
+        return false;
+    }
+
+    Directory = path;
+    isEnabled = true;
+    return true;
+}
+
+void ShaderCache::Disable() {
+    isEnabled = false;
+}
+
+bool ShaderCache::IsEnabled() {
+    if (!isEnabled) {
+        return false;
+    }
+
+    if (driverIdentifier.empty()) {
+        GLint numFormats = 0;
+        OGL(glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats));
+        if (numFormats == 0) {
+            LOG_INFO(cfl::ShaderCache::IsEnabled) << "Driver supports no program binary formats, disabling cache";
+            isEnabled = false;
+            return false;
+        }
+
+        driverIdentifier = GetGlString(GL_VENDOR) + "\n" + GetGlString(GL_RENDERER) + "\n" +
+                           GetGlString(GL_VERSION);
+    }
+
+    return true;
+}
+
+uint64_t ShaderCache::ComputeKey(std::vector<string const *> const &sources) {
+    // queries the driver identifier if that hasn't happened yet
+    IsEnabled();
+
+    uint64_t hash = FnvOffsetBasis;
+    HashBytes(hash, &Version, sizeof(Version));
+    HashString(hash, driverIdentifier);
+    for (auto const source : sources) {
+        HashString(hash, *source);
+    }
+    return hash;
+}
+
+Path ShaderCache::PathForKey(uint64_t key) {
+    std::stringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return Directory / Path(name.str());
+}
+
+std::shared_ptr<gl::Shader> ShaderCache::Load(uint64_t key) {
+    if (!IsEnabled()) {
+        return nullptr;
+    }
+
+    auto const path = PathForKey(key);
+    std::ifstream file(path.str(), std::ios::binary);
+    if (!file.is_open()) {
+        misses++;
+        return nullptr;
+    }
+
+    BinaryHeader header{};
+    std::vector<uint8_t> binary;
+
+    file.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (file && header.magic == Magic && header.version == Version) {
+        binary.resize(header.length);
+        file.read(reinterpret_cast<char *>(binary.data()), header.length);
+    }
+    bool const isComplete = file && !binary.empty();
+    file.close();
+
+    auto shader = isComplete
+                  ? gl::Shader::FromBinary(header.format, binary.data(), static_cast<GLsizei>(binary.size()))
+                  : nullptr;
+    if (!shader) {
+        LOG_INFO(cfl::ShaderCache::Load) << "Discarding unusable program binary (" << path << ")";
+        std::remove(path.str().c_str());
+        rejected++;
+        return nullptr;
+    }
+
+    hits++;
+    return shader;
+}
+
+bool ShaderCache::Store(uint64_t key, gl::Shader const &shader) {
+    if (!IsEnabled()) {
+        return false;
+    }
+
+    BinaryHeader header{Magic, Version, 0, 0};
+    std::vector<uint8_t> binary;
+    GLenum format;
+    if (!shader.GetBinary(format, binary)) {
+        return false;
+    }
+    header.format = format;
+    header.length = static_cast<uint32_t>(binary.size());
+
+    // write to a temporary file first so that a concurrently starting instance never reads a partial binary
+    auto const path = PathForKey(key);
+    auto const temporaryPath = path.str() + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_INFO(cfl::ShaderCache::Store) << "Failed to open path for writing (" << temporaryPath << ")";
+            return false;
+        }
+
+        file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const *>(binary.data()), binary.size());
+        if (!file) {
+            file.close();
+            std::remove(temporaryPath.c_str());
+            return false;
+        }
+    }
+
+    return std::rename(temporaryPath.c_str(), path.str().c_str()) == 0;
+}
+
+size_t ShaderCache::Hits() {
+    return hits;
+}
+
+size_t ShaderCache::Misses() {
+    return misses;
+}
+
+size_t ShaderCache::Rejected() {
+    return rejected;
+}
+} // namespace cfl
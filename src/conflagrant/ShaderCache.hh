@@ -0,0 +1,56 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/GL.hh>
+#include <conflagrant/gl/Shader.hh>
+
+namespace cfl {
+/**
+ * @brief On-disk cache of linked program binaries.
+ *
+ * Programs are keyed by a hash of their fully preprocessed stage sources together with the GL vendor, renderer and
+ * version strings, so a driver update or an edited include invalidates the entry. Binaries the driver rejects are
+ * deleted and the caller compiles from source as usual.
+ */
+class ShaderCache final {
+    ShaderCache() = delete;
+
+    static Path Directory;
+    static bool isEnabled;
+
+    static string driverIdentifier;
+
+    static size_t hits, misses, rejected;
+
+    static Path PathForKey(uint64_t key);
+
+public:
+    /**
+     * @brief Enables the cache, storing binaries in the given folder. The folder is created if it does not exist.
+     */
+    static bool SetDirectory(string const &pathToFolder);
+
+    static void Disable();
+
+    static bool IsEnabled();
+
+    /**
+     * @returns The cache key of a program made from the given preprocessed stage sources, in pipeline order.
+     * Requires a current GL context.
+     */
+    static uint64_t ComputeKey(std::vector<string const *> const &sources);
+
+    /**
+     * @returns The cached program, or nullptr if there is none or the driver rejected it.
+     */
+    static std::shared_ptr<gl::Shader> Load(uint64_t key);
+
+    static bool Store(uint64_t key, gl::Shader const &shader);
+
+    static size_t Hits();
+
+    static size_t Misses();
+
+    static size_t Rejected();
+};
+} // namespace cfl
@@ -1,14 +1,23 @@
 #include "ShaderSourceManager.hh"
+#include "ShaderCache.hh"
 
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
 #include <fstream>
 #include <sstream>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <deque>
 
 namespace cfl {
 namespace Tokens {
 static string const Include = "#include ";
+static string const Version = "#version";
 }
 
 PathResolver ShaderSourceManager::Resolver;
@@ -83,7 +92,48 @@ struct ShaderInfo {
     }
 };
 
-bool GetShaderSource(PathResolver const& resolver, string const& pathToShaderSource, string &out) {
+namespace {
+struct CachedFile {
+    std::shared_ptr<ShaderInfo const> info;
+    std::time_t modified;
+};
+
+struct CachedStage {
+    string source;
+    size_t generation;
+};
+
+struct CachedProgram {
+    std::weak_ptr<gl::Shader> shader;
+    std::vector<size_t> stageGenerations;
+};
+
+std::mutex cacheMutex;
+
+// parsed files by resolved path
+std::unordered_map<string, CachedFile> filesByPath;
+
+// preprocessed stages by the path they were requested with
+std::unordered_map<string, CachedStage> stagesByPath;
+
+// reverse include graph, from a resolved path to every stage whose include closure contains it
+std::unordered_map<string, std::unordered_set<string>> stagesIncluding;
+
+// programs by their joined stage paths
+std::unordered_map<string, CachedProgram> programsByStages;
+
+size_t nextGeneration = 1;
+
+std::time_t GetModificationTime(Path const &path) {
+    struct stat status;
+    if (stat(path.str().c_str(), &status) != 0) {
+        return 0;
+    }
+    return status.st_mtime;
+}
+} // namespace
+
+bool ResolveShaderPath(PathResolver const &resolver, string const &pathToShaderSource, Path &out) {
     Path path(pathToShaderSource);
     path = resolver.resolve(path);
 
@@ -97,6 +147,11 @@ bool GetShaderSource(PathResolver const& resolver, string const& pathToShaderSou
         return false;
     }
 
+    out = path;
+    return true;
+}
+
+bool GetShaderSource(Path const &path, string &out) {
     std::ifstream file(path.str());
     if (!file.is_open()) {
         LOG_INFO(cfl::ShaderSourceManager::RegisterShaderSource) << "Failed to open path for reading (" << path << ")";
@@ -111,9 +166,49 @@ bool GetShaderSource(PathResolver const& resolver, string const& pathToShaderSou
     return true;
 }
 
+/**
+ * @brief Gets the parsed file from the cache, reading and parsing it if it is new or has changed on disk.
+ */
+bool GetShaderInfo(PathResolver const &resolver, string const &pathToShaderSource,
+                   std::shared_ptr<ShaderInfo const> &out, string &resolvedPath) {
+    Path path;
+    if (!ResolveShaderPath(resolver, pathToShaderSource, path)) {
+        return false;
+    }
+
+    resolvedPath = path.str();
+    auto const modified = GetModificationTime(path);
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = filesByPath.find(resolvedPath);
+        if (it != filesByPath.end() && it->second.modified == modified) {
+            out = it->second.info;
+            return true;
+        }
+    }
+
+    string source;
+    if (!GetShaderSource(path, source)) {
+        return false;
+    }
+
+    auto info = std::make_shared<ShaderInfo>();
+    if (!ShaderInfo::CreateFromSource(source, *info)) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        filesByPath[resolvedPath] = CachedFile{info, modified};
+    }
+
+    out = std::move(info);
+    return true;
+}
+
 bool Preprocess(PathResolver const& resolver,
                 ShaderInfo const &info, std::stringstream &out,
-                std::unordered_map<string, ShaderInfo> const &shaderInfosByPath,
                 std::unordered_set<string> &included) {
     auto N = info.lines.size();
     for (decltype(N) i = 0; i < N; i++) {
@@ -124,24 +219,19 @@ bool Preprocess(PathResolver const& resolver,
             continue;
         }
 
-        auto includePath = it->second;
-        if (included.find(includePath) != included.end()) {
-            // already included
-            continue;
-        }
-
-        string source;
-        if (!GetShaderSource(resolver, includePath, source)) {
+        std::shared_ptr<ShaderInfo const> includedInfo;
+        string resolvedPath;
+        if (!GetShaderInfo(resolver, it->second, includedInfo, resolvedPath)) {
             return false;
         }
 
-        ShaderInfo info;
-        if (!ShaderInfo::CreateFromSource(source, info)) {
-            return false;
+        if (included.find(resolvedPath) != included.end()) {
+            // already included
+            continue;
         }
 
-        included.insert(includePath);
-        if (!Preprocess(resolver, info, out, shaderInfosByPath, included)) {
+        included.insert(resolvedPath);
+        if (!Preprocess(resolver, *includedInfo, out, included)) {
             return false;
         }
     }
@@ -150,67 +240,397 @@ bool Preprocess(PathResolver const& resolver,
 }
 
 bool ShaderSourceManager::PrecompileShader(string const &pathToShaderSource, string &out) {
-    string source;
-    if (!GetShaderSource(Resolver, pathToShaderSource, source)) {
-        return false;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = stagesByPath.find(pathToShaderSource);
+        if (it != stagesByPath.end()) {
+            out = it->second.source;
+            return true;
+        }
     }
 
-    ShaderInfo info;
-    if (!ShaderInfo::CreateFromSource(source, info)) {
+    std::shared_ptr<ShaderInfo const> info;
+    string resolvedPath;
+    if (!GetShaderInfo(Resolver, pathToShaderSource, info, resolvedPath)) {
         return false;
     }
 
     std::stringstream preprocessed;
     std::unordered_set<string> included;
-    std::unordered_map<string, ShaderInfo> shaderInfosByPath;
-
-    shaderInfosByPath[pathToShaderSource] = info;
-    included.insert(pathToShaderSource);
+    included.insert(resolvedPath);
 
-    if (!cfl::Preprocess(Resolver, info, preprocessed, shaderInfosByPath, included)) {
+    if (!cfl::Preprocess(Resolver, *info, preprocessed, included)) {
         return false;
     }
 
     out = preprocessed.str();
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    stagesByPath[pathToShaderSource] = CachedStage{out, nextGeneration++};
+    for (auto const &path : included) {
+        stagesIncluding[path].insert(pathToShaderSource);
+    }
+
     return true;
 }
 
-std::shared_ptr<gl::Shader> LoadShader(string const &vertexPathStr,
-                                       string const &fragmentPathStr) {
-    string vertex;
-    string fragment;
+bool ShaderSourceManager::PrecompileShaders(std::vector<string> const &pathsToShaderSources) {
+    $
+    std::vector<string> paths;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        for (auto const &path : pathsToShaderSources) {
+            if (stagesByPath.find(path) == stagesByPath.end() &&
+                std::find(paths.begin(), paths.end(), path) == paths.end()) {
+                paths.push_back(path);
+            }
+        }
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> succeeded{true};
+
+    auto work = [&]() {
+        string source;
+        for (auto i = next++; i < paths.size(); i = next++) {
+            if (!PrecompileShader(paths[i], source)) {
+                succeeded = false;
+            }
+        }
+    };
 
-    if (!ShaderSourceManager::PrecompileShader(vertexPathStr, vertex) ||
-        !ShaderSourceManager::PrecompileShader(fragmentPathStr, fragment)) {
-        return nullptr;
+    auto const numThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), paths.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i) {
+        threads.emplace_back(work);
     }
+    work();
 
-    return std::make_shared<gl::Shader>(vertex, fragment);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    return succeeded;
+}
+
+size_t ShaderSourceManager::CheckForChanges() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    std::vector<string> changed;
+    for (auto const &kvp : filesByPath) {
+        if (GetModificationTime(Path(kvp.first)) != kvp.second.modified) {
+            changed.push_back(kvp.first);
+        }
+    }
+
+    for (auto const &path : changed) {
+        filesByPath.erase(path);
+
+        auto it = stagesIncluding.find(path);
+        if (it == stagesIncluding.end()) {
+            continue;
+        }
+
+        for (auto const &stage : it->second) {
+            stagesByPath.erase(stage);
+        }
+        stagesIncluding.erase(it);
+    }
+
+    if (!changed.empty()) {
+        LOG_INFO(cfl::ShaderSourceManager::CheckForChanges) << changed.size() << " shader source file(s) changed";
+    }
+
+    return changed.size();
+}
+
+size_t ShaderSourceManager::GetStageGeneration(string const &pathToShaderSource) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = stagesByPath.find(pathToShaderSource);
+    return it == stagesByPath.end() ? 0 : it->second.generation;
+}
+
+/**
+ * @brief Loads the program from the binary cache, or submits it for compilation, marking it to be added to the
+ * cache once it is linked.
+ */
+template<typename Compile>
+void SubmitCachedOrCompile(std::vector<string const *> const &sources, Compile &&compile,
+                           PendingShaders::Program &out) {
+    if (!ShaderCache::IsEnabled()) {
+        out.shader = compile();
+        return;
+    }
+
+    out.cacheKey = ShaderCache::ComputeKey(sources);
+    if ((out.shader = ShaderCache::Load(out.cacheKey))) {
+        return;
+    }
+
+    out.shader = compile();
+    out.storeInCache = true;
+}
+
+/**
+ * @brief Waits for a submitted program and stores it in the ShaderCache if it was compiled from source.
+ * @returns false if it failed to build.
+ */
+bool FinalizeProgram(PendingShaders::Program const &program) {
+    if (!program.shader || !program.shader->Finalize()) {
+        return false;
+    }
+
+    if (program.storeInCache) {
+        ShaderCache::Store(program.cacheKey, *program.shader);
+    }
+    return true;
+}
+
+/**
+ * @brief Inserts a #define line for each of the given definitions right after the #version directive, which GLSL
+ * requires to come first.
+ */
+void InjectDefines(string &source, std::vector<string> const &defines) {
+    if (defines.empty()) {
+        return;
+    }
+
+    string lines;
+    for (auto const &define : defines) {
+        lines += "#define " + define + "\n";
+    }
+
+    size_t position = 0;
+    if (source.find(Tokens::Version) == 0) {
+        auto const endOfLine = source.find('\n');
+        position = endOfLine == string::npos ? source.size() : endOfLine + 1;
+    }
+    source.insert(position, lines);
+}
+
+/**
+ * @brief Returns the previously loaded program if none of its stages were preprocessed again since, otherwise
+ * submits it from the stages' (cached) preprocessed sources without waiting for the driver.
+ */
+PendingShaders::Program SubmitProgram(std::shared_ptr<gl::Shader> *target,
+                                      std::vector<string> const &stagePaths,
+                                      std::vector<string> const &defines) {
+    PendingShaders::Program program{target, nullptr, false, 0};
+
+    std::vector<string> sources(stagePaths.size());
+    std::vector<size_t> generations(stagePaths.size());
+    string key;
+    for (size_t i = 0; i < stagePaths.size(); ++i) {
+        if (!ShaderSourceManager::PrecompileShader(stagePaths[i], sources[i])) {
+            return program;
+        }
+        InjectDefines(sources[i], defines);
+        generations[i] = ShaderSourceManager::GetStageGeneration(stagePaths[i]);
+        key += stagePaths[i] + "\n";
+    }
+    for (auto const &define : defines) {
+        key += "#define " + define + "\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = programsByStages.find(key);
+        if (it != programsByStages.end() && it->second.stageGenerations == generations) {
+            if ((program.shader = it->second.shader.lock())) {
+                return program;
+            }
+        }
+    }
+
+    switch (stagePaths.size()) {
+        case 1:
+            SubmitCachedOrCompile({&sources[0]}, [&]() {
+                return std::make_shared<gl::Shader>(sources[0]);
+            }, program);
+            break;
+        case 2:
+            SubmitCachedOrCompile({&sources[0], &sources[1]}, [&]() {
+                return std::make_shared<gl::Shader>(sources[0], sources[1]);
+            }, program);
+            break;
+        case 3:
+            SubmitCachedOrCompile({&sources[0], &sources[1], &sources[2]}, [&]() {
+                return std::make_shared<gl::Shader>(sources[0], sources[2], sources[1]);
+            }, program);
+            break;
+        default:
+            LOG_ERROR(cfl::SubmitProgram) << "Unsupported number of shader stages: " << stagePaths.size();
+            return program;
+    }
+
+    program.shader->SetDefines(defines);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    programsByStages[key] = CachedProgram{program.shader, generations};
+    return program;
+}
+
+/**
+ * @brief Like SubmitProgram(), but waits for the program to be built. Throws if the sources could not be preprocessed
+ * or the program failed to build, so the result is never null.
+ */
+std::shared_ptr<gl::Shader> LoadProgram(std::vector<string> const &stagePaths,
+                                        std::vector<string> const &defines = {}) {
+    auto const program = SubmitProgram(nullptr, stagePaths, defines);
+    if (!FinalizeProgram(program)) {
+        throw std::runtime_error("GLSL program failed to build");
+    }
+    return program.shader;
+}
+
+std::shared_ptr<gl::Shader> LoadShader(string const &vertexPathStr,
+                                       string const &fragmentPathStr) {
+    ShaderSourceManager::CheckForChanges();
+    return LoadProgram({vertexPathStr, fragmentPathStr});
 }
 
 std::shared_ptr<gl::Shader> LoadShader(string const &vertexPathStr,
                                        string const &geometryPathStr,
                                        string const &fragmentPathStr) {
-    string vertex;
-    string fragment;
-    string geometry;
+    ShaderSourceManager::CheckForChanges();
+    return LoadProgram({vertexPathStr, geometryPathStr, fragmentPathStr});
+}
+
+std::shared_ptr<gl::Shader> LoadComputeShader(string const &computePathStr) {
+    ShaderSourceManager::CheckForChanges();
+    return LoadProgram({computePathStr});
+}
 
-    if (!ShaderSourceManager::PrecompileShader(vertexPathStr, vertex) ||
-        !ShaderSourceManager::PrecompileShader(geometryPathStr, geometry) ||
-        !ShaderSourceManager::PrecompileShader(fragmentPathStr, fragment)) {
-        return nullptr;
+PendingShaders LoadShadersAsync(std::vector<ShaderProgramDescription> const &programs) {
+    $
+    ShaderSourceManager::CheckForChanges();
+
+    std::vector<string> stages;
+    for (auto const &program : programs) {
+        stages.insert(stages.end(), program.stages.begin(), program.stages.end());
     }
+    ShaderSourceManager::PrecompileShaders(stages);
 
-    return std::make_shared<gl::Shader>(vertex, fragment, geometry);
+    // submit everything before checking any status, so the driver can compile them concurrently
+    std::vector<PendingShaders::Program> submitted;
+    for (auto const &program : programs) {
+        submitted.push_back(SubmitProgram(program.shader, program.stages, program.defines));
+    }
+    return PendingShaders(std::move(submitted));
 }
 
-std::shared_ptr<gl::Shader> LoadComputeShader(string const &computePathStr) {
-    string compute;
+void LoadShaders(std::vector<ShaderProgramDescription> const &programs) {
+    if (!LoadShadersAsync(programs).Finish()) {
+        throw std::runtime_error("GLSL program failed to build");
+    }
+}
+
+PendingShaders::PendingShaders(std::vector<Program> &&programs)
+        : programs(std::move(programs)) {}
+
+bool PendingShaders::IsEmpty() const {
+    return programs.empty();
+}
+
+bool PendingShaders::IsReady() const {
+    return std::all_of(programs.begin(), programs.end(), [](Program const &program) {
+        return !program.shader || program.shader->IsReady();
+    });
+}
+
+bool PendingShaders::Finish() {
+    bool succeeded = true;
+    for (auto const &program : programs) {
+        succeeded = FinalizeProgram(program) && succeeded;
+    }
+
+    if (succeeded) {
+        for (auto const &program : programs) {
+            *program.target = program.shader;
+        }
+    } else {
+        LOG_ERROR(cfl::PendingShaders::Finish) << "Some programs failed to build, keeping the previous ones";
+    }
+
+    programs.clear();
+    return succeeded;
+}
+
+bool PendingShaders::Poll() {
+    if (programs.empty() || !IsReady()) {
+        return false;
+    }
+
+    Finish();
+    return true;
+}
 
-    if (!ShaderSourceManager::PrecompileShader(computePathStr, compute)) {
-        return nullptr;
+std::vector<ShaderProgramDescription> ShaderPermutations::Load(std::vector<string> const &newStages,
+                                                               std::vector<string> const &newFeatureDefines,
+                                                               std::vector<string> const &newCommonDefines) {
+    stages = newStages;
+    featureDefines = newFeatureDefines;
+    commonDefines = newCommonDefines;
+
+    // the variants that were used so far get rebuilt, the others are built when they are requested next
+    failedVariants.clear();
+    std::vector<ShaderProgramDescription> reloads;
+    for (auto it = variants.begin(); it != variants.end();) {
+        if (!it->second) {
+            it = variants.erase(it);
+            continue;
+        }
+        reloads.push_back(ShaderProgramDescription{&it->second, stages, DefinesFor(it->first)});
+        ++it;
     }
+    return reloads;
+}
+
+std::vector<ShaderProgramDescription> ShaderPermutations::Request(std::vector<uint32_t> const &featureMasks) {
+    std::vector<ShaderProgramDescription> requests;
+    for (auto const features : featureMasks) {
+        if (variants.find(features) != variants.end()) {
+            continue;
+        }
+
+        // the map keeps its values in place, so the target outlives rehashing
+        requests.push_back(ShaderProgramDescription{&variants[features], stages, DefinesFor(features)});
+    }
+    return requests;
+}
 
-    return std::make_shared<gl::Shader>(compute);
+std::shared_ptr<gl::Shader> const &ShaderPermutations::Get(uint32_t features) {
+    auto &variant = variants[features];
+    if (variant || failedVariants.count(features) != 0) {
+        return variant;
+    }
+
+    // not requested up front, or its batch failed because of another variant
+    auto const program = SubmitProgram(nullptr, stages, DefinesFor(features));
+    if (!FinalizeProgram(program)) {
+        LOG_ERROR(cfl::ShaderPermutations::Get) << "Variant " << features << " of " << stages.front()
+                                                << " failed to build, skipping its draws";
+        failedVariants.insert(features);
+        return variant;
+    }
+    return variant = program.shader;
+}
+
+size_t ShaderPermutations::NumVariants() const {
+    return static_cast<size_t>(std::count_if(variants.begin(), variants.end(), [](auto const &kvp) {
+        return kvp.second != nullptr;
+    }));
+}
+
+std::vector<string> const &ShaderPermutations::Stages() const {
+    return stages;
+}
+
+std::vector<string> ShaderPermutations::DefinesFor(uint32_t features) const {
+    std::vector<string> defines = commonDefines;
+    for (size_t i = 0; i < featureDefines.size(); ++i) {
+        defines.push_back(featureDefines[i] + ((features & (1u << i)) ? " 1" : " 0"));
+    }
+    return defines;
 }
 } // namespace cfl
@@ -9,6 +9,13 @@
 #include <unordered_set>
 
 namespace cfl {
+/**
+ * @brief Resolves and preprocesses shader sources.
+ *
+ * Parsed files are cached process-wide by resolved path and modification time, and preprocessed stages are
+ * memoized together with their include closure. A reverse include graph maps every file to the stages that include
+ * it, so that CheckForChanges() only invalidates what actually depends on an edited file.
+ */
 class ShaderSourceManager {
     ShaderSourceManager() = delete;
 
@@ -18,6 +25,85 @@ public:
     static bool RegisterShaderFolder(string const& pathToFolder);
 
     static bool PrecompileShader(string const &pathToShaderSource, string &out);
+
+    /**
+     * @brief Preprocesses the given stages on all hardware threads, so that subsequent PrecompileShader() calls for
+     * them are lookups.
+     * @returns false if any of them failed to preprocess.
+     */
+    static bool PrecompileShaders(std::vector<string> const &pathsToShaderSources);
+
+    /**
+     * @brief Drops the cached files that changed on disk, along with every preprocessed stage that includes them.
+     * @returns The number of changed files.
+     */
+    static size_t CheckForChanges();
+
+    /**
+     * @returns A number that changes every time the stage is preprocessed again, 0 if it has not been preprocessed.
+     */
+    static size_t GetStageGeneration(string const &pathToShaderSource);
+};
+
+struct ShaderProgramDescription {
+    std::shared_ptr<gl::Shader> *shader;
+
+    /**
+     * @brief Either a compute stage, vertex and fragment stages, or vertex, geometry and fragment stages.
+     */
+    std::vector<string> stages;
+
+    /**
+     * @brief Definitions injected after the #version directive of every stage.
+     */
+    std::vector<string> defines;
+};
+
+/**
+ * @brief Programs that were submitted to the driver, but whose compile and link status was not checked yet.
+ *
+ * The targets keep their previous programs until all of the new ones are built, so that a reload neither stalls
+ * rendering nor leaves a system with a broken program.
+ */
+class PendingShaders {
+public:
+    struct Program {
+        std::shared_ptr<gl::Shader> *target;
+        std::shared_ptr<gl::Shader> shader;
+
+        /**
+         * @brief Set if the program was compiled from source, to store its binary in the ShaderCache once linked.
+         */
+        bool storeInCache;
+        uint64_t cacheKey;
+    };
+
+private:
+    std::vector<Program> programs;
+
+public:
+    PendingShaders() = default;
+
+    explicit PendingShaders(std::vector<Program> &&programs);
+
+    bool IsEmpty() const;
+
+    /**
+     * @returns true if Finish() would not block.
+     */
+    bool IsReady() const;
+
+    /**
+     * @brief Waits for the programs and replaces the targets with them, unless any of them failed to build.
+     * @returns false if any of them failed, in which case the targets keep their previous programs.
+     */
+    bool Finish();
+
+    /**
+     * @brief Finishes if all programs are ready, without blocking.
+     * @returns true if it finished.
+     */
+    bool Poll();
 };
 
 std::shared_ptr<gl::Shader> LoadShader(string const &vertexPathStr,
@@ -29,5 +115,65 @@ std::shared_ptr<gl::Shader> LoadShader(string const &vertexPathStr,
 
 std::shared_ptr<gl::Shader> LoadComputeShader(string const &computePathStr);
 
+/**
+ * @brief Loads a set of programs, preprocessing all of their stages in parallel first. Programs none of whose
+ * sources changed since they were last loaded are reused as-is.
+ */
+void LoadShaders(std::vector<ShaderProgramDescription> const &programs);
+
+/**
+ * @brief Like LoadShaders(), but returns once all programs are submitted to the driver. Poll the result every frame
+ * to swap them in when they are ready.
+ */
+PendingShaders LoadShadersAsync(std::vector<ShaderProgramDescription> const &programs);
+
+/**
+ * @brief Compile-time variants of one program, selected by a bitmask of features.
+ *
+ * Bit i of the mask defines featureDefines[i] as 1, unset bits define it as 0, so shaders can resolve per-feature
+ * branches while compiling instead of reading a uniform for every fragment. Variants whose masks are known up front
+ * are built together through Request(), Get() only builds the ones that were missed.
+ */
+class ShaderPermutations {
+    std::vector<string> stages;
+    std::vector<string> featureDefines;
+    std::vector<string> commonDefines;
+    std::unordered_map<uint32_t, std::shared_ptr<gl::Shader>> variants;
+
+    // failed variants are not built again until the next Load()
+    std::unordered_set<uint32_t> failedVariants;
+
+    std::vector<string> DefinesFor(uint32_t features) const;
+
+public:
+    /**
+     * @brief Sets the stages and feature definitions. The common definitions are added to every variant.
+     * @returns Descriptions that rebuild the variants built so far, for LoadShaders() or LoadShadersAsync(). Variants
+     * that failed or were never built are forgotten, and built again when they are requested next.
+     */
+    std::vector<ShaderProgramDescription> Load(std::vector<string> const &newStages,
+                                               std::vector<string> const &newFeatureDefines,
+                                               std::vector<string> const &newCommonDefines = {});
+
+    /**
+     * @returns Descriptions that build the variants of the masks that were neither built nor requested so far, for
+     * LoadShaders() or LoadShadersAsync(). Building them together lets the driver compile them concurrently.
+     */
+    std::vector<ShaderProgramDescription> Request(std::vector<uint32_t> const &featureMasks);
+
+    /**
+     * @brief Builds the variant if it was not built yet, and waits for it.
+     * @returns nullptr if it failed to build, which is logged once. Draws that need it should be skipped.
+     */
+    std::shared_ptr<gl::Shader> const &Get(uint32_t features);
+
+    /**
+     * @returns The number of variants that built.
+     */
+    size_t NumVariants() const;
+
+    std::vector<string> const &Stages() const;
+};
+
 #define REGISTER_SHADER_FOLDER(path) cfl::ShaderSourceManager::RegisterShaderFolder(path)
 } // namespace cfl
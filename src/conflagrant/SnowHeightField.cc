@@ -0,0 +1,176 @@
+#include "SnowHeightField.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cfl {
+namespace {
+/**
+ * @brief FNV-1a over the bytes of a plain value.
+ */
+template<typename T>
+uint64_t HashBytes(T const &x, uint64_t value = 14695981039346656037ull) {
+    auto const bytes = reinterpret_cast<uint8_t const *>(&x);
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        value = (value ^ bytes[i]) * 1099511628211ull;
+    }
+    return value;
+}
+} // namespace
+
+bool SnowHeightField::Rect::IsEmpty() const {
+    return min.x >= max.x || min.y >= max.y;
+}
+
+bool SnowHeightField::Rect::Overlaps(Rect const &other) const {
+    return !IsEmpty() && !other.IsEmpty() &&
+           min.x < other.max.x && other.min.x < max.x && min.y < other.max.y && other.min.y < max.y;
+}
+
+bool SnowHeightField::Configure(int newResolution, int newTileSize, vec2 const &newCenter, float newHalfExtent) {
+    newTileSize = std::max(1, std::min(newTileSize, newResolution));
+    if (newResolution == resolution && newTileSize == tileSize && newCenter == center &&
+        newHalfExtent == halfExtent) {
+        return false;
+    }
+
+    resolution = newResolution;
+    tileSize = newTileSize;
+    center = newCenter;
+    halfExtent = newHalfExtent;
+
+    casters.clear();
+    dirtyTiles.assign(static_cast<size_t>(NumTiles() * NumTiles()), 0);
+    Invalidate();
+    return true;
+}
+
+void SnowHeightField::Invalidate() {
+    std::fill(dirtyTiles.begin(), dirtyTiles.end(), 1);
+}
+
+void SnowHeightField::MarkDirty(Rect const &tiles) {
+    for (int y = tiles.min.y; y < tiles.max.y; ++y) {
+        for (int x = tiles.min.x; x < tiles.max.x; ++x) {
+            dirtyTiles[x + y * NumTiles()] = 1;
+        }
+    }
+}
+
+void SnowHeightField::UpdateCaster(uint64_t id, mat4 const &transform, vec3 const &worldCenter, float worldRadius) {
+    auto const hash = HashBytes(worldRadius, HashBytes(worldCenter, HashBytes(transform)));
+    auto const tiles = Tiles(worldCenter, worldRadius);
+
+    auto const it = casters.find(id);
+    if (it == casters.end()) {
+        casters.emplace(id, Caster{hash, tiles, generation});
+        MarkDirty(tiles);
+        return;
+    }
+
+    auto &caster = it->second;
+    caster.generation = generation;
+    if (caster.hash == hash) {
+        return;
+    }
+
+    // the tiles it left lose the caster, the tiles it entered gain it
+    MarkDirty(caster.tiles);
+    MarkDirty(tiles);
+    caster.hash = hash;
+    caster.tiles = tiles;
+}
+
+void SnowHeightField::RemoveStaleCasters() {
+    for (auto it = casters.begin(); it != casters.end();) {
+        if (it->second.generation != generation) {
+            MarkDirty(it->second.tiles);
+            it = casters.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    ++generation;
+}
+
+std::vector<ivec2> SnowHeightField::TakeDirtyTiles() {
+    std::vector<ivec2> tiles;
+
+    for (int y = 0; y < NumTiles(); ++y) {
+        for (int x = 0; x < NumTiles(); ++x) {
+            auto &isDirty = dirtyTiles[x + y * NumTiles()];
+            if (isDirty) {
+                tiles.emplace_back(x, y);
+                isDirty = 0;
+            }
+        }
+    }
+    return tiles;
+}
+
+bool SnowHeightField::IsCasterInTile(uint64_t id, ivec2 const &tile) const {
+    auto const it = casters.find(id);
+    return it != casters.end() && it->second.tiles.Overlaps(Rect{tile, tile + ivec2(1)});
+}
+
+SnowHeightField::Rect SnowHeightField::Tiles(vec3 const &worldCenter, float worldRadius) const {
+    if (resolution == 0) {
+        return Rect{ivec2(0), ivec2(0)};
+    }
+
+    auto const tileExtent = 2 * halfExtent * tileSize / resolution;
+    auto const origin = center - vec2(halfExtent);
+
+    auto const toTile = [&](float coordinate, float originCoordinate) {
+        return static_cast<int>(std::floor((coordinate - originCoordinate) / tileExtent));
+    };
+
+    auto const clamp = [&](int tile) {
+        return std::max(0, std::min(tile, NumTiles()));
+    };
+
+    return Rect{
+            ivec2(clamp(toTile(worldCenter.x - worldRadius, origin.x)),
+                  clamp(toTile(worldCenter.z - worldRadius, origin.y))),
+            ivec2(clamp(toTile(worldCenter.x + worldRadius, origin.x) + 1),
+                  clamp(toTile(worldCenter.z + worldRadius, origin.y) + 1)),
+    };
+}
+
+SnowHeightField::Rect SnowHeightField::Texels(ivec2 const &tile) const {
+    return Rect{tile * tileSize, glm::min((tile + ivec2(1)) * tileSize, ivec2(resolution))};
+}
+
+int SnowHeightField::Resolution() const {
+    return resolution;
+}
+
+int SnowHeightField::TileSize() const {
+    return tileSize;
+}
+
+int SnowHeightField::NumTiles() const {
+    return (resolution + tileSize - 1) / tileSize;
+}
+
+vec2 const &SnowHeightField::Center() const {
+    return center;
+}
+
+float SnowHeightField::HalfExtent() const {
+    return halfExtent;
+}
+
+mat4 SnowHeightField::Projection(float centerHeight) const {
+    mat4 P(0);
+    P[0][0] = 1 / halfExtent;
+    P[3][0] = -center.x / halfExtent;
+    P[2][1] = 1 / halfExtent;
+    P[3][1] = -center.y / halfExtent;
+    P[1][2] = -1 / halfExtent;
+    P[3][2] = centerHeight / halfExtent;
+    P[3][3] = 1;
+    return P;
+}
+} // namespace cfl
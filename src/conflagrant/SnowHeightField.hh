@@ -0,0 +1,102 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+
+#include <unordered_map>
+
+namespace cfl {
+/**
+ * @brief Bookkeeping of the top-down height field that the snow collides with and accumulates in, see
+ * syst::SnowfallAnimator and snow/SnowHeightField.glsl.
+ *
+ * The height field covers a square of the XZ plane and is split into square tiles of texels. Casters are tracked by
+ * their bounding spheres and transforms, and only the tiles that a caster entered, left or moved within have to be
+ * rendered again.
+ */
+class SnowHeightField {
+public:
+    /**
+     * @brief Rectangle of tiles or texels, min inclusive and max exclusive.
+     */
+    struct Rect {
+        ivec2 min, max;
+
+        bool IsEmpty() const;
+
+        bool Overlaps(Rect const &other) const;
+    };
+
+private:
+    struct Caster {
+        uint64_t hash;
+        Rect tiles;
+        uint64_t generation;
+    };
+
+    int resolution{0}, tileSize{1};
+    vec2 center{0, 0};
+    float halfExtent{1};
+
+    std::unordered_map<uint64_t, Caster> casters;
+    std::vector<uint8_t> dirtyTiles;
+    uint64_t generation{0};
+
+    void MarkDirty(Rect const &tiles);
+
+public:
+    /**
+     * @param resolution Texels per side, a multiple of the tile size.
+     * @param tileSize Texels per side of a tile.
+     * @returns true if anything changed, in which case every tile is dirty and the casters are forgotten.
+     */
+    bool Configure(int resolution, int tileSize, vec2 const &center, float halfExtent);
+
+    /**
+     * @brief Makes every tile dirty, e.g. after the textures were reallocated.
+     */
+    void Invalidate();
+
+    /**
+     * @brief Tracks a caster, marking the tiles it covered and covers now dirty if it is new or changed.
+     * @param id Identifies the caster across updates.
+     * @param transform Whatever changes the rendered caster, usually its model matrix.
+     */
+    void UpdateCaster(uint64_t id, mat4 const &transform, vec3 const &worldCenter, float worldRadius);
+
+    /**
+     * @brief Forgets the casters that were not updated since the last call and marks their tiles dirty.
+     */
+    void RemoveStaleCasters();
+
+    /**
+     * @returns The dirty tiles in row-major order, which are clean afterwards.
+     */
+    std::vector<ivec2> TakeDirtyTiles();
+
+    bool IsCasterInTile(uint64_t id, ivec2 const &tile) const;
+
+    /**
+     * @returns The tiles that a sphere covers, clamped to the height field.
+     */
+    Rect Tiles(vec3 const &worldCenter, float worldRadius) const;
+
+    Rect Texels(ivec2 const &tile) const;
+
+    int Resolution() const;
+
+    int TileSize() const;
+
+    int NumTiles() const;
+
+    vec2 const &Center() const;
+
+    float HalfExtent() const;
+
+    /**
+     * @brief Orthographic projection looking down onto the height field, from world x and z to clip x and y. Higher
+     * surfaces are nearer. The vertical range is the same as the horizontal one, surfaces outside of it need depth
+     * clamping.
+     */
+    mat4 Projection(float centerHeight) const;
+};
+} // namespace cfl
@@ -0,0 +1,353 @@
+#include "SnowSimulation.hh"
+
+#include <conflagrant/ParallelFor.hh>
+#include <conflagrant/RadixSort.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace cfl {
+namespace {
+/**
+ * @brief GLSL's mod(), which takes the sign of y unlike std::fmod.
+ */
+float Mod(float x, float y) {
+    return x - y * std::floor(x / y);
+}
+
+float Mod289(float x) {
+    return x - std::floor(x * (1.0f / 289.0f)) * 289.0f;
+}
+
+float Permute(float x) {
+    return Mod289((34.0f * x + 1.0f) * x);
+}
+
+float TaylorInvSqrt(float r) {
+    return 1.79284291400159f - 0.85373472095314f * r;
+}
+
+/**
+ * @brief Simplex noise of common/noise/noise3Dgrad.glsl, written per corner. SnowSimulationAvx2.cc has the same
+ * operations in the same order.
+ */
+float SimplexNoise(vec3 const &v, vec3 &gradient) {
+    // skew into the simplex grid and find the cell and its corners
+    float const skew = (v.x + v.y + v.z) * (1.0f / 3.0f);
+    float ix = std::floor(v.x + skew), iy = std::floor(v.y + skew), iz = std::floor(v.z + skew);
+    float const unskew = (ix + iy + iz) * (1.0f / 6.0f);
+    float const x0 = v.x - ix + unskew, y0 = v.y - iy + unskew, z0 = v.z - iz + unskew;
+
+    float const gx = x0 >= y0 ? 1.0f : 0.0f, gy = y0 >= z0 ? 1.0f : 0.0f, gz = z0 >= x0 ? 1.0f : 0.0f;
+    float const lx = 1.0f - gx, ly = 1.0f - gy, lz = 1.0f - gz;
+
+    float const offsets[4][3] = {
+            {0, 0, 0},
+            {std::min(gx, lz), std::min(gy, lx), std::min(gz, ly)},
+            {std::max(gx, lz), std::max(gy, lx), std::max(gz, ly)},
+            {1, 1, 1},
+    };
+    float const unskewOffsets[4] = {0.0f, 1.0f / 6.0f, 1.0f / 3.0f, 0.5f};
+
+    ix = Mod289(ix);
+    iy = Mod289(iy);
+    iz = Mod289(iz);
+
+    float const n = 1.0f / 7.0f;
+
+    float value = 0;
+    gradient = vec3(0, 0, 0);
+
+    for (size_t k = 0; k < 4; ++k) {
+        float const dx = x0 - offsets[k][0] + unskewOffsets[k];
+        float const dy = y0 - offsets[k][1] + unskewOffsets[k];
+        float const dz = z0 - offsets[k][2] + unskewOffsets[k];
+
+        // gradients: 7x7 points over a square, mapped onto an octahedron
+        float const p = Permute(Permute(Permute(iz + offsets[k][2]) + iy + offsets[k][1]) + ix + offsets[k][0]);
+        float const j = p - 49.0f * std::floor(p * n * n);
+        float const gridX = std::floor(j * n);
+        float const gridY = std::floor(j - 7.0f * gridX);
+
+        float const x = gridX * (2.0f * n) + (0.5f * n - 1.0f);
+        float const y = gridY * (2.0f * n) + (0.5f * n - 1.0f);
+        float const h = 1.0f - std::abs(x) - std::abs(y);
+        float const sh = h <= 0 ? -1.0f : 0.0f;
+
+        float px = x + (std::floor(x) * 2.0f + 1.0f) * sh;
+        float py = y + (std::floor(y) * 2.0f + 1.0f) * sh;
+        float pz = h;
+
+        float const norm = TaylorInvSqrt(px * px + py * py + pz * pz);
+        px *= norm;
+        py *= norm;
+        pz *= norm;
+
+        float const m = std::max(0.6f - (dx * dx + dy * dy + dz * dz), 0.0f);
+        float const m2 = m * m;
+        float const m4 = m2 * m2;
+        float const pdotx = px * dx + py * dy + pz * dz;
+
+        value += m4 * pdotx;
+
+        float const temp = m2 * m * pdotx;
+        gradient.x += -8.0f * temp * dx + m4 * px;
+        gradient.y += -8.0f * temp * dy + m4 * py;
+        gradient.z += -8.0f * temp * dz + m4 * pz;
+    }
+
+    gradient = gradient * 42.0f;
+    return 42.0f * value;
+}
+} // namespace
+
+void SnowParticles::Resize(size_t count) {
+    for (auto array : {&positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &angle, &lifetime}) {
+        array->resize(count, 0.0f);
+    }
+}
+
+size_t SnowParticles::Size() const {
+    return positionX.size();
+}
+
+void SnowParticles::PackPositions(float *out, size_t begin, size_t end) const {
+    for (auto i = begin; i < end; ++i, out += 3) {
+        out[0] = positionX[i];
+        out[1] = positionY[i];
+        out[2] = positionZ[i];
+    }
+}
+
+void SnowParticles::PackVelocities(float *out, size_t begin, size_t end) const {
+    for (auto i = begin; i < end; ++i, out += 3) {
+        out[0] = velocityX[i];
+        out[1] = velocityY[i];
+        out[2] = velocityZ[i];
+    }
+}
+
+SnowCover::SnowCover(uint32_t resolution, vec2 const &center, float halfExtent, std::vector<float> heights)
+        : resolution(resolution), center(center), halfExtent(halfExtent), heights(std::move(heights)),
+          snowDepth(this->heights.size(), 0) {}
+
+uint32_t SnowCover::Resolution() const {
+    return resolution;
+}
+
+vec2 const &SnowCover::Center() const {
+    return center;
+}
+
+float SnowCover::HalfExtent() const {
+    return halfExtent;
+}
+
+bool SnowCover::IsEmpty() const {
+    return heights.empty();
+}
+
+void SnowCover::UpdateTexels(ivec2 const &min, ivec2 const &max, float const *texels) {
+    auto const width = static_cast<size_t>(max.x - min.x);
+    for (auto y = min.y; y < max.y; ++y, texels += width) {
+        auto const row = static_cast<size_t>(min.x) + resolution * static_cast<size_t>(y);
+        std::copy(texels, texels + width, heights.begin() + row);
+        std::fill(snowDepth.begin() + row, snowDepth.begin() + row + width, 0);
+    }
+}
+
+uint32_t SnowCover::SnowDepth(ivec2 const &texel) const {
+    return snowDepth[static_cast<size_t>(texel.x) + resolution * static_cast<size_t>(texel.y)];
+}
+
+bool SnowCover::GetTexel(vec3 const &position, size_t &texel) const {
+    if (heights.empty()) {
+        return false;
+    }
+
+    // GetHeightFieldTexel() of snow/SnowHeightField.glsl
+    auto const u = (position.x - center.x) / halfExtent, v = (position.z - center.y) / halfExtent;
+    if (!(std::abs(u) < 1 && std::abs(v) < 1)) {
+        return false;
+    }
+
+    auto const coordinate = [&](float w) {
+        return std::min(static_cast<uint32_t>((0.5f * w + 0.5f) * resolution), resolution - 1);
+    };
+    texel = coordinate(u) + resolution * static_cast<size_t>(coordinate(v));
+    return true;
+}
+
+bool SnowCover::Land(vec3 const &position) {
+    size_t texel;
+    if (!GetTexel(position, texel)) {
+        return false;
+    }
+
+    auto &count = snowDepth[texel];
+    auto const depth = particleSnowDepth * __atomic_load_n(&count, __ATOMIC_RELAXED);
+    if (position.y >= heights[texel] + depth) {
+        return false;
+    }
+
+    if (depth < maxSnowDepth) {
+        __atomic_fetch_add(&count, 1u, __ATOMIC_RELAXED);
+    }
+    return true;
+}
+
+void SnowSimulation::Simulate(SnowParticles &particles, SnowSimulationParameters const &parameters,
+                              SnowCover *cover, size_t numThreads, bool allowVectorized) {
+    auto const count = particles.Size();
+#ifdef CFL_ENABLE_AVX2
+    auto const useAvx2 = allowVectorized && IsVectorized();
+#else
+    (void) allowVectorized; // only the AVX2 build has a vectorized step
+#endif
+
+    ParallelFor((count + ChunkSize - 1) / ChunkSize, numThreads, [&](size_t chunk) {
+        auto const begin = chunk * ChunkSize;
+        auto const end = std::min(begin + ChunkSize, count);
+
+#ifdef CFL_ENABLE_AVX2
+        if (useAvx2) {
+            SimulateRangeAvx2(particles, parameters, cover, begin, end);
+            return;
+        }
+#endif
+        SimulateRange(particles, parameters, cover, begin, end);
+    });
+}
+
+bool SnowSimulation::IsVectorized() {
+#ifdef CFL_ENABLE_AVX2
+    static bool const isSupported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return isSupported;
+#else
+    return false;
+#endif
+}
+
+void SnowSimulation::SimulateRange(SnowParticles &particles, SnowSimulationParameters const &parameters,
+                                   SnowCover *cover, size_t begin, size_t end) {
+    auto const dt = parameters.timeDelta;
+    auto const windOffset = Mod(parameters.windFrequency * parameters.time, 100.0f);
+    auto const angleStep = parameters.angleSpeed * dt;
+
+    for (auto i = begin; i < end; ++i) {
+        auto &vx = particles.velocityX[i], &vy = particles.velocityY[i], &vz = particles.velocityZ[i];
+        auto &px = particles.positionX[i], &py = particles.positionY[i], &pz = particles.positionZ[i];
+
+        vec3 wind;
+        SimplexNoise(vec3(parameters.windFrequency * px + windOffset,
+                          parameters.windFrequency * py + windOffset,
+                          parameters.windFrequency * pz + windOffset), wind);
+
+        // the wind only blows horizontally
+        vx += parameters.windStrength * wind.x * dt;
+        vz += parameters.windStrength * wind.z * dt;
+
+        float const speed = std::sqrt(vx * vx + vz * vz);
+        if (speed > parameters.maxSpeed) {
+            vx = vx * parameters.maxSpeed / speed;
+            vz = vz * parameters.maxSpeed / speed;
+        }
+
+        px += vx * dt;
+        py += vy * dt;
+        pz += vz * dt;
+        particles.angle[i] += angleStep;
+        particles.lifetime[i] += dt;
+
+        // respawning twice in a frame gives the same particle, so the checks of the shader can be combined
+        if (parameters.time <= dt || py < -0.1f || particles.lifetime[i] > 30) {
+            Respawn(particles, parameters, i);
+        }
+        // landed on a caster, or on the snow that already lies on it
+        if (cover && cover->Land(vec3(px, py, pz))) {
+            Respawn(particles, parameters, i);
+        }
+    }
+}
+
+void SnowSimulation::SortBackToFront(SnowParticles &particles, vec3 const &eyePosition, size_t numThreads) {
+    auto const count = particles.Size();
+    std::vector<uint32_t> keys(count), order(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        auto const dx = particles.positionX[i] - eyePosition.x;
+        auto const dy = particles.positionY[i] - eyePosition.y;
+        auto const dz = particles.positionZ[i] - eyePosition.z;
+        auto const squaredDistance = dx * dx + dy * dy + dz * dz;
+
+        // the bits of a positive float increase with its value, inverted the farthest particle comes first
+        uint32_t bits;
+        std::memcpy(&bits, &squaredDistance, sizeof(bits));
+        keys[i] = ~bits;
+        order[i] = static_cast<uint32_t>(i);
+    }
+
+    RadixSort(keys, order, numThreads);
+
+    std::vector<float> *const arrays[] = {
+            &particles.positionX, &particles.positionY, &particles.positionZ,
+            &particles.velocityX, &particles.velocityY, &particles.velocityZ,
+            &particles.angle, &particles.lifetime
+    };
+    ParallelFor(8, numThreads, [&](size_t a) {
+        auto &array = *arrays[a];
+        std::vector<float> sorted(count);
+        for (size_t i = 0; i < count; ++i) {
+            sorted[i] = array[order[i]];
+        }
+        array.swap(sorted);
+    });
+}
+
+SnowLod SnowSimulation::ComputeLod(int count, float distance, SnowLodParameters const &parameters) {
+    if (count <= 0 || distance <= parameters.fullDetailDistance) {
+        return SnowLod{std::max(count, 0), 1};
+    }
+
+    auto const ratio = parameters.fullDetailDistance / distance;
+    auto const fraction = std::max(ratio * ratio, parameters.minDetailFraction);
+    auto const lodCount = std::max(1, std::min(count, static_cast<int>(std::ceil(fraction * count))));
+
+    // the area of a particle grows with the square of its radius
+    return SnowLod{lodCount, std::sqrt(static_cast<float>(count) / lodCount)};
+}
+
+void SnowSimulation::Respawn(SnowParticles &particles, SnowSimulationParameters const &parameters, size_t index) {
+    auto const id = static_cast<float>(index);
+    vec3 const seed(0.81693f * id, parameters.time, parameters.timeDelta);
+
+    vec3 const nyOffset(4.54219f, 17.125325f, -5.771239f);
+    vec3 const nzOffset(nyOffset.x * 0.513f, nyOffset.y * 0.967f, nyOffset.z * 1.671f);
+
+    auto const nx = Noise(seed);
+    auto const ny = Noise(seed + nyOffset);
+    auto const nz = Noise(seed + nzOffset);
+
+    vec4 const position = parameters.emitterTransform * vec4(nx, ny, nz, 1);
+    particles.positionX[index] = position.x;
+    particles.positionY[index] = position.y;
+    particles.positionZ[index] = position.z;
+
+    particles.velocityX[index] = Mod(0.612f * id * nx, parameters.emitterMaxHorizontalSpeed);
+    particles.velocityY[index] = -parameters.emitterInitialFallSpeed;
+    particles.velocityZ[index] = Mod(0.612f * id * ny, parameters.emitterMaxHorizontalSpeed);
+
+    particles.angle[index] = 0;
+    particles.lifetime[index] = 0;
+}
+
+float SnowSimulation::Noise(vec3 const &v) {
+    vec3 gradient;
+    return SimplexNoise(v, gradient);
+}
+
+float SnowSimulation::Noise(vec3 const &v, vec3 &gradient) {
+    return SimplexNoise(v, gradient);
+}
+} // namespace cfl
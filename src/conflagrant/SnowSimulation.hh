@@ -0,0 +1,192 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+
+namespace cfl {
+/**
+ * @brief Snow particles in structure-of-arrays layout, the CPU counterpart of the particle buffers of
+ * comp::SnowEmitter.
+ */
+struct SnowParticles {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> velocityX, velocityY, velocityZ;
+    std::vector<float> angle, lifetime;
+
+    /**
+     * @brief Resizes all arrays, new particles are zero and respawn in the next step.
+     */
+    void Resize(size_t count);
+
+    size_t Size() const;
+
+    /**
+     * @brief Writes the positions of the particles [begin, end) as packed vec3's, like the position stream of
+     * comp::SnowEmitter.
+     */
+    void PackPositions(float *out, size_t begin, size_t end) const;
+
+    void PackVelocities(float *out, size_t begin, size_t end) const;
+};
+
+/**
+ * @brief The uniforms of snow/SimulateSnowParticle.glsl.
+ */
+struct SnowSimulationParameters {
+    mat4 emitterTransform{1};
+    float emitterMaxHorizontalSpeed{0.2f};
+    float emitterInitialFallSpeed{0.18f};
+
+    float windStrength{0.2f};
+    float windFrequency{10};
+    float maxSpeed{0.1f};
+    float angleSpeed{3};
+
+    float time{0}, timeDelta{0};
+};
+
+/**
+ * @brief The level of detail of comp::SnowEmitter, see SnowSimulation::ComputeLod().
+ */
+struct SnowLodParameters {
+    // all particles are simulated and drawn up to this distance from the falling snow
+    float fullDetailDistance{10};
+    float minDetailFraction{0.05f};
+
+    // frames between the simulation steps of emitters outside of the view frustum
+    int hiddenSimulationInterval{4};
+};
+
+struct SnowLod {
+    // the particles [0, count) are simulated and drawn
+    int count{0};
+    float radiusScale{1};
+};
+
+/**
+ * @brief The height field of syst::SnowfallAnimator and the snow that landed on it, sampled like
+ * snow/SnowHeightField.glsl samples them: nearest texel, and nothing outside of the square.
+ */
+class SnowCover {
+    uint32_t resolution{0};
+    vec2 center{0, 0};
+    float halfExtent{1};
+    std::vector<float> heights;
+
+    // landed particles per texel, counted atomically since Land() runs on several threads
+    std::vector<uint32_t> snowDepth;
+
+    bool GetTexel(vec3 const &position, size_t &texel) const;
+
+public:
+    // how much a landed particle raises the snow of its texel, and how deep the snow gets at most
+    float particleSnowDepth{0.0005f};
+    float maxSnowDepth{0.25f};
+
+    SnowCover() = default;
+
+    /**
+     * @param heights The world height of the highest caster per texel, x varies fastest. No snow lies on it yet.
+     */
+    SnowCover(uint32_t resolution, vec2 const &center, float halfExtent, std::vector<float> heights);
+
+    uint32_t Resolution() const;
+
+    vec2 const &Center() const;
+
+    float HalfExtent() const;
+
+    bool IsEmpty() const;
+
+    /**
+     * @brief Replaces the heights of the texels [min, max) and clears the snow that lay on the old surface, like
+     * the tiles that the animator renders again.
+     * @param heights Row by row, x varies fastest.
+     */
+    void UpdateTexels(ivec2 const &min, ivec2 const &max, float const *heights);
+
+    /**
+     * @returns The particles that landed on the texel.
+     */
+    uint32_t SnowDepth(ivec2 const &texel) const;
+
+    /**
+     * @brief LandOnHeightField() of snow/SnowHeightField.glsl. Thread safe as long as nothing else modifies the
+     * cover.
+     * @returns true if the position is below the casters and the snow on them, in which case the particle adds to
+     * the snow of the texel.
+     */
+    bool Land(vec3 const &position);
+};
+
+/**
+ * @brief CPU backend of snow/snowfall_simulate.comp, which takes the simulation off the GPU, stands in if the compute
+ * shader failed to load, and tests the particle logic. It does not make the snow drawable without compute shaders:
+ * snow/snowfall_render.vert reads the uploaded particles from shader storage buffers, which need OpenGL 4.3 just like
+ * compute shaders do.
+ *
+ * Simulate() splits the particles into chunks that worker threads pick up. Each chunk runs the AVX2 kernel if the
+ * library was built with it (CFL_ENABLE_AVX2) and the CPU supports it, eight particles at a time, and the scalar
+ * reference otherwise. The kernels perform the same operations in the same order, the results only differ by
+ * floating point contraction. Like the compute shader, the particles land on the height field and pile up on it.
+ */
+class SnowSimulation {
+    SnowSimulation() = delete;
+
+public:
+    static constexpr size_t ChunkSize = 4096;
+
+    /**
+     * @param cover nullptr if there is no height field to land on.
+     * @param numThreads 0 uses one thread per hardware thread.
+     * @param allowVectorized false always runs the scalar reference.
+     */
+    static void Simulate(SnowParticles &particles, SnowSimulationParameters const &parameters,
+                         SnowCover *cover, size_t numThreads = 0, bool allowVectorized = true);
+
+    /**
+     * @returns true if Simulate() runs the AVX2 kernel on this machine.
+     */
+    static bool IsVectorized();
+
+    /**
+     * @brief Scalar reference of SimulateSnowParticle() for the particles [begin, end).
+     */
+    static void SimulateRange(SnowParticles &particles, SnowSimulationParameters const &parameters,
+                              SnowCover *cover, size_t begin, size_t end);
+
+    /**
+     * @brief Like SimulateRange(), eight particles at a time. Only available with CFL_ENABLE_AVX2 and only callable
+     * if the CPU supports AVX2 and FMA.
+     */
+    static void SimulateRangeAvx2(SnowParticles &particles, SnowSimulationParameters const &parameters,
+                                  SnowCover *cover, size_t begin, size_t end);
+
+    /**
+     * @brief Orders the particles from the farthest to the nearest, with a RadixSort() of their squared distances.
+     * The CPU counterpart of snow/snowfall_depthsort.comp.
+     */
+    static void SortBackToFront(SnowParticles &particles, vec3 const &eyePosition, size_t numThreads = 0);
+
+    /**
+     * @brief The particles of an emitter at a distance. The projected area of the falling snow shrinks with the square
+     * of the distance, and so does the count beyond the full detail distance. The radius grows so that the fewer
+     * particles cover as much of the snow's area as all of them would.
+     */
+    static SnowLod ComputeLod(int count, float distance, SnowLodParameters const &parameters);
+
+    /**
+     * @brief RespawnParticle() of snow/SimulateSnowParticle.glsl.
+     */
+    static void Respawn(SnowParticles &particles, SnowSimulationParameters const &parameters, size_t index);
+
+    /**
+     * @brief Simplex noise of common/noise/noise3D.glsl.
+     */
+    static float Noise(vec3 const &v);
+
+    /**
+     * @brief Simplex noise and its gradient, of common/noise/noise3Dgrad.glsl.
+     */
+    static float Noise(vec3 const &v, vec3 &gradient);
+};
+} // namespace cfl
@@ -0,0 +1,200 @@
+#include "SnowSimulation.hh"
+
+// only built with -mavx2 -mfma, see CFL_ENABLE_AVX2 in CMakeLists.txt
+#ifdef CFL_ENABLE_AVX2
+
+#include <immintrin.h>
+
+#include <cmath>
+
+namespace cfl {
+namespace {
+/**
+ * @brief Eight floats, with the arithmetic operators of the GCC and Clang vector extensions.
+ */
+using Float8 = __m256;
+
+inline Float8 Set(float x) {
+    return _mm256_set1_ps(x);
+}
+
+inline Float8 Floor(Float8 x) {
+    return _mm256_floor_ps(x);
+}
+
+inline Float8 Abs(Float8 x) {
+    return _mm256_andnot_ps(Set(-0.0f), x);
+}
+
+inline Float8 Min(Float8 a, Float8 b) {
+    return _mm256_min_ps(a, b);
+}
+
+inline Float8 Max(Float8 a, Float8 b) {
+    return _mm256_max_ps(a, b);
+}
+
+/**
+ * @returns value where the comparison holds, 0 elsewhere.
+ */
+template<int Comparison>
+inline Float8 Select(Float8 a, Float8 b, float value) {
+    return _mm256_and_ps(_mm256_cmp_ps(a, b, Comparison), Set(value));
+}
+
+inline Float8 Mod(Float8 x, float y) {
+    return x - Set(y) * Floor(x / Set(y));
+}
+
+inline Float8 Mod289(Float8 x) {
+    return x - Floor(x * Set(1.0f / 289.0f)) * Set(289.0f);
+}
+
+inline Float8 Permute(Float8 x) {
+    return Mod289((Set(34.0f) * x + Set(1.0f)) * x);
+}
+
+inline Float8 TaylorInvSqrt(Float8 r) {
+    return Set(1.79284291400159f) - Set(0.85373472095314f) * r;
+}
+
+/**
+ * @brief SimplexNoise() of SnowSimulation.cc for eight points, only the gradient is needed.
+ */
+void SimplexNoiseGradient(Float8 vx, Float8 vy, Float8 vz, Float8 &gradientX, Float8 &gradientY, Float8 &gradientZ) {
+    Float8 const skew = (vx + vy + vz) * Set(1.0f / 3.0f);
+    Float8 ix = Floor(vx + skew), iy = Floor(vy + skew), iz = Floor(vz + skew);
+    Float8 const unskew = (ix + iy + iz) * Set(1.0f / 6.0f);
+    Float8 const x0 = vx - ix + unskew, y0 = vy - iy + unskew, z0 = vz - iz + unskew;
+
+    Float8 const gx = Select<_CMP_GE_OQ>(x0, y0, 1.0f);
+    Float8 const gy = Select<_CMP_GE_OQ>(y0, z0, 1.0f);
+    Float8 const gz = Select<_CMP_GE_OQ>(z0, x0, 1.0f);
+    Float8 const lx = Set(1.0f) - gx, ly = Set(1.0f) - gy, lz = Set(1.0f) - gz;
+
+    Float8 const offsets[4][3] = {
+            {Set(0), Set(0), Set(0)},
+            {Min(gx, lz), Min(gy, lx), Min(gz, ly)},
+            {Max(gx, lz), Max(gy, lx), Max(gz, ly)},
+            {Set(1), Set(1), Set(1)},
+    };
+    float const unskewOffsets[4] = {0.0f, 1.0f / 6.0f, 1.0f / 3.0f, 0.5f};
+
+    ix = Mod289(ix);
+    iy = Mod289(iy);
+    iz = Mod289(iz);
+
+    float const n = 1.0f / 7.0f;
+
+    gradientX = gradientY = gradientZ = Set(0);
+
+    for (size_t k = 0; k < 4; ++k) {
+        Float8 const dx = x0 - offsets[k][0] + Set(unskewOffsets[k]);
+        Float8 const dy = y0 - offsets[k][1] + Set(unskewOffsets[k]);
+        Float8 const dz = z0 - offsets[k][2] + Set(unskewOffsets[k]);
+
+        Float8 const p = Permute(Permute(Permute(iz + offsets[k][2]) + iy + offsets[k][1]) + ix + offsets[k][0]);
+        Float8 const j = p - Set(49.0f) * Floor(p * Set(n) * Set(n));
+        Float8 const gridX = Floor(j * Set(n));
+        Float8 const gridY = Floor(j - Set(7.0f) * gridX);
+
+        Float8 const x = gridX * Set(2.0f * n) + Set(0.5f * n - 1.0f);
+        Float8 const y = gridY * Set(2.0f * n) + Set(0.5f * n - 1.0f);
+        Float8 const h = Set(1.0f) - Abs(x) - Abs(y);
+        Float8 const sh = Select<_CMP_LE_OQ>(h, Set(0), -1.0f);
+
+        Float8 px = x + (Floor(x) * Set(2.0f) + Set(1.0f)) * sh;
+        Float8 py = y + (Floor(y) * Set(2.0f) + Set(1.0f)) * sh;
+        Float8 pz = h;
+
+        Float8 const norm = TaylorInvSqrt(px * px + py * py + pz * pz);
+        px *= norm;
+        py *= norm;
+        pz *= norm;
+
+        Float8 const m = Max(Set(0.6f) - (dx * dx + dy * dy + dz * dz), Set(0.0f));
+        Float8 const m2 = m * m;
+        Float8 const m4 = m2 * m2;
+        Float8 const pdotx = px * dx + py * dy + pz * dz;
+
+        Float8 const temp = m2 * m * pdotx;
+        gradientX += Set(-8.0f) * temp * dx + m4 * px;
+        gradientY += Set(-8.0f) * temp * dy + m4 * py;
+        gradientZ += Set(-8.0f) * temp * dz + m4 * pz;
+    }
+
+    gradientX *= Set(42.0f);
+    gradientY *= Set(42.0f);
+    gradientZ *= Set(42.0f);
+}
+} // namespace
+
+void SnowSimulation::SimulateRangeAvx2(SnowParticles &particles, SnowSimulationParameters const &parameters,
+                                       SnowCover *cover, size_t begin, size_t end) {
+    auto const dt = Set(parameters.timeDelta);
+    auto const windFrequency = Set(parameters.windFrequency);
+    auto const windOffset = Mod(Set(parameters.windFrequency * parameters.time), 100.0f);
+    auto const windStrength = Set(parameters.windStrength);
+    auto const maxSpeed = Set(parameters.maxSpeed);
+    auto const angleStep = Set(parameters.angleSpeed * parameters.timeDelta);
+    auto const isFirstFrame = parameters.time <= parameters.timeDelta;
+
+    auto i = begin;
+    for (; i + 8 <= end; i += 8) {
+        auto px = _mm256_loadu_ps(&particles.positionX[i]);
+        auto py = _mm256_loadu_ps(&particles.positionY[i]);
+        auto pz = _mm256_loadu_ps(&particles.positionZ[i]);
+        auto vx = _mm256_loadu_ps(&particles.velocityX[i]);
+        auto vy = _mm256_loadu_ps(&particles.velocityY[i]);
+        auto vz = _mm256_loadu_ps(&particles.velocityZ[i]);
+
+        Float8 windX, windY, windZ;
+        SimplexNoiseGradient(windFrequency * px + windOffset, windFrequency * py + windOffset,
+                             windFrequency * pz + windOffset, windX, windY, windZ);
+
+        vx += windStrength * windX * dt;
+        vz += windStrength * windZ * dt;
+
+        // lanes at or below the maximum speed divide by zero at worst and are discarded
+        auto const speed = _mm256_sqrt_ps(vx * vx + vz * vz);
+        auto const isTooFast = _mm256_cmp_ps(speed, maxSpeed, _CMP_GT_OQ);
+        vx = _mm256_blendv_ps(vx, vx * maxSpeed / speed, isTooFast);
+        vz = _mm256_blendv_ps(vz, vz * maxSpeed / speed, isTooFast);
+
+        px += vx * dt;
+        py += vy * dt;
+        pz += vz * dt;
+        auto const angle = _mm256_loadu_ps(&particles.angle[i]) + angleStep;
+        auto const lifetime = _mm256_loadu_ps(&particles.lifetime[i]) + dt;
+
+        _mm256_storeu_ps(&particles.positionX[i], px);
+        _mm256_storeu_ps(&particles.positionY[i], py);
+        _mm256_storeu_ps(&particles.positionZ[i], pz);
+        _mm256_storeu_ps(&particles.velocityX[i], vx);
+        _mm256_storeu_ps(&particles.velocityZ[i], vz);
+        _mm256_storeu_ps(&particles.angle[i], angle);
+        _mm256_storeu_ps(&particles.lifetime[i], lifetime);
+
+        auto respawn = _mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(py, Set(-0.1f), _CMP_LT_OQ),
+                                                       _mm256_cmp_ps(lifetime, Set(30.0f), _CMP_GT_OQ)));
+        if (isFirstFrame) {
+            respawn = 0xff;
+        }
+
+        // respawning and landing is rare or scattered, so it is done per particle
+        for (size_t lane = 0; lane < 8; ++lane) {
+            if (respawn & (1 << lane)) {
+                Respawn(particles, parameters, i + lane);
+            }
+            if (cover && cover->Land(vec3(particles.positionX[i + lane], particles.positionY[i + lane],
+                                          particles.positionZ[i + lane]))) {
+                Respawn(particles, parameters, i + lane);
+            }
+        }
+    }
+
+    SimulateRange(particles, parameters, cover, i, end);
+}
+} // namespace cfl
+
+#endif // CFL_ENABLE_AVX2
@@ -0,0 +1,189 @@
+#include "SparseVoxelOctree.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+namespace cfl {
+namespace {
+constexpr uint32_t PositionBits = 10;
+constexpr uint32_t PositionMask = (1u << PositionBits) - 1;
+
+/**
+ * @returns The index of the child of a node at the given depth that contains the voxel.
+ */
+uint32_t Octant(uvec3 const &voxel, uint32_t depth, uint32_t levels) {
+    auto const bit = levels - 1 - depth;
+    return ((voxel.x >> bit) & 1u) |
+           (((voxel.y >> bit) & 1u) << 1) |
+           (((voxel.z >> bit) & 1u) << 2);
+}
+} // namespace
+
+uint32_t VoxelFragment::PackPosition(uvec3 const &voxel) {
+    return (voxel.x & PositionMask) |
+           ((voxel.y & PositionMask) << PositionBits) |
+           ((voxel.z & PositionMask) << (2 * PositionBits));
+}
+
+uvec3 VoxelFragment::UnpackPosition(uint32_t position) {
+    return uvec3(position & PositionMask,
+                 (position >> PositionBits) & PositionMask,
+                 (position >> (2 * PositionBits)) & PositionMask);
+}
+
+SparseVoxelOctree::SparseVoxelOctree(uint32_t levels)
+        : levels(std::min(levels, MaxLevels)), nodes(1, SvoNode{0, 0}) {}
+
+uint32_t SparseVoxelOctree::FindNode(uvec3 const &voxel, uint32_t depth) const {
+    uint32_t node = 0;
+    for (uint32_t d = 0; d < depth; ++d) {
+        auto const children = nodes[node].children;
+        if (children == 0) {
+            return InvalidNode;
+        }
+        node = children + Octant(voxel, d, levels);
+    }
+    return node;
+}
+
+void SparseVoxelOctree::Build(std::vector<VoxelFragment> const &fragments) {
+    nodes.assign(1, SvoNode{0, 0});
+
+    // subdivide top-down, one level per pass like voxels/svo/subdivide.comp
+    for (uint32_t depth = 0; depth < levels; ++depth) {
+        for (auto const &fragment : fragments) {
+            auto const node = FindNode(VoxelFragment::UnpackPosition(fragment.position), depth);
+            if (node == InvalidNode || nodes[node].children != 0) {
+                continue;
+            }
+
+            auto const first = static_cast<uint32_t>(nodes.size());
+            nodes.resize(nodes.size() + 8, SvoNode{0, 0});
+            nodes[node].children = first;
+        }
+    }
+
+    // average the fragments of each leaf, the GPU does the same with a running average
+    struct Accumulator {
+        vec3 sum{0, 0, 0};
+        uint32_t count{0};
+    };
+    std::unordered_map<uint32_t, Accumulator> accumulators;
+
+    for (auto const &fragment : fragments) {
+        auto const leaf = FindNode(VoxelFragment::UnpackPosition(fragment.position), levels);
+        auto &accumulator = accumulators[leaf];
+        accumulator.sum += vec3(UnpackColor(fragment.color));
+        accumulator.count++;
+    }
+
+    for (auto const &kvp : accumulators) {
+        auto const &accumulator = kvp.second;
+        auto const count = std::min<uint32_t>(accumulator.count, 255);
+        nodes[kvp.first].color = PackColor(vec4(accumulator.sum / static_cast<float>(accumulator.count),
+                                                count / 255.0f));
+    }
+
+    // filter bottom-up, matching voxels/svo/mipmap.comp and the dense voxels/mipmap.comp
+    std::vector<std::pair<uint32_t, uint32_t>> stack{{0, 0}};
+    std::vector<std::pair<uint32_t, uint32_t>> innerNodes;
+    while (!stack.empty()) {
+        auto const top = stack.back();
+        stack.pop_back();
+
+        auto const children = nodes[top.first].children;
+        if (children == 0 || top.second == levels) {
+            continue;
+        }
+
+        innerNodes.push_back(top);
+        for (uint32_t i = 0; i < 8; ++i) {
+            stack.emplace_back(children + i, top.second + 1);
+        }
+    }
+
+    std::sort(innerNodes.begin(), innerNodes.end(), [](std::pair<uint32_t, uint32_t> const &a,
+                                                       std::pair<uint32_t, uint32_t> const &b) {
+        return a.second > b.second;
+    });
+
+    for (auto const &innerNode : innerNodes) {
+        bool const isFirstLevel = innerNode.second == levels - 1;
+        auto const children = nodes[innerNode.first].children;
+
+        vec3 color(0, 0, 0);
+        float alpha = 0;
+        int count = 0;
+        for (uint32_t i = 0; i < 8; ++i) {
+            auto const child = UnpackColor(nodes[children + i].color);
+            if (child.a > 0) {
+                color += vec3(child);
+                alpha += isFirstLevel ? std::min(255 * child.a, 1.0f) : child.a;
+                count++;
+            }
+        }
+
+        nodes[innerNode.first].color = count > 0
+                                       ? PackColor(vec4(color / static_cast<float>(count), std::min(alpha, 1.0f)))
+                                       : 0;
+    }
+}
+
+vec4 SparseVoxelOctree::Lookup(uvec3 const &voxel, uint32_t mipmapLevel) const {
+    auto const node = FindNode(voxel, levels - std::min(mipmapLevel, levels));
+    return node == InvalidNode ? vec4(0, 0, 0, 0) : UnpackColor(nodes[node].color);
+}
+
+vec4 SparseVoxelOctree::Sample(vec3 const &normalizedPosition, float mipmapLevel) const {
+    for (int i = 0; i < 3; ++i) {
+        if (normalizedPosition[i] < 0 || normalizedPosition[i] >= 1) {
+            return vec4(0, 0, 0, 0);
+        }
+    }
+
+    auto const resolution = static_cast<float>(1u << levels);
+    uvec3 const voxel(normalizedPosition * resolution);
+
+    auto const level = std::max(0.0f, std::min(mipmapLevel, static_cast<float>(levels)));
+    auto const lower = static_cast<uint32_t>(std::floor(level));
+    auto const upper = std::min(lower + 1, levels);
+    auto const fraction = level - lower;
+
+    return (1 - fraction) * Lookup(voxel, lower) + fraction * Lookup(voxel, upper);
+}
+
+uint32_t SparseVoxelOctree::Levels() const {
+    return levels;
+}
+
+std::vector<SvoNode> const &SparseVoxelOctree::Nodes() const {
+    return nodes;
+}
+
+size_t SparseVoxelOctree::SizeInBytes() const {
+    return nodes.size() * sizeof(SvoNode);
+}
+
+size_t SparseVoxelOctree::DenseSizeInBytes(uint32_t levels) {
+    size_t size = 0;
+    for (uint32_t level = 0; level <= levels; ++level) {
+        size_t const side = size_t(1) << level;
+        size += side * side * side * 4;
+    }
+    return size;
+}
+
+vec4 SparseVoxelOctree::UnpackColor(uint32_t color) {
+    return vec4(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF, (color >> 24) & 0xFF) / 255.0f;
+}
+
+uint32_t SparseVoxelOctree::PackColor(vec4 const &color) {
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; ++i) {
+        auto const channel = static_cast<uint32_t>(std::round(std::max(0.0f, std::min(color[i], 1.0f)) * 255));
+        packed |= channel << (8 * i);
+    }
+    return packed;
+}
+} // namespace cfl
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+
+namespace cfl {
+/**
+ * @brief A voxel written by the voxelization pass, before it is sorted into the octree. Matches the layout of the
+ * fragment list in voxels/common/svo.glsl.
+ */
+struct VoxelFragment {
+    /**
+     * @brief 10 bits per axis, see PackPosition().
+     */
+    uint32_t position;
+
+    /**
+     * @brief RGBA8, the alpha channel counts the fragments that were averaged into it.
+     */
+    uint32_t color;
+
+    static uint32_t PackPosition(uvec3 const &voxel);
+
+    static uvec3 UnpackPosition(uint32_t position);
+};
+
+/**
+ * @brief A node of the octree. Matches the layout of SvoNode in voxels/common/svo.glsl.
+ */
+struct SvoNode {
+    /**
+     * @brief Index of the first of the node's 8 consecutive children, or 0 if it has none. The root is node 0, so it
+     * can never be a child.
+     */
+    uint32_t children;
+
+    /**
+     * @brief RGBA8. Leaves store the average color and the number of fragments in the alpha channel, like the dense
+     * voxel texture, inner nodes store the filtered color and coverage of their children.
+     */
+    uint32_t color;
+};
+
+static_assert(sizeof(VoxelFragment) == 8, "VoxelFragment has to match the std430 layout in voxels/common/svo.glsl");
+static_assert(sizeof(SvoNode) == 8, "SvoNode has to match the std430 layout in voxels/common/svo.glsl");
+
+/**
+ * @brief CPU reference of the sparse voxel octree that the voxels/svo/ compute shaders build.
+ *
+ * Only nodes that contain voxelized geometry are subdivided, so memory grows with the surface area of the scene
+ * rather than with the cube of the resolution. The octree with L levels has the resolution of a dense texture of
+ * 2^L voxels per side, and mipmap level m of the dense texture corresponds to depth L - m.
+ */
+class SparseVoxelOctree {
+    uint32_t levels;
+    std::vector<SvoNode> nodes;
+
+    /**
+     * @returns The index of the node at the given depth that contains the voxel, or InvalidNode.
+     */
+    uint32_t FindNode(uvec3 const &voxel, uint32_t depth) const;
+
+public:
+    /**
+     * @brief 10 bits per axis in VoxelFragment::position.
+     */
+    static constexpr uint32_t MaxLevels = 10;
+
+    static constexpr uint32_t InvalidNode = 0xFFFFFFFF;
+
+    explicit SparseVoxelOctree(uint32_t levels);
+
+    /**
+     * @brief Builds the octree from scratch: subdivides the nodes containing fragments level by level, averages the
+     * fragments into the leaves and filters the leaves up to the root, the same way as the compute shaders.
+     */
+    void Build(std::vector<VoxelFragment> const &fragments);
+
+    /**
+     * @returns The color of the voxel at the given mipmap level, 0 for empty space. The voxel is given in leaf
+     * coordinates, i.e. in [0, 2^levels).
+     */
+    vec4 Lookup(uvec3 const &voxel, uint32_t mipmapLevel) const;
+
+    /**
+     * @brief Samples the octree at a position in [0, 1]^3, linearly interpolating between the two nearest mipmap
+     * levels. Within a level, the nearest voxel is used.
+     */
+    vec4 Sample(vec3 const &normalizedPosition, float mipmapLevel) const;
+
+    uint32_t Levels() const;
+
+    std::vector<SvoNode> const &Nodes() const;
+
+    size_t SizeInBytes() const;
+
+    /**
+     * @returns The size of a dense RGBA8 texture of the same resolution, including all of its mipmaps.
+     */
+    static size_t DenseSizeInBytes(uint32_t levels);
+
+    static vec4 UnpackColor(uint32_t color);
+
+    static uint32_t PackColor(vec4 const &color);
+};
+} // namespace cfl
@@ -4,9 +4,10 @@
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/System.hh>
 #include <conflagrant/factory_util.hh>
+#include <conflagrant/TypeId.hh>
+#include <conflagrant/FactoryRegistry.hh>
 
 #include <entityx/System.h>
-#include <unordered_map>
 
 
 namespace cfl {
@@ -28,6 +29,14 @@ struct SystemFactory {
     virtual bool IsSerializable() const = 0;
 
     virtual bool IsImGuiDrawable() const = 0;
+
+    virtual TypeId GetTypeId() const = 0;
+
+    /**
+     * @returns true if the system renders the scene. Only the first renderer in the system order is active, see
+     * Engine::IsActiveRenderer().
+     */
+    virtual bool IsRenderer() const = 0;
 };
 
 template<typename TSystem>
@@ -73,6 +82,17 @@ class ConcreteSystemFactory : public SystemFactory {
 
     static constexpr bool HasSerialize = has_Serialize<TSystem>::value;
     static constexpr bool HasDrawWithImGui = has_DrawWithImGui<TSystem>::value;
+    static constexpr bool HasIsRenderer = has_IsRenderer<TSystem>::value;
+
+    template<bool hasIsRenderer>
+    static constexpr typename std::enable_if<hasIsRenderer, bool>::type _IsRenderer() {
+        return TSystem::IsRenderer;
+    }
+
+    template<bool hasIsRenderer>
+    static constexpr typename std::enable_if<!hasIsRenderer, bool>::type _IsRenderer() {
+        return false;
+    }
 
 public:
     std::shared_ptr<System> Create(entityx::SystemManager &manager, Json::Value &json) const override {
@@ -119,10 +139,18 @@ public:
     bool IsImGuiDrawable() const override {
         return HasDrawWithImGui;
     }
+
+    TypeId GetTypeId() const override {
+        return GetSystemTypeId<TSystem>();
+    }
+
+    bool IsRenderer() const override {
+        return _IsRenderer<HasIsRenderer>();
+    }
 };
 
-extern std::unordered_map<string, std::shared_ptr<SystemFactory>> SystemFactoriesByName;
+extern FactoryRegistry<SystemFactory> SystemFactories;
 
-#define REGISTER_SYSTEM(system_t) cfl::SystemFactoriesByName[system_t::SystemName] = \
-std::static_pointer_cast<cfl::SystemFactory>(std::make_shared<cfl::ConcreteSystemFactory<system_t>>())
+#define REGISTER_SYSTEM(system_t) cfl::SystemFactories.Register( \
+std::static_pointer_cast<cfl::SystemFactory>(std::make_shared<cfl::ConcreteSystemFactory<system_t>>()))
 } // namespace cfl
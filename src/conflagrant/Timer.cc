@@ -0,0 +1,79 @@
+#include "Timer.hh"
+
+namespace cfl {
+TimerPool::~TimerPool() {
+    if (!allQueries.empty()) {
+        OGL(glDeleteQueries(static_cast<GLsizei>(allQueries.size()), allQueries.data()));
+    }
+}
+
+GLuint TimerPool::AcquireQuery() {
+    if (freeQueries.empty()) {
+        static constexpr GLsizei BatchSize = 32;
+
+        std::array<GLuint, BatchSize> queries;
+        OGL(glGenQueries(BatchSize, queries.data()));
+        freeQueries.insert(freeQueries.end(), queries.begin(), queries.end());
+        allQueries.insert(allQueries.end(), queries.begin(), queries.end());
+    }
+
+    auto const query = freeQueries.back();
+    freeQueries.pop_back();
+    return query;
+}
+
+bool TimerPool::Resolve(std::vector<Sample> &samples, GLuint lastQuery, std::map<string, TimedDuration> &durations) {
+    // queries complete in the order they were issued, so if the last issued one is available all of them are. With
+    // nested scopes that is not the end query of the last sample, but of the outermost scope that closed last
+    GLint available = GL_FALSE;
+    OGL(glGetQueryObjectiv(lastQuery, GL_QUERY_RESULT_AVAILABLE, &available));
+    if (available == GL_FALSE) {
+        return false;
+    }
+
+    // sum scopes that were entered more than once during the frame
+    std::unordered_map<string, TimedDuration> frameDurations;
+    for (auto const &sample : samples) {
+        GLuint64 begin, end;
+        OGL(glGetQueryObjectui64v(sample.beginQuery, GL_QUERY_RESULT, &begin));
+        OGL(glGetQueryObjectui64v(sample.endQuery, GL_QUERY_RESULT, &end));
+
+        auto &frameDuration = frameDurations[sample.name];
+        frameDuration.gpu += 1e-9 * static_cast<double>(end - begin);
+        frameDuration.cpu += sample.cpu;
+    }
+
+    for (auto const &kvp : frameDurations) {
+        auto it = durations.find(kvp.first);
+        if (it == durations.end()) {
+            durations[kvp.first] = kvp.second;
+            continue;
+        }
+
+        auto &average = it->second;
+        average.gpu += Smoothing * (kvp.second.gpu - average.gpu);
+        average.cpu += Smoothing * (kvp.second.cpu - average.cpu);
+    }
+
+    return true;
+}
+
+void TimerPool::BeginFrame(std::map<string, TimedDuration> &durations) {
+    currentFrame = (currentFrame + 1) % frames.size();
+
+    auto &samples = frames[currentFrame];
+    if (samples.empty()) {
+        return;
+    }
+
+    if (!Resolve(samples, lastQueries[currentFrame], durations)) {
+        droppedFrames++;
+    }
+
+    for (auto const &sample : samples) {
+        freeQueries.push_back(sample.beginQuery);
+        freeQueries.push_back(sample.endQuery);
+    }
+    samples.clear();
+}
+} // namespace cfl
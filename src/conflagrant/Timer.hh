@@ -3,25 +3,109 @@
 #include <conflagrant/types.hh>
 #include <conflagrant/GL.hh>
 #include <chrono>
+#include <map>
 #include <unordered_map>
 
 namespace cfl {
-template<typename time_t>
-class Timer {
-    time_t &time;
-    decltype(std::chrono::system_clock::now()) start;
+/**
+ * @brief Rolling averages of the GPU and CPU time spent in a named scope, in seconds.
+ */
+struct TimedDuration {
+    double gpu{0.0}, cpu{0.0};
+};
+
+/**
+ * @brief Measures named scopes on both the GPU and the CPU without stalling the pipeline.
+ *
+ * Each scope issues a pair of GL_TIMESTAMP queries (so scopes may nest) and records the CPU time between its
+ * construction and destruction. GPU results are read back FramesOfLatency frames later, when they are available
+ * without waiting. Frames whose queries are still pending when their slot is reused are dropped.
+ */
+class TimerPool {
+public:
+    static constexpr size_t FramesOfLatency = 3;
+
+    /**
+     * @brief Weight of the newest sample in the exponential moving average.
+     */
+    static constexpr double Smoothing = 0.1;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Sample {
+        string name;
+        GLuint beginQuery, endQuery;
+        double cpu;
+    };
+
+    std::array<std::vector<Sample>, FramesOfLatency + 1> frames;
+
+    // the query of every frame that was issued last, the end query of the outermost scope when scopes nest
+    std::array<GLuint, FramesOfLatency + 1> lastQueries{};
+    size_t currentFrame{0};
+    std::vector<GLuint> freeQueries, allQueries;
+    size_t droppedFrames{0};
+
+    GLuint AcquireQuery();
+
+    bool Resolve(std::vector<Sample> &samples, GLuint lastQuery, std::map<string, TimedDuration> &durations);
+
+    inline void IssueQuery(GLuint query) {
+        OGL(glQueryCounter(query, GL_TIMESTAMP));
+        lastQueries[currentFrame] = query;
+    }
+
+    TimerPool(TimerPool const &) = delete;
+
+    TimerPool &operator=(TimerPool const &) = delete;
 
 public:
-    inline Timer(time_t &time)
-            : time(time) {
-        OGL(glFinish());
-        start = std::chrono::system_clock::now();
+    class Scope {
+        TimerPool *pool;
+        size_t index;
+        clock::time_point start;
+
+    public:
+        inline Scope(TimerPool &pool, string const &name)
+                : pool(&pool) {
+            auto &samples = pool.frames[pool.currentFrame];
+            index = samples.size();
+            samples.push_back(Sample{name, pool.AcquireQuery(), pool.AcquireQuery(), 0.0});
+            pool.IssueQuery(samples[index].beginQuery);
+            start = clock::now();
+        }
+
+        inline Scope(Scope &&o) noexcept
+                : pool(o.pool), index(o.index), start(o.start) {
+            o.pool = nullptr;
+        }
+
+        inline ~Scope() {
+            if (!pool) return;
+
+            auto &sample = pool->frames[pool->currentFrame][index];
+            std::chrono::duration<double> const duration = clock::now() - start;
+            sample.cpu = duration.count();
+            pool->IssueQuery(sample.endQuery);
+        }
+    };
+
+    TimerPool() = default;
+
+    ~TimerPool();
+
+    inline Scope Time(string const &name) {
+        return Scope(*this, name);
     }
 
-    inline ~Timer() {
-        OGL(glFinish());
-        std::chrono::duration<time_t> duration = std::chrono::system_clock::now() - start;
-        time = duration.count();
+    /**
+     * @brief Starts a new frame, folding every frame whose results have become available into durations.
+     */
+    void BeginFrame(std::map<string, TimedDuration> &durations);
+
+    inline size_t DroppedFrames() const {
+        return droppedFrames;
     }
 };
 } // namespace cfl
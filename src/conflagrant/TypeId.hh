@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+namespace cfl {
+using TypeId = uint32_t;
+
+constexpr TypeId NoTypeId = std::numeric_limits<TypeId>::max();
+
+namespace detail {
+template<typename Family>
+inline TypeId &NextTypeId() {
+    static TypeId next = 0;
+    return next;
+}
+} // namespace detail
+
+/**
+ * @returns A dense id of the type among the types of the family, assigned on first use. Ids index arrays, unlike the
+ * names or type_info of the types.
+ */
+template<typename Family, typename T>
+inline TypeId GetTypeId() {
+    static TypeId const id = detail::NextTypeId<Family>()++;
+    return id;
+}
+
+/**
+ * @brief Family of the component type ids.
+ */
+struct ComponentFamily;
+
+template<typename TComponent>
+inline TypeId GetComponentTypeId() {
+    return GetTypeId<ComponentFamily, TComponent>();
+}
+
+/**
+ * @brief Family of the system type ids.
+ */
+struct SystemFamily;
+
+template<typename TSystem>
+inline TypeId GetSystemTypeId() {
+    return GetTypeId<SystemFamily, TSystem>();
+}
+} // namespace cfl
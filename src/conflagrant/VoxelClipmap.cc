@@ -0,0 +1,127 @@
+#include "VoxelClipmap.hh"
+
+#include <algorithm>
+
+namespace cfl {
+namespace {
+/**
+ * @brief Splits [min, max) of one axis at the multiples of the resolution, in texel coordinates.
+ */
+std::vector<std::pair<int, int>> ToroidalRanges(int min, int max, int resolution) {
+    auto const start = ((min % resolution) + resolution) % resolution;
+    auto const length = max - min;
+
+    if (start + length <= resolution) {
+        return {{start, start + length}};
+    }
+    return {{start, resolution}, {0, start + length - resolution}};
+}
+} // namespace
+
+bool VoxelClipmap::Box::IsEmpty() const {
+    return min.x >= max.x || min.y >= max.y || min.z >= max.z;
+}
+
+bool VoxelClipmap::Configure(int newResolution, int newNumLevels, float newVoxelSize) {
+    newNumLevels = std::max(1, std::min(newNumLevels, MaxLevels));
+    if (newResolution == resolution && newNumLevels == numLevels && newVoxelSize == voxelSize) {
+        return false;
+    }
+
+    resolution = newResolution;
+    numLevels = newNumLevels;
+    voxelSize = newVoxelSize;
+    isValid = false;
+    return true;
+}
+
+void VoxelClipmap::Invalidate() {
+    isValid = false;
+}
+
+std::vector<VoxelClipmap::Update> VoxelClipmap::Recenter(vec3 const &position) {
+    std::vector<Update> updates;
+
+    for (int level = 0; level < numLevels; ++level) {
+        auto const oldOrigin = origins[level];
+        auto const newOrigin = ivec3(glm::floor(position / VoxelSize(level))) - ivec3(resolution / 2);
+        origins[level] = newOrigin;
+
+        Box remaining{newOrigin, newOrigin + ivec3(resolution)};
+        auto const delta = newOrigin - oldOrigin;
+
+        if (!isValid || glm::any(glm::greaterThanEqual(glm::abs(delta), ivec3(resolution)))) {
+            updates.push_back(Update{level, remaining});
+            continue;
+        }
+
+        // one slab per axis, each cut off the remaining box so that the slabs do not overlap at the edges
+        for (int axis = 0; axis < 3; ++axis) {
+            if (delta[axis] == 0) {
+                continue;
+            }
+
+            Box slab = remaining;
+            if (delta[axis] > 0) {
+                slab.min[axis] = oldOrigin[axis] + resolution;
+                remaining.max[axis] = slab.min[axis];
+            } else {
+                slab.max[axis] = oldOrigin[axis];
+                remaining.min[axis] = slab.max[axis];
+            }
+            updates.push_back(Update{level, slab});
+        }
+    }
+
+    isValid = true;
+    return updates;
+}
+
+std::vector<VoxelClipmap::Box> VoxelClipmap::TexelBoxes(Update const &update) const {
+    auto const xs = ToroidalRanges(update.box.min.x, update.box.max.x, resolution);
+    auto const ys = ToroidalRanges(update.box.min.y, update.box.max.y, resolution);
+    auto const zs = ToroidalRanges(update.box.min.z, update.box.max.z, resolution);
+    auto const zOffset = update.level * resolution;
+
+    std::vector<Box> boxes;
+    for (auto const &x : xs) {
+        for (auto const &y : ys) {
+            for (auto const &z : zs) {
+                boxes.push_back(Box{ivec3(x.first, y.first, zOffset + z.first),
+                                    ivec3(x.second, y.second, zOffset + z.second)});
+            }
+        }
+    }
+    return boxes;
+}
+
+int VoxelClipmap::Resolution() const {
+    return resolution;
+}
+
+int VoxelClipmap::NumLevels() const {
+    return numLevels;
+}
+
+float VoxelClipmap::VoxelSize(int level) const {
+    return voxelSize * static_cast<float>(1 << level);
+}
+
+ivec3 const &VoxelClipmap::Origin(int level) const {
+    return origins[level];
+}
+
+vec3 VoxelClipmap::Center(int level) const {
+    return (vec3(origins[level]) + 0.5f * static_cast<float>(resolution)) * VoxelSize(level);
+}
+
+float VoxelClipmap::HalfExtent(int level) const {
+    return 0.5f * static_cast<float>(resolution) * VoxelSize(level);
+}
+
+void VoxelClipmap::Bounds(int level, Box const &box, vec3 &center, vec3 &halfDimensions) const {
+    auto const size = VoxelSize(level);
+    center = 0.5f * vec3(box.min + box.max) * size;
+    halfDimensions = 0.5f * vec3(box.max - box.min) * size;
+}
+} // namespace cfl
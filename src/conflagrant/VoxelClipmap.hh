@@ -0,0 +1,86 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+
+namespace cfl {
+/**
+ * @brief Bookkeeping of nested voxel volumes (levels) that follow the camera, see voxels/common/clipmap.glsl.
+ *
+ * Every level has the same resolution, and level l + 1 covers twice the extent of level l, so its voxels are twice
+ * as large. Levels are addressed toroidally: the voxel at integer world voxel coordinate v of a level is stored at
+ * texel v mod resolution. When the camera moves, the voxels that stay inside a level keep their texels, and only the
+ * slabs that enter the level have to be cleared and voxelized.
+ */
+class VoxelClipmap {
+public:
+    static constexpr int MaxLevels = 8;
+
+    /**
+     * @brief Axis-aligned box of voxels or texels, min inclusive and max exclusive.
+     */
+    struct Box {
+        ivec3 min, max;
+
+        bool IsEmpty() const;
+    };
+
+    /**
+     * @brief Voxels of a level that have to be cleared and voxelized, in world voxel coordinates of the level.
+     */
+    struct Update {
+        int level;
+        Box box;
+    };
+
+private:
+    int resolution{0}, numLevels{0};
+    float voxelSize{0};
+    std::array<ivec3, MaxLevels> origins;
+    bool isValid{false};
+
+public:
+    /**
+     * @param resolution Voxels per side of every level, a power of two.
+     * @param voxelSize Size of the voxels of level 0.
+     * @returns true if anything changed, in which case every level is voxelized from scratch by the next Recenter().
+     */
+    bool Configure(int resolution, int numLevels, float voxelSize);
+
+    /**
+     * @brief Makes the next Recenter() voxelize every level from scratch.
+     */
+    void Invalidate();
+
+    /**
+     * @brief Moves every level so that it is centered on the position, snapped to the level's voxels.
+     * @returns The boxes that entered the levels. The boxes of one level do not overlap.
+     */
+    std::vector<Update> Recenter(vec3 const &position);
+
+    /**
+     * @returns The texels of a box of voxels of one level, split into several boxes where the toroidal addressing
+     * wraps around. The texels of level l start at z = l * resolution.
+     */
+    std::vector<Box> TexelBoxes(Update const &update) const;
+
+    int Resolution() const;
+
+    int NumLevels() const;
+
+    float VoxelSize(int level) const;
+
+    /**
+     * @returns The world voxel coordinate of the first voxel of the level.
+     */
+    ivec3 const &Origin(int level) const;
+
+    vec3 Center(int level) const;
+
+    float HalfExtent(int level) const;
+
+    /**
+     * @brief The world space bounds of a box of voxels of the level.
+     */
+    void Bounds(int level, Box const &box, vec3 &center, vec3 &halfDimensions) const;
+};
+} // namespace cfl
@@ -0,0 +1,140 @@
+#include "VoxelMipmapper.hh"
+
+#include <conflagrant/SparseVoxelOctree.hh>
+
+#include <algorithm>
+
+namespace cfl {
+namespace {
+/**
+ * @brief Running filter of the non-empty children of a texel, like Accumulate() in voxels/mipmap.comp.
+ */
+struct Filter {
+    vec3 color{0, 0, 0};
+    float alpha{0};
+    int count{0};
+
+    void Accumulate(vec4 const &child, bool isFirstLevel) {
+        if (child.a > 0) {
+            color += vec3(child);
+            alpha += isFirstLevel ? std::min(255 * child.a, 1.0f) : child.a;
+            count++;
+        }
+    }
+
+    /**
+     * @returns The filtered texel, rounded to RGBA8 like it is when it is stored.
+     */
+    vec4 Resolve() const {
+        if (count == 0) {
+            return vec4(0, 0, 0, 0);
+        }
+        return SparseVoxelOctree::UnpackColor(SparseVoxelOctree::PackColor(
+                vec4(color / static_cast<float>(count), std::min(alpha, 1.0f))));
+    }
+};
+
+uint32_t TexelIndex(uvec3 const &texel, uint32_t side) {
+    return texel.x + side * (texel.y + side * texel.z);
+}
+
+bool IsInside(uvec3 const &texel, uint32_t side) {
+    return texel.x < side && texel.y < side && texel.z < side;
+}
+} // namespace
+
+std::vector<VoxelMipmapDispatch> VoxelMipmapper::Plan(uint32_t resolution, uint32_t numLevels,
+                                                      uint32_t levelsPerDispatch) {
+    levelsPerDispatch = std::max(1u, std::min(levelsPerDispatch, MaxLevelsPerDispatch));
+
+    uint32_t lastLevel = 0;
+    while (lastLevel + 1 < numLevels && (resolution >> lastLevel) > 1) {
+        lastLevel++;
+    }
+
+    std::vector<VoxelMipmapDispatch> dispatches;
+    for (uint32_t level = 0; level < lastLevel;) {
+        auto const numLevelsOfDispatch = std::min(levelsPerDispatch, lastLevel - level);
+        auto const firstSide = std::max(1u, resolution >> (level + 1));
+
+        dispatches.push_back(VoxelMipmapDispatch{level, numLevelsOfDispatch, (firstSide + GroupSize - 1) / GroupSize});
+        level += numLevelsOfDispatch;
+    }
+    return dispatches;
+}
+
+void VoxelMipmapper::Run(VoxelVolume &volume, uint32_t numLevels, uint32_t levelsPerDispatch) {
+    auto const dispatches = Plan(volume.Resolution(), numLevels, levelsPerDispatch);
+    volume.SetNumLevels(dispatches.empty() ? 1 : dispatches.back().sourceLevel + dispatches.back().numLevels + 1);
+
+    // the shared memory of one work group
+    std::vector<vec4> tile(GroupSize * GroupSize * GroupSize), nextTile(tile.size());
+
+    for (auto const &dispatch : dispatches) {
+        auto const sourceSide = volume.LevelResolution(dispatch.sourceLevel);
+        auto const firstSide = volume.LevelResolution(dispatch.sourceLevel + 1);
+        auto const &source = volume.Level(dispatch.sourceLevel);
+
+        for (uint32_t gz = 0; gz < dispatch.numGroups; ++gz) {
+            for (uint32_t gy = 0; gy < dispatch.numGroups; ++gy) {
+                for (uint32_t gx = 0; gx < dispatch.numGroups; ++gx) {
+                    uvec3 const group(gx, gy, gz);
+
+                    // every invocation filters 2x2x2 texels of the source level
+                    for (uint32_t i = 0; i < tile.size(); ++i) {
+                        uvec3 const local(i % GroupSize, (i / GroupSize) % GroupSize, i / (GroupSize * GroupSize));
+                        uvec3 const texel(group.x * GroupSize + local.x, group.y * GroupSize + local.y,
+                                          group.z * GroupSize + local.z);
+
+                        Filter filter;
+                        if (IsInside(texel, firstSide)) {
+                            for (uint32_t c = 0; c < 8; ++c) {
+                                uvec3 const child(2 * texel.x + (c & 1), 2 * texel.y + ((c >> 1) & 1),
+                                                  2 * texel.z + ((c >> 2) & 1));
+                                filter.Accumulate(SparseVoxelOctree::UnpackColor(
+                                        source[TexelIndex(child, sourceSide)]), dispatch.sourceLevel == 0);
+                            }
+                        }
+
+                        tile[i] = filter.Resolve();
+                        if (IsInside(texel, firstSide)) {
+                            volume.Level(dispatch.sourceLevel + 1)[TexelIndex(texel, firstSide)] =
+                                    SparseVoxelOctree::PackColor(tile[i]);
+                        }
+                    }
+
+                    // the first eighth of the invocations reduces the tile into the next level, and so on
+                    for (uint32_t k = 2; k <= dispatch.numLevels; ++k) {
+                        auto const level = dispatch.sourceLevel + k;
+                        auto const side = GroupSize >> (k - 1);
+                        auto const levelSide = volume.LevelResolution(level);
+
+                        for (uint32_t i = 0; i < side * side * side; ++i) {
+                            uvec3 const local(i % side, (i / side) % side, i / (side * side));
+
+                            Filter filter;
+                            for (uint32_t c = 0; c < 8; ++c) {
+                                uvec3 const child(2 * local.x + (c & 1), 2 * local.y + ((c >> 1) & 1),
+                                                  2 * local.z + ((c >> 2) & 1));
+                                filter.Accumulate(tile[TexelIndex(child, GroupSize)], false);
+                            }
+
+                            auto const result = filter.Resolve();
+                            nextTile[TexelIndex(local, GroupSize)] = result;
+
+                            uvec3 const texel(group.x * side + local.x, group.y * side + local.y,
+                                              group.z * side + local.z);
+                            if (IsInside(texel, levelSide)) {
+                                volume.Level(level)[TexelIndex(texel, levelSide)] =
+                                        SparseVoxelOctree::PackColor(result);
+                            }
+                        }
+
+                        std::swap(tile, nextTile);
+                    }
+                }
+            }
+        }
+    }
+}
+} // namespace cfl
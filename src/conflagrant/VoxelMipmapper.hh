@@ -0,0 +1,59 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/CpuVoxelizer.hh>
+
+namespace cfl {
+/**
+ * @brief One glDispatchCompute of voxels/mipmap.comp.
+ */
+struct VoxelMipmapDispatch {
+    /**
+     * @brief The level that is read, the dispatch writes the numLevels levels after it.
+     */
+    uint32_t sourceLevel;
+
+    uint32_t numLevels;
+
+    /**
+     * @brief Work groups per axis.
+     */
+    uint32_t numGroups;
+};
+
+/**
+ * @brief Plans the dispatches of voxels/mipmap.comp and runs them on the CPU as a reference.
+ *
+ * Every invocation filters 2x2x2 texels of the source level into one texel of the next level. The work group then
+ * keeps reducing its 8x8x8 results in shared memory into the 4x4x4 and 2x2x2 texels of the levels after that, so a
+ * dispatch writes up to three levels, and only the dispatches need a memory barrier between them.
+ */
+class VoxelMipmapper {
+    VoxelMipmapper() = delete;
+
+public:
+    /**
+     * @brief Invocations per axis of a work group, must match GROUP_SIZE in voxels/mipmap.comp.
+     */
+    static constexpr uint32_t GroupSize = 8;
+
+    /**
+     * @brief log2(GroupSize), the last level of a dispatch is reduced to 1x1x1 texels per work group.
+     */
+    static constexpr uint32_t MaxLevelsPerDispatch = 3;
+
+    /**
+     * @param resolution Resolution of level 0.
+     * @param numLevels All levels of the texture including level 0, of which levels 1 to numLevels - 1 are built.
+     * Stops early at a resolution of 1.
+     * @param levelsPerDispatch Clamped to [1, MaxLevelsPerDispatch].
+     */
+    static std::vector<VoxelMipmapDispatch> Plan(uint32_t resolution, uint32_t numLevels, uint32_t levelsPerDispatch);
+
+    /**
+     * @brief Builds the mipmaps of the volume the same way as the dispatches of Plan() on the GPU, one work group at
+     * a time. The result is the same as VoxelVolume::GenerateMipmaps(numLevels - 1).
+     */
+    static void Run(VoxelVolume &volume, uint32_t numLevels, uint32_t levelsPerDispatch);
+};
+} // namespace cfl
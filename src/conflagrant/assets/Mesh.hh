@@ -29,6 +29,10 @@ struct Mesh : public Asset {
             : vertices(vertices),
               triangles(triangles) {}
 
+    /**
+     * @brief Uploads the mesh to the GPU if needsUpdate is set.
+     * @returns true if any data was uploaded.
+     */
     bool Update();
 
     /**
@@ -58,7 +62,9 @@ struct Mesh : public Asset {
 };
 
 inline bool Mesh::Update() {
-    if (!needsUpdate) return false;
+    if (!needsUpdate) {
+        return false;
+    }
 
     if (!glMesh) {
         glMesh = std::make_shared<gl::Mesh>();
@@ -71,7 +77,9 @@ inline bool Mesh::Update() {
     }
 
     glMesh->BufferVertexData(sizeof(Vertex) * vertices.size(), vertices.data(), GL_DYNAMIC_DRAW);
-    glMesh->BufferIndexData(GL_UNSIGNED_INT, 3 * triangles.size(), triangles.data(), GL_DYNAMIC_DRAW, GL_TRIANGLES);
+    glMesh->BufferIndexData(GL_UNSIGNED_INT, 3 * triangles.size(), triangles.data(), GL_DYNAMIC_DRAW,
+                            GL_TRIANGLES);
+    needsUpdate = false;
 
     // update bounding volumes
     vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::min());
@@ -43,7 +43,6 @@ void ProcessNode(aiNode const *node, aiScene const *scene,
         }
 
         mesh->Update();
-        mesh->needsUpdate = false;
         auto &material = materials[aimesh->mMaterialIndex];
 
         model.parts.emplace_back(mesh, material);
@@ -4,6 +4,7 @@
 #include <conflagrant/GL.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/InputManager.hh>
+#include <conflagrant/JournaledComponent.hh>
 #include <conflagrant/gl/Framebuffer.hh>
 #include <conflagrant/gl/Texture.hh>
 
@@ -11,7 +12,7 @@
 
 namespace cfl {
 namespace comp {
-struct DirectionalLightShadow {
+struct DirectionalLightShadow : public JournaledComponent {
     static constexpr auto ComponentName = "DirectionalLightShadow";
 
     std::shared_ptr<gl::Framebuffer> framebuffer;
@@ -63,12 +64,12 @@ struct DirectionalLightShadow {
 
     inline static bool DrawWithImGui(DirectionalLightShadow &comp, InputManager const &input) {
         ivec2 size(comp.width, comp.height);
-        comp.hasChanged |= ImGui::InputInt2("Texture width", glm::value_ptr(size));
-        comp.hasChanged |= ImGui::DragFloat("Distance from scene", &comp.distanceFromScene, 1.0f, 0.0f);
+        bool changed = ImGui::InputInt2("Texture width", glm::value_ptr(size));
+        changed |= ImGui::DragFloat("Distance from scene", &comp.distanceFromScene, 1.0f, 0.0f);
 
         auto label = comp.filterMethod == GL_NEAREST ? "Nearest neighbour" : "Linear interp.";
         bool clicked = ImGui::Button(label);
-        comp.hasChanged |= clicked;
+        changed |= clicked;
 
         if (clicked) {
             if (comp.filterMethod == GL_NEAREST) {
@@ -78,9 +79,11 @@ struct DirectionalLightShadow {
             }
         }
 
-        if (comp.hasChanged) {
+        if (changed) {
             comp.width = static_cast<uint>(size.x);
             comp.height = static_cast<uint>(size.y);
+            comp.hasChanged = true;
+            comp.RecordChange();
         }
 
         return true;
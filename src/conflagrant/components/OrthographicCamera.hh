@@ -4,13 +4,14 @@
 #include <conflagrant/GL.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/geometry.hh>
+#include <conflagrant/JournaledComponent.hh>
 
 #include <imgui.h>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace cfl {
 namespace comp {
-class OrthographicCamera {
+class OrthographicCamera : public JournaledComponent {
 public:
     static constexpr auto ComponentName = "OrthographicCamera";
 
@@ -20,6 +21,11 @@ private:
 
     bool hasChanged{true};
 
+    inline void Changed() {
+        hasChanged = true;
+        RecordChange();
+    }
+
     mat4 projection;
     geometry::Frustum frustum;
 
@@ -59,7 +65,7 @@ public:
 
     inline void Scale(float scale) {
         this->scale = scale;
-        hasChanged = true;
+        Changed();
     }
 
     inline float ZNear() const {
@@ -68,7 +74,7 @@ public:
 
     inline void ZNear(float zNear) {
         this->zNear = zNear;
-        hasChanged = true;
+        Changed();
     }
 
     inline float ZFar() const {
@@ -77,7 +83,7 @@ public:
 
     inline void ZFar(float zFar) {
         this->zFar = zFar;
-        hasChanged = true;
+        Changed();
     }
 
     inline uvec2 Size() const {
@@ -86,7 +92,7 @@ public:
 
     inline void Size(uvec2 size) {
         this->size = size;
-        hasChanged = true;
+        Changed();
     }
 
     inline mat4 const &GetProjection() const {
@@ -107,7 +113,9 @@ public:
         SERIALIZE(cfl::comp::OrthographicCamera, json["scale"], camera.scale);
         SERIALIZE(cfl::comp::OrthographicCamera, json["near"], camera.zNear);
         SERIALIZE(cfl::comp::OrthographicCamera, json["far"], camera.zFar);
-        camera.hasChanged |= serializer.IsDeserializer();
+        if (serializer.IsDeserializer()) {
+            camera.Changed();
+        }
         return true;
     }
 
@@ -116,9 +124,13 @@ public:
         float const DragSpeed = (input.GetKey(Key::LEFT_CONTROL) || input.GetKey(Key::LEFT_SHIFT))
                                 ? 0.01f : 0.5f;
 
-        camera.hasChanged |= ImGui::DragFloat("Scale", &camera.scale, DragSpeed);
-        camera.hasChanged |= ImGui::DragFloat("Near clip", &camera.zNear, DragSpeed);
-        camera.hasChanged |= ImGui::DragFloat("Far clip", &camera.zFar, DragSpeed);
+        bool changed = ImGui::DragFloat("Scale", &camera.scale, DragSpeed);
+        changed |= ImGui::DragFloat("Near clip", &camera.zNear, DragSpeed);
+        changed |= ImGui::DragFloat("Far clip", &camera.zFar, DragSpeed);
+
+        if (changed) {
+            camera.Changed();
+        }
 
         return true;
     }
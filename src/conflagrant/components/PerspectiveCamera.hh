@@ -4,13 +4,14 @@
 #include <conflagrant/GL.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/geometry.hh>
+#include <conflagrant/JournaledComponent.hh>
 
 #include <imgui.h>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace cfl {
 namespace comp {
-class PerspectiveCamera {
+class PerspectiveCamera : public JournaledComponent {
 public:
     static constexpr auto ComponentName = "PerspectiveCamera";
 
@@ -20,6 +21,11 @@ private:
 
     bool hasChanged{true};
 
+    inline void Changed() {
+        hasChanged = true;
+        RecordChange();
+    }
+
     mat4 projection;
     geometry::Frustum frustum;
 
@@ -70,7 +76,7 @@ public:
 
     inline void Fov(float fov) {
         this->fov = fov;
-        hasChanged = true;
+        Changed();
     }
 
     inline float ZNear() const {
@@ -79,7 +85,7 @@ public:
 
     inline void ZNear(float zNear) {
         this->zNear = zNear;
-        hasChanged = true;
+        Changed();
     }
 
     inline float ZFar() const {
@@ -88,7 +94,7 @@ public:
 
     inline void ZFar(float zFar) {
         this->zFar = zFar;
-        hasChanged = true;
+        Changed();
     }
 
     inline uvec2 Size() const {
@@ -97,7 +103,7 @@ public:
 
     inline void Size(uvec2 size) {
         this->size = size;
-        hasChanged = true;
+        Changed();
     }
 
     inline mat4 const &GetProjection() const {
@@ -117,7 +123,9 @@ public:
         SERIALIZE(cfl::comp::PerspectiveCamera, json["fov"], camera.fov);
         SERIALIZE(cfl::comp::PerspectiveCamera, json["zNear"], camera.zNear);
         SERIALIZE(cfl::comp::PerspectiveCamera, json["zFar"], camera.zFar);
-        camera.hasChanged |= serializer.IsDeserializer();
+        if (serializer.IsDeserializer()) {
+            camera.Changed();
+        }
         return true;
     }
 
@@ -126,11 +134,13 @@ public:
                                 ? 0.01f : 0.5f;
 
         float constexpr MinimumDiff = 1e-4f;
-        camera.hasChanged |= ImGui::DragFloat("Field of view", &camera.fov, DragSpeed, 1.0f, 120.0f);
-        camera.hasChanged |= ImGui::DragFloat("Near clip", &camera.zNear, DragSpeed,
-                                              MinimumDiff, camera.zFar - MinimumDiff);
-        camera.hasChanged |= ImGui::DragFloat("Far clip", &camera.zFar, DragSpeed,
-                                              camera.zNear + MinimumDiff);
+        bool changed = ImGui::DragFloat("Field of view", &camera.fov, DragSpeed, 1.0f, 120.0f);
+        changed |= ImGui::DragFloat("Near clip", &camera.zNear, DragSpeed, MinimumDiff, camera.zFar - MinimumDiff);
+        changed |= ImGui::DragFloat("Far clip", &camera.zFar, DragSpeed, camera.zNear + MinimumDiff);
+
+        if (changed) {
+            camera.Changed();
+        }
 
         return true;
     }
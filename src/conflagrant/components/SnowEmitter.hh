@@ -1,16 +1,16 @@
 #pragma once
 
 #include <variant>
+#include <limits>
 
 #include <conflagrant/types.hh>
 #include <conflagrant/GL.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/InputManager.hh>
 #include <conflagrant/math.hh>
+#include <conflagrant/SnowSimulation.hh>
 
-#include <conflagrant/gl/Texture.hh>
-#include <conflagrant/gl/Framebuffer.hh>
-#include <conflagrant/gl/DoubleBufferedTexture2D.hh>
+#include <conflagrant/gl/Buffer.hh>
 
 #include <imgui.h>
 
@@ -19,6 +19,20 @@ namespace comp {
 struct SnowEmitter {
     static constexpr auto ComponentName = "SnowEmitter";
 
+    static constexpr int CountLimit = 1 << 20;
+
+    // the particle storage grows and shrinks by this many particles at a time
+    static constexpr int CapacityStep = 16384;
+
+    // must match snow/SnowParticle.glsl
+    static constexpr GLuint PositionsBinding = 1;
+    static constexpr GLuint VelocitiesBinding = 2;
+    static constexpr GLuint AnglesBinding = 3;
+    static constexpr GLuint LifetimesBinding = 4;
+    static constexpr GLuint DrawCommandBinding = 5;
+    // must match SORT_BINDING of snow/BitonicSort.glsl
+    static constexpr GLuint SortBinding = 0;
+
     inline static bool Serialize(BaseSerializer const &serializer, Json::Value &json,
                                  SnowEmitter &comp) {
         SERIALIZE(cfl::comp::Snowfall, json["count"], comp.count);
@@ -30,56 +44,103 @@ struct SnowEmitter {
     inline static bool DrawWithImGui(SnowEmitter &comp, InputManager const &input) {
         if (ImGui::InputInt("Count", &comp.count))
         {
-            comp.count = math::Clamp(comp.count, 0, math::Pow(2, 16));
+            comp.count = math::Clamp(comp.count, 0, CountLimit);
         }
         ImGui::DragFloat("Radius", &comp.radius, 0.01f, 0.001f, 1.0f);
         ImGui::DragFloat3("Dimensions", glm::value_ptr(comp.dimensions), 0.2f, 0.0f, 25.0f);
+        ImGui::Text("Capacity: %d particles", comp.capacity);
+        ImGui::Text("Level of detail: %d particles%s", comp.lodCount, comp.isVisible ? "" : ", not visible");
         return true;
     }
 
-    int count{0}, maxCount{0};
+    int count{0}, capacity{0};
     float radius{0.1f};
     vec3 dimensions;
 
-    std::shared_ptr<gl::DoubleBufferedTexture2D> positionsAngles, velocitiesLifetimes;
-    std::shared_ptr<gl::Framebuffer> framebuffer;
+    // one shader storage buffer per attribute, positions and velocities are packed vec3's
+    std::shared_ptr<gl::Buffer> positions, velocities, angles, lifetimes;
+
+    // the DrawArraysIndirectCommand of the particles, written by the simulation
+    std::shared_ptr<gl::Buffer> drawCommand;
+
+    // a (key, index) pair per particle, rounded up to a power of two, for sorting by depth on the GPU
+    std::shared_ptr<gl::Buffer> sortBuffer;
 
+    // true if sortBuffer holds the back to front order of the particles of this frame
+    bool isSortedOnGpu{false};
+
+    // the particles of the CPU simulation, uploaded to the buffers every frame
+    std::shared_ptr<SnowParticles> cpuParticles;
+
+    // the level of detail of this frame, set by syst::SnowfallAnimator
+    bool isVisible{true};
+    int lodCount{0};
+    float lodRadiusScale{1};
+
+    // the simulation steps that were skipped while the emitter was not visible, caught up by the next one
+    int skippedFrames{0};
+    float skippedTime{0};
 };
 
-inline void InitializeComponent(SnowEmitter &snow) {
-    auto const width = static_cast<GLsizei>(snow.maxCount);
-    auto const height = static_cast<GLsizei>(1);
-
-    snow.framebuffer = std::make_shared<gl::Framebuffer>(width, height);
-    snow.framebuffer->Bind();
-
-    snow.positionsAngles
-            = std::make_shared<gl::DoubleBufferedTexture2D>(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-    snow.positionsAngles->ApplyToBoth([](std::shared_ptr<gl::Texture2D> &tex) {
-        tex->Bind();
-        tex->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        tex->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        tex->Unbind();
-    });
-    snow.framebuffer->Attach(GL_COLOR_ATTACHMENT0, snow.positionsAngles->Front());
-
-    snow.velocitiesLifetimes
-            = std::make_shared<gl::DoubleBufferedTexture2D>(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-    snow.velocitiesLifetimes->ApplyToBoth([](std::shared_ptr<gl::Texture2D> &tex) {
-        tex->Bind();
-        tex->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        tex->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        tex->Unbind();
-    });
-    snow.framebuffer->Attach(GL_COLOR_ATTACHMENT1, snow.velocitiesLifetimes->Front());
-
-    snow.framebuffer->Attach(GL_DEPTH_ATTACHMENT,
-                             std::make_shared<gl::Renderbuffer>(width, height, GL_DEPTH_COMPONENT));
-
-    if (!snow.framebuffer->CheckIsComplete()) {
-        LOG_ERROR(cfl::DeferredRenderer::UpdateFramebuffer) << "Framebuffer incomplete";
+/**
+ * @brief Grows or shrinks the particle buffers to the multiple of SnowEmitter::CapacityStep that holds count
+ * particles, and creates the draw command. The particles that fit into both the old and the new buffers are kept, the
+ * new ones respawn in the next simulation step.
+ */
+inline void ReserveParticleStorage(SnowEmitter &snow) {
+    auto const step = SnowEmitter::CapacityStep;
+    auto const capacity = ((snow.count + step - 1) / step) * step;
+
+    if (!snow.drawCommand) {
+        GLuint const command[4] = {1, 0, 0, 0};
+        snow.drawCommand = std::make_shared<gl::Buffer>();
+        snow.drawCommand->Bind(GL_DRAW_INDIRECT_BUFFER);
+        snow.drawCommand->BufferData(sizeof(command), command, GL_DYNAMIC_DRAW);
+        gl::Buffer::Unbind(GL_DRAW_INDIRECT_BUFFER);
+    }
+
+    if (capacity == snow.capacity && snow.positions) {
+        return;
     }
 
+    auto const numKept = static_cast<GLsizeiptr>(std::min(capacity, snow.capacity));
+
+    auto const reallocate = [&](std::shared_ptr<gl::Buffer> &buffer, GLsizeiptr particleSize, float initialValue) {
+        auto resized = std::make_shared<gl::Buffer>();
+
+        // binding once makes the generated name an actual buffer object
+        resized->Bind(GL_SHADER_STORAGE_BUFFER);
+        resized->BufferData(capacity * particleSize, nullptr, GL_DYNAMIC_COPY);
+        gl::Buffer::Unbind(GL_SHADER_STORAGE_BUFFER);
+
+        if (buffer && numKept > 0) {
+            OGL(glCopyNamedBufferSubData(buffer->ID(), resized->ID(), 0, 0, numKept * particleSize));
+        }
+        if (capacity > numKept) {
+            OGL(glClearNamedBufferSubData(resized->ID(), GL_R32F, numKept * particleSize,
+                                          (capacity - numKept) * particleSize, GL_RED, GL_FLOAT, &initialValue));
+        }
+
+        buffer = std::move(resized);
+    };
+
+    reallocate(snow.positions, 3 * sizeof(float), 0.0f);
+    reallocate(snow.velocities, 3 * sizeof(float), 0.0f);
+    reallocate(snow.angles, sizeof(float), 0.0f);
+    // a lifetime past the maximum respawns the particle
+    reallocate(snow.lifetimes, sizeof(float), std::numeric_limits<float>::max());
+
+    snow.capacity = capacity;
+}
+
+/**
+ * @brief Binds the particle buffers to the bindings of snow/SnowParticle.glsl.
+ */
+inline void BindParticleStorage(SnowEmitter const &snow) {
+    OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SnowEmitter::PositionsBinding, snow.positions->ID()));
+    OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SnowEmitter::VelocitiesBinding, snow.velocities->ID()));
+    OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SnowEmitter::AnglesBinding, snow.angles->ID()));
+    OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SnowEmitter::LifetimesBinding, snow.lifetimes->ID()));
 }
 } // namespace comp
 } // namespace cfl
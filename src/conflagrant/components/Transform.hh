@@ -2,6 +2,7 @@
 
 #include <conflagrant/types.hh>
 #include <conflagrant/GL.hh>
+#include <conflagrant/JournaledComponent.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/serialization/glm.hh>
 
@@ -11,7 +12,7 @@
 
 namespace cfl {
 namespace comp {
-class Transform {
+class Transform : public JournaledComponent {
 public:
     static constexpr auto ComponentName = "Transform";
 
@@ -23,6 +24,11 @@ private:
     float scale{1.0f};
     vec3 pivot{0.0f, 0.0f, 0.0f};
 
+    inline void Changed() {
+        hasChanged = true;
+        RecordChange();
+    }
+
     inline void UpdateMatrix() {
         if (!hasChanged) {
             return;
@@ -44,7 +50,7 @@ public:
 
     inline void Position(vec3 const &value) {
         position = value;
-        hasChanged = true;
+        Changed();
     }
 
     inline quat const &Quaternion() const {
@@ -53,7 +59,7 @@ public:
 
     inline void Quaternion(quat const &value) {
         rotation = value;
-        hasChanged = true;
+        Changed();
     }
 
     inline vec3 EulerAnglesDegrees() const {
@@ -62,7 +68,7 @@ public:
 
     inline void EulerAnglesDegrees(vec3 const &value) {
         rotation = glm::quat(glm::radians(value));
-        hasChanged = true;
+        Changed();
     }
 
     inline float Scale() const {
@@ -71,6 +77,7 @@ public:
 
     inline void Scale(float value) {
         scale = value;
+        Changed();
     }
 
     inline vec3 const &Pivot() const {
@@ -79,7 +86,7 @@ public:
 
     inline void Pivot(vec3 const &value) {
         pivot = value;
-        hasChanged = true;
+        Changed();
     }
 
     inline mat4 const &GetMatrix() const {
@@ -95,7 +102,9 @@ public:
         SERIALIZE(cfl::comp::Transform, json["position"], transform.position);
         SERIALIZE(cfl::comp::Transform, json["orientation"], transform.rotation);
         SERIALIZE(cfl::comp::Transform, json["scale"], transform.scale);
-        transform.hasChanged |= serializer.IsDeserializer();
+        if (serializer.IsDeserializer()) {
+            transform.Changed();
+        }
         return true;
     }
 
@@ -103,15 +112,20 @@ public:
         $
         float const DragSpeed = input.GetKey(Key::LEFT_SHIFT) ? 0.01f : 0.5f;
 
-        transform.hasChanged |= ImGui::DragFloat3("Pivot", glm::value_ptr(transform.pivot), DragSpeed);
-        transform.hasChanged |= ImGui::DragFloat3("Position", glm::value_ptr(transform.position), DragSpeed);
+        bool changed = ImGui::DragFloat3("Pivot", glm::value_ptr(transform.pivot), DragSpeed);
+        changed |= ImGui::DragFloat3("Position", glm::value_ptr(transform.position), DragSpeed);
 
         vec3 eulerAngles = transform.EulerAnglesDegrees();
-        transform.hasChanged |= ImGui::DragFloat3("Euler angles", glm::value_ptr(eulerAngles), DragSpeed);
-        transform.EulerAnglesDegrees(eulerAngles);
+        if (ImGui::DragFloat3("Euler angles", glm::value_ptr(eulerAngles), DragSpeed)) {
+            transform.EulerAnglesDegrees(eulerAngles);
+        }
 
-        transform.hasChanged |= ImGui::DragFloat4("Quaternion", glm::value_ptr(transform.rotation), DragSpeed);
-        transform.hasChanged |= ImGui::DragFloat("Scale", &transform.scale, DragSpeed);
+        changed |= ImGui::DragFloat4("Quaternion", glm::value_ptr(transform.rotation), DragSpeed);
+        changed |= ImGui::DragFloat("Scale", &transform.scale, DragSpeed);
+
+        if (changed) {
+            transform.Changed();
+        }
 
         return true;
     }
@@ -34,6 +34,7 @@
 #include <conflagrant/systems/SnowfallAnimator.hh>
 
 #include <conflagrant/ShaderSourceManager.hh>
+#include <conflagrant/ShaderCache.hh>
 
 namespace cfl {
 bool InitDefaults() {
@@ -79,6 +80,7 @@ bool InitDefaults() {
     REGISTER_SYSTEM(cfl::syst::SnowfallAnimator);
 
     REGISTER_SHADER_FOLDER(BUILTIN_SHADER_DIR);
+    cfl::ShaderCache::SetDirectory(SHADER_CACHE_DIR);
 
     return true;
 }
@@ -6,6 +6,10 @@
 
 namespace cfl {
 namespace event {
+/**
+ * @brief Emitted by ActiveCameraCache when the active camera, its Transform or its projection changed. oldCamera and
+ * newCamera are the same entity unless another camera became active.
+ */
 struct CameraChanged {
     entityx::Entity oldCamera, newCamera;
 };
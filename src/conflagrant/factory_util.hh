@@ -32,6 +32,23 @@ class has_DrawWithImGui {
     template<typename C>
     static two test(...);
 
+public:
+    enum {
+        value = sizeof(test<T>(0)) == sizeof(char)
+    };
+};
+
+template<typename T>
+class has_IsRenderer {
+    typedef char one;
+    typedef long two;
+
+    template<typename C>
+    static one test(decltype(&C::IsRenderer));
+
+    template<typename C>
+    static two test(...);
+
 public:
     enum {
         value = sizeof(test<T>(0)) == sizeof(char)
@@ -42,6 +42,22 @@ public:
     inline void BufferSubData(GLintptr offset, GLsizeiptr size, GLvoid const *data) {
         OGL(glNamedBufferSubData(id, offset, size, data));
     }
+
+    /**
+     * @brief Allocates immutable storage, the buffer has to have been bound at least once before.
+     */
+    inline void BufferStorage(GLsizeiptr size, GLvoid const *data, GLbitfield flags) {
+        OGL(glNamedBufferStorage(id, this->size = size, data, flags));
+    }
+
+    inline void *MapRange(GLintptr offset, GLsizeiptr length, GLbitfield access) {
+        OGL(void *pointer = glMapNamedBufferRange(id, offset, length, access));
+        return pointer;
+    }
+
+    inline void Unmap() {
+        OGL(glUnmapNamedBuffer(id));
+    }
 };
 }
 }
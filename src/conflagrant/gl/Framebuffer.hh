@@ -3,6 +3,7 @@
 #include "GlObject.hh"
 #include "Texture.hh"
 #include "Renderbuffer.hh"
+#include "StateCache.hh"
 
 #include <unordered_map>
 
@@ -14,6 +15,7 @@ struct GlFramebufferFactory {
     };
 
     inline static void Destroy(GLuint x) {
+        StateCache::OnFramebufferDeleted(x);
         OGL(glDeleteFramebuffers(1, &x));
     };
 };
@@ -66,11 +68,11 @@ struct Framebuffer : public GlObject<GlFramebufferFactory> {
     }
 
     inline void Bind(GLenum target = GL_FRAMEBUFFER) const {
-        OGL(glBindFramebuffer(target, id));
+        StateCache::BindFramebuffer(target, id);
     }
 
     inline static void Unbind(GLenum target = GL_FRAMEBUFFER) {
-        OGL(glBindFramebuffer(target, 0));
+        StateCache::BindFramebuffer(target, 0);
     }
 };
 }
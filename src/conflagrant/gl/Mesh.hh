@@ -38,8 +38,6 @@ public:
         } else {
             OGL(glDrawArrays(drawMode, 0, static_cast<GLsizei>(vertexBuffer.Size() / vertexStride)));
         }
-
-        vao.Unbind();
     }
 
     inline void DrawElementsInstanced(GLsizei count) const {
@@ -54,21 +52,46 @@ public:
         } else {
             OGL(glDrawArraysInstanced(drawMode, 0, static_cast<GLsizei>(vertexBuffer.Size() / vertexStride), count));
         }
+    }
+
+    /**
+     * @brief Draws the vertices with the instance count and offsets of a DrawArraysIndirectCommand, that a compute
+     * shader may have written without a round trip to the CPU.
+     */
+    inline void DrawArraysIndirect(Buffer const &commands) const {
+        if (vertexBuffer.Size() == 0)
+            return;
 
-        vao.Unbind();
+        vao.Bind();
+
+        commands.Bind(GL_DRAW_INDIRECT_BUFFER);
+        OGL(glDrawArraysIndirect(drawMode, nullptr));
+        Buffer::Unbind(GL_DRAW_INDIRECT_BUFFER);
     }
 
     inline void BufferVertexData(GLsizeiptr size, GLvoid const *data, GLenum usage) {
         vertexBuffer.Bind(GL_ARRAY_BUFFER);
-        vertexBuffer.BufferData(size, data, usage);
+        if (size == vertexBuffer.Size()) {
+            // same size, overwrite in place instead of reallocating the storage
+            vertexBuffer.BufferSubData(0, size, data);
+        } else {
+            vertexBuffer.BufferData(size, data, usage);
+        }
         vertexBuffer.Unbind(GL_ARRAY_BUFFER);
     }
 
     inline void BufferIndexData(GLenum type, GLsizeiptr count, GLvoid const *data, GLenum usage,
                                 GLenum mode = GL_TRIANGLES) {
         size_t size = sizeof_gltype(type);
+
+        // the element array binding is part of the VAO state, don't clobber whichever VAO was left bound
+        VertexArray::Unbind();
         indexBuffer.Bind(GL_ELEMENT_ARRAY_BUFFER);
-        indexBuffer.BufferData(size * count, data, usage);
+        if (static_cast<GLsizeiptr>(size * count) == indexBuffer.Size()) {
+            indexBuffer.BufferSubData(0, size * count, data);
+        } else {
+            indexBuffer.BufferData(size * count, data, usage);
+        }
         indexBuffer.Unbind(GL_ELEMENT_ARRAY_BUFFER);
         drawMode = mode;
         indexType = type;
@@ -87,6 +110,24 @@ public:
         vertexStride = stride;
     }
 
+    /**
+     * @brief Sources a per-instance attribute (divisor 1) from an arbitrary buffer, e.g. a StreamBuffer allocation.
+     */
+    inline void InstanceAttribute(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                                  GLuint buffer, GLintptr offset) {
+        OGL(glEnableVertexArrayAttribEXT(vao.ID(), index));
+        OGL(glVertexArrayVertexAttribOffsetEXT(vao.ID(), buffer, index, size, type, normalized, stride, offset));
+        OGL(glVertexArrayVertexAttribDivisorEXT(vao.ID(), index, 1));
+    }
+
+    /**
+     * @brief Undoes InstanceAttribute(), so that later non-instanced draws of the mesh do not source the attribute.
+     */
+    inline void DisableInstanceAttribute(GLuint index) {
+        OGL(glVertexArrayVertexAttribDivisorEXT(vao.ID(), index, 0));
+        OGL(glDisableVertexArrayAttribEXT(vao.ID(), index));
+    }
+
     inline void SetIndices(GLenum mode, GLsizeiptr count, uint8_t const *indices, GLenum usage) {
         BufferIndexData(GL_UNSIGNED_BYTE, count, indices, usage, mode);
     }
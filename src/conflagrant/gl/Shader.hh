@@ -4,16 +4,49 @@
 #include "Buffer.hh"
 #include "VertexArray.hh"
 #include "Texture.hh"
+#include "StateCache.hh"
 
 #include <fstream>
 
 namespace cfl {
 namespace gl {
-inline void CompileShader(GLuint program, GLenum type, const char *source) {
+/**
+ * @brief Enables GL_KHR_parallel_shader_compile with as many compiler threads as the driver likes, if supported.
+ * @returns true if programs can be polled for completion without blocking.
+ */
+inline bool SupportsParallelShaderCompile() {
+#ifdef GL_KHR_parallel_shader_compile
+    static bool const isSupported = []() {
+        if (!GLEW_KHR_parallel_shader_compile) {
+            return false;
+        }
+
+        OGL(glMaxShaderCompilerThreadsKHR(0xFFFFFFFF));
+        return true;
+    }();
+    return isSupported;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Submits a shader stage for compilation and attaches it to the program, without waiting for the compiler.
+ * The compile status is checked by CheckShaderStage().
+ */
+inline GLuint CompileShader(GLuint program, GLenum type, const char *source) {
     OGL(GLuint shader = glCreateShader(type));
     OGL(glShaderSource(shader, 1, &source, nullptr));
     OGL(glCompileShader(shader));
+    OGL(glAttachShader(program, shader));
+    return shader;
+}
 
+/**
+ * @brief Logs the info log of a shader stage that failed to compile, and deletes the stage.
+ * @returns false if the stage failed to compile.
+ */
+inline bool CheckShaderStage(GLuint program, GLuint shader) {
     GLint status, length;
     OGL(glGetShaderiv(shader, GL_COMPILE_STATUS, &status));
 
@@ -22,87 +55,184 @@ inline void CompileShader(GLuint program, GLenum type, const char *source) {
 
         std::vector<GLchar> buffer((ulong) length);
         OGL(glGetShaderInfoLog(shader, (GLsizei) buffer.size(), nullptr, buffer.data()));
-        OGL(glDeleteShader(shader));
-        LOG_ERROR(cfl::gl::CompileShader()) << buffer.data() << std::endl;
-        throw std::runtime_error("GLSL failed to compile");
+        LOG_ERROR(cfl::gl::CheckShaderStage()) << buffer.data() << std::endl;
     }
 
-    OGL(glAttachShader(program, shader));
+    OGL(glDetachShader(program, shader));
     OGL(glDeleteShader(shader));
+    return status != GL_FALSE;
 }
 
+/**
+ * @brief A linked program.
+ *
+ * Building a program is split in two phases so that the driver can compile many programs concurrently: the
+ * constructors only submit the stages and the link, and Finalize() checks the results. Finalize() is called by the
+ * first Bind() at the latest.
+ */
 class Shader {
     GLuint program;
     std::vector<std::string> defines;
 
+    /**
+     * @brief Stages whose compile status has not been checked yet.
+     */
+    std::vector<GLuint> pendingStages;
+    bool isFinalized{false}, isLinked{false};
+
     Shader(Shader const &r) = delete;
 
     Shader &operator=(Shader const &r) = delete;
 
+    inline explicit Shader(GLuint program)
+            : program(program), isFinalized(true), isLinked(true) {}
+
 public:
     inline Shader(Shader &&o) noexcept
-            : program(o.program), defines(std::move(o.defines)) {
+            : program(o.program), defines(std::move(o.defines)), pendingStages(std::move(o.pendingStages)),
+              isFinalized(o.isFinalized), isLinked(o.isLinked) {
         o.program = 0;
     }
 
     inline Shader(std::string const &vert, std::string const &frag, std::string const &geom = "") {
+        SupportsParallelShaderCompile();
         OGL(program = glCreateProgram());
 
         OGL(glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_FALSE));
+        OGL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
 
-        CompileShader(program, GL_VERTEX_SHADER, vert.c_str());
-        CompileShader(program, GL_FRAGMENT_SHADER, frag.c_str());
+        pendingStages.push_back(CompileShader(program, GL_VERTEX_SHADER, vert.c_str()));
+        pendingStages.push_back(CompileShader(program, GL_FRAGMENT_SHADER, frag.c_str()));
 
-        if (geom.length() != 0) CompileShader(program, GL_GEOMETRY_SHADER, geom.c_str());
+        if (geom.length() != 0) pendingStages.push_back(CompileShader(program, GL_GEOMETRY_SHADER, geom.c_str()));
 
         OGL(glLinkProgram(program));
-
-        // check for errors
-        GLint status, length;
-        OGL(glGetProgramiv(program, GL_LINK_STATUS, &status));
-        if (status == GL_FALSE) {
-            OGL(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
-            std::vector<GLchar> buffer(static_cast<ulong>(length));
-            OGL(glGetProgramInfoLog(program, (GLsizei) buffer.size(), nullptr, buffer.data()));
-            LOG_ERROR(cfl::gl::Shader::Shader()) << "GLSL linkage error: " << buffer.data() << std::endl;
-            throw std::runtime_error("GLSL linkage failure");
-        }
     }
 
     inline Shader(std::string const &compute) {
+        SupportsParallelShaderCompile();
         OGL(program = glCreateProgram());
         OGL(glProgramParameteri(program, GL_PROGRAM_SEPARABLE, GL_FALSE));
-        CompileShader(program, GL_COMPUTE_SHADER, compute.c_str());
+        OGL(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        pendingStages.push_back(CompileShader(program, GL_COMPUTE_SHADER, compute.c_str()));
         OGL(glLinkProgram(program));
+    }
+
+    /**
+     * @returns false while the driver is still compiling or linking the program. Always true if the driver does not
+     * support GL_KHR_parallel_shader_compile, in which case Finalize() blocks instead.
+     */
+    inline bool IsReady() const {
+        if (isFinalized || !SupportsParallelShaderCompile()) {
+            return true;
+        }
+
+#ifdef GL_KHR_parallel_shader_compile
+        GLint isComplete = GL_TRUE;
+        OGL(glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &isComplete));
+        return isComplete != GL_FALSE;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Waits for the program to be built, logging compile and link errors. Only the first call does any work.
+     * @returns false if the program failed to compile or link.
+     */
+    inline bool Finalize() {
+        if (isFinalized) {
+            return isLinked;
+        }
+        isFinalized = true;
+
+        bool compiled = true;
+        for (auto const stage : pendingStages) {
+            compiled = CheckShaderStage(program, stage) && compiled;
+        }
+        pendingStages.clear();
 
-        // check for errors
         GLint status, length;
         OGL(glGetProgramiv(program, GL_LINK_STATUS, &status));
-        if (status == GL_FALSE) {
+        if (compiled && status == GL_FALSE) {
             OGL(glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length));
             std::vector<GLchar> buffer(static_cast<ulong>(length));
             OGL(glGetProgramInfoLog(program, (GLsizei) buffer.size(), nullptr, buffer.data()));
-            LOG_ERROR(cfl::gl::Shader::Shader()) << "GLSL linkage error: " << buffer.data() << std::endl;
-            throw std::runtime_error("GLSL linkage failure");
+            LOG_ERROR(cfl::gl::Shader::Finalize()) << "GLSL linkage error: " << buffer.data() << std::endl;
+        }
+
+        isLinked = compiled && status != GL_FALSE;
+        return isLinked;
+    }
+
+    /**
+     * @brief Creates a program from a binary returned by GetBinary().
+     * @returns nullptr if the driver rejects the binary, e.g. because it was produced by a different driver version.
+     */
+    inline static std::shared_ptr<Shader> FromBinary(GLenum format, GLvoid const *binary, GLsizei length) {
+        OGL(GLuint const program = glCreateProgram());
+        OGL(glProgramBinary(program, format, binary, length));
+
+        GLint status;
+        OGL(glGetProgramiv(program, GL_LINK_STATUS, &status));
+        if (status == GL_FALSE) {
+            OGL(glDeleteProgram(program));
+            return nullptr;
+        }
+
+        return std::shared_ptr<Shader>(new Shader(program));
+    }
+
+    /**
+     * @returns false if the driver provides no binary for the program.
+     */
+    inline bool GetBinary(GLenum &format, std::vector<uint8_t> &binary) const {
+        GLint length = 0;
+        OGL(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (length <= 0) {
+            return false;
         }
+
+        binary.resize(static_cast<size_t>(length));
+        OGL(glGetProgramBinary(program, length, nullptr, &format, binary.data()));
+        return true;
     }
 
     inline ~Shader() {
-        if (program) glDeleteProgram(program);
+        for (auto const stage : pendingStages) {
+            glDeleteShader(stage);
+        }
+
+        if (program) {
+            StateCache::OnProgramDeleted(program);
+            glDeleteProgram(program);
+        }
     }
 
     inline void Bind() {
-        OGL(glUseProgram(program));
+        Finalize();
+        StateCache::UseProgram(program);
     }
 
     inline void Unbind() {
-        OGL(glUseProgram(0));
+        StateCache::UseProgram(0);
     }
 
     inline GLuint ProgramHandle() const {
         return program;
     }
 
+    /**
+     * @brief Records the preprocessor definitions the program was built with, for debugging.
+     */
+    inline void SetDefines(std::vector<std::string> const &newDefines) {
+        defines = newDefines;
+    }
+
+    inline std::vector<std::string> const &Defines() const {
+        return defines;
+    }
+
     inline GLint GetUniformLocation(std::string const &name) const {
         return OGL(glGetUniformLocation(program, name.c_str()));
     }
@@ -127,6 +257,10 @@ public:
         OGL(glProgramUniform4fv(program, GetUniformLocation(name), 1, glm::value_ptr(vec)));
     }
 
+    inline void Uniform(std::string const &name, ivec3 const &vec) const {
+        OGL(glProgramUniform3iv(program, GetUniformLocation(name), 1, glm::value_ptr(vec)));
+    }
+
     inline void Uniform(std::string const &name, mat3 const &mat) const {
         OGL(glProgramUniformMatrix3fv(program, GetUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat)));
     }
@@ -167,9 +301,33 @@ public:
                                       GL_FALSE, glm::value_ptr(values[0])));
     }
 
+    /**
+     * @returns The size in bytes of the named uniform block, or -1 if the program has no such active block.
+     */
+    inline GLint UniformBlockSize(std::string const &name) const {
+        OGL(GLuint const index = glGetUniformBlockIndex(program, name.c_str()));
+        if (index == GL_INVALID_INDEX) {
+            return -1;
+        }
+
+        GLint size;
+        OGL(glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size));
+        return size;
+    }
+
+    inline void UniformBlock(std::string const &name, GLuint binding,
+                             GLuint buffer, GLintptr offset, GLsizeiptr size) const {
+        OGL(GLuint const index = glGetUniformBlockIndex(program, name.c_str()));
+        if (index == GL_INVALID_INDEX) {
+            return;
+        }
+
+        OGL(glUniformBlockBinding(program, index, binding));
+        OGL(glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size));
+    }
+
     inline void Texture(std::string const &name, GLenum unit, GlTextureBase const &tex) const {
-        OGL(glActiveTexture(GL_TEXTURE0 + unit));
-        OGL(glBindTexture(tex.target, tex));
+        StateCache::BindTextureUnit(unit, tex.target, tex);
         OGL(glProgramUniform1i(program, GetUniformLocation(name), unit));
     }
 };
@@ -2,243 +2,201 @@
 
 #include <conflagrant/types.hh>
 #include <conflagrant/GL.hh>
-#include <list>
+#include <conflagrant/gl/StateCache.hh>
+
+#include <cassert>
 
 namespace cfl {
 namespace gl {
 namespace detail {
-struct State {
-    inline virtual ~State() {}
-
-    virtual void Apply() const = 0;
-
-    virtual void Revert() const = 0;
-};
-
-struct ScopedStateStack {
-    std::list<State *> states;
-
-    inline ~ScopedStateStack() {
-        // revert all state changes
-        for (auto state : states) {
-            state->Revert();
-            delete state;
+struct StateChange {
+    enum class Kind : uint8_t {
+        Capability,
+        BlendFunc,
+        DepthMask,
+        CullFace,
+        PolygonMode,
+        ColorMask
+    };
+
+    Kind kind;
+    GLenum capability{0};
+    std::array<GLenum, 2> previousEnums{{0, 0}}, currentEnums{{0, 0}};
+    std::array<GLboolean, 4> previousFlags{{GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE}},
+            currentFlags{{GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE}};
+
+    inline void Set(bool revert) const {
+        auto const &enums = revert ? previousEnums : currentEnums;
+        auto const &flags = revert ? previousFlags : currentFlags;
+
+        switch (kind) {
+            case Kind::Capability:
+                StateCache::Enable(capability, flags[0] == GL_TRUE);
+                break;
+            case Kind::BlendFunc:
+                StateCache::BlendFunc(enums[0], enums[1]);
+                break;
+            case Kind::DepthMask:
+                StateCache::DepthMask(flags[0]);
+                break;
+            case Kind::CullFace:
+                StateCache::CullFace(enums[0]);
+                break;
+            case Kind::PolygonMode:
+                StateCache::PolygonMode(enums[0], enums[1]);
+                break;
+            case Kind::ColorMask:
+                StateCache::ColorMask(flags[0], flags[1], flags[2], flags[3]);
+                break;
         }
     }
 };
 
-struct NullState : State {
-    inline void Apply() const override {}
-
-    inline void Revert() const override {}
-};
-
-struct EnableState : State {
-    GLenum const capability;
-
-    inline EnableState(GLenum capability)
-            : capability(capability) {}
-
-    inline void Apply() const override {
-        OGL(glEnable(capability));
-    }
-
-    inline void Revert() const override {
-        OGL(glDisable(capability));
-    }
-};
-
-struct DisableState : State {
-    GLenum const capability;
-
-    inline DisableState(GLenum capability)
-            : capability(capability) {}
-
-    inline void Apply() const override {
-        OGL(glDisable(capability));
-    }
-
-    inline void Revert() const override {
-        OGL(glEnable(capability));
-    }
-};
-
-struct BlendFuncState : State {
-    GLint srcPrevious, dstPrevious, src, dst;
-
-    inline BlendFuncState(GLint srcPrevious, GLint dstPrevious,
-                          GLint src, GLint dst)
-            : srcPrevious(srcPrevious), dstPrevious(dstPrevious),
-              src(src), dst(dst) {}
-
-    inline void Apply() const override {
-        OGL(glBlendFunc(src, dst));
-    }
-
-    inline void Revert() const override {
-        OGL(glBlendFunc(srcPrevious, dstPrevious));
-    }
-};
-
-struct DepthMaskState : State {
-    GLboolean previous, current;
-
-    inline DepthMaskState(GLboolean previous, GLboolean current)
-            : previous(previous), current(current) {}
-
-    inline void Apply() const override {
-        OGL(glDepthMask(current));
-    }
-
-    inline void Revert() const override {
-        OGL(glDepthMask(previous));
-    }
-};
-
-struct CullFaceState : State {
-    GLenum previous, current;
-
-    inline CullFaceState(GLenum previous, GLenum current)
-            : previous(previous), current(current) {}
+/**
+ * @brief Fixed-capacity list of state changes, reverted in reverse order on destruction.
+ */
+class ScopedStateStack {
+public:
+    static constexpr size_t MaxStateChanges = 16;
 
-    inline void Apply() const override {
-        OGL(glCullFace(current));
-    }
+private:
+    std::array<StateChange, MaxStateChanges> changes;
+    size_t count{0};
 
-    inline void Revert() const override {
-        OGL(glCullFace(previous));
-    }
-};
+    ScopedStateStack(ScopedStateStack const &) = delete;
 
-struct PolygonModeState : State {
-    GLenum face;
-    GLenum previous, current;
+    ScopedStateStack &operator=(ScopedStateStack const &) = delete;
 
-    inline PolygonModeState(GLenum face, GLenum previous, GLenum current)
-            : face(face), previous(previous), current(current) {}
+public:
+    inline ScopedStateStack() = default;
 
-    inline void Apply() const override {
-        OGL(glPolygonMode(face, current));
+    inline ScopedStateStack(ScopedStateStack &&o) noexcept
+            : changes(o.changes), count(o.count) {
+        o.count = 0;
     }
 
-    inline void Revert() const override {
-        OGL(glPolygonMode(face, previous));
+    inline ~ScopedStateStack() {
+        while (count > 0) {
+            changes[--count].Set(true);
+        }
     }
-};
-
-struct ColorMaskState : State {
-    GLboolean rp, gp, bp, ap;
-    GLboolean rc, gc, bc, ac;
 
-    inline ColorMaskState(
-            GLboolean rp, GLboolean gp, GLboolean bp, GLboolean ap,
-            GLboolean rc, GLboolean gc, GLboolean bc, GLboolean ac)
-            : rp(rp), gp(gp), bp(bp), ap(ap),
-              rc(rc), gc(gc), bc(bc), ac(ac) {}
-
-    inline void Apply() const override {
-        OGL(glColorMask(rc, gc, bc, ac));
+    inline void Push(StateChange const &change) {
+        assert(count < MaxStateChanges);
+        changes[count++] = change;
     }
 
-    inline void Revert() const override {
-        OGL(glColorMask(rp, gp, bp, ap));
+    inline void Apply() const {
+        for (size_t i = 0; i < count; ++i) {
+            changes[i].Set(false);
+        }
     }
 };
-}
-
+} // namespace detail
+
+/**
+ * @brief Builder for a set of state changes that are reverted when the built stack goes out of scope.
+ *
+ * Previous values are read from the StateCache, so building a ScopedState neither allocates nor queries OpenGL
+ * for values the cache already knows.
+ */
 class ScopedState {
-    std::unique_ptr<detail::ScopedStateStack> stack;
+    using Kind = detail::StateChange::Kind;
+
+    detail::ScopedStateStack stack;
 
 public:
-    inline ScopedState() : stack(std::make_unique<detail::ScopedStateStack>()) {}
+    inline ScopedState() = default;
 
     inline ScopedState &Enable(GLenum capability) {
-        OGL(auto isEnabled = glIsEnabled(capability));
-        if (!isEnabled) {
-            stack->states.push_back(new detail::EnableState(capability));
+        if (!StateCache::IsEnabled(capability)) {
+            detail::StateChange change{Kind::Capability};
+            change.capability = capability;
+            change.previousFlags[0] = GL_FALSE;
+            change.currentFlags[0] = GL_TRUE;
+            stack.Push(change);
         }
 
         return *this;
     }
 
     inline ScopedState &Disable(GLenum capability) {
-        OGL(auto isEnabled = glIsEnabled(capability));
-        if (isEnabled) {
-            stack->states.push_back(new detail::DisableState(capability));
+        if (StateCache::IsEnabled(capability)) {
+            detail::StateChange change{Kind::Capability};
+            change.capability = capability;
+            change.previousFlags[0] = GL_TRUE;
+            change.currentFlags[0] = GL_FALSE;
+            stack.Push(change);
         }
 
         return *this;
     }
 
-    inline ScopedState &BlendFuncAlpha(GLint src, GLint dst) {
-        GLint srcCurrent;
-        GLint dstCurrent;
-        OGL(glGetIntegerv(GL_BLEND_SRC_ALPHA, &srcCurrent));
-        OGL(glGetIntegerv(GL_BLEND_DST_ALPHA, &dstCurrent));
+    inline ScopedState &BlendFuncAlpha(GLenum src, GLenum dst) {
+        GLenum srcCurrent, dstCurrent;
+        StateCache::GetBlendFunc(srcCurrent, dstCurrent);
 
         if (src != srcCurrent || dst != dstCurrent) {
-            stack->states.push_back(new detail::BlendFuncState(
-                    srcCurrent, dstCurrent,
-                    src, dst
-            ));
+            detail::StateChange change{Kind::BlendFunc};
+            change.previousEnums = {{srcCurrent, dstCurrent}};
+            change.currentEnums = {{src, dst}};
+            stack.Push(change);
         }
 
         return *this;
     }
 
     inline ScopedState &DepthMask(GLboolean enable) {
-        GLboolean current;
-        OGL(glGetBooleanv(GL_DEPTH_WRITEMASK, &current));
+        auto const current = StateCache::GetDepthMask();
 
         if (enable != current) {
-            stack->states.push_back(new detail::DepthMaskState(current, enable));
+            detail::StateChange change{Kind::DepthMask};
+            change.previousFlags[0] = current;
+            change.currentFlags[0] = enable;
+            stack.Push(change);
         }
 
         return *this;
     }
 
     inline ScopedState &CullFace(GLenum state) {
-        GLint temp;
-        OGL(glGetIntegerv(GL_CULL_FACE_MODE, &temp));
-
-        auto const current = static_cast<GLenum>(temp);
+        auto const current = StateCache::GetCullFace();
 
         if (state != current) {
-            stack->states.push_back(new detail::CullFaceState(current, state));
+            detail::StateChange change{Kind::CullFace};
+            change.previousEnums[0] = current;
+            change.currentEnums[0] = state;
+            stack.Push(change);
         }
 
         return *this;
     }
 
     inline ScopedState &PolygonModeFrontBack(GLenum frontMode, GLenum backMode) {
-        GLint previous[2];
-
-        OGL(glGetIntegerv(GL_POLYGON_MODE, previous));
-        OGL(glPolygonMode(GL_FRONT_AND_BACK, GL_LINE));
-
-        auto const frontModeCurrent = static_cast<GLenum>(previous[0]);
-        auto const backModeCurrent = static_cast<GLenum>(previous[1]);
-
-        if (frontMode != frontModeCurrent) {
-            stack->states.push_back(new detail::PolygonModeState(GL_FRONT, frontModeCurrent, frontMode));
-        }
-
-        if (backMode != backModeCurrent) {
-            stack->states.push_back(new detail::PolygonModeState(GL_FRONT, backModeCurrent, backMode));
+        GLenum frontModeCurrent, backModeCurrent;
+        StateCache::GetPolygonMode(frontModeCurrent, backModeCurrent);
+
+        if (frontMode != frontModeCurrent || backMode != backModeCurrent) {
+            detail::StateChange change{Kind::PolygonMode};
+            change.previousEnums = {{frontModeCurrent, backModeCurrent}};
+            change.currentEnums = {{frontMode, backMode}};
+            stack.Push(change);
         }
 
         return *this;
     }
 
     inline ScopedState &ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
-        GLboolean c[4];
-        OGL(glGetBooleanv(GL_COLOR_WRITEMASK, c));
-
-        if (r != c[0] ||
-            g != c[1] ||
-            b != c[2] ||
-            a != c[3]) {
-            stack->states.push_back(new detail::ColorMaskState(c[0], c[1], c[2], c[3], r, g, b, a));
+        auto const current = StateCache::GetColorMask();
+
+        if (r != current[0] ||
+            g != current[1] ||
+            b != current[2] ||
+            a != current[3]) {
+            detail::StateChange change{Kind::ColorMask};
+            change.previousFlags = current;
+            change.currentFlags = {{r, g, b, a}};
+            stack.Push(change);
         }
 
         return *this;
@@ -248,11 +206,8 @@ public:
         return ColorMask(rgba, rgba, rgba, rgba);
     }
 
-    inline std::unique_ptr<detail::ScopedStateStack> &&Build() {
-        for (auto state : stack->states) {
-            state->Apply();
-        }
-
+    inline detail::ScopedStateStack Build() {
+        stack.Apply();
         return std::move(stack);
     }
 };
@@ -0,0 +1,42 @@
+#include "StateCache.hh"
+
+namespace cfl {
+namespace gl {
+std::array<StateCache::Tracked<bool>, StateCache::NumCapabilities> StateCache::Capabilities;
+StateCache::Tracked<std::pair<GLenum, GLenum>> StateCache::BlendFuncs;
+StateCache::Tracked<GLboolean> StateCache::DepthWriteMask;
+StateCache::Tracked<GLenum> StateCache::DepthFuncValue;
+StateCache::Tracked<GLenum> StateCache::CullFaceMode;
+StateCache::Tracked<std::pair<GLenum, GLenum>> StateCache::PolygonModes;
+StateCache::Tracked<std::array<GLboolean, 4>> StateCache::ColorWriteMask;
+StateCache::Tracked<GLuint> StateCache::Program;
+StateCache::Tracked<GLuint> StateCache::VertexArrayBinding;
+StateCache::Tracked<GLuint> StateCache::DrawFramebufferBinding;
+StateCache::Tracked<GLuint> StateCache::ReadFramebufferBinding;
+StateCache::Tracked<GLuint> StateCache::ActiveTextureUnit;
+std::array<std::array<StateCache::Tracked<GLuint>, StateCache::NumTextureTargets>, StateCache::MaxTextureUnits>
+        StateCache::TextureBindings;
+
+size_t StateCache::callsIssued = 0;
+size_t StateCache::callsElided = 0;
+
+void StateCache::Invalidate() {
+    for (auto &capability : Capabilities) capability.known = false;
+    BlendFuncs.known = false;
+    DepthWriteMask.known = false;
+    DepthFuncValue.known = false;
+    CullFaceMode.known = false;
+    PolygonModes.known = false;
+    ColorWriteMask.known = false;
+    Program.known = false;
+    VertexArrayBinding.known = false;
+    DrawFramebufferBinding.known = false;
+    ReadFramebufferBinding.known = false;
+    ActiveTextureUnit.known = false;
+
+    for (auto &unit : TextureBindings) {
+        for (auto &binding : unit) binding.known = false;
+    }
+}
+} // namespace gl
+} // namespace cfl
@@ -0,0 +1,369 @@
+#pragma once
+
+#include <conflagrant/types.hh>
+#include <conflagrant/GL.hh>
+
+namespace cfl {
+namespace gl {
+/**
+ * @brief CPU-side shadow copy of the OpenGL state touched by the engine.
+ *
+ * Every value starts out unknown. The first request for a value is forwarded to OpenGL, after which any request
+ * for the value that is already active is elided. Call Invalidate() whenever code outside of the engine (e.g. the
+ * ImGui renderer) may have changed the state behind the cache's back.
+ */
+class StateCache final {
+    StateCache() = delete;
+
+public:
+    static constexpr size_t MaxTextureUnits = 32;
+
+private:
+    template<typename T>
+    struct Tracked {
+        T value{};
+        bool known{false};
+
+        inline bool Matches(T const &v) const {
+            return known && value == v;
+        }
+
+        inline void Set(T const &v) {
+            value = v;
+            known = true;
+        }
+    };
+
+    static constexpr size_t NumCapabilities = 8;
+    static constexpr size_t NumTextureTargets = 5;
+
+    static std::array<Tracked<bool>, NumCapabilities> Capabilities;
+    static Tracked<std::pair<GLenum, GLenum>> BlendFuncs;
+    static Tracked<GLboolean> DepthWriteMask;
+    static Tracked<GLenum> DepthFuncValue;
+    static Tracked<GLenum> CullFaceMode;
+    static Tracked<std::pair<GLenum, GLenum>> PolygonModes;
+    static Tracked<std::array<GLboolean, 4>> ColorWriteMask;
+    static Tracked<GLuint> Program;
+    static Tracked<GLuint> VertexArrayBinding;
+    static Tracked<GLuint> DrawFramebufferBinding;
+    static Tracked<GLuint> ReadFramebufferBinding;
+    static Tracked<GLuint> ActiveTextureUnit;
+    static std::array<std::array<Tracked<GLuint>, NumTextureTargets>, MaxTextureUnits> TextureBindings;
+
+    static size_t callsIssued, callsElided;
+
+    inline static int CapabilityIndex(GLenum capability) {
+        switch (capability) {
+            case GL_BLEND:
+                return 0;
+            case GL_CULL_FACE:
+                return 1;
+            case GL_DEPTH_TEST:
+                return 2;
+            case GL_SCISSOR_TEST:
+                return 3;
+            case GL_STENCIL_TEST:
+                return 4;
+            case GL_POLYGON_OFFSET_FILL:
+                return 5;
+            case GL_PROGRAM_POINT_SIZE:
+                return 6;
+            case GL_TEXTURE_CUBE_MAP_SEAMLESS:
+                return 7;
+            default:
+                return -1;
+        }
+    }
+
+    inline static int TextureTargetIndex(GLenum target) {
+        switch (target) {
+            case GL_TEXTURE_1D:
+                return 0;
+            case GL_TEXTURE_2D:
+                return 1;
+            case GL_TEXTURE_3D:
+                return 2;
+            case GL_TEXTURE_CUBE_MAP:
+                return 3;
+            case GL_TEXTURE_2D_ARRAY:
+                return 4;
+            default:
+                return -1;
+        }
+    }
+
+    /**
+     * @returns true if the call has to be issued, and counts it as either issued or elided.
+     */
+    template<typename T>
+    inline static bool NeedsCall(Tracked<T> &tracked, T const &value) {
+        if (tracked.Matches(value)) {
+            ++callsElided;
+            return false;
+        }
+
+        ++callsIssued;
+        tracked.Set(value);
+        return true;
+    }
+
+public:
+    ////////////////
+    // statistics //
+    ////////////////
+
+    inline static size_t CallsIssued() {
+        return callsIssued;
+    }
+
+    inline static size_t CallsElided() {
+        return callsElided;
+    }
+
+    inline static void ResetCounters() {
+        callsIssued = 0;
+        callsElided = 0;
+    }
+
+    /**
+     * @brief Forgets all cached values, forcing the next request for each value to reach OpenGL.
+     */
+    static void Invalidate();
+
+    ///////////////////
+    // capabilities  //
+    ///////////////////
+
+    inline static bool IsEnabled(GLenum capability) {
+        auto const index = CapabilityIndex(capability);
+        if (index >= 0 && Capabilities[index].known) {
+            return Capabilities[index].value;
+        }
+
+        OGL(auto const isEnabled = glIsEnabled(capability));
+        if (index >= 0) {
+            Capabilities[index].Set(isEnabled == GL_TRUE);
+        }
+
+        return isEnabled == GL_TRUE;
+    }
+
+    inline static void Enable(GLenum capability, bool enable = true) {
+        auto const index = CapabilityIndex(capability);
+        if (index >= 0 && !NeedsCall(Capabilities[index], enable)) {
+            return;
+        }
+
+        if (index < 0) {
+            ++callsIssued;
+        }
+
+        if (enable) {
+            OGL(glEnable(capability));
+        } else {
+            OGL(glDisable(capability));
+        }
+    }
+
+    inline static void Disable(GLenum capability) {
+        Enable(capability, false);
+    }
+
+    ////////////////////////
+    // fixed-function ops //
+    ////////////////////////
+
+    inline static void GetBlendFunc(GLenum &src, GLenum &dst) {
+        if (!BlendFuncs.known) {
+            GLint srcCurrent, dstCurrent;
+            OGL(glGetIntegerv(GL_BLEND_SRC_ALPHA, &srcCurrent));
+            OGL(glGetIntegerv(GL_BLEND_DST_ALPHA, &dstCurrent));
+            BlendFuncs.Set({static_cast<GLenum>(srcCurrent), static_cast<GLenum>(dstCurrent)});
+        }
+
+        src = BlendFuncs.value.first;
+        dst = BlendFuncs.value.second;
+    }
+
+    inline static void BlendFunc(GLenum src, GLenum dst) {
+        if (NeedsCall(BlendFuncs, {src, dst})) {
+            OGL(glBlendFunc(src, dst));
+        }
+    }
+
+    inline static GLboolean GetDepthMask() {
+        if (!DepthWriteMask.known) {
+            GLboolean current;
+            OGL(glGetBooleanv(GL_DEPTH_WRITEMASK, &current));
+            DepthWriteMask.Set(current);
+        }
+
+        return DepthWriteMask.value;
+    }
+
+    inline static void DepthMask(GLboolean enable) {
+        if (NeedsCall(DepthWriteMask, enable)) {
+            OGL(glDepthMask(enable));
+        }
+    }
+
+    inline static void DepthFunc(GLenum func) {
+        if (NeedsCall(DepthFuncValue, func)) {
+            OGL(glDepthFunc(func));
+        }
+    }
+
+    inline static GLenum GetCullFace() {
+        if (!CullFaceMode.known) {
+            GLint current;
+            OGL(glGetIntegerv(GL_CULL_FACE_MODE, &current));
+            CullFaceMode.Set(static_cast<GLenum>(current));
+        }
+
+        return CullFaceMode.value;
+    }
+
+    inline static void CullFace(GLenum mode) {
+        if (NeedsCall(CullFaceMode, mode)) {
+            OGL(glCullFace(mode));
+        }
+    }
+
+    inline static void GetPolygonMode(GLenum &front, GLenum &back) {
+        if (!PolygonModes.known) {
+            GLint current[2] = {GL_FILL, GL_FILL};
+            OGL(glGetIntegerv(GL_POLYGON_MODE, current));
+            PolygonModes.Set({static_cast<GLenum>(current[0]), static_cast<GLenum>(current[1])});
+        }
+
+        front = PolygonModes.value.first;
+        back = PolygonModes.value.second;
+    }
+
+    inline static void PolygonMode(GLenum front, GLenum back) {
+        if (!NeedsCall(PolygonModes, {front, back})) {
+            return;
+        }
+
+        if (front == back) {
+            OGL(glPolygonMode(GL_FRONT_AND_BACK, front));
+        } else {
+            OGL(glPolygonMode(GL_FRONT, front));
+            OGL(glPolygonMode(GL_BACK, back));
+        }
+    }
+
+    inline static std::array<GLboolean, 4> GetColorMask() {
+        if (!ColorWriteMask.known) {
+            std::array<GLboolean, 4> current;
+            OGL(glGetBooleanv(GL_COLOR_WRITEMASK, current.data()));
+            ColorWriteMask.Set(current);
+        }
+
+        return ColorWriteMask.value;
+    }
+
+    inline static void ColorMask(GLboolean r, GLboolean g, GLboolean b, GLboolean a) {
+        if (NeedsCall(ColorWriteMask, {r, g, b, a})) {
+            OGL(glColorMask(r, g, b, a));
+        }
+    }
+
+    //////////////
+    // bindings //
+    //////////////
+
+    inline static void UseProgram(GLuint program) {
+        if (NeedsCall(Program, program)) {
+            OGL(glUseProgram(program));
+        }
+    }
+
+    inline static void BindVertexArray(GLuint vao) {
+        if (NeedsCall(VertexArrayBinding, vao)) {
+            OGL(glBindVertexArray(vao));
+        }
+    }
+
+    inline static void BindFramebuffer(GLenum target, GLuint framebuffer) {
+        bool const draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+        bool const read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+
+        if (draw && read) {
+            if (DrawFramebufferBinding.Matches(framebuffer) && ReadFramebufferBinding.Matches(framebuffer)) {
+                ++callsElided;
+                return;
+            }
+
+            ++callsIssued;
+            DrawFramebufferBinding.Set(framebuffer);
+            ReadFramebufferBinding.Set(framebuffer);
+            OGL(glBindFramebuffer(target, framebuffer));
+            return;
+        }
+
+        if (NeedsCall(draw ? DrawFramebufferBinding : ReadFramebufferBinding, framebuffer)) {
+            OGL(glBindFramebuffer(target, framebuffer));
+        }
+    }
+
+    inline static void ActiveTexture(GLuint unit) {
+        if (NeedsCall(ActiveTextureUnit, unit)) {
+            OGL(glActiveTexture(GL_TEXTURE0 + unit));
+        }
+    }
+
+    /**
+     * @brief Binds a texture to the currently active texture unit.
+     */
+    inline static void BindTexture(GLenum target, GLuint texture) {
+        auto const targetIndex = TextureTargetIndex(target);
+        auto const unit = ActiveTextureUnit.value;
+
+        if (targetIndex < 0 || !ActiveTextureUnit.known || unit >= MaxTextureUnits) {
+            ++callsIssued;
+            OGL(glBindTexture(target, texture));
+            return;
+        }
+
+        if (NeedsCall(TextureBindings[unit][targetIndex], texture)) {
+            OGL(glBindTexture(target, texture));
+        }
+    }
+
+    inline static void BindTextureUnit(GLuint unit, GLenum target, GLuint texture) {
+        ActiveTexture(unit);
+        BindTexture(target, texture);
+    }
+
+    ///////////////////////
+    // object destroyers //
+    ///////////////////////
+
+    // OpenGL silently resets bindings of deleted objects, and names are recycled,
+    // so cached bindings of deleted objects must be reset to 0 as well.
+
+    inline static void OnProgramDeleted(GLuint program) {
+        if (Program.Matches(program)) Program.Set(0);
+    }
+
+    inline static void OnVertexArrayDeleted(GLuint vao) {
+        if (VertexArrayBinding.Matches(vao)) VertexArrayBinding.Set(0);
+    }
+
+    inline static void OnFramebufferDeleted(GLuint framebuffer) {
+        if (DrawFramebufferBinding.Matches(framebuffer)) DrawFramebufferBinding.Set(0);
+        if (ReadFramebufferBinding.Matches(framebuffer)) ReadFramebufferBinding.Set(0);
+    }
+
+    inline static void OnTextureDeleted(GLuint texture) {
+        for (auto &unit : TextureBindings) {
+            for (auto &binding : unit) {
+                if (binding.Matches(texture)) binding.Set(0);
+            }
+        }
+    }
+};
+} // namespace gl
+} // namespace cfl
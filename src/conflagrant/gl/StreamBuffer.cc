@@ -0,0 +1,142 @@
+#include "StreamBuffer.hh"
+
+#include <cstring>
+#include <algorithm>
+
+namespace cfl {
+namespace gl {
+namespace {
+std::unique_ptr<StreamBuffer> perFrameStreamBuffer;
+} // namespace
+
+StreamBuffer::StreamBuffer(GLsizeiptr regionSize)
+        : regionSize(regionSize) {
+    auto const totalSize = regionSize * static_cast<GLsizeiptr>(FramesInFlight);
+    GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    // binding once makes the generated name an actual buffer object
+    buffer.Bind(GL_COPY_WRITE_BUFFER);
+    buffer.BufferStorage(totalSize, nullptr, flags);
+    Buffer::Unbind(GL_COPY_WRITE_BUFFER);
+
+    mapped = static_cast<uint8_t *>(buffer.MapRange(0, totalSize, flags));
+    if (!mapped) {
+        LOG_ERROR(cfl::gl::StreamBuffer::StreamBuffer) << "failed to persistently map " << totalSize << " bytes"
+                                                       << std::endl;
+    }
+}
+
+StreamBuffer::~StreamBuffer() {
+    for (auto &fence : fences) {
+        if (fence) {
+            OGL(glDeleteSync(fence));
+            fence = nullptr;
+        }
+    }
+
+    if (mapped) {
+        buffer.Unmap();
+        mapped = nullptr;
+    }
+}
+
+void StreamBuffer::WaitForRegion(size_t index) {
+    auto &fence = fences[index];
+    if (!fence) {
+        return;
+    }
+
+    GLbitfield waitFlags = 0;
+    GLuint64 timeout = 0;
+    while (true) {
+        OGL(auto const status = glClientWaitSync(fence, waitFlags, timeout));
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+            break;
+        }
+
+        if (status == GL_WAIT_FAILED) {
+            LOG_ERROR(cfl::gl::StreamBuffer::WaitForRegion) << "glClientWaitSync failed" << std::endl;
+            break;
+        }
+
+        // the GPU is more than FramesInFlight frames behind, flush and block until it catches up
+        waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        timeout = 1000000000;
+    }
+
+    OGL(glDeleteSync(fence));
+    fence = nullptr;
+}
+
+StreamBuffer::Allocation StreamBuffer::Allocate(GLsizeiptr size, GLsizeiptr alignment) {
+    Allocation allocation;
+    if (!mapped || size <= 0) {
+        return allocation;
+    }
+
+    auto const alignedHead = ((head + alignment - 1) / alignment) * alignment;
+    if (alignedHead + size > regionSize) {
+        LOG_ERROR(cfl::gl::StreamBuffer::Allocate) << "region exhausted, requested " << size << " bytes with "
+                                                   << (regionSize - head) << " bytes left" << std::endl;
+        return allocation;
+    }
+
+    allocation.offset = static_cast<GLintptr>(region) * regionSize + alignedHead;
+    allocation.data = mapped + allocation.offset;
+    allocation.size = size;
+
+    head = alignedHead + size;
+    return allocation;
+}
+
+StreamBuffer::Allocation StreamBuffer::Write(GLvoid const *data, GLsizeiptr size, GLsizeiptr alignment) {
+    auto allocation = Allocate(size, alignment);
+    if (allocation) {
+        std::memcpy(allocation.data, data, static_cast<size_t>(size));
+    }
+
+    return allocation;
+}
+
+void StreamBuffer::EndFrame() {
+    if (fences[region]) {
+        OGL(glDeleteSync(fences[region]));
+    }
+    OGL(fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    region = (region + 1) % FramesInFlight;
+    head = 0;
+    ++frame;
+
+    WaitForRegion(region);
+}
+
+GLsizeiptr StreamBuffer::UniformBufferOffsetAlignment() {
+    static GLint alignment = 0;
+    if (alignment == 0) {
+        OGL(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+        alignment = std::max(alignment, 16);
+    }
+
+    return alignment;
+}
+
+StreamBuffer &StreamBuffer::PerFrame() {
+    if (!perFrameStreamBuffer) {
+        perFrameStreamBuffer = std::make_unique<StreamBuffer>();
+    }
+
+    return *perFrameStreamBuffer;
+}
+
+void StreamBuffer::ReleasePerFrame() {
+    perFrameStreamBuffer.reset();
+}
+
+void StreamBuffer::EndPerFrame() {
+    if (perFrameStreamBuffer) {
+        perFrameStreamBuffer->EndFrame();
+    }
+}
+} // namespace gl
+} // namespace cfl
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "GlObject.hh"
+#include "Buffer.hh"
+
+namespace cfl {
+namespace gl {
+/**
+ * @brief Persistently mapped buffer split into one region per frame in flight.
+ *
+ * Allocations are linear within the current frame's region and stay valid until that region is reused
+ * FramesInFlight frames later. A fence placed at the end of each frame guarantees that the GPU is done reading a
+ * region before the CPU writes to it again, so writes are plain memcpy's without driver reallocation or implicit
+ * synchronization.
+ */
+class StreamBuffer {
+public:
+    static constexpr size_t FramesInFlight = 3;
+    static constexpr GLsizeiptr DefaultRegionSize = 8 * 1024 * 1024;
+
+    struct Allocation {
+        void *data{nullptr};
+        GLintptr offset{0};
+        GLsizeiptr size{0};
+
+        inline operator bool() const {
+            return data != nullptr;
+        }
+    };
+
+private:
+    Buffer buffer;
+    GLsizeiptr const regionSize;
+    uint8_t *mapped{nullptr};
+
+    std::array<GLsync, FramesInFlight> fences{};
+    size_t region{0};
+    GLsizeiptr head{0};
+    size_t frame{0};
+
+    StreamBuffer(StreamBuffer const &) = delete;
+
+    StreamBuffer &operator=(StreamBuffer const &) = delete;
+
+    void WaitForRegion(size_t index);
+
+public:
+    explicit StreamBuffer(GLsizeiptr regionSize = DefaultRegionSize);
+
+    ~StreamBuffer();
+
+    inline GLuint ID() const {
+        return buffer.ID();
+    }
+
+    inline GLsizeiptr RegionSize() const {
+        return regionSize;
+    }
+
+    inline GLsizeiptr BytesUsedThisFrame() const {
+        return head;
+    }
+
+    /**
+     * @returns A counter that is incremented every time EndFrame() is called.
+     */
+    inline size_t FrameIndex() const {
+        return frame;
+    }
+
+    /**
+     * @brief Reserves size bytes in the current frame's region.
+     * @returns An empty allocation if the region is exhausted.
+     */
+    Allocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    /**
+     * @brief Allocates size bytes and copies data into them.
+     */
+    Allocation Write(GLvoid const *data, GLsizeiptr size, GLsizeiptr alignment = 16);
+
+    /**
+     * @brief Fences the current region and moves on to the next one, waiting for the GPU to release it if needed.
+     */
+    void EndFrame();
+
+    /**
+     * @brief The alignment required for offsets passed to glBindBufferRange(GL_UNIFORM_BUFFER, ...).
+     */
+    static GLsizeiptr UniformBufferOffsetAlignment();
+
+    /**
+     * @brief The ring used for per-frame dynamic data, created on first use.
+     */
+    static StreamBuffer &PerFrame();
+
+    /**
+     * @brief Destroys the per-frame ring. Has to be called while the GL context is still alive.
+     */
+    static void ReleasePerFrame();
+
+    /**
+     * @brief Calls EndFrame() on the per-frame ring, if it has been created.
+     */
+    static void EndPerFrame();
+};
+} // namespace gl
+} // namespace cfl
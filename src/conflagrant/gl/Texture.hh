@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GlObject.hh"
+#include "StateCache.hh"
 
 namespace cfl {
 namespace gl {
@@ -10,6 +11,7 @@ struct GlTextureFactory {
     };
 
     inline static void Destroy(GLuint x) {
+        StateCache::OnTextureDeleted(x);
         OGL(glDeleteTextures(1, &x));
     };
 };
@@ -28,11 +30,11 @@ struct GlTextureBase : public GlObject<GlTextureFactory> {
               hasMipmap(createMipmap) {}
 
     inline void Bind() const {
-        OGL(glBindTexture(target, id));
+        StateCache::BindTexture(target, id);
     }
 
     inline void Unbind() const {
-        OGL(glBindTexture(target, 0));
+        StateCache::BindTexture(target, 0);
     }
 
     inline void TexParameter(GLenum pname, GLfloat param) {
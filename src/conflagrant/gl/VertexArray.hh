@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GlObject.hh"
+#include "StateCache.hh"
 
 namespace cfl {
 namespace gl {
@@ -10,6 +11,7 @@ struct GlVertexArrayFactory {
     };
 
     inline static void Destroy(GLuint x) {
+        StateCache::OnVertexArrayDeleted(x);
         OGL(glDeleteVertexArrays(1, &x));
     };
 };
@@ -21,11 +23,11 @@ struct VertexArray : public GlObject<GlVertexArrayFactory> {
             : GlObject<GlVertexArrayFactory>(std::move(o)) {}
 
     inline void Bind() const {
-        OGL(glBindVertexArray(id));
+        StateCache::BindVertexArray(id);
     }
 
     inline static void Unbind() {
-        OGL(glBindVertexArray(0));
+        StateCache::BindVertexArray(0);
     }
 };
 }
@@ -3,6 +3,9 @@
 #include <imgui.h>
 #include "imgui_impl_glfw_gl3.h"
 
+#include <conflagrant/gl/StateCache.hh>
+#include <conflagrant/gl/StreamBuffer.hh>
+
 #ifndef GLFW_TRUE
 #define GLFW_TRUE 1
 #endif
@@ -204,6 +207,7 @@ returnStatement; \
 
 GlfwWindow::~GlfwWindow() {
     $
+    gl::StreamBuffer::ReleasePerFrame();
     glfwDestroyWindow(window);
     ImGui_ImplGlfwGL3_Shutdown();
 }
@@ -370,9 +374,14 @@ bool GlfwWindow::FinishFrame(bool renderGui) {
     $
     if (renderGui) {
         ImGui::Render();
+
+        // ImGui restores most of what it touches, but bypasses the cache doing so
+        gl::StateCache::Invalidate();
     } else {
         ImGui::EndFrame();
     }
+
+    gl::StreamBuffer::EndPerFrame();
     GLFW_RETURN_FALSE(glfwSwapBuffers(window));
     return true;
 }
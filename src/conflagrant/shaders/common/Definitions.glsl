@@ -64,6 +64,10 @@
 #define VCT_OCCLUSION_NORMAL_WEIGHT 0.5
 #define VCT_OCCLUSION_SIDE_WEIGHT (0.25 * (1.0 - VCT_OCCLUSION_NORMAL_WEIGHT))
 
+// see voxels/indirect_upsample.frag
+#define VCT_UPSAMPLE_DEPTH_SIGMA 0.02
+#define VCT_UPSAMPLE_NORMAL_POWER 16.0
+
 ///////////////////////
 // SKYDOME RENDERING //
 ///////////////////////
@@ -0,0 +1,5 @@
+// distance along the view direction of a depth buffer value in [0, 1], for a perspective projection
+float LinearizeDepth(float depth, float zNear, float zFar) {
+    const float ndc = 2 * depth - 1;
+    return (2 * zNear * zFar) / (zFar + zNear - ndc * (zFar - zNear));
+}
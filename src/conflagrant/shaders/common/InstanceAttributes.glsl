@@ -0,0 +1,3 @@
+layout (location = 5) in mat4 vIn_InstanceM;
+// x: radiance, y: specular reflectance, z: 1 if the instance overrides the material (VctProperties), otherwise 0
+layout (location = 9) in vec4 vIn_InstanceVct;
@@ -13,9 +13,29 @@ struct Material {
     float radiance;
 };
 
-vec4 GetPropertyColor(MaterialProperty prop, vec2 texCoord) {
+// Shader permutations define MATERIAL_HAS_*_MAP as 0 or 1, which turns the texture branches below into constants the
+// compiler removes. Without them, the hasMap uniforms are read at runtime.
+#ifdef MATERIAL_HAS_DIFFUSE_MAP
+#define HasDiffuseMap(m) (MATERIAL_HAS_DIFFUSE_MAP != 0)
+#else
+#define HasDiffuseMap(m) ((m).diffuse.hasMap != 0)
+#endif
+
+#ifdef MATERIAL_HAS_SPECULAR_MAP
+#define HasSpecularMap(m) (MATERIAL_HAS_SPECULAR_MAP != 0)
+#else
+#define HasSpecularMap(m) ((m).specular.hasMap != 0)
+#endif
+
+#ifdef MATERIAL_HAS_NORMAL_MAP
+#define HasNormalMap(m) (MATERIAL_HAS_NORMAL_MAP != 0)
+#else
+#define HasNormalMap(m) ((m).hasNormalMap != 0)
+#endif
+
+vec4 GetPropertyColor(MaterialProperty prop, bool hasMap, vec2 texCoord) {
     vec4 color = vec4(prop.color, 1);
-    if (prop.hasMap != 0) {
+    if (hasMap) {
         vec2 st = vec2(texCoord.s, 1 - texCoord.t);
         float mipmapLevel = textureQueryLod(prop.map, st).x;
         color = textureLod(prop.map, st, mipmapLevel);
@@ -23,3 +43,7 @@ vec4 GetPropertyColor(MaterialProperty prop, vec2 texCoord) {
 
     return color;
 }
+
+vec4 GetPropertyColor(MaterialProperty prop, vec2 texCoord) {
+    return GetPropertyColor(prop, prop.hasMap != 0, texCoord);
+}
@@ -0,0 +1,9 @@
+// The model matrix of the drawn vertex. Programs defining MODEL_INSTANCING are drawn by RenderModelsInstanced() and
+// read it per instance from common/InstanceAttributes.glsl, the others read the uniform M.
+#include "common/InstanceAttributes.glsl"
+
+#ifdef MODEL_INSTANCING
+#define ModelMatrix vIn_InstanceM
+#else
+#define ModelMatrix M
+#endif
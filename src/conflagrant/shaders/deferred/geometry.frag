@@ -18,19 +18,19 @@ layout (location = 2) out vec4 GAlbedoSpecular;
 layout (location = 3) out float GDepth;
 
 void main(void) {
-    vec4 diffuse = GetPropertyColor(material.diffuse, fIn_TexCoord);
+    vec4 diffuse = GetPropertyColor(material.diffuse, HasDiffuseMap(material), fIn_TexCoord);
     if (diffuse.a < 1.0 / 255) {
         // early out if surface is fully transparent
         discard;
     }
 
     vec3 N = fIn_WorldTBN[2];
-    if (material.hasNormalMap != 0) {
+    if (HasNormalMap(material)) {
         N = 2.0 * texture(material.normalMap, 1 - fIn_TexCoord).rgb - vec3(1.0);
         N = normalize(fIn_WorldTBN * N);
     }
 
-    vec3 specular = GetPropertyColor(material.specular, fIn_TexCoord).rgb;
+    vec3 specular = GetPropertyColor(material.specular, HasSpecularMap(material), fIn_TexCoord).rgb;
     float shininess = max(1, material.shininess);
 
     // write to GBuffer
@@ -0,0 +1,54 @@
+#version 410
+
+#include "common/Definitions.glsl"
+
+in vec3 fIn_WorldPosition;
+in mat3 fIn_WorldTBN;
+in vec2 fIn_TexCoord;
+flat in vec4 fIn_InstanceVct;
+
+#include "common/Material.glsl"
+uniform Material material;
+
+uniform float time;
+uniform vec3 EyePos;
+
+layout (location = 0) out vec4 GPositionRadiance;
+layout (location = 1) out vec4 GNormalShininess;
+layout (location = 2) out vec4 GAlbedoSpecular;
+layout (location = 3) out float GDepth;
+
+void main(void) {
+    vec4 diffuse = GetPropertyColor(material.diffuse, HasDiffuseMap(material), fIn_TexCoord);
+    if (diffuse.a < 1.0 / 255) {
+        // early out if surface is fully transparent
+        discard;
+    }
+
+    vec3 N = fIn_WorldTBN[2];
+    if (HasNormalMap(material)) {
+        N = 2.0 * texture(material.normalMap, 1 - fIn_TexCoord).rgb - vec3(1.0);
+        N = normalize(fIn_WorldTBN * N);
+    }
+
+    // per-instance VctProperties replace the material's specular color and radiance
+    bool overridesMaterial = fIn_InstanceVct.z > 0.5;
+    vec3 specular = overridesMaterial
+                    ? vec3(fIn_InstanceVct.y)
+                    : GetPropertyColor(material.specular, HasSpecularMap(material), fIn_TexCoord).rgb;
+    float radiance = overridesMaterial ? fIn_InstanceVct.x : 0.0;
+    float shininess = max(1, material.shininess);
+
+    // write to GBuffer
+
+    GPositionRadiance.xyz = fIn_WorldPosition;
+    GPositionRadiance.w = radiance / VCT_RADIANCE_MAX;
+
+    GNormalShininess.xyz = N;
+    GNormalShininess.w = shininess;
+
+    GAlbedoSpecular.rgb = diffuse.rgb;
+    GAlbedoSpecular.a = max(max(specular.r, specular.g), specular.b);
+
+    GDepth = gl_FragCoord.z;
+}
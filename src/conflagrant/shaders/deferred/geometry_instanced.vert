@@ -0,0 +1,28 @@
+#version 410
+
+#include "common/Definitions.glsl"
+#include "common/VertexAttributes.glsl"
+#include "common/InstanceAttributes.glsl"
+
+out vec3 fIn_WorldPosition;
+out mat3 fIn_WorldTBN;
+out vec2 fIn_TexCoord;
+flat out vec4 fIn_InstanceVct;
+
+#include "common/Uniforms.glsl"
+
+void main(void) {
+    mat4 InstanceM = vIn_InstanceM;
+
+    vec4 worldPosition = InstanceM * vec4(vIn_Position, 1.0);
+    fIn_WorldPosition = vec3(worldPosition);
+    gl_Position = P * V * vec4(fIn_WorldPosition, 1.0);
+    fIn_TexCoord = vIn_TexCoord;
+
+    vec3 T = normalize(vec3(InstanceM * vec4(vIn_Tangent, 0.0)));
+    vec3 N = normalize(vec3(InstanceM * vec4(vIn_Normal, 0.0)));
+    vec3 B = normalize(vec3(InstanceM * vec4(vIn_Bitangent, 0.0)));
+
+    fIn_WorldTBN = mat3(T, B, N);
+    fIn_InstanceVct = vIn_InstanceVct;
+}
@@ -7,8 +7,10 @@
 
 in vec2 fIn_TexCoord;
 
-uniform PointLight pointLights[MAX_POINTLIGHTS];
-uniform int numPointLights = 0;
+layout(std140) uniform PointLightBlock {
+    int numPointLights;
+    PointLight pointLights[MAX_POINTLIGHTS];
+};
 uniform DirectionalLight directionalLights[MAX_DIRECTIONALLIGHTS];
 uniform int numDirectionalLights = 0;
 
@@ -10,9 +10,14 @@ in mat3 fIn_WorldTBN;
 in vec3 fIn_WorldPosition;
 in vec2 fIn_TexCoord;
 in vec4 fIn_DirectionalLightSpacePositions[MAX_DIRECTIONALLIGHTS];
-
-uniform PointLight pointLights[MAX_POINTLIGHTS];
-uniform int numPointLights = 0;
+#ifdef MODEL_INSTANCING
+flat in vec4 fIn_InstanceVct;
+#endif
+
+layout(std140) uniform PointLightBlock {
+    int numPointLights;
+    PointLight pointLights[MAX_POINTLIGHTS];
+};
 uniform DirectionalLight directionalLights[MAX_DIRECTIONALLIGHTS];
 uniform int numDirectionalLights = 0;
 
@@ -28,18 +33,24 @@ void main(void) {
     vec3 result = vec3(0, 0, 0);
 
     vec3 N = fIn_WorldTBN[2];
-    if (material.hasNormalMap != 0) {
+    if (HasNormalMap(material)) {
         N = 2.0 * texture(material.normalMap, 1 - fIn_TexCoord).rgb - vec3(1.0);
         N = normalize(fIn_WorldTBN * N);
     }
 
-    vec4 diffuse = GetPropertyColor(material.diffuse, fIn_TexCoord);
+    vec4 diffuse = GetPropertyColor(material.diffuse, HasDiffuseMap(material), fIn_TexCoord);
     float alpha = diffuse.a;
     if (alpha < 1.0 / 255) {
         discard;
     }
 
-    vec3 specular = GetPropertyColor(material.specular, fIn_TexCoord).rgb;
+    vec3 specular = GetPropertyColor(material.specular, HasSpecularMap(material), fIn_TexCoord).rgb;
+#ifdef MODEL_INSTANCING
+    // per-instance VctProperties replace the material's specular color
+    if (fIn_InstanceVct.z > 0.5) {
+        specular = vec3(fIn_InstanceVct.y);
+    }
+#endif
 
     SurfaceInfo surf;
     surf.WorldPosition = fIn_WorldPosition;
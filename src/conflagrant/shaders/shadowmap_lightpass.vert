@@ -2,6 +2,7 @@
 
 #include "common/Definitions.glsl"
 #include "common/VertexAttributes.glsl"
+#include "common/ModelMatrix.glsl"
 
 out vec3 fIn_WorldPosition;
 out vec2 fIn_TexCoord;
@@ -9,7 +10,7 @@ out vec2 fIn_TexCoord;
 #include "common/Uniforms.glsl"
 
 void main(void) {
-    fIn_WorldPosition = vec3(M * vec4(vIn_Position, 1.0));
+    fIn_WorldPosition = vec3(ModelMatrix * vec4(vIn_Position, 1.0));
     gl_Position = P * V * vec4(fIn_WorldPosition, 1.0);
     fIn_TexCoord = vIn_TexCoord;
 }
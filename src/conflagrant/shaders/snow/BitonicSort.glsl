@@ -0,0 +1,27 @@
+// Bitonic sort of (key, index) pairs, see cfl::syst::SnowfallAnimator::SortOnGpu() for the dispatches. The number of
+// pairs is a power of two, and a pair goes before another if its key is smaller, or the keys are equal and its index
+// is smaller. Every compare-exchange step of a bitonic merge of size MergeSize pairs up the elements Stride apart:
+// the merge sorts its block ascending if the block's index is even, and descending otherwise.
+
+// the invocations of a work group, which sorts twice as many pairs in shared memory
+#define SORT_GROUP_SIZE 256
+#define SORT_GROUP_PAIRS (2 * SORT_GROUP_SIZE)
+
+#define SORT_BINDING 0
+
+layout(std430, binding = SORT_BINDING) restrict buffer SortBuffer {
+    uvec2 pairs[];
+};
+
+bool IsOrdered(uvec2 a, uvec2 b) {
+    return a.x < b.x || (a.x == b.x && a.y <= b.y);
+}
+
+// the first element of the compare-exchange done by invocation t, the second one is Stride elements later
+uint FirstOfPair(uint t, uint stride) {
+    return ((t & ~(stride - 1)) << 1) | (t & (stride - 1));
+}
+
+bool IsAscending(uint index, uint mergeSize) {
+    return (index & mergeSize) == 0;
+}
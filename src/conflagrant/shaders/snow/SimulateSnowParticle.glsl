@@ -1,5 +1,6 @@
 #include "common/Random.glsl"
 #include "common/noise/noise3D.glsl"
+#include "snow/SnowHeightField.glsl"
 #define NOISE_FUNCTION_NAME snoise_grad
 #include "common/noise/noise3Dgrad.glsl"
 
@@ -81,16 +82,8 @@ void SimulateSnowParticle(
         RespawnParticle(particleID, p, time, timeDelta, gravity);
     }
 
-    vec3 voxelCoords = GetUnitCubeCoordinates(p.position, VoxelCenter, VoxelHalfDimensions);
-    if (!IsWithinVoxelColume(voxelCoords))
-        return;
-
-    voxelCoords = GetNormalizedCoordinatesFromUnitCubeCoordinates(voxelCoords);
-
-    vec4 v = textureLod(VoxelizedScene, voxelCoords, 0);
-    float m = max(v.r, max(v.g, max(v.b, v.a)));
-
-    if (m > 0) {
+    // landed on a caster, or on the snow that already lies on it
+    if (LandOnHeightField(p.position)) {
         RespawnParticle(particleID, p, time, timeDelta, gravity);
     }
 }
@@ -0,0 +1,38 @@
+// The top-down height field of syst::SnowfallAnimator, see cfl::SnowHeightField. HeightField holds the world height
+// of the highest caster per texel, and SnowDepth counts the particles that landed on it.
+
+uniform sampler2D HeightField;
+layout(r32ui) uniform restrict coherent uimage2D SnowDepth;
+
+uniform vec2 HeightFieldCenter;
+uniform float HeightFieldHalfExtent;
+
+// how much a landed particle raises the snow of its texel, and how deep the snow gets at most
+uniform float ParticleSnowDepth = 0.0005;
+uniform float MaxSnowDepth = 0.25;
+
+bool GetHeightFieldTexel(const vec3 worldPosition, out ivec2 texel) {
+    vec2 coordinates = (worldPosition.xz - HeightFieldCenter) / HeightFieldHalfExtent;
+    if (any(greaterThanEqual(abs(coordinates), vec2(1))))
+        return false;
+
+    texel = ivec2((0.5 * coordinates + 0.5) * textureSize(HeightField, 0));
+    return true;
+}
+
+// true if the position is below the surface of the casters and the snow on them, in which case the particle adds to
+// the snow of the texel
+bool LandOnHeightField(const vec3 worldPosition) {
+    ivec2 texel;
+    if (!GetHeightFieldTexel(worldPosition, texel))
+        return false;
+
+    float snowDepth = ParticleSnowDepth * imageLoad(SnowDepth, texel).r;
+    if (worldPosition.y >= texelFetch(HeightField, texel, 0).r + snowDepth)
+        return false;
+
+    if (snowDepth < MaxSnowDepth) {
+        imageAtomicAdd(SnowDepth, texel, 1u);
+    }
+    return true;
+}
@@ -5,43 +5,57 @@ struct Particle {
     float lifetime;
 };
 
-#ifdef USE_IMAGE
-#include "common/UnpackImage.glsl"
+// see comp::SnowEmitter
+#define SNOW_POSITIONS_BINDING 1
+#define SNOW_VELOCITIES_BINDING 2
+#define SNOW_ANGLES_BINDING 3
+#define SNOW_LIFETIMES_BINDING 4
+#define SNOW_DRAW_COMMAND_BINDING 5
+
+#ifdef USE_BUFFERS
+// one stream per attribute, positions and velocities are packed since an array of vec3 would be padded to vec4
+layout(std430, binding = SNOW_POSITIONS_BINDING) restrict buffer SnowPositions {
+    float positions[];
+};
 
-Particle LoadParticle(int index) {
-    Particle p;
+layout(std430, binding = SNOW_VELOCITIES_BINDING) restrict buffer SnowVelocities {
+    float velocities[];
+};
 
-    ivec2 coords = ivec2(index, 0);
-    ImageLoad2D_vec3_float(PositionsAngles,     coords, p.position, p.angle);
-    ImageLoad2D_vec3_float(VelocitiesLifetimes, coords, p.velocity, p.lifetime);
+layout(std430, binding = SNOW_ANGLES_BINDING) restrict buffer SnowAngles {
+    float angles[];
+};
 
-    return p;
-}
+layout(std430, binding = SNOW_LIFETIMES_BINDING) restrict buffer SnowLifetimes {
+    float lifetimes[];
+};
 
-void StoreParticle(int index, Particle p) {
-    ivec2 coords = ivec2(index, 0);
-    ImageStore2D_vec3_float(PositionsAngles,     coords, p.position, p.angle);
-    ImageStore2D_vec3_float(VelocitiesLifetimes, coords, p.velocity, p.lifetime);
+vec3 LoadPosition(int index) {
+    return vec3(positions[3 * index], positions[3 * index + 1], positions[3 * index + 2]);
 }
 
-#endif
-
-#ifdef USE_TEXTURE
-#include "common/UnpackTexture.glsl"
-
-Particle LoadParticle(vec2 texCoord) {
+Particle LoadParticle(int index) {
     Particle p;
 
-    Texture_vec3_float(InPositionsAngles,     texCoord, p.position, p.angle);
-    Texture_vec3_float(InVelocitiesLifetimes, texCoord, p.velocity, p.lifetime);
+    p.position = LoadPosition(index);
+    p.velocity = vec3(velocities[3 * index], velocities[3 * index + 1], velocities[3 * index + 2]);
+    p.angle = angles[index];
+    p.lifetime = lifetimes[index];
 
     return p;
 }
 
-void StoreParticle(Particle p) {
-    OutPositionAngle = vec4(p.position, p.angle);
-    OutVelocityLifetime = vec4(p.velocity, p.lifetime);
+void StoreParticle(int index, Particle p) {
+    positions[3 * index] = p.position.x;
+    positions[3 * index + 1] = p.position.y;
+    positions[3 * index + 2] = p.position.z;
+
+    velocities[3 * index] = p.velocity.x;
+    velocities[3 * index + 1] = p.velocity.y;
+    velocities[3 * index + 2] = p.velocity.z;
+
+    angles[index] = p.angle;
+    lifetimes[index] = p.lifetime;
 }
 
 #endif
-
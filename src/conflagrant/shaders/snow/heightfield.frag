@@ -0,0 +1,10 @@
+#version 410
+
+in float fIn_WorldHeight;
+
+layout (location = 0) out float OutHeight;
+
+void main(void) {
+    // the depth test keeps the highest surface
+    OutHeight = fIn_WorldHeight;
+}
@@ -0,0 +1,16 @@
+#version 410
+
+// Renders the casters top down into the height field of syst::SnowfallAnimator, see cfl::SnowHeightField.
+
+#include "common/Definitions.glsl"
+#include "common/VertexAttributes.glsl"
+
+out float fIn_WorldHeight;
+
+#include "common/Uniforms.glsl"
+
+void main(void) {
+    vec4 worldPosition = M * vec4(vIn_Position, 1.0);
+    fIn_WorldHeight = worldPosition.y;
+    gl_Position = P * worldPosition;
+}
@@ -1,14 +1,17 @@
-#version 410
+#version 430
 
 #include "common/Definitions.glsl"
-#include "common/UnpackTexture.glsl"
 #include "common/VertexAttributes.glsl"
 #include "common/Uniforms.glsl"
 
-uniform sampler2D InPositionsAngles;
-uniform sampler2D InVelocitiesLifetimes;
 uniform int Count;
-uniform int MaxCount;
+
+// 1 if the pairs of snow/snowfall_depthsort.comp hold the back to front order of this frame's particles
+uniform int IsSorted;
+
+#define USE_BUFFERS
+#include "snow/SnowParticle.glsl"
+#include "snow/BitonicSort.glsl"
 
 #define ID gl_InstanceID
 
@@ -19,12 +22,14 @@ out float gIn_Angle;
 out float gIn_Lifetime;
 
 void main(void) {
-    gIn_ParticleID = ID;
-
-    vec2 texCoord = vec2(float(ID) / MaxCount, 0);
-
-    Texture_vec3_float(InPositionsAngles,     texCoord, gIn_WorldPosition, gIn_Angle);
-    Texture_vec3_float(InVelocitiesLifetimes, texCoord, gIn_WorldVelocity, gIn_Lifetime);
+    int particleID = IsSorted == 1 ? int(pairs[ID].y) : ID;
+    gIn_ParticleID = particleID;
+
+    Particle p = LoadParticle(particleID);
+    gIn_WorldPosition = p.position;
+    gIn_WorldVelocity = p.velocity;
+    gIn_Angle = p.angle;
+    gIn_Lifetime = p.lifetime;
 
     gl_Position = vec4(gIn_WorldPosition, 1.0);
 }
@@ -0,0 +1,70 @@
+// Voxel clipmap, see cfl::VoxelClipmap for the bookkeeping.
+//
+// Level l has voxels of size ClipmapVoxelSize * 2^l and is centered on ClipmapCenters[l]. All levels have the same
+// resolution and are stacked along z in one texture: the voxel at integer world voxel coordinate v of level l is
+// stored at texel (v mod ClipmapResolution) + (0, 0, l * ClipmapResolution).
+
+#define MAX_CLIPMAP_LEVELS 8
+
+uniform int ClipmapLevels;
+uniform int ClipmapResolution;
+uniform float ClipmapVoxelSize;
+uniform vec3 ClipmapCenters[MAX_CLIPMAP_LEVELS];
+
+float ClipmapLevelVoxelSize(int level) {
+    return ClipmapVoxelSize * float(1 << level);
+}
+
+ivec3 ClipmapWorldVoxel(vec3 worldPosition, int level) {
+    return ivec3(floor(worldPosition / ClipmapLevelVoxelSize(level)));
+}
+
+ivec3 ClipmapTexel(ivec3 worldVoxel, int level) {
+    // the resolution is a power of two, so this is the positive remainder for negative coordinates as well
+    ivec3 texel = worldVoxel & (ClipmapResolution - 1);
+    texel.z += level * ClipmapResolution;
+    return texel;
+}
+
+#ifndef VCT_CLIPMAP_NO_SAMPLER
+uniform sampler3D VoxelClipmap;
+
+bool IsWithinClipmapLevel(vec3 worldPosition, int level, float margin) {
+    const float halfExtent = 0.5 * ClipmapResolution * ClipmapLevelVoxelSize(level);
+    return all(lessThan(abs(worldPosition - ClipmapCenters[level]), vec3(halfExtent - margin)));
+}
+
+bool IsWithinClipmap(vec3 worldPosition) {
+    return IsWithinClipmapLevel(worldPosition, ClipmapLevels - 1, 0);
+}
+
+vec4 SampleClipmapLevel(vec3 worldPosition, int level) {
+    const float resolution = ClipmapResolution;
+
+    // x and y wrap around in hardware, z is clamped so that the filter does not reach into the neighbouring level
+    vec3 texel = worldPosition / ClipmapLevelVoxelSize(level);
+    texel.z = clamp(mod(texel.z, resolution), 0.5, resolution - 0.5) + level * resolution;
+
+    vec4 voxel = texture(VoxelClipmap, vec3(texel.xy / resolution, texel.z / (resolution * ClipmapLevels)));
+
+    // every level is voxelized directly, so the alpha channel counts fragments like level 0 of the dense texture
+    voxel.a = clamp(255 * voxel.a, 0, 1);
+    return voxel;
+}
+
+// counterpart of textureLod on the dense voxel texture: each mipmap level doubles the voxel size of level 0, and
+// positions outside of a level are sampled from the next coarser level that contains them
+vec4 SampleClipmap(vec3 worldPosition, float mipmapLevel) {
+    int finest = 0;
+    while (finest < ClipmapLevels - 1 &&
+           !IsWithinClipmapLevel(worldPosition, finest, ClipmapLevelVoxelSize(finest))) {
+        finest++;
+    }
+
+    const float level = clamp(mipmapLevel, float(finest), float(ClipmapLevels - 1));
+    const int lower = int(floor(level));
+    const int upper = min(lower + 1, ClipmapLevels - 1);
+
+    return mix(SampleClipmapLevel(worldPosition, lower), SampleClipmapLevel(worldPosition, upper), level - lower);
+}
+#endif
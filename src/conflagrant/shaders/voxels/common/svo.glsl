@@ -0,0 +1,124 @@
+// Sparse voxel octree, see cfl::SparseVoxelOctree for the CPU reference.
+//
+// Node 0 is the root, every subdivided node points to 8 consecutive children. Leaves are at depth SvoLevels, which
+// corresponds to mipmap level 0 of the dense voxel texture. Shaders that build the octree define SVO_BUILD before
+// including this file.
+
+// bindings match cfl::syst::DeferredRenderer
+#define SVO_FRAGMENTS_BINDING 1
+#define SVO_NODES_BINDING 2
+#define SVO_COUNTERS_BINDING 3
+
+#define SVO_NONE 0xFFFFFFFFu
+#define SVO_BUSY 0xFFFFFFFFu
+#define SVO_POSITION_BITS 10u
+#define SVO_POSITION_MASK 0x3FFu
+
+struct SvoNode {
+    uint children;
+    uint color;
+};
+
+#ifdef SVO_BUILD
+layout(std430, binding = SVO_NODES_BINDING) coherent buffer SvoNodeBuffer {
+    SvoNode svoNodes[];
+};
+
+layout(std430, binding = SVO_FRAGMENTS_BINDING) buffer SvoFragmentBuffer {
+    uvec2 svoFragments[];
+};
+
+// the dispatch arguments are read by glDispatchComputeIndirect
+layout(std430, binding = SVO_COUNTERS_BINDING) coherent buffer SvoCounterBuffer {
+    uint svoFragmentCount;
+    uint svoNodeCount;
+    uint svoDispatchArguments[3];
+};
+
+uniform int SvoFragmentCapacity;
+uniform int SvoNodeCapacity;
+#else
+layout(std430, binding = SVO_NODES_BINDING) readonly buffer SvoNodeBuffer {
+    SvoNode svoNodes[];
+};
+#endif
+
+uniform int SvoLevels;
+
+uint SvoPackPosition(uvec3 voxel) {
+    return (voxel.x & SVO_POSITION_MASK) |
+           ((voxel.y & SVO_POSITION_MASK) << SVO_POSITION_BITS) |
+           ((voxel.z & SVO_POSITION_MASK) << (2u * SVO_POSITION_BITS));
+}
+
+uvec3 SvoUnpackPosition(uint position) {
+    return uvec3(position, position >> SVO_POSITION_BITS, position >> (2u * SVO_POSITION_BITS)) & SVO_POSITION_MASK;
+}
+
+uint SvoOctant(uvec3 voxel, int depth) {
+    const uvec3 bits = (voxel >> uint(SvoLevels - 1 - depth)) & 1u;
+    return bits.x | (bits.y << 1) | (bits.z << 2);
+}
+
+// returns the node at the given depth that contains the voxel, or SVO_NONE if that region is empty
+uint SvoFindNode(uvec3 voxel, int depth) {
+    uint node = 0;
+    for (int d = 0; d < depth; ++d) {
+        const uint children = svoNodes[node].children;
+        if (children == 0 || children == SVO_BUSY) {
+            return SVO_NONE;
+        }
+        node = children + SvoOctant(voxel, d);
+    }
+    return node;
+}
+
+vec4 SvoLookup(uvec3 voxel, int mipmapLevel) {
+    const uint node = SvoFindNode(voxel, SvoLevels - clamp(mipmapLevel, 0, SvoLevels));
+    return node == SVO_NONE ? vec4(0) : unpackUnorm4x8(svoNodes[node].color);
+}
+
+// counterpart of textureLod on the dense voxel texture, but without filtering within a level
+vec4 SvoSampleLod(vec3 normalizedCoordinates, float mipmapLevel) {
+    if (any(lessThan(normalizedCoordinates, vec3(0))) || any(greaterThanEqual(normalizedCoordinates, vec3(1)))) {
+        return vec4(0);
+    }
+
+    const uvec3 voxel = uvec3(normalizedCoordinates * float(1 << SvoLevels));
+
+    const float level = clamp(mipmapLevel, 0, SvoLevels);
+    const int lower = int(floor(level));
+    const int upper = min(lower + 1, SvoLevels);
+
+    return mix(SvoLookup(voxel, lower), SvoLookup(voxel, upper), level - lower);
+}
+
+#ifdef SVO_BUILD
+void SvoAppendFragment(uvec3 voxel, vec3 color) {
+    const uint index = atomicAdd(svoFragmentCount, 1u);
+    if (index < uint(SvoFragmentCapacity)) {
+        svoFragments[index] = uvec2(SvoPackPosition(voxel), packUnorm4x8(vec4(color, 1.0 / 255.0)));
+    }
+}
+
+uint SvoNumFragments() {
+    return min(svoFragmentCount, uint(SvoFragmentCapacity));
+}
+
+// running average with the count in the alpha channel, like ImageAtomicAverageRGBA8 in voxels/common/util.glsl
+void SvoAtomicAverageRGBA8(uint node, vec3 nextVec3) {
+    uint nextUint = packUnorm4x8(vec4(nextVec3, 1.0 / 255.0));
+    uint prevUint = 0;
+    uint currUint;
+
+    while ((currUint = atomicCompSwap(svoNodes[node].color, prevUint, nextUint)) != prevUint) {
+        prevUint = currUint;
+        const vec4 currVec4 = unpackUnorm4x8(currUint);
+
+        const uint count = uint(currVec4.a * 255.0);
+        const vec3 average = (currVec4.rgb * count + nextVec3) / (count + 1);
+
+        nextUint = packUnorm4x8(vec4(average, min(count + 1, 255) / 255.0));
+    }
+}
+#endif
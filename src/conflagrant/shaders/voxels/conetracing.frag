@@ -13,8 +13,10 @@
 
 in vec2 fIn_TexCoord;
 
-uniform PointLight pointLights[MAX_POINTLIGHTS];
-uniform int numPointLights = 0;
+layout(std140) uniform PointLightBlock {
+    int numPointLights;
+    PointLight pointLights[MAX_POINTLIGHTS];
+};
 uniform DirectionalLight directionalLights[MAX_DIRECTIONALLIGHTS];
 uniform int numDirectionalLights = 0;
 
@@ -25,7 +27,15 @@ uniform sampler2D GAlbedoSpecular;
 uniform float time;
 uniform vec3 EyePos;
 
+#ifdef VCT_CLIPMAP
+#include "voxels/common/clipmap.glsl"
+#elif defined(VCT_SPARSE_OCTREE)
+#include "voxels/common/svo.glsl"
+#define SampleVoxels(coordinates, level) SvoSampleLod(coordinates, level)
+#else
 uniform sampler3D VoxelizedScene;
+#define SampleVoxels(coordinates, level) textureLod(VoxelizedScene, coordinates, level)
+#endif
 uniform vec3 VoxelHalfDimensions;
 uniform vec3 VoxelCenter;
 uniform float VoxelSize;
@@ -34,6 +44,16 @@ uniform float DirectMultiplier = 1.0;
 uniform float IndirectDiffuseMultiplier = 1.0;
 uniform float IndirectSpecularMultiplier = 1.0;
 
+// VCT_INDIRECT_ONLY traces only the indirect light and the visibility, into a target that is ResolutionDivisor times
+// smaller than the G-buffer. Its albedo is multiplied in at full resolution, so texture detail survives upsampling.
+// VCT_UPSAMPLED_INDIRECT reads them from IndirectLighting instead of tracing, see voxels/indirect_upsample.frag.
+#if VCT_INDIRECT_ONLY
+uniform int ResolutionDivisor;
+uniform vec2 ScreenSize;
+#elif VCT_UPSAMPLED_INDIRECT
+uniform sampler2D IndirectLighting;
+#endif
+
 out vec4 out_Color;
 
 vec3 TraceVoxelCone(const vec3 Origin, const vec3 Direction, const float MipmapFactor, const float ColorBoost,
@@ -50,12 +70,19 @@ vec3 TraceVoxelCone(const vec3 Origin, const vec3 Direction, const float MipmapF
         const float MipmapLevel = MipmapFactor * log2((1 + VCT_INDIRECT_SPREAD * t / VoxelSize));
         const float SamplePower = (MipmapLevel + 1) * (MipmapLevel + 1);
 
+#ifdef VCT_CLIPMAP
+        if (!IsWithinClipmap(worldPosition)) {
+            break;
+        }
+        vec4 voxel = SampleClipmap(worldPosition, min(VCT_MIPMAP_MAX, MipmapLevel));
+#else
         vec3 voxelCoordinates = GetUnitCubeCoordinates(worldPosition, VoxelCenter, VoxelHalfDimensions);
         if (!IsWithinVoxelColume(voxelCoordinates)) {
             break;
         }
         voxelCoordinates = GetNormalizedCoordinatesFromUnitCubeCoordinates(voxelCoordinates);
-        vec4 voxel = textureLod(VoxelizedScene, voxelCoordinates, min(VCT_MIPMAP_MAX, MipmapLevel));
+        vec4 voxel = SampleVoxels(voxelCoordinates, min(VCT_MIPMAP_MAX, MipmapLevel));
+#endif
         voxel.rgb *= 1 + ColorBoost;
 
         if (MipmapLevel == 0) {
@@ -150,11 +177,18 @@ void TextureVec3AndFloat(sampler2D sampler, vec2 texCoords, out vec3 outvec3, ou
 void main(void) {
     vec3 result = vec3(0, 0, 0);
 
+#if VCT_INDIRECT_ONLY
+    // the center of the G-buffer texel this one stands for
+    const vec2 TexCoord = (vec2(ivec2(gl_FragCoord.xy) * ResolutionDivisor) + 0.5) / ScreenSize;
+#else
+    const vec2 TexCoord = fIn_TexCoord;
+#endif
+
     SurfaceInfo surf;
-    TextureVec3AndFloat(GPositionRadiance, fIn_TexCoord, surf.WorldPosition, surf.Radiance);
+    TextureVec3AndFloat(GPositionRadiance, TexCoord, surf.WorldPosition, surf.Radiance);
     surf.Radiance *= VCT_RADIANCE_MAX;
-    TextureVec3AndFloat(GNormalShininess, fIn_TexCoord, surf.Normal, surf.Shininess);
-    TextureVec3AndFloat(GAlbedoSpecular, fIn_TexCoord, surf.Diffuse, surf.Specular);
+    TextureVec3AndFloat(GNormalShininess, TexCoord, surf.Normal, surf.Shininess);
+    TextureVec3AndFloat(GAlbedoSpecular, TexCoord, surf.Diffuse, surf.Specular);
 
     if (length(surf.Normal) < 0.1) {
         // invalid normal => no fragment here
@@ -163,9 +197,18 @@ void main(void) {
 
     vec3 E = normalize(EyePos - surf.WorldPosition);
 
+#if VCT_UPSAMPLED_INDIRECT
+    const vec4 indirect = texelFetch(IndirectLighting, ivec2(gl_FragCoord.xy), 0);
+    const float visibility = indirect.a;
+#else
     const float occlusion = quadraticInOut(clamp(ComputeOcclusion(surf), 0, 1));
     const float visibility = clamp(1 - VCT_OCCLUSION_STRENGTH * occlusion, 0, 1);
+#endif
 
+#if VCT_INDIRECT_ONLY
+    // the albedo is multiplied in after upsampling
+    surf.Diffuse = vec3(1);
+#else
     // calculate direct lighting
     int i;
     for (i = 0; i < numPointLights; i++) {
@@ -180,14 +223,22 @@ void main(void) {
 
     // emit light from radiant surfaces
     result += surf.Diffuse * surf.Radiance;
+#endif
 
-
+#if VCT_UPSAMPLED_INDIRECT
+    result += surf.Diffuse * indirect.rgb;
+#else
     // calculate indirect lighting
     result += visibility * IndirectDiffuseMultiplier
             * VCT_DIFFUSE_STRENGTH * ApplyIndirectDiffuseLight(surf);
     result += visibility * IndirectSpecularMultiplier
             * surf.Specular * VCT_SPECULAR_STRENGTH * ApplyIndirectSpecularLight(surf, E,
                                                         VCT_DIFFUSION_MULTIPLIER * surf.Specular);
+#endif
 
+#if VCT_INDIRECT_ONLY
+    out_Color = vec4(result, visibility);
+#else
     out_Color = vec4(pow(result, vec3(GAMMA)), 1);
+#endif
 }
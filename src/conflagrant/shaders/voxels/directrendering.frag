@@ -9,7 +9,15 @@
 in vec3 fIn_RayOrigin;
 in vec3 fIn_RayDirection;
 
+#ifdef VCT_CLIPMAP
+#include "voxels/common/clipmap.glsl"
+#elif defined(VCT_SPARSE_OCTREE)
+#include "voxels/common/svo.glsl"
+#define SampleVoxels(coordinates, level) SvoSampleLod(coordinates, level)
+#else
 uniform sampler3D VoxelizedScene;
+#define SampleVoxels(coordinates, level) textureLod(VoxelizedScene, coordinates, level)
+#endif
 uniform vec3 EyePos;
 uniform vec3 VoxelHalfDimensions;
 uniform vec3 VoxelCenter;
@@ -35,11 +43,17 @@ void main(void) {
 	for(int i = 0; i < N && alpha < BreakOnAlpha; ++i) {
 	    vec3 worldPosition = fIn_RayOrigin + (offset + EASE(i * fraction) * RenderDistance) * fIn_RayDirection;
 
+#ifdef VCT_CLIPMAP
+        if(!IsWithinClipmap(worldPosition)) continue;
+
+		vec4 texel = SampleClipmap(worldPosition, MipmapLevel);
+#else
         vec3 voxelCoordinates = GetUnitCubeCoordinates(worldPosition, VoxelCenter, VoxelHalfDimensions);
         if(!IsWithinVoxelColume(voxelCoordinates)) continue;
 
         voxelCoordinates = GetNormalizedCoordinatesFromUnitCubeCoordinates(voxelCoordinates);
-		vec4 texel = textureLod(VoxelizedScene, voxelCoordinates, MipmapLevel);
+		vec4 texel = SampleVoxels(voxelCoordinates, MipmapLevel);
+#endif
 
 		if (MipmapLevel == 0) {
             texel.a = texel.a > 0 ? 1 : 0;
@@ -0,0 +1,100 @@
+#version 450 core
+
+// Upsamples the indirect light that voxels/conetracing.frag traced at a reduced resolution (VCT_INDIRECT_ONLY) and
+// blends it with the previous frame's result.
+//
+// Texel t of the reduced resolution target was traced at G-buffer texel t * ResolutionDivisor. Every pixel weights
+// the four closest of them bilinearly and by how close their depth and normal are to its own, so that light does not
+// bleed across edges. The previous frame's result is reprojected with the pixel's world position and clamped to the
+// range of the four samples, which rejects most of the history that became visible or changed since.
+
+#include "common/Definitions.glsl"
+#include "common/DepthFunctions.glsl"
+
+uniform sampler2D IndirectLighting;
+uniform sampler2D IndirectHistory;
+
+uniform sampler2D GPositionRadiance;
+uniform sampler2D GNormalShininess;
+uniform sampler2D GDepth;
+
+uniform int ResolutionDivisor;
+uniform float ZNear, ZFar;
+
+uniform mat4 PreviousVP;
+// how much of the reprojected history is kept, 0 if there is none
+uniform float HistoryWeight;
+
+out vec4 out_Color;
+
+bool IsSurface(vec3 normal) {
+    // invalid normal => no fragment here
+    return length(normal) >= 0.1;
+}
+
+void main(void) {
+    const ivec2 texel = ivec2(gl_FragCoord.xy);
+
+    const vec3 normal = texelFetch(GNormalShininess, texel, 0).xyz;
+    if (!IsSurface(normal)) {
+        discard;
+    }
+    const float depth = LinearizeDepth(texelFetch(GDepth, texel, 0).x, ZNear, ZFar);
+
+    const ivec2 lowSize = textureSize(IndirectLighting, 0);
+    const vec2 lowPosition = (vec2(texel) + 0.5) / ResolutionDivisor - 0.5;
+    const ivec2 lowBase = ivec2(floor(lowPosition));
+    const vec2 f = lowPosition - vec2(lowBase);
+
+    vec4 sum = vec4(0);
+    float totalWeight = 0;
+    vec4 minimum = vec4(1e30), maximum = vec4(-1e30);
+
+    // if no sample is similar enough, the most similar one is used
+    vec4 best = vec4(0);
+    float bestSimilarity = -1;
+
+    for (int i = 0; i < 4; ++i) {
+        const ivec2 offset = ivec2(i & 1, i >> 1);
+        const ivec2 lowTexel = clamp(lowBase + offset, ivec2(0), lowSize - 1);
+        const ivec2 sampleTexel = lowTexel * ResolutionDivisor;
+
+        const vec3 sampleNormal = texelFetch(GNormalShininess, sampleTexel, 0).xyz;
+        if (!IsSurface(sampleNormal)) {
+            continue;
+        }
+        const float sampleDepth = LinearizeDepth(texelFetch(GDepth, sampleTexel, 0).x, ZNear, ZFar);
+        const vec4 value = texelFetch(IndirectLighting, lowTexel, 0);
+
+        const float similarity = exp(-abs(depth - sampleDepth) / (VCT_UPSAMPLE_DEPTH_SIGMA * depth))
+                               * pow(max(dot(normal, normalize(sampleNormal)), 0), VCT_UPSAMPLE_NORMAL_POWER);
+        const vec2 bilinear = mix(1 - f, f, vec2(offset));
+        const float weight = bilinear.x * bilinear.y * similarity;
+
+        sum += weight * value;
+        totalWeight += weight;
+        minimum = min(minimum, value);
+        maximum = max(maximum, value);
+
+        if (similarity > bestSimilarity) {
+            best = value;
+            bestSimilarity = similarity;
+        }
+    }
+
+    vec4 result = totalWeight > 1e-4 ? sum / totalWeight : best;
+
+    if (HistoryWeight > 0 && bestSimilarity >= 0) {
+        const vec3 worldPosition = texelFetch(GPositionRadiance, texel, 0).xyz;
+        const vec4 previousClip = PreviousVP * vec4(worldPosition, 1);
+        const vec2 previousCoordinates = 0.5 * previousClip.xy / previousClip.w + 0.5;
+
+        if (previousClip.w > 0 && all(greaterThanEqual(previousCoordinates, vec2(0)))
+                               && all(lessThanEqual(previousCoordinates, vec2(1)))) {
+            const vec4 history = clamp(texture(IndirectHistory, previousCoordinates), minimum, maximum);
+            result = mix(result, history, HistoryWeight);
+        }
+    }
+
+    out_Color = result;
+}
@@ -11,14 +11,33 @@ in vec3 fIn_VoxelUnitCubeCoord;
 in mat3 fIn_WorldTBN;
 in vec2 fIn_TexCoord;
 in vec4 fIn_DirectionalLightSpacePositions[MAX_DIRECTIONALLIGHTS];
-
-uniform PointLight pointLights[MAX_POINTLIGHTS];
-uniform int numPointLights = 0;
+#ifdef MODEL_INSTANCING
+flat in vec4 fIn_InstanceVct;
+#endif
+
+layout(std140) uniform PointLightBlock {
+    int numPointLights;
+    PointLight pointLights[MAX_POINTLIGHTS];
+};
 uniform DirectionalLight directionalLights[MAX_DIRECTIONALLIGHTS];
 uniform int numDirectionalLights = 0;
 
+#ifdef VCT_SPARSE_OCTREE
+#define SVO_BUILD
+#include "voxels/common/svo.glsl"
+#else
+#ifdef VCT_CLIPMAP
+#define VCT_CLIPMAP_NO_SAMPLER
+#include "voxels/common/clipmap.glsl"
+
+// only the voxels of this box of the level are written, in world voxel coordinates
+uniform int ClipmapLevel;
+uniform ivec3 UpdateMin;
+uniform ivec3 UpdateMax;
+#endif
 //layout(RGBA8) uniform image3D VoxelizedScene;
 uniform layout (r32ui) coherent volatile uimage3D VoxelizedScene;
+#endif
 
 uniform Material material;
 
@@ -33,18 +52,23 @@ void main(void){
     vec3 voxelCoordinates = GetUnitCubeCoordinates(fIn_WorldPosition, VoxelCenter, VoxelHalfDimensions);
     if(!IsWithinVoxelColume(voxelCoordinates)) discard;
 
+#ifdef VCT_CLIPMAP
+    const ivec3 worldVoxel = ClipmapWorldVoxel(fIn_WorldPosition, ClipmapLevel);
+    if (any(lessThan(worldVoxel, UpdateMin)) || any(greaterThanEqual(worldVoxel, UpdateMax))) discard;
+#endif
+
     // x, y and z go from 0 to 1, i.e. for indexing voxel volume
     voxelCoordinates = GetNormalizedCoordinatesFromUnitCubeCoordinates(voxelCoordinates);
 
     vec3 result = vec3(0, 0, 0);
 
     vec3 N = fIn_WorldTBN[2];
-    if (material.hasNormalMap != 0) {
+    if (HasNormalMap(material)) {
         N = 2.0 * texture(material.normalMap, fIn_TexCoord).rgb - vec3(1.0);
         N = normalize(fIn_WorldTBN * N);
     }
 
-    vec4 diffuse = GetPropertyColor(material.diffuse, fIn_TexCoord);
+    vec4 diffuse = GetPropertyColor(material.diffuse, HasDiffuseMap(material), fIn_TexCoord);
     if (diffuse.a < 1.0 / 255) {
         discard;
     }
@@ -56,6 +80,12 @@ void main(void){
     surf.Specular = 0; // max(max(specular.r, specular.g), specular.b);
     surf.Shininess = max(1, material.shininess);
     surf.Radiance = material.radiance;
+#ifdef MODEL_INSTANCING
+    // per-instance VctProperties replace the material's radiance
+    if (fIn_InstanceVct.z > 0.5) {
+        surf.Radiance = fIn_InstanceVct.x;
+    }
+#endif
 
     vec3 E = normalize(EyePos - fIn_WorldPosition);
 
@@ -75,6 +105,13 @@ void main(void){
         result = diffuse.rgb;
     }
 
+#ifdef VCT_SPARSE_OCTREE
+    const uint resolution = 1u << SvoLevels;
+    SvoAppendFragment(min(uvec3(voxelCoordinates * resolution), uvec3(resolution - 1)), result);
+#elif defined(VCT_CLIPMAP)
+    ImageAtomicAverageRGBA8(VoxelizedScene, ClipmapTexel(worldVoxel, ClipmapLevel), result);
+#else
     ivec3 imageCoords = GetIntegerCoordinatesFromNormalizedTextureCoordinates(imageSize(VoxelizedScene), voxelCoordinates);
     ImageAtomicAverageRGBA8(VoxelizedScene, imageCoords, result);
+#endif
 }
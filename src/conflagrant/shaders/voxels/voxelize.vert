@@ -2,6 +2,7 @@
 
 #include "common/Definitions.glsl"
 #include "common/VertexAttributes.glsl"
+#include "common/ModelMatrix.glsl"
 
 uniform mat4 M;
 uniform mat4 V;
@@ -11,6 +12,9 @@ out vec3 gIn_WorldPosition;
 out mat3 gIn_WorldTBN;
 out vec2 gIn_TexCoord;
 out vec4 gIn_DirectionalLightSpacePositions[MAX_DIRECTIONALLIGHTS];
+#ifdef MODEL_INSTANCING
+flat out vec4 gIn_InstanceVct;
+#endif
 
 #include "common/DirectionalLight.glsl"
 
@@ -18,15 +22,18 @@ uniform DirectionalLight directionalLights[MAX_DIRECTIONALLIGHTS];
 uniform int numDirectionalLights = 0;
 
 void main(void){
-    vec4 worldPosition = M * vec4(vIn_Position, 1.0);
+    vec4 worldPosition = ModelMatrix * vec4(vIn_Position, 1.0);
     gIn_WorldPosition = vec3(worldPosition);
     gIn_TexCoord = vIn_TexCoord;
 
-    vec3 T = normalize(vec3(M * vec4(vIn_Tangent, 0.0)));
-    vec3 N = normalize(vec3(M * vec4(vIn_Normal, 0.0)));
-    vec3 B = normalize(vec3(M * vec4(vIn_Bitangent, 0.0)));
+    vec3 T = normalize(vec3(ModelMatrix * vec4(vIn_Tangent, 0.0)));
+    vec3 N = normalize(vec3(ModelMatrix * vec4(vIn_Normal, 0.0)));
+    vec3 B = normalize(vec3(ModelMatrix * vec4(vIn_Bitangent, 0.0)));
 
     gIn_WorldTBN = mat3(T, B, N);
+#ifdef MODEL_INSTANCING
+    gIn_InstanceVct = vIn_InstanceVct;
+#endif
 
     for (int i = 0; i < numDirectionalLights; ++i) {
         gIn_DirectionalLightSpacePositions[i] = directionalLights[i].VP * worldPosition;
@@ -1,5 +1,7 @@
 #include "Animator.hh"
 
+#include <conflagrant/ComponentView.hh>
+#include <conflagrant/ChangeJournal.hh>
 #include <conflagrant/components/Transform.hh>
 #include <conflagrant/components/VelocityAnimation.hh>
 #include <conflagrant/components/PeriodicalAnimation.hh>
@@ -35,9 +37,20 @@ void Animator::update(entityx::EntityManager &entities, entityx::EventManager &e
 
     auto const delta = static_cast<float>(Time::DeltaTime());
 
-    for (auto entity : entities.entities_with_components(transform, velocity)) {
-        velocity->isRunning |= startAllNextFrame;
-        velocity->isRunning &= !stopAllNextFrame;
+    // the transforms record their own changes, the other components are recorded here
+    auto &journal = ChangeJournal::Of(entities);
+
+    // starts or stops the animation for the hotkeys, recording it if that changed anything
+    auto const toggle = [&](entityx::Entity entity, TypeId component, bool &isRunning) {
+        auto const wasRunning = isRunning;
+        isRunning = (isRunning || startAllNextFrame) && !stopAllNextFrame;
+        if (isRunning != wasRunning) {
+            journal.Record(entity.id(), component);
+        }
+    };
+
+    for (auto entity : EntitiesWith(entities, transform, velocity)) {
+        toggle(entity, GetComponentTypeId<comp::VelocityAnimation>(), velocity->isRunning);
 
         if (!velocity->isRunning) {
             continue;
@@ -53,15 +66,15 @@ void Animator::update(entityx::EntityManager &entities, entityx::EventManager &e
         transform->Position(transform->Position() + delta * velocity->linearVelocity);
     }
 
-    for (auto entity : entities.entities_with_components(transform, period)) {
-        period->isRunning |= startAllNextFrame;
-        period->isRunning &= !stopAllNextFrame;
+    for (auto entity : EntitiesWith(entities, transform, period)) {
+        toggle(entity, GetComponentTypeId<comp::PeriodicalAnimation>(), period->isRunning);
 
         if (!period->isRunning) {
             if (period->wasRunning) {
                 transform->Position(period->startPosition);
                 transform->Quaternion(period->startRotation);
                 period->wasRunning = false;
+                journal.Record<comp::PeriodicalAnimation>(entity);
             }
             continue;
         }
@@ -70,6 +83,7 @@ void Animator::update(entityx::EntityManager &entities, entityx::EventManager &e
             period->startPosition = transform->Position();
             period->startRotation = transform->Quaternion();
             period->hasSavedStartValues = true;
+            journal.Record<comp::PeriodicalAnimation>(entity);
         }
 
         auto time = Time::CurrentTime() - period->startTime;
@@ -98,9 +112,8 @@ void Animator::update(entityx::EntityManager &entities, entityx::EventManager &e
         transform->Quaternion(z * y * x * period->startRotation);
     }
 
-    for (auto entity : entities.entities_with_components(light, lightAnimation)) {
-        lightAnimation->isRunning |= startAllNextFrame;
-        lightAnimation->isRunning &= !stopAllNextFrame;
+    for (auto entity : EntitiesWith(entities, light, lightAnimation)) {
+        toggle(entity, GetComponentTypeId<comp::DirectionalLightAnimation>(), lightAnimation->isRunning);
 
         if (!lightAnimation->isRunning) {
             continue;
@@ -108,6 +121,7 @@ void Animator::update(entityx::EntityManager &entities, entityx::EventManager &e
 
         light->horizontal += delta * lightAnimation->horizontalSpeed;
         light->vertical   += delta * lightAnimation->verticalSpeed;
+        journal.Record<comp::DirectionalLight>(entity);
     }
 
     startAllNextFrame = false;
@@ -14,16 +14,72 @@
 #include <conflagrant/components/Skydome.hh>
 #include <conflagrant/components/SnowEmitter.hh>
 #include <conflagrant/ShaderSourceManager.hh>
+#include <conflagrant/ShaderCache.hh>
 
 #include <imgui.h>
 
-#define TIMER(name) cfl::Timer<double> __timer__ ## name (durationsByName[(#name)])
+#include <algorithm>
 
 namespace cfl {
+namespace {
+/**
+ * @brief FNV-1a over the bytes of plain values.
+ */
+class InputHash {
+    uint64_t value{14695981039346656037ull};
+
+public:
+    template<typename T>
+    inline InputHash &Add(T const &x) {
+        auto const bytes = reinterpret_cast<uint8_t const *>(&x);
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            value = (value ^ bytes[i]) * 1099511628211ull;
+        }
+        return *this;
+    }
+
+    inline uint64_t Value() const {
+        return value;
+    }
+};
+
+#ifdef ENABLE_VOXEL_CONE_TRACING
+/**
+ * @returns The constant diffuse color of the material, or the average of its diffuse texture read back from the
+ * texture's smallest mipmap.
+ */
+vec3 AverageDiffuseColor(assets::Material const &material) {
+    if (!material.diffuseTexture) {
+        return material.diffuseColor;
+    }
+
+    auto const &texture = material.diffuseTexture->texture;
+    GLint level = 0;
+    if (texture.hasMipmap) {
+        level = static_cast<GLint>(std::floor(std::log2(std::max(texture.width, texture.height))));
+    }
+
+    GLint width = 0, height = 0;
+    OGL(glGetTextureLevelParameteriv(texture.ID(), level, GL_TEXTURE_WIDTH, &width));
+    OGL(glGetTextureLevelParameteriv(texture.ID(), level, GL_TEXTURE_HEIGHT, &height));
+
+    std::vector<vec3> pixels(static_cast<size_t>(width) * height);
+    OGL(glGetTextureImage(texture.ID(), level, GL_RGB, GL_FLOAT, static_cast<GLsizei>(pixels.size() * sizeof(vec3)),
+                          pixels.data()));
+
+    vec3 sum(0);
+    for (auto const &pixel : pixels) {
+        sum += pixel;
+    }
+    return pixels.empty() ? material.diffuseColor : sum / static_cast<float>(pixels.size());
+}
+#endif // ENABLE_VOXEL_CONE_TRACING
+} // namespace
+
 syst::DeferredRenderer::DeferredRenderer() {
     timeSnowStart = -1;
 
-    LoadShaders();
+    cfl::LoadShaders(ShaderPrograms());
 
     pointMesh = std::make_shared<gl::Mesh>();
 
@@ -34,120 +90,338 @@ syst::DeferredRenderer::DeferredRenderer() {
     pointMesh->SetDrawMode(GL_POINTS);
 }
 
-void syst::DeferredRenderer::LoadShaders() {
-    geometryShader = LoadShader("deferred/geometry.vert", "deferred/geometry.frag");
-    snowGeometryShader = LoadShader("snow/snowgeometry.vert", "snow/snowgeometry.geom", "snow/snowgeometry.frag");
-    directionalLightShadowShader = LoadShader("shadowmap_lightpass.vert", "shadowmap_lightpass.frag");
-    lightsShader = LoadShader("deferred/lights.vert", "deferred/lights.frag");
-    skydomeShader = LoadShader("forward_skydome.vert", "forward_skydome.frag");
-    wireframeShader = LoadShader("wireframe.vert", "wireframe.frag");
-    snowfallParticleShader = LoadShader("snow/snowfall_render.vert", "snow/snowfall_render.geom", "snow/snowfall_render.frag");
+std::vector<ShaderProgramDescription> syst::DeferredRenderer::ShaderPrograms() {
+    std::vector<ShaderProgramDescription> programs{
+            {&snowGeometryShader, {"snow/snowgeometry.vert", "snow/snowgeometry.geom", "snow/snowgeometry.frag"}},
+            {&directionalLightShadowShader, {"shadowmap_lightpass.vert", "shadowmap_lightpass.frag"}},
+            {&directionalLightShadowInstancedShader, {"shadowmap_lightpass.vert", "shadowmap_lightpass.frag"},
+             {"MODEL_INSTANCING"}},
+            {&lightsShader, {"deferred/lights.vert", "deferred/lights.frag"}},
+            {&skydomeShader, {"forward_skydome.vert", "forward_skydome.frag"}},
+            {&wireframeShader, {"wireframe.vert", "wireframe.frag"}},
+            {&snowfallParticleShader, {"snow/snowfall_render.vert", "snow/snowfall_render.geom", "snow/snowfall_render.frag"}},
+#ifdef ENABLE_VOXEL_CONE_TRACING
+            {&voxelDirectRenderingShader, {"voxels/directrendering.vert", "voxels/directrendering.frag"}},
+            {&mipmapShader, {"voxels/mipmap.comp"}},
+            {&indirectUpsampleShader, {"voxels/conetracing.vert", "voxels/indirect_upsample.frag"}},
+            {&svoDispatchArgumentsShader, {"voxels/svo/dispatcharguments.comp"}},
+            {&svoSubdivideShader, {"voxels/svo/subdivide.comp"}},
+            {&svoLeavesShader, {"voxels/svo/leaves.comp"}},
+            {&svoMipmapShader, {"voxels/svo/mipmap.comp"}},
+            {&svoDirectRenderingShader, {"voxels/directrendering.vert", "voxels/directrendering.frag"},
+             {"VCT_SPARSE_OCTREE"}},
+            {&clipmapDirectRenderingShader, {"voxels/directrendering.vert", "voxels/directrendering.frag"},
+             {"VCT_CLIPMAP"}},
+#endif
+    };
+
+    auto const append = [&](std::vector<ShaderProgramDescription> const &variants) {
+        programs.insert(programs.end(), variants.begin(), variants.end());
+    };
 
+    // material features are compiled into these, see MaterialFeature
+    append(geometryPermutations.Load({"deferred/geometry.vert", "deferred/geometry.frag"},
+                                     MaterialFeatureDefines()));
+    append(geometryInstancedPermutations.Load({"deferred/geometry_instanced.vert", "deferred/geometry_instanced.frag"},
+                                              MaterialFeatureDefines()));
 #ifdef ENABLE_VOXEL_CONE_TRACING
-    voxelizeShader = LoadShader("voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag");
-    voxelDirectRenderingShader = LoadShader("voxels/directrendering.vert", "voxels/directrendering.frag");
-    voxelConeTracingShader = LoadShader("voxels/conetracing.vert", "voxels/conetracing.frag");
-    mipmapShader = LoadComputeShader("voxels/mipmap.comp");
+    append(voxelizePermutations.Load({"voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag"},
+                                     MaterialFeatureDefines()));
+    append(voxelizeSparsePermutations.Load({"voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag"},
+                                           MaterialFeatureDefines(), {"VCT_SPARSE_OCTREE"}));
+    append(voxelizeClipmapPermutations.Load({"voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag"},
+                                            MaterialFeatureDefines(), {"VCT_CLIPMAP"}));
+    append(voxelizeInstancedPermutations.Load({"voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag"},
+                                              MaterialFeatureDefines(), {"MODEL_INSTANCING"}));
+    append(voxelizeSparseInstancedPermutations.Load(
+            {"voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag"},
+            MaterialFeatureDefines(), {"VCT_SPARSE_OCTREE", "MODEL_INSTANCING"}));
+    append(voxelizeClipmapInstancedPermutations.Load(
+            {"voxels/voxelize.vert", "voxels/voxelize.geom", "voxels/voxelize.frag"},
+            MaterialFeatureDefines(), {"VCT_CLIPMAP", "MODEL_INSTANCING"}));
+
+    // in the order of the ConeTracingFeature bits
+    std::vector<string> const coneTracingDefines{"VCT_INDIRECT_ONLY", "VCT_UPSAMPLED_INDIRECT"};
+    append(coneTracingPermutations.Load({"voxels/conetracing.vert", "voxels/conetracing.frag"}, coneTracingDefines));
+    append(svoConeTracingPermutations.Load({"voxels/conetracing.vert", "voxels/conetracing.frag"}, coneTracingDefines,
+                                           {"VCT_SPARSE_OCTREE"}));
+    append(clipmapConeTracingPermutations.Load({"voxels/conetracing.vert", "voxels/conetracing.frag"},
+                                               coneTracingDefines, {"VCT_CLIPMAP"}));
 #endif
+
+    return programs;
 }
 
-bool syst::DeferredRenderer::UpdateFramebuffer(GLsizei const width, GLsizei const height) {
-    framebuffer = std::make_shared<gl::Framebuffer>(width, height);
-    framebuffer->Bind();
+void syst::DeferredRenderer::BuildKnownVariants(entityx::EntityManager &entities) {
+    auto const &store = RenderableStore::Of(entities);
 
-    positionRadianceTexture = std::make_shared<gl::DoubleBufferedTexture2D>(width, height,
-                                                              GL_RGBA16F, GL_RGBA, GL_FLOAT);
-    positionRadianceTexture->ApplyToBoth([](auto &tex) {
+    std::vector<ShaderProgramDescription> requests;
+    auto const append = [&](std::vector<ShaderProgramDescription> const &variants) {
+        requests.insert(requests.end(), variants.begin(), variants.end());
+    };
 
-        tex->Bind();
-        tex->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        tex->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        tex->Unbind();
-    });
-    framebuffer->Attach(GL_COLOR_ATTACHMENT0, positionRadianceTexture->Front());
+    if (useInstancing) {
+        append(geometryInstancedPermutations.Request(GetStoredMaterialFeatures(store, true)));
+    } else {
+        append(geometryPermutations.Request(GetStoredMaterialFeatures(store)));
+    }
 
-    normalShininessTexture = std::make_shared<gl::DoubleBufferedTexture2D>(width, height,
-                                                                       GL_RGBA16F, GL_RGBA, GL_FLOAT);
-    normalShininessTexture->ApplyToBoth([](auto &tex) {
+#ifdef ENABLE_VOXEL_CONE_TRACING
+    if (useVoxelConeTracing) {
+        auto const useSparseOctree = VCT.storage == VoxelStorage::SparseOctree;
+        auto const useClipmap = VCT.storage == VoxelStorage::Clipmap;
+
+        if (useInstancing) {
+            auto &voxelize = useSparseOctree ? voxelizeSparseInstancedPermutations
+                             : useClipmap ? voxelizeClipmapInstancedPermutations
+                                          : voxelizeInstancedPermutations;
+            append(voxelize.Request(GetStoredMaterialFeatures(store, true)));
+        } else {
+            auto &voxelize = useSparseOctree ? voxelizeSparsePermutations
+                             : useClipmap ? voxelizeClipmapPermutations
+                                          : voxelizePermutations;
+            append(voxelize.Request(GetStoredMaterialFeatures(store)));
+        }
 
-        tex->Bind();
-        tex->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        tex->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        tex->Unbind();
-    });
-    framebuffer->Attach(GL_COLOR_ATTACHMENT1, normalShininessTexture->Front());
+        auto &coneTracing = useSparseOctree ? svoConeTracingPermutations
+                            : useClipmap ? clipmapConeTracingPermutations
+                                         : coneTracingPermutations;
+        append(coneTracing.Request({0, ConeTracingFeature::IndirectOnly, ConeTracingFeature::UpsampledIndirect}));
+    }
+#endif
 
-    albedoSpecularTexture = std::make_shared<gl::DoubleBufferedTexture2D>(width, height,
-                                                                      GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
-    albedoSpecularTexture->ApplyToBoth([](auto &tex) {
+    BuildVariants(requests);
+}
 
-        tex->Bind();
-        tex->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        tex->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        tex->Unbind();
-    });
-    framebuffer->Attach(GL_COLOR_ATTACHMENT2, albedoSpecularTexture->Front());
-
-    depthTexture = std::make_shared<gl::DoubleBufferedTexture2D>(width, height, GL_R32F, GL_RED, GL_FLOAT);
-    depthTexture->ApplyToBoth([](auto &tex) {
-        tex->Bind();
-        tex->TexParameter(GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        tex->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        tex->Unbind();
-    });
-    framebuffer->Attach(GL_COLOR_ATTACHMENT3, depthTexture->Front());
+#ifdef ENABLE_VOXEL_CONE_TRACING
+uint64_t syst::DeferredRenderer::HashStaticVoxelInputs(entityx::EntityManager &entities) {
+    $
+    InputHash hash;
+    hash.Add(VCT.center).Add(VCT.halfDimensions).Add(VCT.textureDimensionExponent);
+
+    entityx::ComponentHandle<comp::Transform> transform;
+    entityx::ComponentHandle<comp::Model> model;
+    for (auto entity : EntitiesWith(entities, transform, model)) {
+        if (IsAnimated(entity)) {
+            continue;
+        }
 
-    GLenum const attachments[4] = {
-            GL_COLOR_ATTACHMENT0,
-            GL_COLOR_ATTACHMENT1,
-            GL_COLOR_ATTACHMENT2,
-            GL_COLOR_ATTACHMENT3
-    };
-    framebuffer->SetDrawBuffers(4, attachments);
+        hash.Add(entity.id().id()).Add(model->value.get()).Add(transform->GetMatrix());
 
-    depthRenderbuffer = std::make_shared<gl::Renderbuffer>(width, height, GL_DEPTH_COMPONENT);
-    framebuffer->Attach(GL_DEPTH_ATTACHMENT, depthRenderbuffer);
+        auto const vctProperties = entity.component<comp::VctProperties>();
+        if (vctProperties) {
+            hash.Add(vctProperties->radiance).Add(vctProperties->specularReflectance);
+        }
+    }
 
-    if (!framebuffer->CheckIsComplete()) {
-        LOG_ERROR(cfl::DeferredRenderer::UpdateFramebuffer) << "Framebuffer incomplete";
-        return false;
+    entityx::ComponentHandle<comp::PointLight> pointLight;
+    for (auto entity : EntitiesWith(entities, transform, pointLight)) {
+        hash.Add(transform->Position()).Add(pointLight->color).Add(pointLight->intensity);
     }
 
-    return true;
+    entityx::ComponentHandle<comp::DirectionalLight> directionalLight;
+    for (auto entity : EntitiesWith(entities, directionalLight)) {
+        hash.Add(directionalLight->horizontal).Add(directionalLight->vertical)
+                .Add(directionalLight->color).Add(directionalLight->intensity).Add(directionalLight->castShadows);
+    }
+
+    return hash.Value();
 }
 
-void syst::DeferredRenderer::Pingpong() {
-    framebuffer->Bind();
+uint64_t syst::DeferredRenderer::HashBakedVoxelContent(entityx::EntityManager &entities) {
+    $
+    // hashed one by one and sorted, so that the order the entities were created in does not matter
+    std::vector<uint64_t> hashes;
+
+    entityx::ComponentHandle<comp::Transform> transform;
+    entityx::ComponentHandle<comp::Model> model;
+    for (auto entity : EntitiesWith(entities, transform, model)) {
+        if (IsAnimated(entity) || !model->value) {
+            continue;
+        }
+
+        auto const vctProperties = entity.component<comp::VctProperties>();
+        InputHash hash;
+        hash.Add(transform->GetMatrix()).Add(vctProperties ? vctProperties->radiance : 0.0f);
+
+        for (auto const &part : model->value->parts) {
+            auto const &mesh = *part.first;
+            hash.Add(part.second ? AverageDiffuseColor(*part.second) : vec3(0));
+            hash.Add(mesh.vertices.size()).Add(mesh.triangles.size());
+            for (auto const &vertex : mesh.vertices) {
+                hash.Add(vertex.position).Add(vertex.normal);
+            }
+            for (auto const &indices : mesh.triangles) {
+                hash.Add(indices);
+            }
+        }
+        hashes.push_back(hash.Value());
+    }
+
+    entityx::ComponentHandle<comp::PointLight> pointLight;
+    for (auto entity : EntitiesWith(entities, transform, pointLight)) {
+        hashes.push_back(InputHash().Add(transform->Position()).Add(pointLight->color)
+                                 .Add(pointLight->intensity).Value());
+    }
+
+    entityx::ComponentHandle<comp::DirectionalLight> directionalLight;
+    for (auto entity : EntitiesWith(entities, directionalLight)) {
+        hashes.push_back(InputHash().Add(directionalLight->horizontal).Add(directionalLight->vertical)
+                                 .Add(directionalLight->color).Add(directionalLight->intensity).Value());
+    }
+
+    std::sort(hashes.begin(), hashes.end());
+
+    InputHash hash;
+    for (auto const value : hashes) {
+        hash.Add(value);
+    }
+    return hash.Value();
+}
+
+bool syst::DeferredRenderer::BakeStaticVoxels(entityx::EntityManager &entities) {
+    DOLLAR("Deferred: Bake static voxels")
+
+    if (VCT.bakedVoxelsPath.empty()) {
+        LOG_ERROR(cfl::syst::DeferredRenderer::BakeStaticVoxels) << "No path to bake the static voxels to";
+        return false;
+    }
+
+    std::vector<VoxelizerTriangle> triangles;
+
+    entityx::ComponentHandle<comp::Transform> transform;
+    entityx::ComponentHandle<comp::Model> model;
+    for (auto entity : EntitiesWith(entities, transform, model)) {
+        if (IsAnimated(entity) || !model->value) {
+            continue;
+        }
+
+        auto const vctProperties = entity.component<comp::VctProperties>();
+        auto const radiance = vctProperties ? vctProperties->radiance : 0.0f;
+        auto const &M = transform->GetMatrix();
+
+        for (auto const &part : model->value->parts) {
+            auto const &mesh = *part.first;
+            auto const diffuse = part.second ? AverageDiffuseColor(*part.second) : vec3(0);
+
+            for (auto const &indices : mesh.triangles) {
+                VoxelizerTriangle triangle{};
+                for (int i = 0; i < 3; ++i) {
+                    auto const &vertex = mesh.vertices[indices[i]];
+                    // like voxels/voxelize.vert
+                    triangle.positions[i] = vec3(M * vec4(vertex.position, 1));
+                    triangle.normals[i] = glm::normalize(vec3(M * vec4(vertex.normal, 0)));
+                }
+                triangle.diffuse = diffuse;
+                triangle.radiance = radiance;
+                triangles.push_back(triangle);
+            }
+        }
+    }
+
+    struct Light {
+        vec3 positionOrDirection, color;
+    };
+    std::vector<Light> pointLights, directionalLights;
+
+    entityx::ComponentHandle<comp::PointLight> pointLight;
+    for (auto entity : EntitiesWith(entities, transform, pointLight)) {
+        pointLights.push_back(Light{transform->Position(), pointLight->intensity * pointLight->color});
+    }
+
+    entityx::ComponentHandle<comp::DirectionalLight> directionalLight;
+    for (auto entity : EntitiesWith(entities, directionalLight)) {
+        float const phi = glm::radians(directionalLight->horizontal);
+        float const theta = glm::radians(90 - directionalLight->vertical);
+        vec3 const direction(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+        directionalLights.push_back(Light{direction, directionalLight->intensity * directionalLight->color});
+    }
+
+    // voxels/voxelize.frag without specular, which it disables, and with the default attenuation of Attenuation.glsl
+    auto const shade = [&](vec3 const &position, vec3 const &normal, VoxelizerTriangle const &triangle) {
+        if (pointLights.empty() && directionalLights.empty()) {
+            return triangle.diffuse;
+        }
+
+        auto const N = glm::length(normal) > 0 ? glm::normalize(normal) : normal;
+        vec3 result = triangle.diffuse * triangle.radiance;
+
+        for (auto const &light : pointLights) {
+            auto L = light.positionOrDirection - position;
+            auto const distance = glm::length(L);
+            if (distance > 0) {
+                L /= distance;
+            }
+
+            auto const attenuation = 1.0f / (1.0f + 0.1f * distance + 0.01f * distance * distance);
+            result += attenuation * std::max(glm::dot(N, L), 0.0f) * light.color * triangle.diffuse;
+        }
+
+        for (auto const &light : directionalLights) {
+            result += std::max(glm::dot(N, light.positionOrDirection), 0.0f) * light.color * triangle.diffuse;
+        }
+
+        return result;
+    };
+
+    auto const resolution = static_cast<uint32_t>(GetActualVoxelTextureSize());
+    VoxelVolume volume(resolution, VCT.center, VCT.halfDimensions);
+    CpuVoxelizer::Voxelize(triangles, shade, volume);
+    // VCT.mipmapLevels includes level 0, like the voxel texture
+    volume.GenerateMipmaps(static_cast<size_t>(std::max(VCT.mipmapLevels - 1, 0)));
+    volume.ContentHash(HashBakedVoxelContent(entities));
+
+    if (!volume.Save(VCT.bakedVoxelsPath)) {
+        return false;
+    }
 
-    positionRadianceTexture->Swap();
-    framebuffer->Attach(GL_COLOR_ATTACHMENT0, positionRadianceTexture->Front());
+    LOG_INFO(cfl::syst::DeferredRenderer::BakeStaticVoxels) << "Baked " << triangles.size() << " triangles into "
+                                                            << VCT.bakedVoxelsPath;
 
-    normalShininessTexture->Swap();
-    framebuffer->Attach(GL_COLOR_ATTACHMENT1, normalShininessTexture->Front());
+    bakedVoxels = std::make_shared<VoxelVolume>(std::move(volume));
+    bakedVoxelsInputsHash = HashStaticVoxelInputs(entities);
+    staticVoxelsDirty = true;
+    return true;
+}
 
-    albedoSpecularTexture->Swap();
-    framebuffer->Attach(GL_COLOR_ATTACHMENT2, albedoSpecularTexture->Front());
+void syst::DeferredRenderer::AllocateSparseOctree() {
+    auto const allocate = [](gl::Buffer &buffer, GLsizeiptr size) {
+        if (buffer.Size() == size) {
+            return;
+        }
 
-    depthTexture->Swap();
-    framebuffer->Attach(GL_COLOR_ATTACHMENT3, depthTexture->Front());
+        // binding once makes the generated name an actual buffer object
+        buffer.Bind(GL_SHADER_STORAGE_BUFFER);
+        buffer.BufferData(size, nullptr, GL_DYNAMIC_COPY);
+        gl::Buffer::Unbind(GL_SHADER_STORAGE_BUFFER);
+    };
 
-    framebuffer->Unbind();
+    DOLLAR("Deferred: Allocate sparse voxel octree")
+    allocate(svoNodes, VCT.octreeNodeCapacity * static_cast<GLsizeiptr>(sizeof(SvoNode)));
+    allocate(svoFragments, VCT.octreeFragmentCapacity * static_cast<GLsizeiptr>(sizeof(VoxelFragment)));
+    // fragment count, node count and the indirect dispatch arguments
+    allocate(svoCounters, 5 * sizeof(GLuint));
 }
+#endif // ENABLE_VOXEL_CONE_TRACING
 
 void
 syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) {
-    for (auto &kvp : durationsByName) {
-        kvp.second = 0.0;
+    // swaps in reloaded shaders once the driver is done with all of them
+    if (pendingShaders.Poll()) {
+#ifdef ENABLE_VOXEL_CONE_TRACING
+        staticVoxelsDirty = true;
+        clipmap.Invalidate();
+#endif
     }
 
-    auto const& factories = engine->orderedSystemFactories;
-    auto itForward = std::find_if(factories.begin(), factories.end(), [](std::shared_ptr<SystemFactory> const factory) {
-        return factory->GetName() == "ForwardRenderer";
-    });
-    auto itDeferred = std::find_if(factories.begin(), factories.end(), [](std::shared_ptr<SystemFactory> const factory) {
-        return factory->GetName() == "DeferredRenderer";
-    });
-    if (itForward < itDeferred) return;
+#ifdef ENABLE_VOXEL_CONE_TRACING
+    if (bakeStaticVoxelsRequested) {
+        bakeStaticVoxelsRequested = false;
+        BakeStaticVoxels(entities);
+    }
+#endif
+
+    if (!engine->IsActiveRenderer<syst::DeferredRenderer>()) return;
 
     /////////////
     // hotkeys //
@@ -171,56 +445,80 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
 #undef TOGGLE_ON_KEY
 #undef TOGGLE
 
+    // the variants of newly loaded materials are built together here, instead of one by one in the passes
+    BuildKnownVariants(entities);
+
     uvec2 size = window->GetSize();
     auto const width = static_cast<GLsizei>(size.x);
     auto const height = static_cast<GLsizei>(size.y);
     vec2 const ScreenSize(width, height);
 
-    if (size != lastWindowSize) {
-        DOLLAR("Deferred: Update framebuffer")
-        lastWindowSize = size;
-        if (!UpdateFramebuffer(width, height)) {
-            return;
-        }
+    if (width == 0 || height == 0) {
+        return;
     }
 
-    Pingpong();
-    // framebuffer is ready to go
-
     renderStats.Reset();
+    renderStats.CollectStateChanges();
+    timers.BeginFrame(durationsByName);
 
     auto const timeCurrent = static_cast<float>(Time::CurrentTime());
     auto const timeDelta = static_cast<float>(Time::DeltaTime());
 
-    mat4 P;
+    mat4 V, P;
     geometry::Frustum frustum;
     entityx::ComponentHandle<comp::Transform> cameraTransform;
     float zNear, zFar;
 
-    GetCameraInfo(entities, cameraTransform, frustum, P, zNear, zFar);
-    mat4 const V = glm::inverse(cameraTransform->GetMatrix());
-    frustum = cameraTransform->GetMatrix() * frustum;
+    GetCameraInfo(entities, cameraTransform, frustum, V, P, zNear, zFar);
 
     auto const EyePos = cameraTransform->Position();
 
-    {
-        auto shader = (isSnowing) ? snowGeometryShader : geometryShader;
+    //////////////////
+    // render graph //
+    //////////////////
+
+    renderGraph.Reset();
+
+    // the G-buffer only lives for the duration of the frame, nothing reads the previous frame's contents
+    auto const gPositionRadiance = renderGraph.CreateTexture("GPositionRadiance",
+                                                             {width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT});
+    auto const gNormalShininess = renderGraph.CreateTexture("GNormalShininess",
+                                                            {width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT});
+    auto const gAlbedoSpecular = renderGraph.CreateTexture("GAlbedoSpecular",
+                                                           {width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE});
+    auto const gDepth = renderGraph.CreateTexture("GDepth", {width, height, GL_R32F, GL_RED, GL_FLOAT});
+    // 24 bit to match the default framebuffer's depth buffer, which it is blitted into
+    auto const gDepthBuffer = renderGraph.CreateTexture("GDepthBuffer",
+                                                        {width, height, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT,
+                                                         GL_UNSIGNED_INT});
+
+    auto const blitDepth = [=](RenderGraph &graph) {
+        graph.BindFramebuffer(GL_READ_FRAMEBUFFER, {}, gDepthBuffer);
+
+        gl::Framebuffer::Unbind(GL_DRAW_FRAMEBUFFER);
+        OGL(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST));
+        gl::Framebuffer::Unbind();
+    };
 
-        TIMER(GeometryPass);
+    renderGraph.AddPass("GeometryPass", [&](RenderGraph::PassBuilder &builder) {
+        builder.Write(gPositionRadiance, true)
+                .Write(gNormalShininess, true)
+                .Write(gAlbedoSpecular, true)
+                .Write(gDepth, true)
+                .Write(gDepthBuffer, true);
+    }, [&](RenderGraph &graph) {
         DOLLAR("Deferred: Geometry pass")
-        framebuffer->Bind();
-        OGL(glViewport(0, 0, width, height));
-        OGL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-        OGL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-
-        shader->Bind();
-        shader->Uniform("V", V);
-        shader->Uniform("P", P);
-        shader->Uniform("EyePos", EyePos);
-        shader->Uniform("time", timeCurrent);
-        shader->Uniform("timeSnowStart", static_cast<float>(timeSnowStart));
-        shader->Uniform("ScreenSize", ScreenSize);
-        renderStats.UniformCalls += 4;
+
+        auto const setupShader = [&](gl::Shader &shader) -> GLenum {
+            shader.Uniform("V", V);
+            shader.Uniform("P", P);
+            shader.Uniform("EyePos", EyePos);
+            shader.Uniform("time", timeCurrent);
+            shader.Uniform("timeSnowStart", static_cast<float>(timeSnowStart));
+            shader.Uniform("ScreenSize", ScreenSize);
+            renderStats.UniformCalls += 4;
+            return 0;
+        };
 
         auto scopedState = gl::ScopedState()
                 .Enable(GL_CULL_FACE)
@@ -228,23 +526,27 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
                 .Enable(GL_DEPTH_TEST)
                 .Build();
 
-        OGL(glEnable(GL_CULL_FACE));
-        OGL(glCullFace(GL_BACK));
-        OGL(glEnable(GL_DEPTH_TEST));
+        auto const modelFrustum = cullModelsAndMeshes ? &frustum : nullptr;
 
-        if (cullModelsAndMeshes) {
-            RenderModels(entities, *shader, 0, renderStats, &frustum);
+        // the snow geometry shader has neither an instanced variant nor material permutations
+        if (isSnowing) {
+            snowGeometryShader->Bind();
+            setupShader(*snowGeometryShader);
+            RenderModels(entities, *snowGeometryShader, 0, renderStats, modelFrustum);
+            snowGeometryShader->Unbind();
+        } else if (useInstancing) {
+            RenderModelsInstanced(entities, geometryInstancedPermutations, setupShader, renderStats, modelFrustum);
         } else {
-            RenderModels(entities, *shader, 0, renderStats);
+            RenderModels(entities, geometryPermutations, setupShader, renderStats, modelFrustum);
         }
-
-        shader->Unbind();
-    }
+    });
 
     GLenum lightsShaderTextureCount = 0;
 
-    {
-        TIMER(DeferredUploadLights);
+    renderGraph.AddPass("DeferredUploadLights", [](RenderGraph::PassBuilder &builder) {
+        // renders the shadow maps, which the VCT passes sample as well
+        builder.SideEffect();
+    }, [&](RenderGraph &graph) {
         {
             DOLLAR("Deferred: Upload PointLights")
             UploadPointLights<false>(entities, *lightsShader, renderStats);
@@ -258,233 +560,553 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
                     .Enable(GL_DEPTH_TEST)
                     .Build();
 
-            RenderDirectionalLightShadows(entities, *directionalLightShadowShader, renderStats, cullModelsAndMeshes);
+            auto &lightpassShader = useInstancing ? *directionalLightShadowInstancedShader
+                                                  : *directionalLightShadowShader;
+            RenderDirectionalLightShadows(entities, lightpassShader, renderStats, cullModelsAndMeshes, useInstancing);
             UploadDirectionalLights<true>(entities, *lightsShader, lightsShaderTextureCount, renderStats, cullModelsAndMeshes);
         }
-    }
+    });
 
-#ifdef ENABLE_VOXEL_CONE_TRACING
-    if (useVoxelConeTracing) {
-        auto const voxelTextureSize = GetActualVoxelTextureSize();
-        GLenum voxelizeShaderTextureCount = 0, voxelConeTracingShaderTextureCount = 0;
+    auto voxels = RenderGraph::InvalidResource;
 
-        {
-            TIMER(VctAllocateClearTextures);
-            DOLLAR("Deferred: Prepare for VCT")
+#ifdef ENABLE_VOXEL_CONE_TRACING
+    auto const voxelTextureSize = GetActualVoxelTextureSize();
+    GLenum voxelConeTracingShaderTextureCount = 0;
+
+    auto const useSparseOctree = VCT.storage == VoxelStorage::SparseOctree;
+    auto const useClipmap = VCT.storage == VoxelStorage::Clipmap;
+    auto const svoLevels = static_cast<int>(std::min<GLsizei>(VCT.textureDimensionExponent,
+                                                               SparseVoxelOctree::MaxLevels));
+    auto &coneTracingPermutations = useSparseOctree ? svoConeTracingPermutations
+                                    : useClipmap ? clipmapConeTracingPermutations
+                                                 : this->coneTracingPermutations;
+
+    // the indirect light is traced into its own target at a reduced resolution and upsampled
+    auto const indirectDivisor = VCT.indirectResolutionDivisor > 1 ? std::min(VCT.indirectResolutionDivisor, 4) : 1;
+    auto const useReducedIndirect = indirectDivisor > 1;
+    auto const &voxelConeTracingShader = coneTracingPermutations.Get(
+            useReducedIndirect ? ConeTracingFeature::UpsampledIndirect : 0u);
+    // lit without cone tracing if its variants failed to build
+    auto const useVoxelConeTracing =
+            this->useVoxelConeTracing && voxelConeTracingShader &&
+            (!useReducedIndirect || coneTracingPermutations.Get(ConeTracingFeature::IndirectOnly));
+    if (!useVoxelConeTracing || VCT.useDirectVoxelRendering || !useReducedIndirect) {
+        indirectHistoryTexture.reset();
+        isIndirectHistoryValid = false;
+    }
+    auto const useIncrementalVoxelization = VCT.storage == VoxelStorage::Dense && VCT.useIncrementalVoxelization;
 
-            if (!voxelTexture ||
-                voxelTexture->width != voxelTextureSize  ||
-                voxelTexture->height != voxelTextureSize ||
-                voxelTexture->depth != voxelTextureSize  ||
-                voxelTexture->mipmapLevels != VCT.mipmapLevels) {
+    // the cached voxels of the other storages go stale while they are not updated
+    if (!useClipmap) {
+        clipmap.Invalidate();
+    }
+    if (!useIncrementalVoxelization) {
+        staticVoxelsDirty = true;
+    }
 
-                voxelTexture = std::make_shared<gl::Texture3D>(voxelTextureSize, voxelTextureSize, voxelTextureSize,
-                                                               GL_RGBA8, GL_RGBA, GL_FLOAT,
-                                                               nullptr, VCT.mipmapLevels);
+    auto clipmapVoxels = RenderGraph::InvalidResource;
+    auto indirectResolved = RenderGraph::InvalidResource;
 
-                voxelTexture->Bind();
+    // binds the octree buffers for the voxels/svo/ shaders, see voxels/common/svo.glsl
+    auto const setupSparseOctree = [&](gl::Shader const &shader) {
+        OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, svoFragments.ID()));
+        OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, svoNodes.ID()));
+        OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, svoCounters.ID()));
 
-                voxelTexture->TexParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-                voxelTexture->TexParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-                voxelTexture->TexParameter(GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+        shader.Uniform("SvoLevels", svoLevels);
+        shader.Uniform("SvoFragmentCapacity", static_cast<int>(VCT.octreeFragmentCapacity));
+        shader.Uniform("SvoNodeCapacity", static_cast<int>(VCT.octreeNodeCapacity));
+        renderStats.UniformCalls += 3;
+    };
 
-                voxelTexture->TexParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-                voxelTexture->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // see voxels/common/clipmap.glsl
+    auto const setupClipmap = [&](gl::Shader const &shader) {
+        std::vector<vec3> centers;
+        for (int level = 0; level < clipmap.NumLevels(); ++level) {
+            centers.push_back(clipmap.Center(level));
+        }
 
-                voxelTexture->Unbind();
-            }
+        shader.Uniform("ClipmapLevels", clipmap.NumLevels());
+        shader.Uniform("ClipmapResolution", clipmap.Resolution());
+        shader.Uniform("ClipmapVoxelSize", clipmap.VoxelSize(0));
+        shader.Uniform("ClipmapCenters", centers);
+        renderStats.UniformCalls += 4;
+    };
 
-            voxelTexture->ClearTexImage();
+    // binds the voxels and uploads what the cone tracing permutations have in common
+    auto const setupConeTracing = [&](gl::Shader &shader, GLenum &textureCount, RenderGraph &graph) {
+        if (useSparseOctree) {
+            setupSparseOctree(shader);
+        } else if (useClipmap) {
+            setupClipmap(shader);
+            shader.Texture("VoxelClipmap", textureCount++, graph.Texture(clipmapVoxels));
+        } else {
+            shader.Texture("VoxelizedScene", textureCount++, graph.Texture(voxels));
         }
+        shader.Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
+        shader.Uniform("VoxelCenter", VCT.center);
 
-        {
-            TIMER(VctUploadLights);
-            DOLLAR("Deferred (VCT): Upload lights")
-            UploadPointLights<false>(entities, *voxelizeShader, renderStats);
-            UploadDirectionalLights<true>(entities, *voxelizeShader, voxelizeShaderTextureCount,
-                                          renderStats, cullModelsAndMeshes);
-        }
+        // todo verify
+        shader.Uniform("VoxelSize", VCT.halfDimensions / GetActualVoxelTextureSize());
 
-        {
-            TIMER(VctVoxelizeScene);
-            DOLLAR("Deferred (VCT): Voxelize scene")
+        shader.Uniform("IndirectDiffuseMultiplier", VCT.useIndirectDiffuseLighting ? 1.f : 0.f);
+        shader.Uniform("IndirectSpecularMultiplier", VCT.useIndirectSpecularLighting ? 1.f : 0.f);
+        renderStats.UniformCalls += 5;
+    };
 
-            geometry::Frustum const voxelFrustum{
-                    .sides = {
-                            geometry::Plane{
-                                    .center = VCT.center + VCT.halfDimensions * geometry::Backward,
-                                    .normal = geometry::Backward
-                            },
-                            geometry::Plane{
-                                    .center = VCT.center + VCT.halfDimensions * geometry::Forward,
-                                    .normal = geometry::Forward
-                            },
-                            geometry::Plane{
-                                    .center = VCT.center + VCT.halfDimensions * geometry::Left,
-                                    .normal = geometry::Left
-                            },
-                            geometry::Plane{
-                                    .center = VCT.center + VCT.halfDimensions * geometry::Right,
-                                    .normal = geometry::Right
-                            },
-                            geometry::Plane{
-                                    .center = VCT.center + VCT.halfDimensions * geometry::Down,
-                                    .normal = geometry::Down
-                            },
-                            geometry::Plane{
-                                    .center = VCT.center + VCT.halfDimensions * geometry::Up,
-                                    .normal = geometry::Up
-                            }
-                    }
-            };
+    // voxelizes the models accepted by the filter into level 0 of the target, or into the octree if there is none.
+    // With a clipmap update, only the voxels of its box are written.
+    auto const voxelizeModels = [&](gl::Texture3D const *target, ModelFilter const &filter,
+                                    VoxelClipmap::Update const *clipmapUpdate) {
+        vec3 volumeCenter = VCT.center, volumeHalfDimensions(VCT.halfDimensions);
+        vec3 cullCenter = volumeCenter, cullHalfDimensions = volumeHalfDimensions;
+
+        if (clipmapUpdate) {
+            volumeCenter = clipmap.Center(clipmapUpdate->level);
+            volumeHalfDimensions = vec3(clipmap.HalfExtent(clipmapUpdate->level));
+            // models outside of the box would only have their fragments discarded
+            clipmap.Bounds(clipmapUpdate->level, clipmapUpdate->box, cullCenter, cullHalfDimensions);
+        }
 
-            OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-            OGL(glViewport(0, 0, voxelTextureSize, voxelTextureSize));
+        geometry::Frustum const voxelFrustum{
+                .sides = {
+                        geometry::Plane{
+                                .center = cullCenter + cullHalfDimensions * geometry::Backward,
+                                .normal = geometry::Backward
+                        },
+                        geometry::Plane{
+                                .center = cullCenter + cullHalfDimensions * geometry::Forward,
+                                .normal = geometry::Forward
+                        },
+                        geometry::Plane{
+                                .center = cullCenter + cullHalfDimensions * geometry::Left,
+                                .normal = geometry::Left
+                        },
+                        geometry::Plane{
+                                .center = cullCenter + cullHalfDimensions * geometry::Right,
+                                .normal = geometry::Right
+                        },
+                        geometry::Plane{
+                                .center = cullCenter + cullHalfDimensions * geometry::Down,
+                                .normal = geometry::Down
+                        },
+                        geometry::Plane{
+                                .center = cullCenter + cullHalfDimensions * geometry::Up,
+                                .normal = geometry::Up
+                        }
+                }
+        };
 
-            auto scopedState = gl::ScopedState()
-                    .ColorMask(GL_FALSE)
-                    .Disable(GL_CULL_FACE)
-                    .Disable(GL_DEPTH_TEST)
-                    .Disable(GL_BLEND)
-                    .Build();
+        gl::Framebuffer::Unbind();
+        OGL(glViewport(0, 0, voxelTextureSize, voxelTextureSize));
 
-            voxelizeShader->Bind();
+        auto scopedState = gl::ScopedState()
+                .ColorMask(GL_FALSE)
+                .Disable(GL_CULL_FACE)
+                .Disable(GL_DEPTH_TEST)
+                .Disable(GL_BLEND)
+                .Build();
 
-            voxelizeShader->Uniform("V", geometry::Identity4);
-            voxelizeShader->Uniform("P", geometry::Identity4);
+        // every variant is a separate program, so each of them gets the lights and voxel uniforms
+        auto const setupShader = [&](gl::Shader &shader) -> GLenum {
+            GLenum textureCount = 0;
 
-            voxelizeShader->Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
-            voxelizeShader->Uniform("VoxelCenter", VCT.center);
+            UploadPointLights<false>(entities, shader, renderStats);
+            UploadDirectionalLights<true>(entities, shader, textureCount, renderStats, cullModelsAndMeshes);
 
-            auto const voxelizedSceneTextureUnit = voxelizeShaderTextureCount++;
-            voxelizeShader->Texture("VoxelizedScene", voxelizedSceneTextureUnit, *voxelTexture);
-            OGL(glBindImageTexture(voxelizedSceneTextureUnit, voxelTexture->ID(),
-                                   0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI));
+            shader.Uniform("V", geometry::Identity4);
+            shader.Uniform("P", geometry::Identity4);
 
-            renderStats.UniformCalls += 5;
+            shader.Uniform("VoxelHalfDimensions", volumeHalfDimensions);
+            shader.Uniform("VoxelCenter", volumeCenter);
 
-            if (cullModelsAndMeshes) {
-                RenderModels(entities, *voxelizeShader, voxelizeShaderTextureCount, renderStats, &voxelFrustum);
+            if (clipmapUpdate) {
+                setupClipmap(shader);
+                shader.Uniform("ClipmapLevel", clipmapUpdate->level);
+                shader.Uniform("UpdateMin", clipmapUpdate->box.min);
+                shader.Uniform("UpdateMax", clipmapUpdate->box.max);
+                renderStats.UniformCalls += 3;
+            }
+
+            if (!target) {
+                setupSparseOctree(shader);
             } else {
-                RenderModels(entities, *voxelizeShader, voxelizeShaderTextureCount, renderStats);
+                auto const voxelizedSceneTextureUnit = textureCount++;
+                shader.Texture("VoxelizedScene", voxelizedSceneTextureUnit, *target);
+                OGL(glBindImageTexture(voxelizedSceneTextureUnit, target->ID(),
+                                       0, GL_TRUE, 0, GL_READ_WRITE, GL_R32UI));
             }
 
-            voxelizeShader->Unbind();
+            renderStats.UniformCalls += 5;
+            return textureCount;
+        };
+
+        auto const modelFrustum = cullModelsAndMeshes ? &voxelFrustum : nullptr;
+        if (useInstancing) {
+            auto &permutations = !target ? voxelizeSparseInstancedPermutations
+                                         : clipmapUpdate ? voxelizeClipmapInstancedPermutations
+                                                         : voxelizeInstancedPermutations;
+            RenderModelsInstanced(entities, permutations, setupShader, renderStats, modelFrustum, filter);
+        } else {
+            auto &permutations = !target ? voxelizeSparsePermutations
+                                         : clipmapUpdate ? voxelizeClipmapPermutations
+                                                         : voxelizePermutations;
+            RenderModels(entities, permutations, setupShader, renderStats, modelFrustum, filter);
         }
+    };
 
-        if (Time::CurrentTime() - VCT.timeOfLastMipmapGeneration >= VCT.timeBetweenMipmapGeneration) {
-            TIMER(VctGenerateMipmap);
-            DOLLAR("Deferred (VCT): Generate voxel mipmap")
-            VCT.timeOfLastMipmapGeneration = Time::CurrentTime();
-
-            if (VCT.useComputeShaderMipmapper) {
-                mipmapShader->Bind();
+    if (useVoxelConeTracing && useSparseOctree) {
+        AllocateSparseOctree();
+
+        renderGraph.AddPass("SvoClear", [](RenderGraph::PassBuilder &builder) {
+            builder.SideEffect();
+        }, [&](RenderGraph &graph) {
+            DOLLAR("Deferred (SVO): Clear octree")
+
+            // no fragments, only the root node, and 1x1x1 work groups until the fragments are counted
+            GLuint const counters[] = {0, 1, 0, 1, 1};
+            svoCounters.BufferSubData(0, sizeof(counters), counters);
+
+            SvoNode const root{0, 0};
+            svoNodes.BufferSubData(0, sizeof(root), &root);
+        });
+    } else if (useVoxelConeTracing && useClipmap) {
+        auto const voxelSize = 2 * VCT.halfDimensions / voxelTextureSize;
+        if (clipmap.Configure(voxelTextureSize, VCT.clipmapLevels, voxelSize) || !clipmapTexture) {
+            DOLLAR("Deferred: Allocate voxel clipmap")
+
+            auto const allocate = [&]() {
+                auto texture = std::make_shared<gl::Texture3D>(voxelTextureSize, voxelTextureSize,
+                                                               voxelTextureSize * clipmap.NumLevels(),
+                                                               GL_RGBA8, GL_RGBA, GL_FLOAT, nullptr, 1);
+                // x and y are addressed toroidally, z is clamped per level by SampleClipmapLevel()
+                texture->TexParameter(GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+                return texture;
+            };
 
-                auto computeSize = static_cast<GLuint>(GetActualVoxelTextureSize() / 2);
-                for (decltype(VCT.mipmapLevels) level = 0; level < VCT.mipmapLevels; ++level) {
-                    mipmapShader->Uniform("IsFirstLevel", 1 - math::Clamp(level, 0, 1));
+            clipmapTexture = allocate();
+            staticClipmapTexture = allocate();
+            clipmap.Invalidate();
+        }
 
-                    mipmapShader->Texture("ImageSource", 0, *voxelTexture);
-                    OGL(glBindImageTexture(0, voxelTexture->ID(), level, GL_TRUE, 0, GL_READ_ONLY, GL_RGBA8));
-                    mipmapShader->Texture("ImageMipmap", 1, *voxelTexture);
-                    OGL(glBindImageTexture(1, voxelTexture->ID(), level + 1, GL_TRUE, 0, GL_WRITE_ONLY, GL_RGBA8));
+        auto const inputsHash = HashStaticVoxelInputs(entities);
+        if (inputsHash != staticClipmapInputsHash) {
+            staticClipmapInputsHash = inputsHash;
+            clipmap.Invalidate();
+        }
 
-                    OGL(glDispatchCompute(computeSize, computeSize, computeSize));
+        // only the slabs that the camera moved into, unless everything was invalidated
+        auto const updates = clipmap.Recenter(EyePos);
+        clipmapUpdatesLastFrame = updates.size();
+
+        clipmapVoxels = renderGraph.ImportTexture("VoxelClipmap", clipmapTexture);
+        auto const staticClipmapVoxels = renderGraph.ImportTexture("StaticVoxelClipmap", staticClipmapTexture);
+
+        if (!updates.empty()) {
+            renderGraph.AddPass("ClipmapVoxelizeStatic", [&](RenderGraph::PassBuilder &builder) {
+                builder.WriteImage(staticClipmapVoxels);
+            }, [&, updates](RenderGraph &graph) {
+                DOLLAR("Deferred (clipmap): Voxelize static geometry")
+
+                for (auto const &update : updates) {
+                    for (auto const &box : clipmap.TexelBoxes(update)) {
+                        auto const size = box.max - box.min;
+                        OGL(glClearTexSubImage(staticClipmapTexture->ID(), 0, box.min.x, box.min.y, box.min.z,
+                                               size.x, size.y, size.z, staticClipmapTexture->format,
+                                               staticClipmapTexture->type, nullptr));
+                    }
 
-                    computeSize /= 2;
+                    voxelizeModels(staticClipmapTexture.get(), [](entityx::Entity entity) {
+                        return !IsAnimated(entity);
+                    }, &update);
                 }
-
-                mipmapShader->Unbind();
-            } else {
-                voxelTexture->GenerateMipmap();
-            }
+            });
         }
 
-        if (VCT.useDirectVoxelRendering) {
-            TIMER(VctDirectRendering);
-            DOLLAR("Deferred (VCT): Direct voxel rendering")
-
-            OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-            OGL(glViewport(0, 0, width, height));
-            OGL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-            OGL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-
-            voxelDirectRenderingShader->Bind();
+        // like the dense incremental voxelization, the animated models are averaged into a copy of the static voxels
+        renderGraph.AddPass("ClipmapCopyStatic", [&](RenderGraph::PassBuilder &builder) {
+            builder.Modify(staticClipmapVoxels)
+                    .Modify(clipmapVoxels);
+        }, [&](RenderGraph &graph) {
+            DOLLAR("Deferred (clipmap): Copy static voxels")
+            OGL(glCopyImageSubData(staticClipmapTexture->ID(), GL_TEXTURE_3D, 0, 0, 0, 0,
+                                   clipmapTexture->ID(), GL_TEXTURE_3D, 0, 0, 0, 0,
+                                   clipmapTexture->width, clipmapTexture->height, clipmapTexture->depth));
+        });
+    } else if (useVoxelConeTracing) {
+        if (!voxelTexture ||
+            voxelTexture->width != voxelTextureSize  ||
+            voxelTexture->height != voxelTextureSize ||
+            voxelTexture->depth != voxelTextureSize  ||
+            voxelTexture->mipmapLevels != VCT.mipmapLevels) {
+            DOLLAR("Deferred: Allocate voxel texture")
+
+            voxelTexture = std::make_shared<gl::Texture3D>(voxelTextureSize, voxelTextureSize, voxelTextureSize,
+                                                           GL_RGBA8, GL_RGBA, GL_FLOAT,
+                                                           nullptr, VCT.mipmapLevels);
+
+            voxelTexture->Bind();
+
+            voxelTexture->TexParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+            voxelTexture->TexParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+            voxelTexture->TexParameter(GL_TEXTURE_WRAP_R, GL_CLAMP_TO_BORDER);
+
+            voxelTexture->TexParameter(GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            voxelTexture->TexParameter(GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+            voxelTexture->Unbind();
+        }
 
-            voxelDirectRenderingShader->Uniform("InverseVP", glm::inverse(P * V));
-            voxelDirectRenderingShader->Uniform("EyePos", EyePos);
+        voxels = renderGraph.ImportTexture("VoxelizedScene", voxelTexture);
 
-            voxelDirectRenderingShader->Uniform("RenderDistance", VCT.DirectRendering.renderDistance);
-            voxelDirectRenderingShader->Texture("VoxelizedScene", 0, *voxelTexture);
-            voxelDirectRenderingShader->Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
-            voxelDirectRenderingShader->Uniform("VoxelCenter", VCT.center);
-            voxelDirectRenderingShader->Uniform("MipmapLevel", VCT.DirectRendering.mipmapLevel);
-            voxelDirectRenderingShader->Uniform("NumSteps", VCT.DirectRendering.raymarchingSteps);
+        if (useIncrementalVoxelization) {
+            if (!staticVoxelTexture || staticVoxelTexture->width != voxelTextureSize) {
+                DOLLAR("Deferred: Allocate static voxel texture")
 
-            renderStats.UniformCalls += 8;
+                staticVoxelTexture = std::make_shared<gl::Texture3D>(voxelTextureSize, voxelTextureSize,
+                                                                     voxelTextureSize, GL_RGBA8, GL_RGBA, GL_FLOAT,
+                                                                     nullptr, 1);
+                staticVoxelsDirty = true;
+            }
 
-            auto scopedState = gl::ScopedState()
-                    .Enable(GL_CULL_FACE)
-                    .CullFace(GL_BACK)
-                    .Enable(GL_DEPTH_TEST)
-                    .Build();
+            auto const staticVoxels = renderGraph.ImportTexture("StaticVoxels", staticVoxelTexture);
 
-            RenderFullscreenQuad(renderStats);
+            auto const inputsHash = HashStaticVoxelInputs(entities);
 
-            voxelDirectRenderingShader->Unbind();
+            // a loaded volume is only used if it was baked from the scene as it is now
+            if (bakedVoxels && bakedVoxelsInputsHash == 0) {
+                if (bakedVoxels->ContentHash() == HashBakedVoxelContent(entities)) {
+                    bakedVoxelsInputsHash = inputsHash;
+                } else {
+                    LOG_ERROR(cfl::syst::DeferredRenderer::update) << "The baked voxels (" << VCT.bakedVoxelsPath
+                                                                   << ") are of a different scene, voxelizing "
+                                                                   << "the static models instead. Bake them again.";
+                    bakedVoxels = nullptr;
+                }
+            }
+            auto const useBakedVoxels = bakedVoxels && inputsHash == bakedVoxelsInputsHash &&
+                                        bakedVoxels->Matches(static_cast<uint32_t>(voxelTextureSize), VCT.center,
+                                                             VCT.halfDimensions);
+
+            if ((staticVoxelsDirty || inputsHash != staticVoxelInputsHash) && useBakedVoxels) {
+                staticVoxelsDirty = false;
+                staticVoxelInputsHash = inputsHash;
+
+                renderGraph.AddPass("VctUploadBakedVoxels", [&](RenderGraph::PassBuilder &builder) {
+                    builder.Modify(staticVoxels);
+                }, [&](RenderGraph &graph) {
+                    DOLLAR("Deferred (VCT): Upload baked voxels")
+                    // packed RGBA8 in little endian is the byte order of GL_RGBA
+                    OGL(glTextureSubImage3D(staticVoxelTexture->ID(), 0, 0, 0, 0,
+                                            voxelTextureSize, voxelTextureSize, voxelTextureSize,
+                                            GL_RGBA, GL_UNSIGNED_BYTE, bakedVoxels->Level(0).data()));
+                });
+            } else if (staticVoxelsDirty || inputsHash != staticVoxelInputsHash) {
+                staticVoxelsDirty = false;
+                staticVoxelInputsHash = inputsHash;
+                staticVoxelizations++;
+
+                renderGraph.AddPass("VctClearStaticVoxels", [&](RenderGraph::PassBuilder &builder) {
+                    builder.Modify(staticVoxels);
+                }, [&](RenderGraph &graph) {
+                    DOLLAR("Deferred (VCT): Clear static voxels")
+                    staticVoxelTexture->ClearTexImage();
+                });
+
+                renderGraph.AddPass("VctVoxelizeStatic", [&](RenderGraph::PassBuilder &builder) {
+                    builder.WriteImage(staticVoxels);
+                }, [&](RenderGraph &graph) {
+                    DOLLAR("Deferred (VCT): Voxelize static geometry")
+                    voxelizeModels(staticVoxelTexture.get(), [](entityx::Entity entity) {
+                        return !IsAnimated(entity);
+                    }, nullptr);
+                });
+            }
 
-            return;
+            // the animated models are averaged into a copy of the static voxels, which merges both layers
+            renderGraph.AddPass("VctCopyStaticVoxels", [&](RenderGraph::PassBuilder &builder) {
+                // declared as modified rather than read, so that it gets the texture update barrier for the copy
+                builder.Modify(staticVoxels)
+                        .Modify(voxels);
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred (VCT): Copy static voxels")
+                OGL(glCopyImageSubData(staticVoxelTexture->ID(), GL_TEXTURE_3D, 0, 0, 0, 0,
+                                       voxelTexture->ID(), GL_TEXTURE_3D, 0, 0, 0, 0,
+                                       voxelTextureSize, voxelTextureSize, voxelTextureSize));
+            });
+        } else {
+            renderGraph.AddPass("VctClearVoxels", [&](RenderGraph::PassBuilder &builder) {
+                builder.Modify(voxels);
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred: Prepare for VCT")
+                voxelTexture->ClearTexImage();
+            });
         }
+    }
 
-        else {
-            {
-                TIMER(VctUploadLights);
-                DOLLAR("Deferred (VCT): Upload lights")
-                UploadPointLights<false>(entities, *voxelConeTracingShader, renderStats);
-                UploadDirectionalLights<true>(entities, *voxelConeTracingShader, voxelConeTracingShaderTextureCount,
-                                              renderStats, cullModelsAndMeshes);
+    if (useVoxelConeTracing) {
+        renderGraph.AddPass("VctVoxelizeScene", [&](RenderGraph::PassBuilder &builder) {
+            if (useSparseOctree) {
+                // the octree buffers live outside of the graph
+                builder.SideEffect();
+            } else {
+                builder.WriteImage(useClipmap ? clipmapVoxels : voxels);
             }
+        }, [&](RenderGraph &graph) {
+            DOLLAR("Deferred (VCT): Voxelize scene")
 
-            {
-                TIMER(VctFinalRendering);
+            if (useClipmap) {
+                // animated models can move anywhere, so every level is voxelized as a whole
+                for (int level = 0; level < clipmap.NumLevels(); ++level) {
+                    auto const &origin = clipmap.Origin(level);
+                    VoxelClipmap::Update const update{level, {origin, origin + ivec3(clipmap.Resolution())}};
+                    voxelizeModels(clipmapTexture.get(), IsAnimated, &update);
+                }
+                return;
+            }
 
-                OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-                OGL(glViewport(0, 0, width, height));
-                OGL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
-                OGL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+            // on top of the static voxels, if those are cached
+            voxelizeModels(useSparseOctree ? nullptr : voxelTexture.get(),
+                           useIncrementalVoxelization ? ModelFilter(IsAnimated) : nullptr, nullptr);
+        });
+
+        if (useSparseOctree) {
+            // the octree is rebuilt from the fragments every frame, so there is no mipmap to keep around
+            renderGraph.AddPass("SvoBuild", [](RenderGraph::PassBuilder &builder) {
+                builder.SideEffect();
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred (SVO): Build octree")
+
+                // one invocation per fragment, with the arguments written by svoDispatchArgumentsShader
+                auto const dispatchPerFragment = []() {
+                    OGL(glDispatchComputeIndirect(2 * sizeof(GLuint)));
+                    OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+                };
+
+                OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+                svoDispatchArgumentsShader->Bind();
+                setupSparseOctree(*svoDispatchArgumentsShader);
+                OGL(glDispatchCompute(1, 1, 1));
+                OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT));
+
+                svoCounters.Bind(GL_DISPATCH_INDIRECT_BUFFER);
+
+                // one dispatch per level, each only sees the nodes allocated by the previous one
+                svoSubdivideShader->Bind();
+                setupSparseOctree(*svoSubdivideShader);
+                for (int depth = 0; depth < svoLevels; ++depth) {
+                    svoSubdivideShader->Uniform("Depth", depth);
+                    dispatchPerFragment();
+                }
 
-                voxelConeTracingShader->Bind();
+                svoLeavesShader->Bind();
+                setupSparseOctree(*svoLeavesShader);
+                dispatchPerFragment();
 
-                voxelConeTracingShader->Uniform("V", V);
-                voxelConeTracingShader->Uniform("P", P);
-                voxelConeTracingShader->Uniform("EyePos", EyePos);
-                voxelConeTracingShader->Uniform("time", timeCurrent);
-                voxelConeTracingShader->Uniform("ScreenSize", ScreenSize);
+                svoMipmapShader->Bind();
+                setupSparseOctree(*svoMipmapShader);
+                for (int depth = svoLevels - 1; depth >= 0; --depth) {
+                    svoMipmapShader->Uniform("Depth", depth);
+                    dispatchPerFragment();
+                }
 
-                voxelConeTracingShader->Texture("GPositionRadiance", voxelConeTracingShaderTextureCount++,
-                                                *positionRadianceTexture->Front());
-                voxelConeTracingShader->Texture("GNormalShininess", voxelConeTracingShaderTextureCount++,
-                                                *normalShininessTexture->Front());
-                voxelConeTracingShader->Texture("GAlbedoSpecular", voxelConeTracingShaderTextureCount++,
-                                                *albedoSpecularTexture->Front());
-                voxelConeTracingShader->Texture("GDepth", voxelConeTracingShaderTextureCount++,
-                                                *depthTexture->Front());
+                gl::Buffer::Unbind(GL_DISPATCH_INDIRECT_BUFFER);
+                svoMipmapShader->Unbind();
+            });
+        } else if (!useClipmap &&
+                   Time::CurrentTime() - VCT.timeOfLastMipmapGeneration >= VCT.timeBetweenMipmapGeneration) {
+            VCT.timeOfLastMipmapGeneration = Time::CurrentTime();
 
-                voxelConeTracingShader->Texture("VoxelizedScene", voxelConeTracingShaderTextureCount++, *voxelTexture);
-                voxelConeTracingShader->Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
-                voxelConeTracingShader->Uniform("VoxelCenter", VCT.center);
+            renderGraph.AddPass("VctGenerateMipmap", [&](RenderGraph::PassBuilder &builder) {
+                if (VCT.useComputeShaderMipmapper) {
+                    builder.WriteImage(voxels);
+                } else {
+                    builder.Modify(voxels);
+                }
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred (VCT): Generate voxel mipmap")
+
+                if (VCT.useComputeShaderMipmapper) {
+                    mipmapShader->Bind();
+
+                    auto const dispatches = VoxelMipmapper::Plan(static_cast<uint32_t>(voxelTextureSize),
+                                                                 static_cast<uint32_t>(voxelTexture->mipmapLevels),
+                                                                 static_cast<uint32_t>(VCT.mipmapLevelsPerDispatch));
+                    for (size_t i = 0; i < dispatches.size(); ++i) {
+                        auto const &dispatch = dispatches[i];
+                        auto const sourceLevel = static_cast<GLint>(dispatch.sourceLevel);
+
+                        mipmapShader->Uniform("IsFirstLevel", sourceLevel == 0 ? 1 : 0);
+                        mipmapShader->Uniform("NumLevels", static_cast<int>(dispatch.numLevels));
+                        renderStats.UniformCalls += 2;
+
+                        mipmapShader->Texture("ImageSource", 0, *voxelTexture);
+                        OGL(glBindImageTexture(0, voxelTexture->ID(), sourceLevel, GL_TRUE, 0, GL_READ_ONLY,
+                                               GL_RGBA8));
+
+                        // the images a dispatch does not write are bound to its last level, which always exists
+                        for (GLuint unit = 1; unit <= VoxelMipmapper::MaxLevelsPerDispatch; ++unit) {
+                            auto const level = sourceLevel + static_cast<GLint>(std::min(unit, dispatch.numLevels));
+                            mipmapShader->Texture("ImageMipmap" + std::to_string(unit), unit, *voxelTexture);
+                            OGL(glBindImageTexture(unit, voxelTexture->ID(), level, GL_TRUE, 0, GL_WRITE_ONLY,
+                                                   GL_RGBA8));
+                        }
+
+                        OGL(glDispatchCompute(dispatch.numGroups, dispatch.numGroups, dispatch.numGroups));
+
+                        // the next dispatch reads the last level of this one, the graph orders the rest
+                        if (i + 1 < dispatches.size()) {
+                            OGL(glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT));
+                        }
+                    }
+
+                    mipmapShader->Unbind();
+                } else {
+                    voxelTexture->GenerateMipmap();
+                }
+            });
+        }
+
+        if (VCT.useDirectVoxelRendering) {
+            renderGraph.AddPass("VctDirectRendering", [&](RenderGraph::PassBuilder &builder) {
+                if (useClipmap) {
+                    builder.Read(clipmapVoxels);
+                } else if (!useSparseOctree) {
+                    builder.Read(voxels);
+                }
+                builder.SideEffect();
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred (VCT): Direct voxel rendering")
 
-                // todo verify
-                voxelConeTracingShader->Uniform("VoxelSize", VCT.halfDimensions / GetActualVoxelTextureSize());
+                gl::Framebuffer::Unbind();
+                OGL(glViewport(0, 0, width, height));
+                OGL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+                OGL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
-                voxelConeTracingShader->Uniform("DirectMultiplier",
-                                                VCT.useDirectLighting ? 1.f : 0.f);
-                voxelConeTracingShader->Uniform("IndirectDiffuseMultiplier",
-                                                VCT.useIndirectDiffuseLighting ? 1.f : 0.f);
-                voxelConeTracingShader->Uniform("IndirectSpecularMultiplier",
-                                                VCT.useIndirectSpecularLighting ? 1.f : 0.f);
+                auto const &voxelDirectRenderingShader = useSparseOctree ? svoDirectRenderingShader
+                                                         : useClipmap ? clipmapDirectRenderingShader
+                                                                      : this->voxelDirectRenderingShader;
+                voxelDirectRenderingShader->Bind();
+
+                voxelDirectRenderingShader->Uniform("InverseVP", glm::inverse(P * V));
+                voxelDirectRenderingShader->Uniform("EyePos", EyePos);
+
+                voxelDirectRenderingShader->Uniform("RenderDistance", VCT.DirectRendering.renderDistance);
+                if (useSparseOctree) {
+                    setupSparseOctree(*voxelDirectRenderingShader);
+                } else if (useClipmap) {
+                    setupClipmap(*voxelDirectRenderingShader);
+                    voxelDirectRenderingShader->Texture("VoxelClipmap", 0, graph.Texture(clipmapVoxels));
+                } else {
+                    voxelDirectRenderingShader->Texture("VoxelizedScene", 0, graph.Texture(voxels));
+                }
+                voxelDirectRenderingShader->Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
+                voxelDirectRenderingShader->Uniform("VoxelCenter", VCT.center);
+                voxelDirectRenderingShader->Uniform("MipmapLevel", VCT.DirectRendering.mipmapLevel);
+                voxelDirectRenderingShader->Uniform("NumSteps", VCT.DirectRendering.raymarchingSteps);
 
-                renderStats.UniformCalls += 14;
+                renderStats.UniformCalls += 8;
 
                 auto scopedState = gl::ScopedState()
                         .Enable(GL_CULL_FACE)
@@ -492,33 +1114,211 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
                         .Enable(GL_DEPTH_TEST)
                         .Build();
 
-                RenderFullscreenTriangle(renderStats);
+                RenderFullscreenQuad(renderStats);
+
+                voxelDirectRenderingShader->Unbind();
+            });
+
+            // the voxels are all there is to see, the geometry pass gets culled
+            renderGraph.Execute(&timers);
+            return;
+        }
 
-                voxelConeTracingShader->Unbind();
+        renderGraph.AddPass("VctUploadLights", [](RenderGraph::PassBuilder &builder) {
+            builder.SideEffect();
+        }, [&](RenderGraph &graph) {
+            DOLLAR("Deferred (VCT): Upload lights")
+            UploadPointLights<false>(entities, *voxelConeTracingShader, renderStats);
+            UploadDirectionalLights<true>(entities, *voxelConeTracingShader, voxelConeTracingShaderTextureCount,
+                                          renderStats, cullModelsAndMeshes);
+        });
+
+        auto const readVoxels = [&](RenderGraph::PassBuilder &builder) {
+            if (useClipmap) {
+                builder.Read(clipmapVoxels);
+            } else if (!useSparseOctree) {
+                builder.Read(voxels);
+            }
+        };
+
+        if (useReducedIndirect) {
+            if (!indirectHistoryTexture ||
+                indirectHistoryTexture->width != width ||
+                indirectHistoryTexture->height != height) {
+                DOLLAR("Deferred (VCT): Allocate indirect history")
+
+                indirectHistoryTexture = std::make_shared<gl::Texture2D>(width, height, GL_RGBA16F, GL_RGBA,
+                                                                         GL_FLOAT, nullptr);
+                indirectHistoryTexture->Bind();
+                indirectHistoryTexture->TexParameter(GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                indirectHistoryTexture->TexParameter(GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                indirectHistoryTexture->Unbind();
+                isIndirectHistoryValid = false;
             }
 
-            {
-                TIMER(VctBlitFboDepth);
-                DOLLAR("Deferred (VCT): Blit framebuffer depth")
+            // rounded up, so that every pixel has traced texels around it
+            auto const indirectWidth = (width + indirectDivisor - 1) / indirectDivisor;
+            auto const indirectHeight = (height + indirectDivisor - 1) / indirectDivisor;
+
+            auto const indirectLighting = renderGraph.CreateTexture("VctIndirectLighting",
+                                                                    {indirectWidth, indirectHeight, GL_RGBA16F,
+                                                                     GL_RGBA, GL_FLOAT});
+            indirectResolved = renderGraph.CreateTexture("VctIndirectResolved",
+                                                         {width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT});
+            auto const indirectHistory = renderGraph.ImportTexture("VctIndirectHistory", indirectHistoryTexture);
+
+            renderGraph.AddPass("VctIndirectTracing", [&, indirectLighting](RenderGraph::PassBuilder &builder) {
+                builder.Read(gPositionRadiance)
+                        .Read(gNormalShininess)
+                        .Read(gAlbedoSpecular)
+                        .Write(indirectLighting, true);
+                readVoxels(builder);
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred (VCT): Trace indirect light")
+
+                auto const &shader = coneTracingPermutations.Get(ConeTracingFeature::IndirectOnly);
+                shader->Bind();
+
+                GLenum textureCount = 0;
+                shader->Texture("GPositionRadiance", textureCount++, graph.Texture(gPositionRadiance));
+                shader->Texture("GNormalShininess", textureCount++, graph.Texture(gNormalShininess));
+                shader->Texture("GAlbedoSpecular", textureCount++, graph.Texture(gAlbedoSpecular));
+                setupConeTracing(*shader, textureCount, graph);
+
+                shader->Uniform("EyePos", EyePos);
+                shader->Uniform("ScreenSize", ScreenSize);
+                shader->Uniform("ResolutionDivisor", indirectDivisor);
+                renderStats.UniformCalls += 3;
 
-                framebuffer->Bind(GL_READ_FRAMEBUFFER);
+                RenderFullscreenTriangle(renderStats);
 
-                OGL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
-                OGL(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST));
-                OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+                shader->Unbind();
+            });
+
+            renderGraph.AddPass("VctIndirectUpsample", [&, indirectLighting, indirectHistory](
+                    RenderGraph::PassBuilder &builder) {
+                builder.Read(indirectLighting)
+                        .Read(indirectHistory)
+                        .Read(gPositionRadiance)
+                        .Read(gNormalShininess)
+                        .Read(gDepth)
+                        .Write(indirectResolved, true);
+            }, [&, indirectLighting, indirectHistory](RenderGraph &graph) {
+                DOLLAR("Deferred (VCT): Upsample indirect light")
+
+                indirectUpsampleShader->Bind();
+
+                GLenum textureCount = 0;
+                indirectUpsampleShader->Texture("IndirectLighting", textureCount++, graph.Texture(indirectLighting));
+                indirectUpsampleShader->Texture("IndirectHistory", textureCount++, graph.Texture(indirectHistory));
+                indirectUpsampleShader->Texture("GPositionRadiance", textureCount++,
+                                                graph.Texture(gPositionRadiance));
+                indirectUpsampleShader->Texture("GNormalShininess", textureCount++, graph.Texture(gNormalShininess));
+                indirectUpsampleShader->Texture("GDepth", textureCount++, graph.Texture(gDepth));
+
+                indirectUpsampleShader->Uniform("ResolutionDivisor", indirectDivisor);
+                indirectUpsampleShader->Uniform("ZNear", zNear);
+                indirectUpsampleShader->Uniform("ZFar", zFar);
+                indirectUpsampleShader->Uniform("PreviousVP", previousViewProjection);
+                indirectUpsampleShader->Uniform("HistoryWeight",
+                                                isIndirectHistoryValid ? VCT.indirectHistoryWeight : 0.f);
+                renderStats.UniformCalls += 5;
 
-                framebuffer->Unbind();
-            }
+                RenderFullscreenTriangle(renderStats);
+
+                indirectUpsampleShader->Unbind();
+            });
+
+            renderGraph.AddPass("VctIndirectHistory", [&, indirectHistory](RenderGraph::PassBuilder &builder) {
+                builder.Read(indirectResolved)
+                        .Modify(indirectHistory);
+            }, [&](RenderGraph &graph) {
+                DOLLAR("Deferred (VCT): Store indirect history")
+                OGL(glCopyImageSubData(graph.Texture(indirectResolved).ID(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                                       indirectHistoryTexture->ID(), GL_TEXTURE_2D, 0, 0, 0, 0,
+                                       width, height, 1));
+
+                previousViewProjection = P * V;
+                isIndirectHistoryValid = true;
+            });
         }
+
+        renderGraph.AddPass("VctFinalRendering", [&](RenderGraph::PassBuilder &builder) {
+            builder.Read(gPositionRadiance)
+                    .Read(gNormalShininess)
+                    .Read(gAlbedoSpecular)
+                    .Read(gDepth)
+                    .SideEffect();
+            readVoxels(builder);
+            if (useReducedIndirect) {
+                builder.Read(indirectResolved);
+            }
+        }, [&](RenderGraph &graph) {
+            gl::Framebuffer::Unbind();
+            OGL(glViewport(0, 0, width, height));
+            OGL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
+            OGL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+            voxelConeTracingShader->Bind();
+
+            voxelConeTracingShader->Uniform("V", V);
+            voxelConeTracingShader->Uniform("P", P);
+            voxelConeTracingShader->Uniform("EyePos", EyePos);
+            voxelConeTracingShader->Uniform("time", timeCurrent);
+            voxelConeTracingShader->Uniform("ScreenSize", ScreenSize);
+
+            voxelConeTracingShader->Texture("GPositionRadiance", voxelConeTracingShaderTextureCount++,
+                                            graph.Texture(gPositionRadiance));
+            voxelConeTracingShader->Texture("GNormalShininess", voxelConeTracingShaderTextureCount++,
+                                            graph.Texture(gNormalShininess));
+            voxelConeTracingShader->Texture("GAlbedoSpecular", voxelConeTracingShaderTextureCount++,
+                                            graph.Texture(gAlbedoSpecular));
+            voxelConeTracingShader->Texture("GDepth", voxelConeTracingShaderTextureCount++,
+                                            graph.Texture(gDepth));
+
+            setupConeTracing(*voxelConeTracingShader, voxelConeTracingShaderTextureCount, graph);
+            if (useReducedIndirect) {
+                voxelConeTracingShader->Texture("IndirectLighting", voxelConeTracingShaderTextureCount++,
+                                                graph.Texture(indirectResolved));
+            }
+
+            voxelConeTracingShader->Uniform("DirectMultiplier",
+                                            VCT.useDirectLighting ? 1.f : 0.f);
+
+            renderStats.UniformCalls += 9;
+
+            auto scopedState = gl::ScopedState()
+                    .Enable(GL_CULL_FACE)
+                    .CullFace(GL_BACK)
+                    .Enable(GL_DEPTH_TEST)
+                    .Build();
+
+            RenderFullscreenTriangle(renderStats);
+
+            voxelConeTracingShader->Unbind();
+        });
+
+        renderGraph.AddPass("VctBlitFboDepth", [&](RenderGraph::PassBuilder &builder) {
+            builder.Read(gDepthBuffer)
+                    .SideEffect();
+        }, [&](RenderGraph &graph) {
+            DOLLAR("Deferred (VCT): Blit framebuffer depth")
+            blitDepth(graph);
+        });
     }
 
     else {
 #endif // ENABLE_VOXEL_CONE_TRACING
-        {
-            TIMER(DeferredAllLightsPass);
+        renderGraph.AddPass("DeferredAllLightsPass", [&](RenderGraph::PassBuilder &builder) {
+            builder.Read(gPositionRadiance)
+                    .Read(gNormalShininess)
+                    .Read(gAlbedoSpecular)
+                    .Read(gDepth)
+                    .SideEffect();
+        }, [&](RenderGraph &graph) {
             DOLLAR("Deferred: All lights pass")
 
-            OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
+            gl::Framebuffer::Unbind();
             OGL(glViewport(0, 0, width, height));
             OGL(glClearColor(0.0f, 0.0f, 0.0f, 0.0f));
             OGL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
@@ -533,10 +1333,10 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
             lightsShader->Uniform("ZFar", zFar);
             lightsShader->Uniform("ZNear", zNear);
 
-            lightsShader->Texture("GPositionRadiance", lightsShaderTextureCount++, *positionRadianceTexture->Front());
-            lightsShader->Texture("GNormalShininess", lightsShaderTextureCount++, *normalShininessTexture->Front());
-            lightsShader->Texture("GAlbedoSpecular", lightsShaderTextureCount++, *albedoSpecularTexture->Front());
-            lightsShader->Texture("GDepth", lightsShaderTextureCount++, *depthTexture->Front());
+            lightsShader->Texture("GPositionRadiance", lightsShaderTextureCount++, graph.Texture(gPositionRadiance));
+            lightsShader->Texture("GNormalShininess", lightsShaderTextureCount++, graph.Texture(gNormalShininess));
+            lightsShader->Texture("GAlbedoSpecular", lightsShaderTextureCount++, graph.Texture(gAlbedoSpecular));
+            lightsShader->Texture("GDepth", lightsShaderTextureCount++, graph.Texture(gDepth));
 
             renderStats.UniformCalls += 7;
 
@@ -549,27 +1349,23 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
             RenderFullscreenTriangle(renderStats);
 
             lightsShader->Unbind();
-        }
+        });
 
-        {
-            TIMER(DeferredBlitFboDepth);
+        renderGraph.AddPass("DeferredBlitFboDepth", [&](RenderGraph::PassBuilder &builder) {
+            builder.Read(gDepthBuffer)
+                    .SideEffect();
+        }, [&](RenderGraph &graph) {
             DOLLAR("Deferred: Blit framebuffer depth")
-
-            framebuffer->Bind(GL_READ_FRAMEBUFFER);
-
-            OGL(glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
-            OGL(glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST));
-            OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-
-            framebuffer->Unbind();
-        }
+            blitDepth(graph);
+        });
 
 #ifdef ENABLE_VOXEL_CONE_TRACING
     }
 #endif // ENABLE_VOXEL_CONE_TRACING
 
-    {
-        TIMER(DeferredRenderSkydome);
+    renderGraph.AddPass("DeferredRenderSkydome", [](RenderGraph::PassBuilder &builder) {
+        builder.SideEffect();
+    }, [&](RenderGraph &graph) {
         DOLLAR("Deferred: Render skydome")
 
         // only use rotational part for skydome
@@ -592,89 +1388,105 @@ syst::DeferredRenderer::update(entityx::EntityManager &entities, entityx::EventM
         RenderSkydomes(entities, *skydomeShader, 0, renderStats, P, skydomeV);
 
         skydomeShader->Unbind();
-    }
+    });
 
     if (renderBoundingSpheres) {
-        TIMER(DeferredRenderBoundingSpheres);
-        DOLLAR("Bounding spheres")
+        renderGraph.AddPass("DeferredRenderBoundingSpheres", [](RenderGraph::PassBuilder &builder) {
+            builder.SideEffect();
+        }, [&](RenderGraph &graph) {
+            DOLLAR("Bounding spheres")
 
-        wireframeShader->Bind();
-        wireframeShader->Uniform("V", V);
-        wireframeShader->Uniform("P", P);
-        wireframeShader->Uniform("EyePos", EyePos);
-        wireframeShader->Uniform("time", timeCurrent);
-        wireframeShader->Uniform("ScreenSize", ScreenSize);
+            wireframeShader->Bind();
+            wireframeShader->Uniform("V", V);
+            wireframeShader->Uniform("P", P);
+            wireframeShader->Uniform("EyePos", EyePos);
+            wireframeShader->Uniform("time", timeCurrent);
+            wireframeShader->Uniform("ScreenSize", ScreenSize);
 
-        renderStats.UniformCalls += 4;
+            renderStats.UniformCalls += 4;
 
-        auto scopedState = gl::ScopedState()
-                .Disable(GL_CULL_FACE)
-                .Enable(GL_DEPTH_TEST)
-                .Build();
+            auto scopedState = gl::ScopedState()
+                    .Disable(GL_CULL_FACE)
+                    .Enable(GL_DEPTH_TEST)
+                    .Build();
 
-        RenderBoundingSpheres(entities, *wireframeShader, 0, renderStats,
-                              renderBoundingSpheresAsWireframe);
-        wireframeShader->Unbind();
+            RenderBoundingSpheres(entities, *wireframeShader, 0, renderStats,
+                                  renderBoundingSpheresAsWireframe);
+            wireframeShader->Unbind();
+        });
     }
 
     if (isSnowing) {
-        GLenum texCount = 0;
-
-        snowfallParticleShader->Bind();
+        renderGraph.AddPass("DeferredRenderSnowfall", [&](RenderGraph::PassBuilder &builder) {
+            builder.Read(gDepth)
+                    .SideEffect();
+            if (voxels != RenderGraph::InvalidResource) {
+                builder.Read(voxels);
+            }
+        }, [&](RenderGraph &graph) {
+            GLenum texCount = 0;
 
-        snowfallParticleShader->Uniform("P", P);
-        snowfallParticleShader->Uniform("V", V);
-        snowfallParticleShader->Uniform("EyePos", EyePos);
-        snowfallParticleShader->Uniform("time", timeCurrent);
-        snowfallParticleShader->Uniform("timeSnowStart", static_cast<float>(timeSnowStart));
-        snowfallParticleShader->Uniform("ScreenSize", ScreenSize);
+            snowfallParticleShader->Bind();
 
-        snowfallParticleShader->Uniform("timeDelta", timeDelta);
-        snowfallParticleShader->Texture("SceneDepth", texCount++, *depthTexture->Front());
+            snowfallParticleShader->Uniform("P", P);
+            snowfallParticleShader->Uniform("V", V);
+            snowfallParticleShader->Uniform("EyePos", EyePos);
+            snowfallParticleShader->Uniform("time", timeCurrent);
+            snowfallParticleShader->Uniform("timeSnowStart", static_cast<float>(timeSnowStart));
+            snowfallParticleShader->Uniform("ScreenSize", ScreenSize);
 
-        snowfallParticleShader->Texture("AmbientSceneLight", texCount++, *voxelTexture);
-        snowfallParticleShader->Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
-        snowfallParticleShader->Uniform("VoxelCenter", VCT.center);
+            snowfallParticleShader->Uniform("timeDelta", timeDelta);
+            snowfallParticleShader->Texture("SceneDepth", texCount++, graph.Texture(gDepth));
 
-        UploadDirectionalLights<true>(entities, *snowfallParticleShader, texCount, renderStats, cullModelsAndMeshes);
+            // only the dense storage has a texture to sample, the snow goes without ambient light otherwise
+            if (voxels != RenderGraph::InvalidResource) {
+                snowfallParticleShader->Texture("AmbientSceneLight", texCount, graph.Texture(voxels));
+            }
+            texCount++;
+            snowfallParticleShader->Uniform("VoxelHalfDimensions", vec3(VCT.halfDimensions));
+            snowfallParticleShader->Uniform("VoxelCenter", VCT.center);
 
-        {
-            auto scopedState = gl::ScopedState()
-                    .Enable(GL_BLEND)
-                    .BlendFuncAlpha(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
-                    .DepthMask(GL_FALSE)
-                    .Enable(GL_DEPTH_TEST)
-                    .Build();
+            UploadDirectionalLights<true>(entities, *snowfallParticleShader, texCount, renderStats, cullModelsAndMeshes);
 
-            entityx::ComponentHandle<comp::SnowEmitter> snow;
-            for (auto e : entities.entities_with_components(snow)) {
-                if (snow->count == 0) {
-                    continue;
-                }
+            {
+                auto scopedState = gl::ScopedState()
+                        .Enable(GL_BLEND)
+                        .BlendFuncAlpha(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+                        .DepthMask(GL_FALSE)
+                        .Enable(GL_DEPTH_TEST)
+                        .Build();
 
-                auto const oldMaxCount = snow->maxCount;
-                snow->maxCount = math::NextPowerOfTwo(snow->count);
-                if (!snow->framebuffer || oldMaxCount != snow->maxCount) {
-                    InitializeComponent(*snow);
-                }
+                entityx::ComponentHandle<comp::SnowEmitter> snow;
+                for (auto e : EntitiesWith(entities, snow)) {
+                    if (snow->lodCount == 0 || !snow->isVisible || !snow->positions || !snow->drawCommand) {
+                        continue;
+                    }
 
-                OGL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
-                OGL(glViewport(0, 0, width, height));
+                    gl::Framebuffer::Unbind();
+                    OGL(glViewport(0, 0, width, height));
 
-                snowfallParticleShader->Uniform("radius", snow->radius);
+                    // fewer but larger particles in the distance
+                    snowfallParticleShader->Uniform("radius", snow->radius * snow->lodRadiusScale);
 
-                snowfallParticleShader->Texture("InPositionsAngles", texCount + 0, *snow->positionsAngles->Front());
-                snowfallParticleShader->Texture("InVelocitiesLifetimes", texCount + 1, *snow->velocitiesLifetimes->Front());
+                    comp::BindParticleStorage(*snow);
+                    if (snow->isSortedOnGpu) {
+                        OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, comp::SnowEmitter::SortBinding,
+                                             snow->sortBuffer->ID()));
+                    }
 
-                snowfallParticleShader->Uniform("Count", static_cast<GLint>(snow->count));
-                snowfallParticleShader->Uniform("MaxCount", static_cast<GLint>(snow->maxCount));
+                    snowfallParticleShader->Uniform("Count", static_cast<GLint>(snow->lodCount));
+                    snowfallParticleShader->Uniform("IsSorted", snow->isSortedOnGpu ? 1 : 0);
 
-                OGL(pointMesh->DrawElementsInstanced(static_cast<GLsizei>(snow->count)));
+                    // the instance count is written by snowfall_simulate.comp, or by the CPU backend
+                    OGL(pointMesh->DrawArraysIndirect(*snow->drawCommand));
+                }
             }
-        }
 
-        snowfallParticleShader->Unbind();
+            snowfallParticleShader->Unbind();
+        });
     }
+
+    renderGraph.Execute(&timers);
 }
 
 bool
@@ -694,6 +1506,51 @@ syst::DeferredRenderer::Serialize(BaseSerializer const &serializer, Json::Value
     SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["mipmapLevels"], sys.VCT.mipmapLevels);
     SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["timeBetweenMipmapGeneration"], sys.VCT.timeBetweenMipmapGeneration);
 
+    if (serializer.IsSerializer() || jvoxels.isMember("incrementalVoxelization")) {
+        SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["incrementalVoxelization"],
+                  sys.VCT.useIncrementalVoxelization);
+    }
+
+    // "dense", "sparseOctree" or "clipmap", older scenes do not have it
+    if (serializer.IsSerializer() || jvoxels.isMember("storage")) {
+        std::array<string, 3> const storageNames{"dense", "sparseOctree", "clipmap"};
+
+        string storage = storageNames[static_cast<size_t>(sys.VCT.storage)];
+        SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["storage"], storage);
+
+        auto const it = std::find(storageNames.begin(), storageNames.end(), storage);
+        sys.VCT.storage = it == storageNames.end() ? VoxelStorage::Dense
+                                                   : static_cast<VoxelStorage>(it - storageNames.begin());
+    }
+
+    if (serializer.IsSerializer() || jvoxels.isMember("clipmapLevels")) {
+        SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["clipmapLevels"], sys.VCT.clipmapLevels);
+    }
+
+    if (serializer.IsSerializer() || jvoxels.isMember("indirectResolutionDivisor")) {
+        SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["indirectResolutionDivisor"],
+                  sys.VCT.indirectResolutionDivisor);
+    }
+
+    if (serializer.IsSerializer() || jvoxels.isMember("indirectHistoryWeight")) {
+        SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["indirectHistoryWeight"], sys.VCT.indirectHistoryWeight);
+    }
+
+    if (serializer.IsSerializer() || jvoxels.isMember("bakedVoxels")) {
+        SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["bakedVoxels"], sys.VCT.bakedVoxelsPath);
+
+        if (serializer.IsDeserializer()) {
+            sys.bakedVoxels = nullptr;
+            sys.bakedVoxelsInputsHash = 0;
+
+            auto volume = std::make_shared<VoxelVolume>();
+            if (!sys.VCT.bakedVoxelsPath.empty() && VoxelVolume::Load(sys.VCT.bakedVoxelsPath, *volume)) {
+                sys.bakedVoxels = volume;
+                sys.staticVoxelsDirty = true;
+            }
+        }
+    }
+
     SERIALIZE(cfl::syst::DeferredRenderer, jvoxels["useDirectVoxelRendering"], sys.VCT.useDirectVoxelRendering);
     Json::Value &jvdirect = jvoxels["directRendering"];
 
@@ -708,8 +1565,24 @@ syst::DeferredRenderer::Serialize(BaseSerializer const &serializer, Json::Value
 bool syst::DeferredRenderer::DrawWithImGui(syst::DeferredRenderer &sys, InputManager const &input) {
     $
     if (ImGui::Button("Reload shaders")) {
-        sys.LoadShaders();
+        sys.pendingShaders = LoadShadersAsync(sys.ShaderPrograms());
+    }
+    if (!sys.pendingShaders.IsEmpty()) {
+        ImGui::SameLine();
+        ImGui::Text("Compiling...");
     }
+    ImGui::Text("Shader cache: %zu hits, %zu misses, %zu rejected",
+                ShaderCache::Hits(), ShaderCache::Misses(), ShaderCache::Rejected());
+    ImGui::Text("Geometry shader variants: %zu (instanced: %zu)",
+                sys.geometryPermutations.NumVariants(), sys.geometryInstancedPermutations.NumVariants());
+#ifdef ENABLE_VOXEL_CONE_TRACING
+    ImGui::Text("Voxelize shader variants: %zu (sparse octree: %zu, clipmap: %zu)",
+                sys.voxelizePermutations.NumVariants(), sys.voxelizeSparsePermutations.NumVariants(),
+                sys.voxelizeClipmapPermutations.NumVariants());
+    ImGui::Text("Instanced voxelize shader variants: %zu (sparse octree: %zu, clipmap: %zu)",
+                sys.voxelizeInstancedPermutations.NumVariants(), sys.voxelizeSparseInstancedPermutations.NumVariants(),
+                sys.voxelizeClipmapInstancedPermutations.NumVariants());
+#endif
 
     int swapInterval = sys.window->GetSwapInterval();
     string currentRenderMode = (swapInterval == 0) ? "Enable VSync" : "Disable VSync";
@@ -723,12 +1596,70 @@ bool syst::DeferredRenderer::DrawWithImGui(syst::DeferredRenderer &sys, InputMan
         ImGui::DragInt("Mipmap level", &sys.VCT.mipmapLevels, 1, 0, 9);
         ImGui::DragFloat("Mipmap delta time", &sys.VCT.timeBetweenMipmapGeneration, 1, 0, 10);
         ImGui::Checkbox("Compute shader mipmapper", &sys.VCT.useComputeShaderMipmapper);
+        if (sys.VCT.useComputeShaderMipmapper) {
+            ImGui::DragInt("Mipmap levels per dispatch", &sys.VCT.mipmapLevelsPerDispatch, 1, 1,
+                           VoxelMipmapper::MaxLevelsPerDispatch);
+        }
+        ImGui::Checkbox("Incremental voxelization", &sys.VCT.useIncrementalVoxelization);
+        if (sys.VCT.useIncrementalVoxelization) {
+            ImGui::SameLine();
+            if (ImGui::Button("Revoxelize static geometry")) {
+                sys.staticVoxelsDirty = true;
+                sys.clipmap.Invalidate();
+            }
+            ImGui::Text("Static voxelizations: %zu", sys.staticVoxelizations);
+
+            size_t constexpr BufferSize = 1024;
+            char buf[BufferSize] = {};
+            sys.VCT.bakedVoxelsPath.copy(buf, BufferSize - 1);
+            if (ImGui::InputText("Baked voxels", buf, IM_ARRAYSIZE(buf))) {
+                sys.VCT.bakedVoxelsPath = string(buf);
+            }
 
-        ImGui::DragInt("Texture size exponent", &sys.VCT.textureDimensionExponent, 1, 5, 9);
+            if (ImGui::Button("Bake static voxels")) {
+                sys.bakeStaticVoxelsRequested = true;
+            }
+            ImGui::SameLine();
+            ImGui::Text("%s", sys.bakedVoxels ? "Baked voxels loaded" : "No baked voxels");
+        }
+
+        auto storage = static_cast<int>(sys.VCT.storage);
+        if (ImGui::Combo("Voxel storage", &storage, "Dense\0Sparse octree\0Clipmap\0")) {
+            sys.VCT.storage = static_cast<VoxelStorage>(storage);
+        }
+
+        bool const useSparseOctree = sys.VCT.storage == VoxelStorage::SparseOctree;
+        ImGui::DragInt("Texture size exponent", &sys.VCT.textureDimensionExponent, 1, 5,
+                       useSparseOctree ? static_cast<int>(SparseVoxelOctree::MaxLevels) : 9);
         ImGui::Text("Actual texture size: %i", sys.GetActualVoxelTextureSize());
+        if (sys.VCT.storage == VoxelStorage::Clipmap) {
+            ImGui::DragInt("Clipmap levels", &sys.VCT.clipmapLevels, 1, 1, VoxelClipmap::MaxLevels);
+            ImGui::Text("Clipmap extent: %.1f, updated boxes last frame: %zu",
+                        2 * sys.VCT.halfDimensions * static_cast<float>(1 << (sys.VCT.clipmapLevels - 1)),
+                        sys.clipmapUpdatesLastFrame);
+        }
+        if (useSparseOctree) {
+            ImGui::DragInt("Octree node capacity", &sys.VCT.octreeNodeCapacity, 1024, 1024, 1 << 26);
+            ImGui::DragInt("Octree fragment capacity", &sys.VCT.octreeFragmentCapacity, 1024, 1024, 1 << 26);
+
+            auto const octreeSize = sys.svoNodes.Size() + sys.svoFragments.Size();
+            ImGui::Text("Octree memory: %.1f MB (dense texture: %.1f MB)", octreeSize / (1024.0f * 1024.0f),
+                        SparseVoxelOctree::DenseSizeInBytes(static_cast<uint32_t>(sys.VCT.textureDimensionExponent)) /
+                        (1024.0f * 1024.0f));
+        }
         ImGui::DragFloat("Half dimensions", &sys.VCT.halfDimensions, 1, 0, std::numeric_limits<float>::max());
         ImGui::DragFloat3("Center", glm::value_ptr(sys.VCT.center), 1);
 
+        // divisors 1, 2 and 4
+        int indirectResolution = sys.VCT.indirectResolutionDivisor >= 4 ? 2
+                               : sys.VCT.indirectResolutionDivisor >= 2 ? 1 : 0;
+        if (ImGui::Combo("Indirect light resolution", &indirectResolution, "Full\0Half\0Quarter\0")) {
+            sys.VCT.indirectResolutionDivisor = 1 << indirectResolution;
+        }
+        if (sys.VCT.indirectResolutionDivisor > 1) {
+            ImGui::DragFloat("Indirect history weight", &sys.VCT.indirectHistoryWeight, 0.01f, 0, 0.98f);
+        }
+
         ImGui::Checkbox("Direct voxel rendering", &sys.VCT.useDirectVoxelRendering);
         if (sys.VCT.useDirectVoxelRendering) {
             ImGui::DragFloat("Distance", &sys.VCT.DirectRendering.renderDistance, 1, 0,
@@ -741,6 +1672,7 @@ bool syst::DeferredRenderer::DrawWithImGui(syst::DeferredRenderer &sys, InputMan
 #endif // ENABLE_VOXEL_CONE_TRACING
 
     ImGui::Checkbox("Cull models and meshes", &sys.cullModelsAndMeshes);
+    ImGui::Checkbox("Instanced models", &sys.useInstancing);
     ImGui::Checkbox("Render bounding spheres", &sys.renderBoundingSpheres);
     if (sys.renderBoundingSpheres) {
         ImGui::Checkbox("- as wireframe", &sys.renderBoundingSpheresAsWireframe);
@@ -752,10 +1684,14 @@ bool syst::DeferredRenderer::DrawWithImGui(syst::DeferredRenderer &sys, InputMan
     ImGui::Text("Render Stats");
     sys.renderStats.DrawWithImGui();
 
-    ImGui::Text("Timings");
+    ImGui::Text("Render Graph");
+    sys.renderGraph.DrawStatsWithImGui();
+
+    ImGui::Text("Timings (GPU / CPU)");
     for (auto const& kvp : sys.durationsByName) {
-        ImGui::LabelText(kvp.first.c_str(), "%f ms", 1000 * kvp.second);
+        ImGui::LabelText(kvp.first.c_str(), "%.3f ms / %.3f ms", 1000 * kvp.second.gpu, 1000 * kvp.second.cpu);
     }
+    ImGui::LabelText("Dropped timer frames", std::to_string(sys.timers.DroppedFrames()).c_str());
 
     return true;
 }
@@ -9,12 +9,17 @@
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/RenderStats.hh>
 #include <conflagrant/Time.hh>
-#include <conflagrant/DoubleBuffer.hh>
-#include <conflagrant/gl/DoubleBufferedTexture2D.hh>
+#include <conflagrant/Timer.hh>
+#include <conflagrant/RenderGraph.hh>
+#include <conflagrant/ShaderSourceManager.hh>
 #include <conflagrant/gl/Mesh.hh>
 
 #ifdef ENABLE_VOXEL_CONE_TRACING
 #include <conflagrant/components/OrthographicCamera.hh>
+#include <conflagrant/SparseVoxelOctree.hh>
+#include <conflagrant/CpuVoxelizer.hh>
+#include <conflagrant/VoxelMipmapper.hh>
+#include <conflagrant/VoxelClipmap.hh>
 #include <conflagrant/components/Transform.hh>
 #include <conflagrant/math.hh>
 #endif // ENABLE_VOXEL_CONE_TRACING
@@ -28,12 +33,15 @@ class SnowfallAnimator;
 class DeferredRenderer : public System, public entityx::System<DeferredRenderer> {
 public:
     static constexpr auto SystemName = "DeferredRenderer";
+    static constexpr bool IsRenderer = true;
 
 private:
+    ShaderPermutations geometryPermutations, geometryInstancedPermutations;
+
     std::shared_ptr<gl::Shader>
-            geometryShader,
             snowGeometryShader,
             directionalLightShadowShader,
+            directionalLightShadowInstancedShader,
             lightsShader,
             skydomeShader,
             wireframeShader,
@@ -42,17 +50,57 @@ private:
     bool isSnowing{false};
     time_t timeSnowStart;
 
-    std::map<string, double> durationsByName;
-    std::list<string> durationsOrder;
+    TimerPool timers;
+    std::map<string, TimedDuration> durationsByName;
 
     std::shared_ptr<gl::Mesh> pointMesh;
 
 #ifdef ENABLE_VOXEL_CONE_TRACING
+    ShaderPermutations voxelizePermutations, voxelizeSparsePermutations, voxelizeClipmapPermutations;
+    ShaderPermutations voxelizeInstancedPermutations, voxelizeSparseInstancedPermutations,
+            voxelizeClipmapInstancedPermutations;
+
+    /**
+     * @brief Bits of the cone tracing permutations, see voxels/conetracing.frag.
+     */
+    struct ConeTracingFeature {
+        enum : uint32_t {
+            // traces the indirect light at a reduced resolution
+            IndirectOnly = 1u << 0,
+            // reads the upsampled indirect light instead of tracing it
+            UpsampledIndirect = 1u << 1,
+        };
+    };
+
+    ShaderPermutations coneTracingPermutations, svoConeTracingPermutations, clipmapConeTracingPermutations;
+
     std::shared_ptr<gl::Shader>
-            voxelizeShader,
             voxelDirectRenderingShader,
             mipmapShader,
-            voxelConeTracingShader;
+            indirectUpsampleShader;
+
+    // see voxels/common/svo.glsl
+    std::shared_ptr<gl::Shader>
+            svoDispatchArgumentsShader,
+            svoSubdivideShader,
+            svoLeavesShader,
+            svoMipmapShader,
+            svoDirectRenderingShader,
+            clipmapDirectRenderingShader;
+
+    gl::Buffer svoFragments, svoNodes, svoCounters;
+
+    /**
+     * @brief Where the voxelized scene is stored.
+     */
+    enum class VoxelStorage {
+        // one 3D texture with mipmaps, around VCT.center
+        Dense,
+        // see SparseVoxelOctree
+        SparseOctree,
+        // nested volumes around the camera, see VoxelClipmap
+        Clipmap
+    };
 
     bool useVoxelConeTracing{true};
     struct {
@@ -63,9 +111,26 @@ private:
         float timeBetweenMipmapGeneration{0.1f};
         cfl::time_t timeOfLastMipmapGeneration{std::numeric_limits<cfl::time_t>::min()};
         bool useComputeShaderMipmapper{true};
+        // see VoxelMipmapper
+        int mipmapLevelsPerDispatch{3};
+
+        // voxelizes static geometry into its own texture only when it changes, and only animated geometry every frame
+        bool useIncrementalVoxelization{true};
+        // static voxels baked by BakeStaticVoxels(), empty if there are none
+        string bakedVoxelsPath;
+
+        VoxelStorage storage{VoxelStorage::Dense};
+        GLsizei octreeNodeCapacity{1 << 22}, octreeFragmentCapacity{1 << 23};
+        // level 0 covers the same extent as the dense volume, each further level twice that of the previous one
+        int clipmapLevels{4};
 
         bool useDirectLighting{true}, useIndirectDiffuseLighting{true}, useIndirectSpecularLighting{true};
 
+        // 2 or 4 trace the indirect light at half or quarter resolution and upsample it, 1 traces every pixel
+        int indirectResolutionDivisor{1};
+        // how much of the previous frame's upsampled indirect light is reused, 0 disables the reuse
+        float indirectHistoryWeight{0.9f};
+
         bool useDirectVoxelRendering{true};
         struct {
             int mipmapLevel{0}, raymarchingSteps{32};
@@ -78,26 +143,87 @@ private:
     }
 
     std::shared_ptr<gl::Texture3D> voxelTexture;
+
+    /**
+     * @brief Level 0 of the voxel texture without the animated models, see VCT.useIncrementalVoxelization.
+     */
+    std::shared_ptr<gl::Texture3D> staticVoxelTexture;
+    uint64_t staticVoxelInputsHash{0};
+    bool staticVoxelsDirty{true};
+    size_t staticVoxelizations{0};
+
+    /**
+     * @returns A hash of everything the static voxels depend on: the transforms of the models that are not
+     * animated, the lights and the voxel volume.
+     */
+    uint64_t HashStaticVoxelInputs(entityx::EntityManager &entities);
+
+    /**
+     * @returns A hash of what BakeStaticVoxels() reads: the geometry, transforms and materials of the models that are
+     * not animated and the lights. Unlike HashStaticVoxelInputs() it does not depend on entity ids, asset pointers or
+     * the order of the entities, so it is the same across runs and is stored with the baked volume. It reads back
+     * the diffuse textures, so it is only computed when baking and when a loaded volume is first used.
+     */
+    uint64_t HashBakedVoxelContent(entityx::EntityManager &entities);
+
+    /**
+     * @brief Static voxels from VCT.bakedVoxelsPath. They replace the voxelization of the static models as long as
+     * the static inputs hash the same as when the volume was baked or loaded. A loaded volume is dropped if its
+     * content hash does not match the scene.
+     */
+    std::shared_ptr<VoxelVolume> bakedVoxels;
+    uint64_t bakedVoxelsInputsHash{0};
+    bool bakeStaticVoxelsRequested{false};
+
+    /**
+     * @brief Voxelizes the models that are not animated on the CPU and writes them to VCT.bakedVoxelsPath. Lighting
+     * is the same as in voxels/voxelize.frag, but without shadows, normal maps and diffuse textures, which are
+     * replaced by their average color.
+     */
+    bool BakeStaticVoxels(entityx::EntityManager &entities);
+
+    VoxelClipmap clipmap;
+
+    /**
+     * @brief All clipmap levels stacked along z, the static one only contains the models that are not animated.
+     */
+    std::shared_ptr<gl::Texture3D> clipmapTexture, staticClipmapTexture;
+    uint64_t staticClipmapInputsHash{0};
+    size_t clipmapUpdatesLastFrame{0};
+
+    /**
+     * @brief The upsampled indirect light of the previous frame, see VCT.indirectResolutionDivisor. The G-buffer only
+     * lives for one frame, so the history is kept here together with the view projection it was rendered with.
+     */
+    std::shared_ptr<gl::Texture2D> indirectHistoryTexture;
+    mat4 previousViewProjection;
+    bool isIndirectHistoryValid{false};
+
+    /**
+     * @brief (Re)allocates the octree buffers if the capacities changed.
+     */
+    void AllocateSparseOctree();
 #endif // ENABLE_VOXEL_CONE_TRACING
 
-    std::shared_ptr<gl::Framebuffer> framebuffer;
-    std::shared_ptr<gl::DoubleBufferedTexture2D>
-            positionRadianceTexture,
-            normalShininessTexture,
-            albedoSpecularTexture,
-            depthTexture;
-    std::shared_ptr<gl::Renderbuffer> depthRenderbuffer;
+    RenderGraph renderGraph;
 
     RenderStats renderStats;
     bool cullModelsAndMeshes{true}, renderBoundingSpheres{false}, renderBoundingSpheresAsWireframe{true};
+    bool useInstancing{true};
 
-    uvec2 lastWindowSize{0, 0};
-
-    bool UpdateFramebuffer(GLsizei const width, GLsizei const height);
+    PendingShaders pendingShaders;
 
-    void LoadShaders();
+    /**
+     * @brief Sets up the shader permutations.
+     * @returns All programs to (re)load.
+     */
+    std::vector<ShaderProgramDescription> ShaderPrograms();
 
-    void Pingpong();
+    /**
+     * @brief Builds the permutation variants that the loaded materials and the current settings need, before the
+     * passes draw with them.
+     */
+    void BuildKnownVariants(entityx::EntityManager &entities);
 
     friend class cfl::syst::SnowfallAnimator;
 
@@ -3,6 +3,7 @@
 
 #include <conflagrant/SystemFactory.hh>
 #include <conflagrant/ComponentFactory.hh>
+#include <conflagrant/ChangeJournal.hh>
 #include <conflagrant/components/Name.hh>
 #include <conflagrant/Engine.hh>
 #include <conflagrant/math.hh>
@@ -35,36 +36,36 @@ void syst::EcsDebugger::DrawEntityEditor(entityx::Entity &entity) {
 
     ImGui::Text(ss.str().c_str());
 
-    std::vector<string> componentNames;
+    ComponentFactories.ForEachOf(entity, [&](ComponentFactory const &factory) {
+        if (!factory.IsImGuiDrawable()) return;
 
-    for (auto &kvp : ComponentFactoriesByName) {
-        auto const &name = kvp.first;
-        auto &factory = *kvp.second;
-
-        if (!factory.IsImGuiDrawable()) continue;
-        if (!factory.HasComponent(entity)) continue;
-
-        componentNames.emplace_back(factory.GetName());
-
-        if (!ImGui::CollapsingHeader(name.c_str())) continue;
+        auto const name = factory.GetName();
+        if (!ImGui::CollapsingHeader(name.c_str())) return;
 
+        ImGui::BeginGroup();
         factory.DrawWithImGui(entity, *input);
-    }
+        ImGui::EndGroup();
+
+        // journaled components record their changes themselves, for the others any widget in use counts as a change
+        if (ImGui::IsItemActive() && !factory.IsJournaled()) {
+            ChangeJournal::Of(*engine->GetEntityManager()).Record(entity.id(), factory.GetTypeId());
+        }
+    });
 
     if (ImGui::CollapsingHeader("Add component")) {
-        for (auto &kvp : ComponentFactoriesByName) {
-            auto const &name = kvp.first;
-            auto &factory = *kvp.second;
+        auto const mask = entity.component_mask();
 
-            if (std::find(componentNames.begin(), componentNames.end(), name) != componentNames.end()) {
+        ComponentFactories.ForEach([&](ComponentFactory const &factory) {
+            if (mask.test(factory.GetFamily())) {
                 // entity already has component
-                continue;
+                return;
             }
 
+            auto const name = factory.GetName();
             if (ImGui::Button(name.c_str())) {
                 factory.Create(entity);
             }
-        }
+        });
     }
 
     ImGui::End();
@@ -116,23 +117,7 @@ void syst::EcsDebugger::DrawSystems(std::unordered_set<std::shared_ptr<SystemFac
 
     if (!toMove) return;
 
-    auto iter = std::find(engine->orderedSystemFactories.begin(), engine->orderedSystemFactories.end(), toMove);
-    if (moveDown) {
-        if (iter + 1 == engine->orderedSystemFactories.end()) {
-            return;
-        }
-
-        std::iter_swap(iter, iter + 1);
-        return;
-    } else {
-        // move up
-        if (iter == engine->orderedSystemFactories.begin()) {
-            return;
-        }
-
-        std::iter_swap(iter, iter - 1);
-        return;
-    }
+    engine->MoveSystem(toMove, moveDown);
 }
 
 void syst::EcsDebugger::update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) {
@@ -164,6 +149,7 @@ void syst::EcsDebugger::update(entityx::EntityManager &entities, entityx::EventM
             auto guid = currentEntity.assign<comp::Guid>();
             auto name = currentEntity.assign<comp::Name>();
             name->value = "(new entity)";
+            ChangeJournal::Of(entities).Record<comp::Name>(currentEntity);
         }
     }
     ImGui::End();
@@ -18,51 +18,59 @@
 namespace cfl {
 namespace syst {
 ForwardRenderer::ForwardRenderer() {
-    LoadShaders();
+    cfl::LoadShaders(ShaderPrograms());
 }
 
-void ForwardRenderer::LoadShaders() {
-    $
-    forwardShader = LoadShader("forward.vert", "forward.frag");
-    wireframeShader = LoadShader("wireframe.vert", "wireframe.frag");
-    skydomeShader = LoadShader("forward_skydome.vert", "forward_skydome.frag");
-    shadowmapLightpassShader = LoadShader("shadowmap_lightpass.vert", "shadowmap_lightpass.frag");
-    shadowmapVisShader = LoadShader("shadowmap_visualization.vert", "shadowmap_visualization.frag");
+std::vector<ShaderProgramDescription> ForwardRenderer::ShaderPrograms() {
+    std::vector<ShaderProgramDescription> programs{
+            {&wireframeShader, {"wireframe.vert", "wireframe.frag"}},
+            {&skydomeShader, {"forward_skydome.vert", "forward_skydome.frag"}},
+            {&shadowmapLightpassShader, {"shadowmap_lightpass.vert", "shadowmap_lightpass.frag"}},
+            {&shadowmapLightpassInstancedShader, {"shadowmap_lightpass.vert", "shadowmap_lightpass.frag"},
+             {"MODEL_INSTANCING"}},
+            {&shadowmapVisShader, {"shadowmap_visualization.vert", "shadowmap_visualization.frag"}},
+    };
+
+    auto const append = [&](std::vector<ShaderProgramDescription> const &variants) {
+        programs.insert(programs.end(), variants.begin(), variants.end());
+    };
+
+    append(forwardPermutations.Load({"forward.vert", "forward.frag"}, MaterialFeatureDefines()));
+    append(forwardInstancedPermutations.Load({"forward.vert", "forward.frag"}, MaterialFeatureDefines(),
+                                             {"MODEL_INSTANCING"}));
+    return programs;
 }
 
 void ForwardRenderer::update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) {
-    auto const& factories = engine->orderedSystemFactories;
-    auto itForward = std::find_if(factories.begin(), factories.end(), [](std::shared_ptr<SystemFactory> const factory) {
-        return factory->GetName() == "ForwardRenderer";
-    });
-    auto itDeferred = std::find_if(factories.begin(), factories.end(), [](std::shared_ptr<SystemFactory> const factory) {
-        return factory->GetName() == "DeferredRenderer";
-    });
-    if (itForward > itDeferred) return;
+    // swaps in reloaded shaders once the driver is done with all of them
+    pendingShaders.Poll();
 
-    $
-    renderStats.Reset();
-    GLenum forwardShaderTextureCount = 0;
+    if (!engine->IsActiveRenderer<ForwardRenderer>()) return;
 
-    {
-        DOLLAR("Upload PointLight data")
-        UploadPointLights<false>(entities, *forwardShader, renderStats);
+    $
+    // the variants of newly loaded materials are built together here, instead of one by one while drawing
+    auto const &store = RenderableStore::Of(entities);
+    if (useInstancing) {
+        BuildVariants(forwardInstancedPermutations.Request(GetStoredMaterialFeatures(store, true)));
+    } else {
+        BuildVariants(forwardPermutations.Request(GetStoredMaterialFeatures(store)));
     }
 
+    renderStats.Reset();
+    renderStats.CollectStateChanges();
+
     {
-        DOLLAR("Upload DirectionalLight data")
-        RenderDirectionalLightShadows(entities, *shadowmapLightpassShader, renderStats, cullModelsAndMeshes);
-        UploadDirectionalLights<true>(entities, *forwardShader, forwardShaderTextureCount, renderStats, cullModelsAndMeshes);
+        DOLLAR("Render DirectionalLight shadows")
+        auto &lightpassShader = useInstancing ? *shadowmapLightpassInstancedShader : *shadowmapLightpassShader;
+        RenderDirectionalLightShadows(entities, lightpassShader, renderStats, cullModelsAndMeshes, useInstancing);
     }
 
-    mat4 P;
+    mat4 V, P;
     geometry::Frustum frustum;
     entityx::ComponentHandle<comp::Transform> cameraTransform;
     float zNear, zFar;
 
-    GetCameraInfo(entities, cameraTransform, frustum, P, zNear, zFar);
-    mat4 V = glm::inverse(cameraTransform->GetMatrix());
-    frustum = cameraTransform->GetMatrix() * frustum;
+    GetCameraInfo(entities, cameraTransform, frustum, V, P, zNear, zFar);
 
     uvec2 size = window->GetSize();
     OGL(glViewport(0, 0, size.x, size.y));
@@ -72,12 +80,19 @@ void ForwardRenderer::update(entityx::EntityManager &entities, entityx::EventMan
     {
         DOLLAR("Models")
 
-        forwardShader->Bind();
-        forwardShader->Uniform("V", V);
-        forwardShader->Uniform("P", P);
-        forwardShader->Uniform("EyePos", cameraTransform->Position());
-        forwardShader->Uniform("time", static_cast<float>(Time::CurrentTime()));
-        renderStats.UniformCalls += 4;
+        // every variant is a separate program, so each of them gets the lights and camera uniforms
+        auto const setupShader = [&](gl::Shader &shader) -> GLenum {
+            GLenum textureCount = 0;
+            UploadPointLights<false>(entities, shader, renderStats);
+            UploadDirectionalLights<true>(entities, shader, textureCount, renderStats, cullModelsAndMeshes);
+
+            shader.Uniform("V", V);
+            shader.Uniform("P", P);
+            shader.Uniform("EyePos", cameraTransform->Position());
+            shader.Uniform("time", static_cast<float>(Time::CurrentTime()));
+            renderStats.UniformCalls += 4;
+            return textureCount;
+        };
 
         auto scopedState = gl::ScopedState()
                 .Enable(GL_CULL_FACE)
@@ -85,13 +100,12 @@ void ForwardRenderer::update(entityx::EntityManager &entities, entityx::EventMan
                 .Enable(GL_DEPTH_TEST)
                 .Build();
 
-        if (cullModelsAndMeshes) {
-            RenderModels(entities, *forwardShader, forwardShaderTextureCount, renderStats, &frustum);
+        auto const modelFrustum = cullModelsAndMeshes ? &frustum : nullptr;
+        if (useInstancing) {
+            RenderModelsInstanced(entities, forwardInstancedPermutations, setupShader, renderStats, modelFrustum);
         } else {
-            RenderModels(entities, *forwardShader, forwardShaderTextureCount, renderStats);
+            RenderModels(entities, forwardPermutations, setupShader, renderStats, modelFrustum);
         }
-
-        forwardShader->Unbind();
     }
 
     // Skydome
@@ -132,7 +146,7 @@ void ForwardRenderer::update(entityx::EntityManager &entities, entityx::EventMan
                 .Enable(GL_DEPTH_TEST)
                 .Build();
 
-        RenderBoundingSpheres(entities, *wireframeShader, forwardShaderTextureCount, renderStats,
+        RenderBoundingSpheres(entities, *wireframeShader, 0, renderStats,
                               renderBoundingSpheresAsWireframe);
         wireframeShader->Unbind();
     }
@@ -141,7 +155,11 @@ void ForwardRenderer::update(entityx::EntityManager &entities, entityx::EventMan
 bool ForwardRenderer::DrawWithImGui(ForwardRenderer &sys, InputManager const &input) {
     $
     if (ImGui::Button("Reload shaders")) {
-        sys.LoadShaders();
+        sys.pendingShaders = LoadShadersAsync(sys.ShaderPrograms());
+    }
+    if (!sys.pendingShaders.IsEmpty()) {
+        ImGui::SameLine();
+        ImGui::Text("Compiling...");
     }
 
     int swapInterval = sys.window->GetSwapInterval();
@@ -150,7 +168,11 @@ bool ForwardRenderer::DrawWithImGui(ForwardRenderer &sys, InputManager const &in
         sys.window->SetSwapInterval(swapInterval == 0 ? 1 : 0);
     }
 
+    ImGui::Text("Forward shader variants: %zu (instanced: %zu)",
+                sys.forwardPermutations.NumVariants(), sys.forwardInstancedPermutations.NumVariants());
+
     ImGui::Checkbox("Cull models and meshes", &sys.cullModelsAndMeshes);
+    ImGui::Checkbox("Instanced models", &sys.useInstancing);
     ImGui::Checkbox("Render bounding spheres", &sys.renderBoundingSpheres);
     if (sys.renderBoundingSpheres) {
         ImGui::Checkbox("- as wireframe", &sys.renderBoundingSpheresAsWireframe);
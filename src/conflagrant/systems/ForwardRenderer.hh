@@ -6,6 +6,7 @@
 #include <conflagrant/gl/Shader.hh>
 #include <conflagrant/serialization/serialize.hh>
 #include <conflagrant/RenderStats.hh>
+#include <conflagrant/ShaderSourceManager.hh>
 
 #include <entityx/System.h>
 
@@ -14,20 +15,30 @@ namespace syst {
 class ForwardRenderer : public cfl::System, public entityx::System<ForwardRenderer> {
 public:
     static constexpr auto SystemName = "ForwardRenderer";
+    static constexpr bool IsRenderer = true;
 
 private:
+    ShaderPermutations forwardPermutations, forwardInstancedPermutations;
+
     std::shared_ptr<gl::Shader>
-            forwardShader,
             skydomeShader,
             shadowmapLightpassShader,
+            shadowmapLightpassInstancedShader,
             shadowmapVisShader,
             wireframeShader;
 
     RenderStats renderStats;
 
     bool cullModelsAndMeshes{false}, renderBoundingSpheres{false}, renderBoundingSpheresAsWireframe{true};
+    bool useInstancing{true};
+
+    PendingShaders pendingShaders;
 
-    void LoadShaders();
+    /**
+     * @brief Sets up the shader permutations.
+     * @returns All programs to (re)load.
+     */
+    std::vector<ShaderProgramDescription> ShaderPrograms();
 
 public:
     ForwardRenderer();
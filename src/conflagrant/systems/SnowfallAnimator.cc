@@ -2,31 +2,69 @@
 #include "DeferredRenderer.hh"
 
 #include <conflagrant/components/SnowEmitter.hh>
+#include <conflagrant/components/Model.hh>
+#include <conflagrant/RenderableStore.hh>
+#include <conflagrant/ChangeJournal.hh>
 #include <conflagrant/systems/DeferredRenderer.hh>
 #include <conflagrant/ShaderSourceManager.hh>
 #include <conflagrant/Time.hh>
 #include <conflagrant/systems/system_util.hh>
 #include <conflagrant/gl/State.hh>
 #include <conflagrant/Engine.hh>
+#include <conflagrant/gl/StreamBuffer.hh>
+
+#include <limits>
 
 namespace cfl {
 namespace syst {
-void Pingpong(comp::SnowEmitter &snow) {
-    snow.framebuffer->Bind();
-
-    snow.positionsAngles->Swap();
-    snow.framebuffer->Attach(GL_COLOR_ATTACHMENT0, snow.positionsAngles->Front());
+/**
+ * @brief Bounds of the snow of an emitter: the emitter volume, the unit cube under emitterTransform, extended down to
+ * the ground where snow/SimulateSnowParticle.glsl respawns the particles.
+ */
+geometry::Sphere SnowfallBounds(mat4 const &emitterTransform) {
+    vec3 min(std::numeric_limits<float>::max()), max(std::numeric_limits<float>::lowest());
+    for (int corner = 0; corner < 8; ++corner) {
+        vec4 const unit((corner & 1) ? 1 : -1, (corner & 2) ? 1 : -1, (corner & 4) ? 1 : -1, 1);
+        auto const world = vec3(emitterTransform * unit);
+        min = glm::min(min, world);
+        max = glm::max(max, world);
+    }
+    min.y = std::min(min.y, -0.1f);
 
-    snow.velocitiesLifetimes->Swap();
-    snow.framebuffer->Attach(GL_COLOR_ATTACHMENT1, snow.velocitiesLifetimes->Front());
+    geometry::Sphere bounds;
+    bounds.center = 0.5f * (min + max);
+    bounds.radius = 0.5f * glm::distance(min, max);
+    return bounds;
+}
 
-    GLenum const attachments[2] = {
-            GL_COLOR_ATTACHMENT0,
-            GL_COLOR_ATTACHMENT1
-    };
-    snow.framebuffer->SetDrawBuffers(2, attachments);
+/**
+ * @brief Writes count particles of particleSize bytes each into buffer, through the per-frame stream buffer so that
+ * the upload does not stall on the buffer's previous contents.
+ * @param pack Called as pack(out, begin, end) to write the particles [begin, end) to out.
+ */
+template<typename Pack>
+void UploadParticles(gl::Buffer &buffer, size_t count, size_t particleSize, Pack const &pack) {
+    auto &stream = gl::StreamBuffer::PerFrame();
+
+    // a quarter of a region at most, so that a million particles do not use up the region of the frame
+    auto const particlesPerBatch = std::max<size_t>(1, stream.RegionSize() / 4 / particleSize);
+
+    for (size_t begin = 0; begin < count; begin += particlesPerBatch) {
+        auto const end = std::min(count, begin + particlesPerBatch);
+        auto const offset = static_cast<GLintptr>(begin * particleSize);
+        auto const size = static_cast<GLsizeiptr>((end - begin) * particleSize);
+
+        auto const allocation = stream.Allocate(size);
+        if (!allocation) {
+            std::vector<uint8_t> data(static_cast<size_t>(size));
+            pack(data.data(), begin, end);
+            buffer.BufferSubData(offset, size, data.data());
+            continue;
+        }
 
-    snow.framebuffer->Unbind();
+        pack(allocation.data, begin, end);
+        OGL(glCopyNamedBufferSubData(stream.ID(), buffer.ID(), allocation.offset, offset, size));
+    }
 }
 
 SnowfallAnimator::SnowfallAnimator() {
@@ -34,8 +72,12 @@ SnowfallAnimator::SnowfallAnimator() {
 }
 
 void SnowfallAnimator::LoadShaders() {
-    simulateComputeShader = LoadComputeShader("snow/snowfall_simulate.comp");
-    sortByDepthComputeShader = LoadComputeShader("snow/snowfall_depthsort.comp");
+    cfl::LoadShaders({
+            {&heightFieldShader, {"snow/heightfield.vert", "snow/heightfield.frag"}},
+            {&simulateComputeShader, {"snow/snowfall_simulate.comp"}},
+            {&sortByDepthComputeShader, {"snow/snowfall_depthsort.comp"}},
+            {&sortMergeComputeShader, {"snow/snowfall_depthsort_merge.comp"}},
+    });
 }
 
 void SnowfallAnimator::ResetTopDownFramebuffer(GLsizei size) {
@@ -62,32 +104,215 @@ void SnowfallAnimator::ResetTopDownFramebuffer(GLsizei size) {
     }
 
     heightFramebuffer->Unbind();
+
+    snowDepthTexture = std::make_shared<gl::Texture2D>(size, size, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void SnowfallAnimator::UpdateHeightField(entityx::EntityManager &entities, DeferredRenderer const &deferred,
+                                         SnowCover *cover) {
+    auto const size = static_cast<GLsizei>(math::Pow(2, heightTexturePower));
+    if (!heightFramebuffer || heightFramebuffer->width != size) {
+        ResetTopDownFramebuffer(size);
+        heightField.Invalidate();
+    }
+
+    // the height field covers the voxel volume, whose voxels the particles collided with before
+    auto const &center = deferred.VCT.center;
+    heightField.Configure(size, std::min(size, HeightFieldTileSize), vec2(center.x, center.z),
+                          deferred.VCT.halfDimensions);
+
+    // a new cover has no heights yet, so every tile is rendered and read back into it
+    if (cover && (cover->Resolution() != static_cast<uint32_t>(size) || cover->Center() != heightField.Center() ||
+                  cover->HalfExtent() != heightField.HalfExtent())) {
+        std::vector<float> noHeights(static_cast<size_t>(size) * size, std::numeric_limits<float>::lowest());
+        *cover = SnowCover(static_cast<uint32_t>(size), heightField.Center(), heightField.HalfExtent(),
+                           std::move(noHeights));
+        heightField.Invalidate();
+    }
+
+    auto &store = RenderableStore::Of(entities);
+    store.Update();
+
+    for (uint32_t slot = 0; slot < store.Size(); ++slot) {
+        if (!store.Model(slot).value) {
+            continue;
+        }
+
+        auto const &sphere = store.Bounds(slot);
+        heightField.UpdateCaster(store.Entity(slot).id().id(), store.Matrix(slot), sphere.center, sphere.radius);
+    }
+    heightField.RemoveStaleCasters();
+
+    if (!heightFieldShader) {
+        return;
+    }
+
+    auto const tiles = heightField.TakeDirtyTiles();
+    if (tiles.empty()) {
+        return;
+    }
+
+    auto scopedState = gl::ScopedState()
+            .Enable(GL_DEPTH_TEST)
+            .Enable(GL_SCISSOR_TEST)
+            // casters above or below the projection's range are clamped instead of clipped
+            .Enable(GL_DEPTH_CLAMP)
+            .Disable(GL_CULL_FACE)
+            .Disable(GL_BLEND)
+            .DepthMask(GL_TRUE)
+            .Build();
+
+    heightFramebuffer->Bind();
+    OGL(glViewport(0, 0, size, size));
+
+    heightFieldShader->Bind();
+    heightFieldShader->Uniform("P", heightField.Projection(center.y));
+
+    GLfloat const noHeight = std::numeric_limits<GLfloat>::lowest();
+    GLfloat const farthest = 1;
+    GLuint const noSnow = 0;
+
+    for (auto const &tile : tiles) {
+        auto const texels = heightField.Texels(tile);
+        auto const extent = texels.max - texels.min;
+
+        OGL(glScissor(texels.min.x, texels.min.y, extent.x, extent.y));
+        OGL(glClearBufferfv(GL_COLOR, 0, &noHeight));
+        OGL(glClearBufferfv(GL_DEPTH, 0, &farthest));
+
+        // the accumulated snow lay on the old surface
+        OGL(glClearTexSubImage(snowDepthTexture->ID(), 0, texels.min.x, texels.min.y, 0, extent.x, extent.y, 1,
+                               snowDepthTexture->format, snowDepthTexture->type, &noSnow));
+
+        for (uint32_t slot = 0; slot < store.Size(); ++slot) {
+            if (heightField.IsCasterInTile(store.Entity(slot).id().id(), tile)) {
+                RenderModel<false, false, false, false>(store.Matrix(slot), store.Scale(slot), store.Model(slot),
+                                                        nullptr, *heightFieldShader, 0, renderStats, nullptr);
+            }
+        }
+    }
+
+    heightFieldShader->Unbind();
+    heightFramebuffer->Unbind();
+
+    if (!cover) {
+        return;
+    }
+
+    // the readback waits for the tiles to be rendered, which only happens when casters change
+    std::vector<float> heights;
+    for (auto const &tile : tiles) {
+        auto const texels = heightField.Texels(tile);
+        auto const extent = texels.max - texels.min;
+
+        heights.resize(static_cast<size_t>(extent.x) * extent.y);
+        OGL(glGetTextureSubImage(heightTexture->ID(), 0, texels.min.x, texels.min.y, 0, extent.x, extent.y, 1, GL_RED,
+                                 GL_FLOAT, static_cast<GLsizei>(heights.size() * sizeof(float)), heights.data()));
+        cover->UpdateTexels(texels.min, texels.max, heights.data());
+    }
+}
+
+void SnowfallAnimator::SimulateOnCpu(comp::SnowEmitter &snow, mat4 const &emitterTransform, vec3 const &eyePosition,
+                                     float time, float timeDelta) {
+    SnowSimulationParameters parameters;
+    parameters.emitterTransform = emitterTransform;
+    parameters.time = time;
+    parameters.timeDelta = timeDelta;
+
+    if (!snow.cpuParticles) {
+        snow.cpuParticles = std::make_shared<SnowParticles>();
+    }
+
+    auto &particles = *snow.cpuParticles;
+    auto const oldCount = particles.Size();
+    auto const count = static_cast<size_t>(snow.lodCount);
+    if (oldCount != count) {
+        // new particles start in the emitter instead of at the origin
+        particles.Resize(count);
+        for (auto i = oldCount; i < count; ++i) {
+            SnowSimulation::Respawn(particles, parameters, i);
+        }
+    }
+
+    SnowSimulation::Simulate(particles, parameters, snowCover.IsEmpty() ? nullptr : &snowCover);
+    if (sortByDepth) {
+        SnowSimulation::SortBackToFront(particles, eyePosition);
+    }
+
+    UploadParticles(*snow.positions, count, 3 * sizeof(float), [&](void *out, size_t begin, size_t end) {
+        particles.PackPositions(static_cast<float *>(out), begin, end);
+    });
+    UploadParticles(*snow.velocities, count, 3 * sizeof(float), [&](void *out, size_t begin, size_t end) {
+        particles.PackVelocities(static_cast<float *>(out), begin, end);
+    });
+    UploadParticles(*snow.angles, count, sizeof(float), [&](void *out, size_t begin, size_t end) {
+        std::copy(particles.angle.begin() + begin, particles.angle.begin() + end, static_cast<float *>(out));
+    });
+    UploadParticles(*snow.lifetimes, count, sizeof(float), [&](void *out, size_t begin, size_t end) {
+        std::copy(particles.lifetime.begin() + begin, particles.lifetime.begin() + end, static_cast<float *>(out));
+    });
+
+    GLuint const command[4] = {1, static_cast<GLuint>(count), 0, 0};
+    snow.drawCommand->BufferSubData(0, sizeof(command), command);
+    snow.isSortedOnGpu = false;
 }
 
-void SnowfallAnimator::RenderTopDownDepthTexture() {
+void SnowfallAnimator::SortOnGpu(comp::SnowEmitter &snow, vec3 const &eyePosition) {
+    auto const size = math::NextPowerOfTwo(static_cast<GLuint>(snow.lodCount));
+    auto const numGroups = std::max<GLuint>(1, size / SortGroupPairs);
+
+    auto const sortBufferSize = static_cast<GLsizeiptr>(size * 2 * sizeof(GLuint));
+    if (!snow.sortBuffer || snow.sortBuffer->Size() != sortBufferSize) {
+        // binding once makes the generated name an actual buffer object
+        snow.sortBuffer = std::make_shared<gl::Buffer>();
+        snow.sortBuffer->Bind(GL_SHADER_STORAGE_BUFFER);
+        snow.sortBuffer->BufferData(sortBufferSize, nullptr, GL_DYNAMIC_COPY);
+        gl::Buffer::Unbind(GL_SHADER_STORAGE_BUFFER);
+    }
+
+    BindParticleStorage(snow);
+    OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, comp::SnowEmitter::SortBinding, snow.sortBuffer->ID()));
+
+    // the keys, in blocks that are sorted in shared memory
+    sortByDepthComputeShader->Bind();
+    sortByDepthComputeShader->Uniform("Count", static_cast<GLint>(snow.lodCount));
+    sortByDepthComputeShader->Uniform("Size", static_cast<GLint>(size));
+    sortByDepthComputeShader->Uniform("EyePos", eyePosition);
+    sortByDepthComputeShader->Uniform("MergeSize", 0);
+    OGL(glDispatchCompute(numGroups, 1, 1));
+    OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+
+    // merges of the blocks, every stride of a block or more takes a dispatch before the rest is done in shared memory
+    for (auto mergeSize = 2 * SortGroupPairs; mergeSize <= size; mergeSize <<= 1) {
+        sortMergeComputeShader->Bind();
+        sortMergeComputeShader->Uniform("MergeSize", static_cast<GLint>(mergeSize));
+        for (auto stride = mergeSize / 2; stride >= SortGroupPairs; stride >>= 1) {
+            sortMergeComputeShader->Uniform("Stride", static_cast<GLint>(stride));
+            OGL(glDispatchCompute(size / 2 / SortGroupSize, 1, 1));
+            OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+        }
 
+        sortByDepthComputeShader->Bind();
+        sortByDepthComputeShader->Uniform("MergeSize", static_cast<GLint>(mergeSize));
+        OGL(glDispatchCompute(numGroups, 1, 1));
+        OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT));
+    }
+
+    sortByDepthComputeShader->Unbind();
+
+    snow.isSortedOnGpu = true;
 }
 
 void SnowfallAnimator::update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) {
     if (!enabled)
         return;
 
-    auto const heightTextureSize = static_cast<GLsizei>(math::Pow(2, heightTexturePower));
-    if (!heightFramebuffer || heightFramebuffer->width != heightTextureSize) {
-        ResetTopDownFramebuffer(heightTextureSize);
-        RenderTopDownDepthTexture();
-    }
-
     // --------------- //
     // common uniforms //
     // --------------- //
 
     auto const& deferred = engine->GetSystemManager()->system<DeferredRenderer>();
 
-    auto const& sceneVoxelTexture = deferred->voxelTexture;
-    auto const& voxelHalfDimensions = deferred->VCT.halfDimensions;
-    auto const& voxelCenter = deferred->VCT.center;
-
     auto const time = static_cast<float>(Time::CurrentTime());
     auto const timeDelta = static_cast<float>(Time::DeltaTime());
 
@@ -95,107 +320,135 @@ void SnowfallAnimator::update(entityx::EntityManager &entities, entityx::EventMa
     auto const width = static_cast<GLsizei>(size.x);
     auto const height = static_cast<GLsizei>(size.y);
 
-    mat4 P;
+    mat4 V, P;
     geometry::Frustum frustum;
     entityx::ComponentHandle<comp::Transform> cameraTransform;
     float zNear, zFar;
 
-    GetCameraInfo(entities, cameraTransform, frustum, P, zNear, zFar);
-    auto const V = glm::inverse(cameraTransform->GetMatrix());
+    GetCameraInfo(entities, cameraTransform, frustum, V, P, zNear, zFar);
     auto const EyePos = cameraTransform->Position();
-    frustum = cameraTransform->GetMatrix() * frustum;
 
     renderStats.Reset();
 
-    {
+    // the 4.5 context of the engine always supports compute shaders, which leaves the CPU as the fallback for a
+    // simulation shader that failed to load. The particles are drawn from shader storage buffers either way.
+    auto const isCpuSimulation = useCpuSimulation || !simulateComputeShader;
+
+    if (isCpuSimulation) {
+        // only the CPU simulation reads the snow that lands on the CPU, so it stays in the cover
+        UpdateHeightField(entities, *deferred, &snowCover);
+    } else {
+        // the cover would miss the tiles rendered in the meantime, switching back reads all of them again
+        snowCover = SnowCover();
+        UpdateHeightField(entities, *deferred, nullptr);
+
         simulateComputeShader->Bind();
         simulateComputeShader->Uniform("time", time);
-        simulateComputeShader->Uniform("timeDelta", timeDelta);
 
-        simulateComputeShader->Uniform("VoxelHalfDimensions", vec3(voxelHalfDimensions));
-        simulateComputeShader->Uniform("VoxelCenter", voxelCenter);
-        simulateComputeShader->Texture("VoxelizedScene", 2, *sceneVoxelTexture);
+        simulateComputeShader->Uniform("HeightFieldCenter", heightField.Center());
+        simulateComputeShader->Uniform("HeightFieldHalfExtent", heightField.HalfExtent());
+        simulateComputeShader->Texture("HeightField", 2, *heightTexture);
+        simulateComputeShader->Texture("SnowDepth", 3, *snowDepthTexture);
+        OGL(glBindImageTexture(3, snowDepthTexture->ID(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI));
+    }
 
+    {
         entityx::ComponentHandle<comp::SnowEmitter> snow;
-        for (auto e : entities.entities_with_components(snow)) {
+        for (auto e : EntitiesWith(entities, snow)) {
             if (snow->count == 0) {
                 continue;
             }
 
-            auto const oldMaxCount = snow->maxCount;
-            snow->maxCount = math::NextPowerOfTwo(snow->count);
-            if (!snow->framebuffer || oldMaxCount != snow->maxCount) {
-                InitializeComponent(*snow);
-            }
+            ReserveParticleStorage(*snow);
 
             mat4 snowEmitterTransform(1);
             auto const transform = e.component<comp::Transform>();
             if (transform) {
                 snowEmitterTransform = transform->GetMatrix();
             }
+            snowEmitterTransform = snowEmitterTransform * glm::scale(snow->dimensions);
+
+            auto const bounds = SnowfallBounds(snowEmitterTransform);
+            auto const distance = std::max(0.0f, glm::distance(EyePos, bounds.center) - bounds.radius);
+            auto const lod = SnowSimulation::ComputeLod(snow->count, distance, lodParameters);
+            auto const isVisible = frustum.ComputeIntersection(bounds) != geometry::IntersectionType::OUTSIDE;
+            if (isVisible != snow->isVisible || lod.count != snow->lodCount ||
+                lod.radiusScale != snow->lodRadiusScale) {
+                // the simulation state below changes every frame, only what the renderer draws is recorded
+                ChangeJournal::Of(entities).Record<comp::SnowEmitter>(e);
+            }
+            snow->isVisible = isVisible;
+            snow->lodCount = lod.count;
+            snow->lodRadiusScale = lod.radiusScale;
 
-            simulateComputeShader->Uniform("Count", static_cast<GLint>(snow->count));
-            simulateComputeShader->Uniform("MaxCount", static_cast<GLint>(snow->maxCount));
-            simulateComputeShader->Uniform("EmitterTransform", snowEmitterTransform * glm::scale(snow->dimensions));
-
-            simulateComputeShader->Texture("PositionsAngles", 0, *snow->positionsAngles->Front());
-            simulateComputeShader->Texture("VelocitiesLifetimes", 1, *snow->velocitiesLifetimes->Front());
-            OGL(glBindImageTexture(0, snow->positionsAngles->Front()->ID(),
-                                   0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F));
-            OGL(glBindImageTexture(1, snow->velocitiesLifetimes->Front()->ID(),
-                                   0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F));
-
-            auto computeSize = static_cast<GLuint>(snow->count);
-            OGL(glDispatchCompute(computeSize, 1, 1));
-        }
-
-        simulateComputeShader->Unbind();
-    }
+            // emitters that are not visible take larger steps every few frames
+            snow->skippedTime += timeDelta;
+            if (!snow->isVisible && ++snow->skippedFrames < lodParameters.hiddenSimulationInterval) {
+                continue;
+            }
 
-    if (sortByDepth) {
-        sortByDepthComputeShader->Bind();
-        sortByDepthComputeShader->Uniform("time", time);
-        sortByDepthComputeShader->Uniform("timeDelta", timeDelta);
-        sortByDepthComputeShader->Uniform("EyePos", EyePos);
+            auto const stepTimeDelta = snow->skippedTime;
+            snow->skippedFrames = 0;
+            snow->skippedTime = 0;
 
-        entityx::ComponentHandle<comp::SnowEmitter> snow;
-        for (auto e : entities.entities_with_components(snow)) {
-            if (snow->count == 0) {
+            if (isCpuSimulation) {
+                SimulateOnCpu(*snow, snowEmitterTransform, EyePos, time, stepTimeDelta);
                 continue;
             }
 
-            auto const oldMaxCount = snow->maxCount;
-            snow->maxCount = math::NextPowerOfTwo(snow->count);
-            if (!snow->framebuffer || oldMaxCount != snow->maxCount) {
-                InitializeComponent(*snow);
-            }
+            // switching back to the CPU restarts its simulation
+            snow->cpuParticles.reset();
 
-            sortByDepthComputeShader->Uniform("Count", static_cast<GLint>(snow->count));
-            sortByDepthComputeShader->Uniform("MaxCount", static_cast<GLint>(snow->maxCount));
+            simulateComputeShader->Uniform("Count", static_cast<GLint>(snow->lodCount));
+            simulateComputeShader->Uniform("timeDelta", stepTimeDelta);
+            simulateComputeShader->Uniform("EmitterTransform", snowEmitterTransform);
 
-            sortByDepthComputeShader->Texture("PositionsAngles", 0, *snow->positionsAngles->Front());
-            sortByDepthComputeShader->Texture("VelocitiesLifetimes", 1, *snow->velocitiesLifetimes->Front());
+            BindParticleStorage(*snow);
+            OGL(glBindBufferBase(GL_SHADER_STORAGE_BUFFER, comp::SnowEmitter::DrawCommandBinding,
+                                 snow->drawCommand->ID()));
 
-            OGL(glBindImageTexture(0, snow->positionsAngles->Front()->ID(),
-                                   0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F));
-            OGL(glBindImageTexture(1, snow->velocitiesLifetimes->Front()->ID(),
-                                   0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F));
+            auto const computeSize = static_cast<GLuint>((snow->lodCount + 63) / 64);
+            OGL(glDispatchCompute(computeSize, 1, 1));
+            snow->isSortedOnGpu = false;
+        }
 
-            auto const computeSize = static_cast<GLuint>(math::NextEvenNumber(snow->count) / 2);
+        if (!isCpuSimulation) {
+            // the particles are read by the sort and the renderer, which also draws with the command, and the snow
+            // depth by the next frame's simulation and tile clears
+            OGL(glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT |
+                                GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT));
+        }
 
-            for (int i = 0; i < 2; ++i) {
-                sortByDepthComputeShader->Uniform("GlobalOffset", i);
-                OGL(glDispatchCompute(computeSize, 1, 1));
-            }
+        if (!isCpuSimulation) {
+            simulateComputeShader->Unbind();
         }
+    }
 
-        sortByDepthComputeShader->Unbind();
+    // the CPU simulation sorts its particles before uploading them
+    if (sortByDepth && !isCpuSimulation) {
+        entityx::ComponentHandle<comp::SnowEmitter> snow;
+        for (auto e : EntitiesWith(entities, snow)) {
+            if (snow->count == 0 || !snow->positions || !snow->isVisible) {
+                continue;
+            }
+
+            SortOnGpu(*snow, EyePos);
+        }
     }
 }
 
 bool SnowfallAnimator::Serialize(BaseSerializer const &serializer, Json::Value &json, SnowfallAnimator &sys) {
     json["name"] = SystemName;
     SERIALIZE(cfl::SnowfallAnimator, json["heightTexturePower"], sys.heightTexturePower);
+    if (serializer.IsSerializer() || json.isMember("cpuSimulation")) {
+        SERIALIZE(cfl::SnowfallAnimator, json["cpuSimulation"], sys.useCpuSimulation);
+    }
+    if (serializer.IsSerializer() || json.isMember("lodFullDetailDistance")) {
+        SERIALIZE(cfl::SnowfallAnimator, json["lodFullDetailDistance"], sys.lodParameters.fullDetailDistance);
+        SERIALIZE(cfl::SnowfallAnimator, json["lodMinDetailFraction"], sys.lodParameters.minDetailFraction);
+        SERIALIZE(cfl::SnowfallAnimator, json["lodHiddenSimulationInterval"],
+                  sys.lodParameters.hiddenSimulationInterval);
+    }
     return true;
 }
 
@@ -208,6 +461,20 @@ bool SnowfallAnimator::DrawWithImGui(SnowfallAnimator &sys, InputManager const &
 
     ImGui::Checkbox("Sort by depth", &sys.sortByDepth);
 
+    ImGui::DragFloat("LOD full detail distance", &sys.lodParameters.fullDetailDistance, 0.5f, 0.0f, 1000.0f);
+    ImGui::DragFloat("LOD min detail fraction", &sys.lodParameters.minDetailFraction, 0.01f, 0.01f, 1.0f);
+    ImGui::DragInt("Hidden simulation interval", &sys.lodParameters.hiddenSimulationInterval, 1, 1, 60);
+
+    ImGui::DragInt("Height field size exponent", &sys.heightTexturePower, 1, 6, 12);
+    if (ImGui::Button("Clear accumulated snow")) {
+        sys.heightField.Invalidate();
+    }
+
+    ImGui::Checkbox("Simulate on CPU", &sys.useCpuSimulation);
+    if (sys.useCpuSimulation || !sys.simulateComputeShader) {
+        ImGui::Text("CPU simulation: %s", SnowSimulation::IsVectorized() ? "AVX2" : "scalar");
+    }
+
     return true;
 }
 } // namespace syst
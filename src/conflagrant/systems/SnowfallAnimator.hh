@@ -9,11 +9,16 @@
 #include <conflagrant/RenderStats.hh>
 #include <conflagrant/gl/Mesh.hh>
 #include <conflagrant/gl/Framebuffer.hh>
+#include <conflagrant/SnowSimulation.hh>
+#include <conflagrant/SnowHeightField.hh>
+#include <conflagrant/components/SnowEmitter.hh>
 
 #include <entityx/System.h>
 
 namespace cfl {
 namespace syst {
+class DeferredRenderer;
+
 class SnowfallAnimator : public System, public entityx::System<SnowfallAnimator> {
 public:
     static constexpr auto SystemName = "SnowfallAnimator";
@@ -23,15 +28,40 @@ private:
 
     void ResetTopDownFramebuffer(GLsizei size);
 
-    void RenderTopDownDepthTexture();
+    /**
+     * @brief Renders the tiles of the height field whose casters changed, and clears the snow that landed on them.
+     * @param cover nullptr, or the cover of the CPU simulation, which the rendered tiles are read back into.
+     */
+    void UpdateHeightField(entityx::EntityManager &entities, DeferredRenderer const &deferred, SnowCover *cover);
+
+    /**
+     * @brief Advances the particles of snow with SnowSimulation and streams them into its buffers.
+     */
+    void SimulateOnCpu(comp::SnowEmitter &snow, mat4 const &emitterTransform, vec3 const &eyePosition, float time,
+                       float timeDelta);
+
+    /**
+     * @brief Sorts the particles of snow back to front with a bitonic sort of their indices, into snow.sortBuffer.
+     */
+    void SortOnGpu(comp::SnowEmitter &snow, vec3 const &eyePosition);
+
+    // must match snow/BitonicSort.glsl
+    static constexpr GLuint SortGroupSize = 256;
+    static constexpr GLuint SortGroupPairs = 2 * SortGroupSize;
+
+    // texels per side of the tiles of the height field
+    static constexpr GLsizei HeightFieldTileSize = 64;
 
     std::shared_ptr<gl::Shader>
+            heightFieldShader,
             simulateComputeShader,
-            sortByDepthComputeShader;
+            sortByDepthComputeShader,
+            sortMergeComputeShader;
 
-    std::shared_ptr<gl::Texture2D> heightTexture;
+    std::shared_ptr<gl::Texture2D> heightTexture, snowDepthTexture;
     std::shared_ptr<gl::Framebuffer> heightFramebuffer;
     int heightTexturePower{10};
+    SnowHeightField heightField;
 
     RenderStats renderStats;
 
@@ -39,6 +69,14 @@ private:
 
     bool sortByDepth{false};
 
+    SnowLodParameters lodParameters;
+
+    // simulate on the CPU even if the simulation shader loaded, which frees the GPU for rendering
+    bool useCpuSimulation{false};
+
+    // the height field and the snow on it as the CPU simulation sees them
+    SnowCover snowCover;
+
 public:
     SnowfallAnimator();
 
@@ -15,82 +15,58 @@
 #include <conflagrant/components/Skydome.hh>
 #include <conflagrant/gl/Shader.hh>
 #include <conflagrant/gl/State.hh>
+#include <conflagrant/gl/StreamBuffer.hh>
 #include <conflagrant/RenderStats.hh>
+#include <conflagrant/ShaderSourceManager.hh>
 #include <conflagrant/Time.hh>
 #include <conflagrant/components/BoundingSphere.hh>
 #include <conflagrant/components/VctProperties.hh>
+#include <conflagrant/components/VelocityAnimation.hh>
+#include <conflagrant/components/PeriodicalAnimation.hh>
 #include <conflagrant/math.hh>
+#include <conflagrant/ComponentView.hh>
+#include <conflagrant/RenderableStore.hh>
+#include <conflagrant/ActiveCameraCache.hh>
 
 #include <entityx/Entity.h>
 
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
 namespace cfl {
 inline entityx::Entity GetActiveCamera(entityx::EntityManager &entities,
                                        entityx::ComponentHandle<comp::Transform> &outTransform,
                                        entityx::ComponentHandle<comp::PerspectiveCamera> &outPerspective,
                                        entityx::ComponentHandle<comp::OrthographicCamera> &outOrtographic) {
     $
+    auto &camera = ActiveCameraCache::Of(entities);
+    camera.Update();
 
-    entityx::ComponentHandle<comp::ActiveCamera> active;
-
-    // 1. Check if we have any Perspective- or OrthographicCamera's with ActiveCamera attached
-    for (auto entity : entities.entities_with_components(outTransform, active, outPerspective))
-        return entity;
-    for (auto entity : entities.entities_with_components(outTransform, active, outOrtographic))
-        return entity;
-
-    // 2. Check if we have any Perspective- or OrthographicCamera's without ActiveCamera attached
-    //    => if so, attach ActiveCamera and return
-    for (auto entity : entities.entities_with_components(outTransform, outPerspective)) {
-        entity.assign<comp::ActiveCamera>();
-        return entity;
-    }
-    for (auto entity : entities.entities_with_components(outTransform, outOrtographic)) {
-        entity.assign<comp::ActiveCamera>();
-        return entity;
-    }
-
-
-    entityx::Entity newActiveCamera = entities.create();
-    newActiveCamera.assign<comp::Name>()->value = "(auto-created camera)";
-    newActiveCamera.assign<comp::Guid>();
-    newActiveCamera.assign<comp::ActiveCamera>();
-
-    outTransform = newActiveCamera.assign<comp::Transform>();
-    outTransform->Position(vec3(0, 0, 10));
-    outPerspective = newActiveCamera.assign<comp::PerspectiveCamera>();
-
-    return newActiveCamera;
+    outTransform = camera.Transform();
+    outPerspective = camera.Perspective();
+    outOrtographic = camera.Orthographic();
+    return camera.Camera();
 }
 
+/**
+ * @param frustum The world space frustum of the camera.
+ */
 inline void GetCameraInfo(entityx::EntityManager &entities,
                           entityx::ComponentHandle<comp::Transform> &outTransform,
                           geometry::Frustum &frustum,
-                          mat4 &P, float &zNear, float &zFar) {
+                          mat4 &V, mat4 &P, float &zNear, float &zFar) {
     $
-    using entityx::ComponentHandle;
-
-    ComponentHandle<comp::PerspectiveCamera> perspective;
-    ComponentHandle<comp::OrthographicCamera> orthographic;
-
-    GetActiveCamera(entities, outTransform, perspective, orthographic);
-
-    if (perspective) {
-        P = perspective->GetProjection();
-        frustum = perspective->GetFrustum();
-        zNear = perspective->ZNear();
-        zFar = perspective->ZFar();
-
-    } else if (orthographic) {
-        P = orthographic->GetProjection();
-        frustum = orthographic->GetFrustum();
-        zNear = orthographic->ZNear();
-        zFar = orthographic->ZFar();
-
-    } else {
-        LOG_ERROR(cfl::ForwardRenderer::SetCameraMatrices)
-                << "No OrthographicCamera or PerspectiveCamera." << std::endl;
-        P = mat4(1);
-    }
+    auto &camera = ActiveCameraCache::Of(entities);
+    camera.Update();
+
+    outTransform = camera.Transform();
+    frustum = camera.Frustum();
+    V = camera.View();
+    P = camera.Projection();
+    zNear = camera.ZNear();
+    zFar = camera.ZFar();
 }
 
 template<bool UseShadows = false>
@@ -120,6 +96,12 @@ void RenderSkydomes(entityx::EntityManager &entities,
                     gl::Shader &shader, GLenum const nextTextureUnit,
                     RenderStats &renderStats, mat4 const &P, mat4 const &V);
 
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
+void RenderModel(mat4 const &M, float scale, comp::Model &model,
+                 comp::VctProperties const *vctProperties,
+                 gl::Shader &shader, GLenum const nextTextureUnit,
+                 RenderStats &renderStats, geometry::Frustum const *frustum = nullptr);
+
 template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
 void RenderModel(comp::Transform &transform, comp::Model &model,
                  comp::VctProperties const *vctProperties,
@@ -130,40 +112,83 @@ template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true,
 void RenderModels(entityx::EntityManager &entities, gl::Shader &shader,
                   GLenum const nextTextureUnit, RenderStats &renderStats, geometry::Frustum const *frustum = nullptr);
 
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
+void RenderModelsInstanced(entityx::EntityManager &entities, gl::Shader &shader,
+                           GLenum const nextTextureUnit, RenderStats &renderStats,
+                           geometry::Frustum const *frustum = nullptr);
+
+/**
+ * @brief Mirror of the std140 layout of PointLight in common/PointLight.glsl.
+ */
+struct PointLightStd140 {
+    vec3 worldPosition;
+    float intensity;
+    vec3 color;
+    float padding;
+};
+
+static_assert(sizeof(PointLightStd140) == 32, "PointLightStd140 has to match the std140 array stride");
+
+// all programs share this binding point, which is fine since the data is the same for all of them within a frame
+static constexpr GLuint PointLightBlockBinding = 0;
+
 template<bool UseShadows = false>
 inline void UploadPointLights(entityx::EntityManager &entities,
                               gl::Shader &shader,
                               RenderStats &renderStats) {
+    auto const blockSize = shader.UniformBlockSize("PointLightBlock");
+    if (blockSize <= 0) {
+        // the point lights were optimized away
+        return;
+    }
+
+    // int numPointLights takes up the first 16 bytes, followed by the array of lights
+    static constexpr GLsizeiptr LightsOffset = 16;
+
+    auto &stream = gl::StreamBuffer::PerFrame();
+    auto const allocation = stream.Allocate(blockSize, gl::StreamBuffer::UniformBufferOffsetAlignment());
+    if (!allocation) {
+        return;
+    }
+
+    auto const maxLights = static_cast<int>((blockSize - LightsOffset) / sizeof(PointLightStd140));
+    auto lights = reinterpret_cast<PointLightStd140 *>(static_cast<uint8_t *>(allocation.data) + LightsOffset);
+
     entityx::ComponentHandle<comp::Transform> transform;
     entityx::ComponentHandle<comp::PointLight> pointLight;
 
     int ilight = 0;
-    std::stringstream ss;
-    for (auto const &entity : entities.entities_with_components(transform, pointLight)) {
-        ss << "pointLights" << "[" << ilight << "]" << ".";
-        string const prefix = ss.str();
+    for (auto const &entity : EntitiesWith(entities, transform, pointLight)) {
+        if (ilight == maxLights) {
+            break;
+        }
 
-        shader.Uniform(prefix + "worldPosition", transform->Position());
-        shader.Uniform(prefix + "intensity", pointLight->intensity);
-        shader.Uniform(prefix + "color", pointLight->color);
-        renderStats.UniformCalls += 3;
+        lights[ilight].worldPosition = transform->Position();
+        lights[ilight].intensity = pointLight->intensity;
+        lights[ilight].color = pointLight->color;
 
         ilight++;
-        ss.str("");
     }
-    shader.Uniform("numPointLights", ilight);
+
+    *static_cast<int32_t *>(allocation.data) = ilight;
+
+    shader.UniformBlock("PointLightBlock", PointLightBlockBinding, stream.ID(), allocation.offset, blockSize);
     renderStats.UniformCalls++;
     renderStats.PointLights = static_cast<size_t>(ilight);
 }
 
+/**
+ * @param lightpassShader A program built with MODEL_INSTANCING if useInstancing is set, see common/ModelMatrix.glsl.
+ */
 inline void RenderDirectionalLightShadows(entityx::EntityManager &entities,
                                           gl::Shader &lightpassShader,
-                                          RenderStats &renderStats, bool cullModelsAndMeshes) {
+                                          RenderStats &renderStats, bool cullModelsAndMeshes,
+                                          bool useInstancing = false) {
     entityx::ComponentHandle<comp::DirectionalLight> light;
     entityx::ComponentHandle<comp::DirectionalLightShadow> shadow;
     entityx::ComponentHandle<comp::OrthographicCamera> camera;
 
-    for (auto entity : entities.entities_with_components(light)) {
+    for (auto entity : EntitiesWith(entities, light)) {
         float const phi = glm::radians(light->horizontal);
         float const theta = glm::radians(90 - light->vertical);
         vec3 direction(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
@@ -212,11 +237,13 @@ inline void RenderDirectionalLightShadows(entityx::EntityManager &entities,
 
             {
                 DOLLAR("Shadowmap: Render entities with Model")
-                if (cullModelsAndMeshes) {
-                    RenderModels<true, false, false, false>(entities, lightpassShader, 0, renderStats,
-                                                            &transformedFrustum);
+                auto const modelFrustum = cullModelsAndMeshes ? &transformedFrustum : nullptr;
+                if (useInstancing) {
+                    RenderModelsInstanced<true, false, false, false>(entities, lightpassShader, 0, renderStats,
+                                                                     modelFrustum);
                 } else {
-                    RenderModels<true, false, false, false>(entities, lightpassShader, 0, renderStats);
+                    RenderModels<true, false, false, false>(entities, lightpassShader, 0, renderStats,
+                                                            modelFrustum);
                 }
             }
 
@@ -237,7 +264,7 @@ inline void UploadDirectionalLights(entityx::EntityManager &entities,
 
     auto const nextTextureUnitStart = nextTextureUnit;
 
-    for (auto entity : entities.entities_with_components(light)) {
+    for (auto entity : EntitiesWith(entities, light)) {
         auto localNextTextureUnit = nextTextureUnitStart;
 
         ss << "directionalLights" << "[" << ilight << "]" << ".";
@@ -291,10 +318,7 @@ inline void RenderFullscreenQuad(RenderStats &renderStats) {
 
     auto &mesh = quadModel->parts[0].first;
 
-    if (mesh->needsUpdate) {
-        mesh->Update();
-        mesh->needsUpdate = false;
-    }
+    mesh->Update();
 
     mesh->glMesh->DrawElements();
     renderStats.DrawCalls++;
@@ -313,10 +337,7 @@ inline void RenderFullscreenTriangle(RenderStats &renderStats) {
 
     auto &mesh = quadModel->parts[0].first;
 
-    if (mesh->needsUpdate) {
-        mesh->Update();
-        mesh->needsUpdate = false;
-    }
+    mesh->Update();
 
     mesh->glMesh->DrawElements();
     renderStats.DrawCalls++;
@@ -339,10 +360,7 @@ inline void RenderUnitSphere(float radius, RenderStats &renderStats) {
 
     auto &mesh = sphereModel->parts[0].first;
 
-    if (mesh->needsUpdate) {
-        mesh->Update();
-        mesh->needsUpdate = false;
-    }
+    mesh->Update();
 
     mesh->glMesh->DrawElements();
     renderStats.DrawCalls++;
@@ -369,7 +387,7 @@ inline void RenderBoundingSpheres(entityx::EntityManager &entities,
     shader.Uniform(diffusePrefix + "hasMap", 0);
     renderStats.UniformCalls += 2;
 
-    for (auto entity : entities.entities_with_components(transform, boundingSphere)) {
+    for (auto entity : EntitiesWith(entities, transform, boundingSphere)) {
         if (frustum &&
             frustum->ComputeIntersection(
                     geometry::Transform(boundingSphere->sphere, transform->GetMatrix(), transform->Scale())) ==
@@ -386,7 +404,7 @@ inline void RenderBoundingSpheres(entityx::EntityManager &entities,
         RenderUnitSphere(boundingSphere->sphere.radius, renderStats);
     }
 
-    for (auto entity : entities.entities_with_components(transform, model)) {
+    for (auto entity : EntitiesWith(entities, transform, model)) {
         if (!model->value || model->value->parts.size() < 2) {
             // the model's single bounding sphere is exactly the same as the entire model's bounding sphere
             // ==> skip it
@@ -395,10 +413,7 @@ inline void RenderBoundingSpheres(entityx::EntityManager &entities,
 
         for (auto const &part : model->value->parts) {
             auto &mesh = *part.first;
-            if (mesh.needsUpdate) {
-                mesh.Update();
-                mesh.needsUpdate = false;
-            }
+            mesh.Update();
 
             if (frustum &&
                 frustum->ComputeIntersection(
@@ -425,7 +440,7 @@ inline void RenderSkydomes(entityx::EntityManager &entities,
     mat4 MVP;
 
     entityx::ComponentHandle<comp::Skydome> skydome;
-    for (auto entity : entities.entities_with_components(skydome)) {
+    for (auto entity : EntitiesWith(entities, skydome)) {
         MVP = P * V * glm::rotate(glm::radians(skydome->rotationDegrees), geometry::Up);
 
         shader.Texture("skydomeColor", nextTextureUnit, skydome->texture->texture);
@@ -434,10 +449,7 @@ inline void RenderSkydomes(entityx::EntityManager &entities,
         renderStats.UniformCalls += 3;
 
         auto &mesh = *skydome->mesh;
-        if (mesh.needsUpdate) {
-            mesh.Update();
-            mesh.needsUpdate = false;
-        }
+        mesh.Update();
 
         mesh.glMesh->DrawElements();
         renderStats.DrawCalls++;
@@ -448,8 +460,94 @@ inline void RenderSkydomes(entityx::EntityManager &entities,
     }
 }
 
+/**
+ * @tparam UploadHasMaps false for shader permutations, which compile in whether the maps exist, see MaterialFeature.
+ */
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true,
+        bool UploadHasMaps = true>
+inline void UploadMaterial(assets::Material const &material, comp::VctProperties const *vctProperties,
+                           gl::Shader &shader, GLenum const nextTextureUnit, RenderStats &renderStats) {
+    string const prefix = "material.";
+    auto textureCount = nextTextureUnit;
+
+    if (UseDiffuse) {
+        string const diffusePrefix = prefix + "diffuse.";
+        int hasDiffuseMap = (material.diffuseTexture != nullptr) ? 1 : 0;
+
+        shader.Uniform(diffusePrefix + "color", material.diffuseColor);
+        renderStats.UniformCalls += 2;
+        if (UploadHasMaps) {
+            shader.Uniform(diffusePrefix + "hasMap", hasDiffuseMap);
+            renderStats.UniformCalls++;
+        }
+
+        if (hasDiffuseMap == 1) {
+            shader.Texture(diffusePrefix + "map",
+                           textureCount++,
+                           material.diffuseTexture->texture);
+            renderStats.UniformCalls++;
+        }
+
+    }
+
+    if (UseSpecular) {
+        string const specularPrefix = prefix + "specular.";
+        int hasSpecularMap = (material.specularTexture != nullptr) ? 1 : 0;
+
+        shader.Uniform(specularPrefix + "color", material.specularColor);
+        renderStats.UniformCalls++;
+        if (UploadHasMaps) {
+            shader.Uniform(specularPrefix + "hasMap", hasSpecularMap);
+            renderStats.UniformCalls++;
+        }
+
+        if (hasSpecularMap == 1) {
+            shader.Texture(specularPrefix + "map",
+                           textureCount++,
+                           material.specularTexture->texture);
+            renderStats.UniformCalls++;
+        }
+    }
+
+    if (UseNormal) {
+        int hasNormalMap = (material.normalTexture != nullptr) ? 1 : 0;
+        if (UploadHasMaps) {
+            shader.Uniform(prefix + "hasNormalMap", hasNormalMap);
+            renderStats.UniformCalls++;
+        }
+
+        if (hasNormalMap == 1) {
+            shader.Texture(prefix + "normalMap",
+                           textureCount++,
+                           material.normalTexture->texture);
+            renderStats.UniformCalls++;
+        }
+    }
+
+    if (UseShininess) {
+        shader.Uniform(prefix + "shininess", material.shininess);
+        renderStats.UniformCalls++;
+    }
+
+    if (vctProperties) {
+        shader.Uniform(prefix + "radiance", vctProperties->radiance);
+        shader.Uniform(prefix + "specular.color", vec3(vctProperties->specularReflectance));
+        if (UploadHasMaps) {
+            shader.Uniform(prefix + "specular.hasMap", 0);
+        }
+        if (material.specularTexture != nullptr) {
+            textureCount--;
+        }
+
+        renderStats.UniformCalls += 2;
+    } else {
+        shader.Uniform(prefix + "radiance", 0.0f);
+        renderStats.UniformCalls++;
+    }
+}
+
 template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
-inline void RenderModel(comp::Transform &transform, comp::Model &model,
+inline void RenderModel(mat4 const &M, float scale, comp::Model &model,
                         comp::VctProperties const *vctProperties,
                         gl::Shader &shader, GLenum const nextTextureUnit,
                         RenderStats &renderStats, geometry::Frustum const *frustum) {
@@ -460,148 +558,474 @@ inline void RenderModel(comp::Transform &transform, comp::Model &model,
         return;
     }
 
-    auto const &M = transform.GetMatrix();
     shader.Uniform("M", M);
     renderStats.UniformCalls++;
 
     for (auto const &part : model.value->parts) {
         if (UseMaterial) {
-            string const prefix = "material.";
-            auto const &material = *part.second;
-            auto textureCount = nextTextureUnit;
-
-            if (UseDiffuse) {
-                string const diffusePrefix = prefix + "diffuse.";
-                int hasDiffuseMap = (material.diffuseTexture != nullptr) ? 1 : 0;
-
-                shader.Uniform(diffusePrefix + "color", material.diffuseColor);
-                shader.Uniform(diffusePrefix + "hasMap", hasDiffuseMap);
-                renderStats.UniformCalls += 3;
-
-                if (hasDiffuseMap == 1) {
-                    shader.Texture(diffusePrefix + "map",
-                                   textureCount++,
-                                   material.diffuseTexture->texture);
-                    renderStats.UniformCalls++;
-                }
+            UploadMaterial<UseDiffuse, UseSpecular, UseNormal, UseShininess>(*part.second, vctProperties,
+                                                                             shader, nextTextureUnit, renderStats);
+        }
+
+        if (RenderMesh) {
+            auto &mesh = *part.first;
+            mesh.Update();
 
+            if (frustum &&
+                frustum->ComputeIntersection(geometry::Transform(mesh.boundingSphere, M, scale)) ==
+                geometry::IntersectionType::OUTSIDE) {
+                renderStats.MeshesCulled++;
+                continue;
             }
 
-            if (UseSpecular) {
-                string const specularPrefix = prefix + "specular.";
-                int hasSpecularMap = (material.specularTexture != nullptr) ? 1 : 0;
+            mesh.glMesh->DrawElements();
+            renderStats.DrawCalls++;
+
+            renderStats.MeshesRendered++;
+            renderStats.Triangles += mesh.triangles.size();
+            renderStats.Vertices += mesh.vertices.size();
+        }
+    }
+};
+
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
+inline void RenderModel(comp::Transform &transform, comp::Model &model,
+                        comp::VctProperties const *vctProperties,
+                        gl::Shader &shader, GLenum const nextTextureUnit,
+                        RenderStats &renderStats, geometry::Frustum const *frustum) {
+    RenderModel<UseDiffuse, UseSpecular, UseNormal, UseShininess>(transform.GetMatrix(), transform.Scale(), model,
+                                                                  vctProperties, shader, nextTextureUnit,
+                                                                  renderStats, frustum);
+}
 
-                shader.Uniform(specularPrefix + "color", material.specularColor);
-                shader.Uniform(specularPrefix + "hasMap", hasSpecularMap);
-                renderStats.UniformCalls += 2;
+/**
+ * @brief Counts the models and meshes of the slots that RenderableStore::Cull() culled.
+ */
+inline void CountCulledModels(RenderableStore const &store, std::vector<uint32_t> const &culled,
+                              RenderStats &renderStats) {
+    for (auto const slot : culled) {
+        auto const &model = store.Model(slot);
+        renderStats.ModelsCulled++;
+        renderStats.MeshesCulled += (model.value ? model.value->parts.size() : 0);
+    }
+}
 
-                if (hasSpecularMap == 1) {
-                    shader.Texture(specularPrefix + "map",
-                                   textureCount++,
-                                   material.specularTexture->texture);
-                    renderStats.UniformCalls++;
-                }
-            }
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
+inline void RenderModels(entityx::EntityManager &entities,
+                         gl::Shader &shader, GLenum const nextTextureUnit,
+                         RenderStats &renderStats, geometry::Frustum const *frustum) {
+    auto &store = RenderableStore::Of(entities);
+    store.Update();
 
-            if (UseNormal) {
-                int hasNormalMap = (material.normalTexture != nullptr) ? 1 : 0;
-                shader.Uniform(prefix + "hasNormalMap", hasNormalMap);
-                renderStats.UniformCalls++;
+    std::vector<uint32_t> visible, culled;
+    store.Cull(frustum, visible, &culled);
+    CountCulledModels(store, culled, renderStats);
 
-                if (hasNormalMap == 1) {
-                    shader.Texture(prefix + "normalMap",
-                                   textureCount++,
-                                   material.normalTexture->texture);
-                    renderStats.UniformCalls++;
-                }
-            }
+    shader.Bind();
 
-            if (UseShininess) {
-                shader.Uniform(prefix + "shininess", material.shininess);
-                renderStats.UniformCalls++;
+    for (auto const slot : visible) {
+        RenderModel<UseDiffuse, UseSpecular, UseNormal, UseShininess>(store.Matrix(slot), store.Scale(slot),
+                                                                      store.Model(slot), store.VctProperties(slot),
+                                                                      shader, nextTextureUnit,
+                                                                      renderStats, frustum);
+        renderStats.ModelsRendered++;
+    }
+
+    shader.Unbind();
+}
+
+/**
+ * @brief Per-instance data read by common/InstanceAttributes.glsl.
+ */
+struct ModelInstance {
+    mat4 M;
+    vec4 vct;
+};
+
+static constexpr GLuint InstanceMatrixLocation = 5;
+static constexpr GLuint InstanceVctLocation = 9;
+
+/**
+ * @brief Sources the instance attributes of the mesh from ModelInstance's in the stream, starting at the offset.
+ */
+inline void BindInstanceAttributes(gl::Mesh &glMesh, gl::StreamBuffer const &stream, GLintptr offset) {
+    for (GLuint column = 0; column < 4; ++column) {
+        glMesh.InstanceAttribute(InstanceMatrixLocation + column, 4, GL_FLOAT, GL_FALSE,
+                                 sizeof(ModelInstance), stream.ID(),
+                                 offset + offsetof(ModelInstance, M) + column * sizeof(vec4));
+    }
+    glMesh.InstanceAttribute(InstanceVctLocation, 4, GL_FLOAT, GL_FALSE,
+                             sizeof(ModelInstance), stream.ID(), offset + offsetof(ModelInstance, vct));
+}
+
+/**
+ * @brief Disables the instance attributes again, the VAO of the mesh is shared with the passes that do not instance.
+ */
+inline void UnbindInstanceAttributes(gl::Mesh &glMesh) {
+    for (GLuint column = 0; column < 4; ++column) {
+        glMesh.DisableInstanceAttribute(InstanceMatrixLocation + column);
+    }
+    glMesh.DisableInstanceAttribute(InstanceVctLocation);
+}
+
+/**
+ * @brief Renders all entities with a Transform and a Model, drawing every part of a shared assets::Model once for all
+ * visible entities using it. The per-instance matrices and VctProperties are streamed through
+ * gl::StreamBuffer::PerFrame(), the shader has to read them from common/InstanceAttributes.glsl, e.g. through
+ * common/ModelMatrix.glsl with MODEL_INSTANCING defined.
+ *
+ * Models are only culled as a whole, RenderModels() also culls the meshes of a visible model on their own.
+ */
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
+inline void RenderModelsInstanced(entityx::EntityManager &entities,
+                                  gl::Shader &shader, GLenum const nextTextureUnit,
+                                  RenderStats &renderStats, geometry::Frustum const *frustum) {
+    static constexpr bool UseMaterial = UseDiffuse || UseSpecular || UseNormal || UseShininess;
+
+    auto &store = RenderableStore::Of(entities);
+    store.Update();
+
+    std::vector<uint32_t> visible, culled;
+    store.Cull(frustum, visible, &culled);
+    CountCulledModels(store, culled, renderStats);
+
+    std::unordered_map<assets::Model const *, std::vector<ModelInstance>> instancesByModel;
+
+    for (auto const slot : visible) {
+        auto const &model = store.Model(slot);
+        if (!model.value) {
+            continue;
+        }
+
+        vec4 vct(0, 0, 0, 0);
+        auto const vctProperties = store.VctProperties(slot);
+        if (vctProperties) {
+            vct = vec4(vctProperties->radiance, vctProperties->specularReflectance, 1, 0);
+        }
+
+        instancesByModel[model.value.get()].push_back(ModelInstance{store.Matrix(slot), vct});
+        renderStats.ModelsRendered++;
+    }
+
+    auto &stream = gl::StreamBuffer::PerFrame();
+
+    shader.Bind();
+
+    for (auto const &kvp : instancesByModel) {
+        auto const &instances = kvp.second;
+        auto const count = static_cast<GLsizei>(instances.size());
+
+        auto const allocation = stream.Write(instances.data(),
+                                             static_cast<GLsizeiptr>(sizeof(ModelInstance) * instances.size()));
+        if (!allocation) {
+            continue;
+        }
+
+        for (auto const &part : kvp.first->parts) {
+            if (UseMaterial) {
+                UploadMaterial<UseDiffuse, UseSpecular, UseNormal, UseShininess>(*part.second, nullptr,
+                                                                                 shader, nextTextureUnit,
+                                                                                 renderStats);
             }
 
-            if (vctProperties) {
-                shader.Uniform(prefix + "radiance", vctProperties->radiance);
-                shader.Uniform(prefix + "specular.color", vec3(vctProperties->specularReflectance));
-                shader.Uniform(prefix + "specular.hasMap", 0);
-                if (material.specularTexture != nullptr) {
-                    textureCount--;
-                }
+            auto &mesh = *part.first;
+            mesh.Update();
 
-                renderStats.UniformCalls += 2;
-            } else {
-                shader.Uniform(prefix + "radiance", 0.0f);
-                renderStats.UniformCalls++;
+            auto &glMesh = *mesh.glMesh;
+            BindInstanceAttributes(glMesh, stream, allocation.offset);
+            glMesh.DrawElementsInstanced(count);
+            UnbindInstanceAttributes(glMesh);
+            renderStats.DrawCalls++;
+
+            renderStats.MeshesRendered += instances.size();
+            renderStats.Triangles += mesh.triangles.size() * instances.size();
+            renderStats.Vertices += mesh.vertices.size() * instances.size();
+        }
+    }
+
+    shader.Unbind();
+}
+
+/**
+ * @brief Bits of a ShaderPermutations mask for shaders including common/Material.glsl.
+ */
+namespace MaterialFeature {
+enum : uint32_t {
+    DiffuseMap = 1u << 0,
+    SpecularMap = 1u << 1,
+    NormalMap = 1u << 2,
+};
+} // namespace MaterialFeature
+
+/**
+ * @returns The definitions corresponding to the MaterialFeature bits, in bit order.
+ */
+inline std::vector<string> const &MaterialFeatureDefines() {
+    static std::vector<string> const defines{
+            "MATERIAL_HAS_DIFFUSE_MAP",
+            "MATERIAL_HAS_SPECULAR_MAP",
+            "MATERIAL_HAS_NORMAL_MAP",
+    };
+    return defines;
+}
+
+/**
+ * @returns The MaterialFeature mask of the shader variant that renders the material, matching what UploadMaterial()
+ * uploads for it.
+ */
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true>
+inline uint32_t GetMaterialFeatures(assets::Material const &material, comp::VctProperties const *vctProperties) {
+    uint32_t features = 0;
+    if (UseDiffuse && material.diffuseTexture) {
+        features |= MaterialFeature::DiffuseMap;
+    }
+    if (UseSpecular && material.specularTexture && !vctProperties) {
+        features |= MaterialFeature::SpecularMap;
+    }
+    if (UseNormal && material.normalTexture) {
+        features |= MaterialFeature::NormalMap;
+    }
+    return features;
+}
+
+/**
+ * @brief Prepares a shader variant for drawing, called once per variant before its draws.
+ * @returns The next free texture unit.
+ */
+using ShaderVariantSetup = std::function<GLenum(gl::Shader &)>;
+
+/**
+ * @returns false for entities that should be skipped.
+ */
+using ModelFilter = std::function<bool(entityx::Entity)>;
+
+/**
+ * @returns true if a running animation moves the entity, i.e. its transform may change every frame.
+ */
+inline bool IsAnimated(entityx::Entity entity) {
+    auto const velocity = entity.component<comp::VelocityAnimation>();
+    auto const periodical = entity.component<comp::PeriodicalAnimation>();
+    return (velocity && velocity->isRunning) || (periodical && periodical->isRunning);
+}
+
+/**
+ * @returns The MaterialFeature masks of the parts of every model in the store, as RenderModels() selects its variants,
+ * or as RenderModelsInstanced() does if the VctProperties are ignored.
+ */
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true>
+inline std::vector<uint32_t> GetStoredMaterialFeatures(RenderableStore const &store, bool ignoreVctProperties = false) {
+    std::vector<uint32_t> features;
+    for (uint32_t slot = 0; slot < store.Size(); ++slot) {
+        auto const &model = store.Model(slot);
+        if (!model.value) {
+            continue;
+        }
+
+        auto const vctProperties = ignoreVctProperties ? nullptr : store.VctProperties(slot);
+        for (auto const &part : model.value->parts) {
+            auto const mask = GetMaterialFeatures<UseDiffuse, UseSpecular, UseNormal>(*part.second, vctProperties);
+            if (std::find(features.begin(), features.end(), mask) == features.end()) {
+                features.push_back(mask);
             }
+        }
+    }
+    return features;
+}
+
+/**
+ * @brief Builds the requested variants together, so that the driver compiles them concurrently before anything is
+ * drawn with them. If any of them fails, ShaderPermutations::Get() builds the others on their own.
+ */
+inline void BuildVariants(std::vector<ShaderProgramDescription> const &requests) {
+    if (!requests.empty()) {
+        LoadShadersAsync(requests).Finish();
+    }
+}
+
+/**
+ * @brief Like RenderModels(), but renders every model part with the variant of the permutations that matches its
+ * material. Parts are grouped by variant, so that each variant is bound and set up only once.
+ */
+template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
+inline void RenderModels(entityx::EntityManager &entities,
+                         ShaderPermutations &permutations, ShaderVariantSetup const &setupVariant,
+                         RenderStats &renderStats, geometry::Frustum const *frustum = nullptr,
+                         ModelFilter const &filter = nullptr) {
+    static constexpr bool UseMaterial = UseDiffuse || UseSpecular || UseNormal || UseShininess;
 
+    struct PartDraw {
+        uint32_t slot;
+        assets::Mesh *mesh;
+        assets::Material const *material;
+        comp::VctProperties const *vctProperties;
+    };
+
+    auto &store = RenderableStore::Of(entities);
+    store.Update();
+
+    std::vector<uint32_t> visible, culled;
+    store.Cull(frustum, visible, &culled);
+    CountCulledModels(store, culled, renderStats);
+
+    std::unordered_map<uint32_t, std::vector<PartDraw>> drawsByFeatures;
+
+    for (auto const slot : visible) {
+        auto const &model = store.Model(slot);
+        if (!model.value || (filter && !filter(store.Entity(slot)))) {
+            continue;
         }
 
-        if (RenderMesh) {
+        auto const &M = store.Matrix(slot);
+        auto const vctProperties = store.VctProperties(slot);
+
+        for (auto const &part : model.value->parts) {
             auto &mesh = *part.first;
-            if (mesh.needsUpdate) {
-                mesh.Update();
-                mesh.needsUpdate = false;
-            }
+            mesh.Update();
 
             if (frustum &&
-                frustum->ComputeIntersection(geometry::Transform(mesh.boundingSphere, M, transform.Scale())) ==
+                frustum->ComputeIntersection(geometry::Transform(mesh.boundingSphere, M, store.Scale(slot))) ==
                 geometry::IntersectionType::OUTSIDE) {
                 renderStats.MeshesCulled++;
                 continue;
             }
 
-            mesh.glMesh->DrawElements();
+            auto const features = GetMaterialFeatures<UseDiffuse, UseSpecular, UseNormal>(*part.second,
+                                                                                           vctProperties);
+            drawsByFeatures[features].push_back(PartDraw{slot, &mesh, part.second.get(), vctProperties});
+        }
+
+        renderStats.ModelsRendered++;
+    }
+
+    for (auto const &kvp : drawsByFeatures) {
+        auto const &shader = permutations.Get(kvp.first);
+        if (!shader) {
+            continue;
+        }
+
+        shader->Bind();
+        auto const nextTextureUnit = setupVariant(*shader);
+
+        auto lastSlot = std::numeric_limits<uint32_t>::max();
+        for (auto const &draw : kvp.second) {
+            // consecutive parts of the same model share the matrix
+            if (draw.slot != lastSlot) {
+                shader->Uniform("M", store.Matrix(draw.slot));
+                renderStats.UniformCalls++;
+                lastSlot = draw.slot;
+            }
+
+            if (UseMaterial) {
+                UploadMaterial<UseDiffuse, UseSpecular, UseNormal, UseShininess, false>(
+                        *draw.material, draw.vctProperties, *shader, nextTextureUnit, renderStats);
+            }
+
+            draw.mesh->glMesh->DrawElements();
             renderStats.DrawCalls++;
 
             renderStats.MeshesRendered++;
-            renderStats.Triangles += mesh.triangles.size();
-            renderStats.Vertices += mesh.vertices.size();
+            renderStats.Triangles += draw.mesh->triangles.size();
+            renderStats.Vertices += draw.mesh->vertices.size();
         }
+
+        shader->Unbind();
     }
-};
+}
 
+/**
+ * @brief Like RenderModelsInstanced(), but draws every model part with the variant of the permutations that matches
+ * its material. Parts are grouped by variant, so that each variant is bound and set up only once.
+ */
 template<bool UseDiffuse = true, bool UseSpecular = true, bool UseNormal = true, bool UseShininess = true>
-inline void RenderModels(entityx::EntityManager &entities,
-                         gl::Shader &shader, GLenum const nextTextureUnit,
-                         RenderStats &renderStats, geometry::Frustum const *frustum) {
-    entityx::ComponentHandle<comp::Transform> transform;
-    entityx::ComponentHandle<comp::Model> model;
+inline void RenderModelsInstanced(entityx::EntityManager &entities,
+                                  ShaderPermutations &permutations, ShaderVariantSetup const &setupVariant,
+                                  RenderStats &renderStats, geometry::Frustum const *frustum = nullptr,
+                                  ModelFilter const &filter = nullptr) {
+    static constexpr bool UseMaterial = UseDiffuse || UseSpecular || UseNormal || UseShininess;
 
-    shader.Bind();
+    struct PartDraw {
+        assets::Mesh *mesh;
+        assets::Material const *material;
+        GLintptr instancesOffset;
+        GLsizei instanceCount;
+    };
 
-    for (auto entity : entities.entities_with_components(transform, model)) {
-        if (frustum) {
-            auto boundingSphere = entity.component<comp::BoundingSphere>();
-            if (!boundingSphere) {
-                boundingSphere = entity.assign<comp::BoundingSphere>();
-                boundingSphere->Reset(*model);
-            }
+    auto &store = RenderableStore::Of(entities);
+    store.Update();
 
-            auto const &M = transform->GetMatrix();
-            auto intersection = frustum->ComputeIntersection(
-                    geometry::Transform(boundingSphere->sphere, M, transform->Scale()));
+    std::vector<uint32_t> visible, culled;
+    store.Cull(frustum, visible, &culled);
+    CountCulledModels(store, culled, renderStats);
 
-            if (intersection == geometry::IntersectionType::OUTSIDE) {
-                renderStats.ModelsCulled++;
-                renderStats.MeshesCulled += (model->value ? model->value->parts.size() : 0);
-                continue;
-            }
+    std::unordered_map<assets::Model const *, std::vector<ModelInstance>> instancesByModel;
+
+    for (auto const slot : visible) {
+        auto const &model = store.Model(slot);
+        if (!model.value || (filter && !filter(store.Entity(slot)))) {
+            continue;
         }
 
-        comp::VctProperties *vctProperties = nullptr;
-        auto c = entity.component<comp::VctProperties>();
-        if (c) {
-            vctProperties = &(*c);
+        vec4 vct(0, 0, 0, 0);
+        auto const vctProperties = store.VctProperties(slot);
+        if (vctProperties) {
+            vct = vec4(vctProperties->radiance, vctProperties->specularReflectance, 1, 0);
         }
 
-        RenderModel<UseDiffuse, UseSpecular, UseNormal, UseShininess>(*transform, *model,
-                                                                      vctProperties,
-                                                                      shader, nextTextureUnit,
-                                                                      renderStats, frustum);
+        instancesByModel[model.value.get()].push_back(ModelInstance{store.Matrix(slot), vct});
         renderStats.ModelsRendered++;
     }
 
-    shader.Unbind();
+    auto &stream = gl::StreamBuffer::PerFrame();
+
+    // the VctProperties override is per instance, so the variant only depends on the material
+    std::unordered_map<uint32_t, std::vector<PartDraw>> drawsByFeatures;
+
+    for (auto const &kvp : instancesByModel) {
+        auto const &instances = kvp.second;
+
+        auto const allocation = stream.Write(instances.data(),
+                                             static_cast<GLsizeiptr>(sizeof(ModelInstance) * instances.size()));
+        if (!allocation) {
+            continue;
+        }
+
+        for (auto const &part : kvp.first->parts) {
+            auto const features = GetMaterialFeatures<UseDiffuse, UseSpecular, UseNormal>(*part.second, nullptr);
+            drawsByFeatures[features].push_back(PartDraw{part.first.get(), part.second.get(), allocation.offset,
+                                                         static_cast<GLsizei>(instances.size())});
+        }
+    }
+
+    for (auto const &kvp : drawsByFeatures) {
+        auto const &shader = permutations.Get(kvp.first);
+        if (!shader) {
+            continue;
+        }
+
+        shader->Bind();
+        auto const nextTextureUnit = setupVariant(*shader);
+
+        for (auto const &draw : kvp.second) {
+            if (UseMaterial) {
+                UploadMaterial<UseDiffuse, UseSpecular, UseNormal, UseShininess, false>(
+                        *draw.material, nullptr, *shader, nextTextureUnit, renderStats);
+            }
+
+            auto &mesh = *draw.mesh;
+            mesh.Update();
+
+            auto &glMesh = *mesh.glMesh;
+            BindInstanceAttributes(glMesh, stream, draw.instancesOffset);
+            glMesh.DrawElementsInstanced(draw.instanceCount);
+            UnbindInstanceAttributes(glMesh);
+            renderStats.DrawCalls++;
+
+            renderStats.MeshesRendered += draw.instanceCount;
+            renderStats.Triangles += mesh.triangles.size() * draw.instanceCount;
+            renderStats.Vertices += mesh.vertices.size() * draw.instanceCount;
+        }
+
+        shader->Unbind();
+    }
 }
 } // namespace cfl
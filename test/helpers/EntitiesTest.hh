@@ -0,0 +1,23 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <conflagrant/ComponentView.hh>
+
+/**
+ * @brief A test fixture with an EntityManager that has ComponentViews attached.
+ */
+struct EntitiesTest : public ::testing::Test {
+    entityx::EventManager events;
+    entityx::EntityManager entities{events};
+    cfl::ComponentViews views{entities, events};
+};
+
+/**
+ * @brief Like EntitiesTest, along with a cache of the ComponentViews.
+ * @tparam TCache Has a static Of(entityx::EntityManager &) that returns the cache of the attached ComponentViews.
+ */
+template<typename TCache>
+struct CacheTest : public EntitiesTest {
+    TCache &cache{TCache::Of(entities)};
+};
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include <EntitiesTest.hh>
+
+#include <conflagrant/ActiveCameraCache.hh>
+#include <conflagrant/ComponentView.hh>
+#include <conflagrant/events.hh>
+
+using cfl::ActiveCameraCache;
+
+namespace {
+struct ActiveCameraCacheTest : public CacheTest<ActiveCameraCache>, public entityx::Receiver<ActiveCameraCacheTest> {
+
+    std::vector<cfl::event::CameraChanged> changes;
+
+    ActiveCameraCacheTest() {
+        events.subscribe<cfl::event::CameraChanged>(*this);
+    }
+
+    void receive(cfl::event::CameraChanged const &event) {
+        changes.push_back(event);
+    }
+
+    entityx::Entity CreateCamera() {
+        auto entity = entities.create();
+        entity.assign<cfl::comp::Transform>();
+        entity.assign<cfl::comp::PerspectiveCamera>();
+        return entity;
+    }
+};
+} // namespace
+
+TEST_F(ActiveCameraCacheTest, ActivatesTheFirstCamera) {
+    auto const a = CreateCamera();
+    CreateCamera();
+
+    cache.Update();
+    EXPECT_EQ(a, cache.Camera());
+    EXPECT_TRUE(a.has_component<cfl::comp::ActiveCamera>());
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_FALSE(changes[0].oldCamera.valid());
+    EXPECT_EQ(a, changes[0].newCamera);
+
+    cache.Update();
+    EXPECT_EQ(1u, changes.size());
+}
+
+TEST_F(ActiveCameraCacheTest, CreatesACameraIfThereIsNone) {
+    cache.Update();
+    ASSERT_TRUE(cache.Camera().valid());
+    EXPECT_TRUE(cache.Perspective());
+    EXPECT_EQ(cache.Transform()->Position(), cache.Camera().component<cfl::comp::Transform>()->Position());
+}
+
+TEST_F(ActiveCameraCacheTest, FollowsTheTransformAndProjection) {
+    auto const a = CreateCamera();
+    cache.Update();
+    changes.clear();
+
+    a.component<cfl::comp::Transform>()->Position(cfl::vec3(1, 2, 3));
+    cache.Update();
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(a, changes[0].oldCamera);
+    EXPECT_EQ(a, changes[0].newCamera);
+    EXPECT_EQ(cfl::vec3(-1, -2, -3), cfl::vec3(cache.View()[3]));
+
+    a.component<cfl::comp::PerspectiveCamera>()->ZFar(50);
+    cache.Update();
+    EXPECT_EQ(2u, changes.size());
+    EXPECT_EQ(50, cache.ZFar());
+}
+
+TEST_F(ActiveCameraCacheTest, SwitchesCameraWhenActiveCameraChanges) {
+    auto a = CreateCamera();
+    auto b = CreateCamera();
+    cache.Update();
+    EXPECT_EQ(a, cache.Camera());
+
+    a.remove<cfl::comp::ActiveCamera>();
+    a.remove<cfl::comp::PerspectiveCamera>();
+    b.assign<cfl::comp::ActiveCamera>();
+    cache.Update();
+    EXPECT_EQ(b, cache.Camera());
+    ASSERT_EQ(2u, changes.size());
+    EXPECT_EQ(a, changes[1].oldCamera);
+
+    b.destroy();
+    cache.Update();
+    EXPECT_NE(b, cache.Camera());
+    EXPECT_TRUE(cache.Camera().valid());
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include <EntitiesTest.hh>
+
+#include <conflagrant/ChangeJournal.hh>
+#include <conflagrant/ComponentView.hh>
+
+using cfl::ChangeJournal;
+
+namespace {
+class Tracked : public cfl::JournaledComponent {
+    int value{0};
+
+public:
+    inline void Value(int newValue) {
+        value = newValue;
+        RecordChange();
+    }
+};
+
+struct Untracked {
+    int value{0};
+};
+
+struct ChangeJournalTest : public CacheTest<ChangeJournal> {
+
+    ChangeJournalTest() {
+        cache.Track<Tracked>(events);
+    }
+
+    std::vector<entityx::Entity::Id> ChangedSince(uint64_t frame) {
+        std::vector<entityx::Entity::Id> changed;
+        EXPECT_TRUE(cache.ChangedSince<Tracked>(frame, changed));
+        return changed;
+    }
+};
+} // namespace
+
+TEST_F(ChangeJournalTest, RecordsWritesThroughSetters) {
+    auto a = entities.create();
+    auto b = entities.create();
+    a.assign<Tracked>();
+    b.assign<Tracked>();
+    cache.NextFrame();
+
+    auto const frame = cache.Frame();
+    EXPECT_TRUE(ChangedSince(frame).empty());
+
+    b.component<Tracked>()->Value(1);
+    b.component<Tracked>()->Value(2);
+    EXPECT_EQ(std::vector<entityx::Entity::Id>({b.id()}), ChangedSince(frame));
+
+    // written twice in the frame, recorded once with the latest generation
+    std::vector<ChangeJournal::Change> changes;
+    EXPECT_TRUE(cache.ChangedSince(frame, changes));
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(b.component<Tracked>()->Generation(), changes[0].generation);
+    EXPECT_EQ(frame, changes[0].frame);
+
+    cache.NextFrame();
+    a.component<Tracked>()->Value(3);
+    EXPECT_EQ(std::vector<entityx::Entity::Id>({a.id()}), ChangedSince(cache.Frame()));
+    EXPECT_EQ(2u, ChangedSince(frame).size());
+}
+
+TEST_F(ChangeJournalTest, RecordsAssignmentRemovalAndOtherComponents) {
+    auto const frame = cache.Frame();
+    auto a = entities.create();
+    a.assign<Tracked>();
+    a.assign<Untracked>();
+    EXPECT_EQ(std::vector<entityx::Entity::Id>({a.id()}), ChangedSince(frame));
+
+    cache.NextFrame();
+    a.remove<Tracked>();
+    EXPECT_EQ(std::vector<entityx::Entity::Id>({a.id()}), ChangedSince(cache.Frame()));
+
+    cache.NextFrame();
+    std::vector<entityx::Entity::Id> changed;
+    EXPECT_TRUE(cache.ChangedSince<Untracked>(cache.Frame(), changed));
+    EXPECT_TRUE(changed.empty());
+    cache.Record<Untracked>(a);
+    EXPECT_TRUE(cache.ChangedSince<Untracked>(cache.Frame(), changed));
+    EXPECT_EQ(std::vector<entityx::Entity::Id>({a.id()}), changed);
+}
+
+TEST_F(ChangeJournalTest, ForgetsOldFrames) {
+    auto a = entities.create();
+    a.assign<Tracked>();
+
+    for (uint64_t i = 0; i < ChangeJournal::HistoryFrames; ++i) {
+        cache.NextFrame();
+    }
+    EXPECT_EQ(1u, ChangedSince(0).size());
+
+    cache.NextFrame();
+    std::vector<ChangeJournal::Change> changes;
+    EXPECT_FALSE(cache.ChangedSince(0, changes));
+    EXPECT_TRUE(cache.ChangedSince(1, changes));
+    EXPECT_TRUE(changes.empty());
+}
+
+TEST_F(ChangeJournalTest, CopiesBelongToNoEntity) {
+    auto a = entities.create();
+    a.assign<Tracked>();
+    cache.NextFrame();
+
+    auto copy = *a.component<Tracked>();
+    copy.Value(1);
+    EXPECT_TRUE(ChangedSince(cache.Frame()).empty());
+
+    *a.component<Tracked>() = copy;
+    EXPECT_EQ(std::vector<entityx::Entity::Id>({a.id()}), ChangedSince(cache.Frame()));
+}
+
+TEST_F(ChangeJournalTest, AssigningAStaleCopyIncreasesTheGeneration) {
+    auto a = entities.create();
+    auto tracked = a.assign<Tracked>();
+
+    auto const stale = *tracked;
+    tracked->Value(1);
+    auto const generation = tracked->Generation();
+
+    *tracked = stale;
+    EXPECT_GT(tracked->Generation(), generation);
+}
@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+#include <EntitiesTest.hh>
+
+#include <conflagrant/ComponentView.hh>
+
+#include <algorithm>
+
+using cfl::ComponentViews;
+using cfl::EntitiesWith;
+
+namespace {
+struct Position {
+    Position(float x = 0) : x(x) {}
+
+    float x;
+};
+
+struct Velocity {
+    Velocity(float x = 0) : x(x) {}
+
+    float x;
+};
+
+struct ComponentViewTest : public EntitiesTest {
+
+    std::vector<uint32_t> Indices() {
+        std::vector<uint32_t> indices;
+        entityx::ComponentHandle<Position> position;
+        entityx::ComponentHandle<Velocity> velocity;
+        for (auto entity : EntitiesWith(entities, position, velocity)) {
+            EXPECT_TRUE(position);
+            EXPECT_TRUE(velocity);
+            indices.push_back(entity.id().index());
+        }
+        return indices;
+    }
+};
+} // namespace
+
+TEST_F(ComponentViewTest, ContainsExistingEntities) {
+    auto a = entities.create();
+    a.assign<Position>(1);
+    a.assign<Velocity>(2);
+    entities.create().assign<Position>(3);
+
+    entityx::ComponentHandle<Position> position;
+    entityx::ComponentHandle<Velocity> velocity;
+    int count = 0;
+    for (auto entity : EntitiesWith(entities, position, velocity)) {
+        EXPECT_EQ(a.id(), entity.id());
+        EXPECT_EQ(1, position->x);
+        EXPECT_EQ(2, velocity->x);
+        ++count;
+    }
+    EXPECT_EQ(1, count);
+    auto &view = views.Get<Position, Velocity>();
+    EXPECT_EQ(&view, (&views.Get<Position, Velocity>()));
+    EXPECT_EQ(1u, view.Size());
+    EXPECT_EQ(2u, views.Get<Position>().Size());
+}
+
+TEST_F(ComponentViewTest, FollowsComponentsAndEntities) {
+    EXPECT_TRUE(Indices().empty());
+
+    std::vector<entityx::Entity> created;
+    for (int i = 0; i < 6; ++i) {
+        created.push_back(entities.create());
+        created.back().assign<Velocity>();
+    }
+
+    // gaining the components in reverse order, the view is still iterated by index
+    for (int i = 5; i >= 0; --i) {
+        created[i].assign<Position>();
+    }
+    EXPECT_EQ(std::vector<uint32_t>({0, 1, 2, 3, 4, 5}), Indices());
+
+    created[1].remove<Position>();
+    created[3].destroy();
+    EXPECT_EQ(std::vector<uint32_t>({0, 2, 4, 5}), Indices());
+
+    // the destroyed entity's index is reused
+    auto reused = entities.create();
+    reused.assign<Position>();
+    EXPECT_EQ(std::vector<uint32_t>({0, 2, 4, 5}), Indices());
+    reused.assign<Velocity>();
+    EXPECT_EQ(4u + 1, Indices().size());
+
+    auto const indices = Indices();
+    EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+}
+
+TEST_F(ComponentViewTest, RemovingWhileIterating) {
+    for (int i = 0; i < 4; ++i) {
+        auto entity = entities.create();
+        entity.assign<Position>();
+        entity.assign<Velocity>();
+    }
+
+    entityx::ComponentHandle<Position> position;
+    entityx::ComponentHandle<Velocity> velocity;
+    for (auto entity : EntitiesWith(entities, position, velocity)) {
+        entity.remove<Velocity>();
+    }
+    EXPECT_LT(Indices().size(), 4u);
+
+    for (auto entity : EntitiesWith(entities, position, velocity)) {
+        entity.destroy();
+    }
+    for (auto entity : EntitiesWith(entities, position, velocity)) {
+        entity.destroy();
+    }
+    EXPECT_TRUE(Indices().empty());
+}
+
+TEST(ComponentViewsTest, AttachedToTheirEntityManager) {
+    entityx::EventManager events;
+    entityx::EntityManager entities(events);
+    EXPECT_EQ(nullptr, ComponentViews::Of(entities));
+
+    {
+        ComponentViews views(entities, events);
+        EXPECT_EQ(&views, ComponentViews::Of(entities));
+    }
+    EXPECT_EQ(nullptr, ComponentViews::Of(entities));
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/CpuVoxelizer.hh>
+#include <conflagrant/SparseVoxelOctree.hh>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+
+using cfl::CpuVoxelizer;
+using cfl::VoxelizerTriangle;
+using cfl::VoxelVolume;
+
+namespace {
+VoxelizerTriangle MakeTriangle(cfl::vec3 const &a, cfl::vec3 const &b, cfl::vec3 const &c,
+                               cfl::vec3 const &diffuse) {
+    cfl::vec3 const up(0, 1, 0);
+    return VoxelizerTriangle{{a, b, c}, {up, up, up}, diffuse, 0};
+}
+
+void ExpectColorNear(cfl::vec4 const &expected, cfl::vec4 const &actual, float tolerance = 1.5f / 255) {
+    EXPECT_NEAR(expected.r, actual.r, tolerance);
+    EXPECT_NEAR(expected.g, actual.g, tolerance);
+    EXPECT_NEAR(expected.b, actual.b, tolerance);
+    EXPECT_NEAR(expected.a, actual.a, tolerance);
+}
+
+std::vector<VoxelizerTriangle> RandomTriangles(size_t count, float extent) {
+    std::mt19937 random(1337);
+    std::uniform_real_distribution<float> coordinate(-extent, extent);
+    std::uniform_real_distribution<float> channel(0, 1);
+
+    auto const point = [&]() {
+        return cfl::vec3(coordinate(random), coordinate(random), coordinate(random));
+    };
+
+    std::vector<VoxelizerTriangle> triangles;
+    for (size_t i = 0; i < count; ++i) {
+        auto const a = point();
+        auto const diffuse = cfl::vec3(channel(random), channel(random), channel(random));
+        triangles.push_back(MakeTriangle(a, a + 0.2f * point(), a + 0.2f * point(), diffuse));
+    }
+    return triangles;
+}
+} // namespace
+
+TEST(CpuVoxelizerTest, AverageIntoKeepsRunningAverageAndCount) {
+    uint32_t voxel = 0;
+    CpuVoxelizer::AverageInto(voxel, cfl::vec3(1, 0, 0));
+    ExpectColorNear(cfl::vec4(1, 0, 0, 1.0f / 255), cfl::SparseVoxelOctree::UnpackColor(voxel), 0);
+
+    CpuVoxelizer::AverageInto(voxel, cfl::vec3(0, 0, 1));
+    ExpectColorNear(cfl::vec4(0.5f, 0, 0.5f, 2.0f / 255), cfl::SparseVoxelOctree::UnpackColor(voxel));
+}
+
+TEST(CpuVoxelizerTest, OverlapsSeparatesByEveryAxis) {
+    cfl::vec3 const center(0, 0, 0), halfDimensions(0.5f);
+
+    // through the box, above it, and diagonally past one of its corners
+    EXPECT_TRUE(CpuVoxelizer::Overlaps({cfl::vec3(-2, 0, -2), cfl::vec3(2, 0, -2), cfl::vec3(0, 0, 2)},
+                                       center, halfDimensions));
+    EXPECT_FALSE(CpuVoxelizer::Overlaps({cfl::vec3(-2, 1, -2), cfl::vec3(2, 1, -2), cfl::vec3(0, 1, 2)},
+                                        center, halfDimensions));
+    EXPECT_FALSE(CpuVoxelizer::Overlaps({cfl::vec3(0.7f, 0.7f, -1), cfl::vec3(0.7f, 0.7f, 1), cfl::vec3(2, 0, 0)},
+                                        center, halfDimensions));
+}
+
+TEST(CpuVoxelizerTest, ClosestPointFindsInteriorAndVertices) {
+    std::array<cfl::vec3, 3> const triangle{cfl::vec3(0, 0, 0), cfl::vec3(1, 0, 0), cfl::vec3(0, 0, 1)};
+
+    auto const interior = CpuVoxelizer::ClosestPoint(triangle, cfl::vec3(0.25f, 3, 0.25f));
+    EXPECT_NEAR(0.5f, interior.x, 1e-5f);
+    EXPECT_NEAR(0.25f, interior.y, 1e-5f);
+    EXPECT_NEAR(0.25f, interior.z, 1e-5f);
+
+    auto const vertex = CpuVoxelizer::ClosestPoint(triangle, cfl::vec3(2, 0, -1));
+    EXPECT_EQ(1.0f, vertex.y);
+}
+
+TEST(CpuVoxelizerTest, FloorFillsOneLayer) {
+    VoxelVolume volume(8, cfl::vec3(0, 0, 0), 1);
+
+    // a floor across the whole volume, in the middle of the voxels of layer 2
+    float const y = -1 + 2.5f * 0.25f;
+    CpuVoxelizer::Voxelize({MakeTriangle(cfl::vec3(-1, y, -1), cfl::vec3(1, y, -1), cfl::vec3(1, y, 1),
+                                         cfl::vec3(1, 0, 0)),
+                            MakeTriangle(cfl::vec3(-1, y, -1), cfl::vec3(1, y, 1), cfl::vec3(-1, y, 1),
+                                         cfl::vec3(0, 0, 1))}, nullptr, volume);
+
+    for (uint32_t z = 0; z < 8; ++z) {
+        for (uint32_t y = 0; y < 8; ++y) {
+            for (uint32_t x = 0; x < 8; ++x) {
+                auto const texel = volume.Texel(cfl::uvec3(x, y, z));
+                if (y != 2) {
+                    ExpectColorNear(cfl::vec4(0), texel, 0);
+                } else if (std::abs(static_cast<int>(x) - static_cast<int>(z)) <= 1) {
+                    // both triangles overlap the voxels along the diagonal, and touch the corners of their neighbours
+                    ExpectColorNear(cfl::vec4(0.5f, 0, 0.5f, 2.0f / 255), texel);
+                } else {
+                    ExpectColorNear(x > z ? cfl::vec4(1, 0, 0, 1.0f / 255) : cfl::vec4(0, 0, 1, 1.0f / 255), texel);
+                }
+            }
+        }
+    }
+}
+
+TEST(CpuVoxelizerTest, ShadingFunctionSeesTheClosestPoint) {
+    VoxelVolume volume(4, cfl::vec3(0, 0, 0), 1);
+
+    CpuVoxelizer::Voxelize({MakeTriangle(cfl::vec3(-1, 0.1f, -1), cfl::vec3(1, 0.1f, -1), cfl::vec3(-1, 0.1f, 1),
+                                         cfl::vec3(1))},
+                           [](cfl::vec3 const &position, cfl::vec3 const &normal, VoxelizerTriangle const &) {
+                               // encode the position, which has to be on the triangle
+                               return cfl::vec3(0.5f * position.x + 0.5f, position.y, normal.y);
+                           }, volume);
+
+    auto const texel = volume.Texel(cfl::uvec3(0, 2, 0));
+    EXPECT_NEAR(0.125f, texel.r, 1.0f / 255);
+    EXPECT_NEAR(0.1f, texel.g, 1.0f / 255);
+    EXPECT_NEAR(1.0f, texel.b, 1.0f / 255);
+}
+
+TEST(CpuVoxelizerTest, ResultDoesNotDependOnThreadCount) {
+    auto const triangles = RandomTriangles(300, 1);
+
+    VoxelVolume serial(32, cfl::vec3(0, 0, 0), 1), parallel(32, cfl::vec3(0, 0, 0), 1);
+    CpuVoxelizer::Voxelize(triangles, nullptr, serial, 1);
+    CpuVoxelizer::Voxelize(triangles, nullptr, parallel, 4);
+
+    EXPECT_EQ(serial.Level(0), parallel.Level(0));
+
+    serial.GenerateMipmaps(5, 1);
+    parallel.GenerateMipmaps(5, 4);
+    ASSERT_EQ(6u, serial.NumLevels());
+    for (size_t level = 1; level < serial.NumLevels(); ++level) {
+        EXPECT_EQ(serial.Level(level), parallel.Level(level));
+    }
+}
+
+TEST(CpuVoxelizerTest, MipmapsMatchSparseVoxelOctree) {
+    uint32_t const levels = 4;
+    VoxelVolume volume(1u << levels, cfl::vec3(0, 0, 0), 1);
+    CpuVoxelizer::Voxelize(RandomTriangles(100, 1), nullptr, volume);
+    volume.GenerateMipmaps(levels);
+
+    // one fragment per voxel with the averaged color, so that the octree leaves are the same as level 0
+    std::vector<cfl::VoxelFragment> fragments;
+    for (uint32_t z = 0; z < volume.Resolution(); ++z) {
+        for (uint32_t y = 0; y < volume.Resolution(); ++y) {
+            for (uint32_t x = 0; x < volume.Resolution(); ++x) {
+                auto const texel = volume.Texel(cfl::uvec3(x, y, z));
+                if (texel.a > 0) {
+                    fragments.push_back(cfl::VoxelFragment{
+                            cfl::VoxelFragment::PackPosition(cfl::uvec3(x, y, z)),
+                            cfl::SparseVoxelOctree::PackColor(cfl::vec4(texel.r, texel.g, texel.b, 1.0f / 255))});
+                }
+            }
+        }
+    }
+    ASSERT_FALSE(fragments.empty());
+
+    cfl::SparseVoxelOctree octree(levels);
+    octree.Build(fragments);
+
+    for (uint32_t level = 1; level <= levels; ++level) {
+        auto const side = volume.LevelResolution(level);
+        for (uint32_t z = 0; z < side; ++z) {
+            for (uint32_t y = 0; y < side; ++y) {
+                for (uint32_t x = 0; x < side; ++x) {
+                    ExpectColorNear(octree.Lookup(cfl::uvec3(x, y, z) * (1u << level), level),
+                                    volume.Texel(cfl::uvec3(x, y, z), level));
+                }
+            }
+        }
+    }
+}
+
+TEST(CpuVoxelizerTest, SaveAndLoadRoundTrip) {
+    VoxelVolume volume(16, cfl::vec3(1, 2, 3), 4);
+    CpuVoxelizer::Voxelize(RandomTriangles(50, 4), nullptr, volume);
+    volume.GenerateMipmaps(3);
+    volume.ContentHash(0x0123456789abcdefull);
+
+    auto const path = ::testing::TempDir() + "test_CpuVoxelizer.cflv";
+    ASSERT_TRUE(volume.Save(path));
+
+    VoxelVolume loaded;
+    ASSERT_TRUE(VoxelVolume::Load(path, loaded));
+    std::remove(path.c_str());
+
+    EXPECT_TRUE(loaded.Matches(16, cfl::vec3(1, 2, 3), 4));
+    EXPECT_EQ(0x0123456789abcdefull, loaded.ContentHash());
+    ASSERT_EQ(volume.NumLevels(), loaded.NumLevels());
+    for (size_t level = 0; level < volume.NumLevels(); ++level) {
+        EXPECT_EQ(volume.Level(level), loaded.Level(level));
+    }
+}
+
+TEST(CpuVoxelizerTest, LoadRejectsOtherFiles) {
+    auto const path = ::testing::TempDir() + "test_CpuVoxelizer_invalid.cflv";
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << "not a voxel volume";
+    }
+
+    VoxelVolume loaded(4, cfl::vec3(0, 0, 0), 1);
+    EXPECT_FALSE(VoxelVolume::Load(path, loaded));
+    EXPECT_TRUE(loaded.Matches(4, cfl::vec3(0, 0, 0), 1));
+    std::remove(path.c_str());
+}
@@ -4,6 +4,8 @@
 #include <conflagrant/ComponentFactory.hh>
 #include <conflagrant/SystemFactory.hh>
 
+#include <algorithm>
+
 struct DummyWindow : public cfl::Window {
     void SetKeyCallback(KeyCallback callback) override {}
 
@@ -11,6 +13,14 @@ struct DummyWindow : public cfl::Window {
 
     void SetMousePosCallback(MousePosCallback callback) override {}
 
+    bool SetCursorMode(cfl::CursorMode mode) const override {
+        return true;
+    }
+
+    cfl::CursorMode GetCursorMode() const override {
+        return cfl::CursorMode::NORMAL;
+    }
+
     bool MakeContextCurrent() override {
         return true;
     }
@@ -23,11 +33,15 @@ struct DummyWindow : public cfl::Window {
         return true;
     }
 
+    int GetSwapInterval() const override {
+        return 0;
+    }
+
     bool BeginFrame() override {
         return false;
     }
 
-    bool FinishFrame() override {
+    bool FinishFrame(bool renderGui) override {
         return false;
     }
 
@@ -35,6 +49,10 @@ struct DummyWindow : public cfl::Window {
         return cfl::uvec2();
     }
 
+    bool SizeHasChanged(cfl::uvec2 &sizeOut) const override {
+        return false;
+    }
+
     double GetTime() const override {
         return 0;
     }
@@ -42,6 +60,10 @@ struct DummyWindow : public cfl::Window {
     bool SetTime(double time) override {
         return false;
     }
+
+    bool SetTitle(cfl::string const &title) override {
+        return true;
+    }
 };
 
 struct CompA {
@@ -50,13 +72,10 @@ struct CompA {
     int a;
     uint count;
 
-    inline static cfl::string const GetName() {
-        return "CompA";
-    }
+    static constexpr auto ComponentName = "CompA";
 
-    template<typename TSerializer>
-    static bool Serialize(Json::Value &json, CompA &component) {
-        SERIALIZE(json["a"], component.a);
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, CompA &component) {
+        SERIALIZE(CompA, json["a"], component.a);
         return true;
     }
 };
@@ -67,14 +86,11 @@ struct CompB {
     std::string a, b;
     uint count;
 
-    inline static cfl::string const GetName() {
-        return "CompB";
-    }
+    static constexpr auto ComponentName = "CompB";
 
-    template<typename TSerializer>
-    static bool Serialize(Json::Value &json, CompB &component) {
-        SERIALIZE(json["a"], component.a);
-        SERIALIZE(json["b"], component.b);
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, CompB &component) {
+        SERIALIZE(CompB, json["a"], component.a);
+        SERIALIZE(CompB, json["b"], component.b);
         return true;
     }
 };
@@ -85,14 +101,12 @@ struct CompUnregistered {
     std::string a, b;
     uint count;
 
-    inline static cfl::string const GetName() {
-        return "CompUnregistered";
-    }
+    static constexpr auto ComponentName = "CompUnregistered";
 
-    template<typename TSerializer>
-    static bool Serialize(Json::Value &json, CompUnregistered &component) {
-        SERIALIZE(json["a"], component.a);
-        SERIALIZE(json["b"], component.b);
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json,
+                                 CompUnregistered &component) {
+        SERIALIZE(CompUnregistered, json["a"], component.a);
+        SERIALIZE(CompUnregistered, json["b"], component.b);
         return true;
     }
 };
@@ -105,13 +119,10 @@ struct SystemA : public cfl::System, public entityx::System<SystemA> {
         }
     }
 
-    inline static cfl::string const GetName() {
-        return "SystemA";
-    }
+    static constexpr auto SystemName = "SystemA";
 
-    template<typename TSerializer>
-    static bool Serialize(Json::Value &json, SystemA &name) {
-        json["name"] = GetName();
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, SystemA &sys) {
+        json["name"] = SystemName;
         return true;
     }
 };
@@ -125,13 +136,10 @@ struct SystemAB : public cfl::System, public entityx::System<SystemAB> {
         }
     }
 
-    inline static cfl::string const GetName() {
-        return "SystemAB";
-    }
+    static constexpr auto SystemName = "SystemAB";
 
-    template<typename TSerializer>
-    static bool Serialize(Json::Value &json, SystemAB &name) {
-        json["name"] = GetName();
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, SystemAB &sys) {
+        json["name"] = SystemName;
         return true;
     }
 };
@@ -140,13 +148,36 @@ struct SystemUnregistered : public cfl::System, public entityx::System<SystemUnr
     void update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) override {
     }
 
-    inline static cfl::string const GetName() {
-        return "SystemUnregistered";
+    static constexpr auto SystemName = "SystemUnregistered";
+
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, SystemUnregistered &sys) {
+        json["name"] = SystemName;
+        return true;
     }
+};
 
-    template<typename TSerializer>
-    static bool Serialize(Json::Value &json, SystemUnregistered &name) {
-        json["name"] = GetName();
+struct RendererA : public cfl::System, public entityx::System<RendererA> {
+    void update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) override {
+    }
+
+    static constexpr auto SystemName = "RendererA";
+    static constexpr bool IsRenderer = true;
+
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, RendererA &sys) {
+        json["name"] = SystemName;
+        return true;
+    }
+};
+
+struct RendererB : public cfl::System, public entityx::System<RendererB> {
+    void update(entityx::EntityManager &entities, entityx::EventManager &events, entityx::TimeDelta dt) override {
+    }
+
+    static constexpr auto SystemName = "RendererB";
+    static constexpr bool IsRenderer = true;
+
+    inline static bool Serialize(cfl::BaseSerializer const &serializer, Json::Value &json, RendererB &sys) {
+        json["name"] = SystemName;
         return true;
     }
 };
@@ -156,6 +187,8 @@ public:
     EngineTest() : engine(window = std::static_pointer_cast<cfl::Window>(std::make_shared<DummyWindow>())) {
         REGISTER_SYSTEM(SystemA);
         REGISTER_SYSTEM(SystemAB);
+        REGISTER_SYSTEM(RendererA);
+        REGISTER_SYSTEM(RendererB);
 
         REGISTER_COMPONENT(CompA);
         REGISTER_COMPONENT(CompB);
@@ -163,6 +196,22 @@ public:
 
     cfl::Engine engine;
     std::shared_ptr<cfl::Window> window;
+
+    bool LoadSystems(std::vector<std::string> const &names) {
+        Json::Value json;
+        json["entities"] = Json::Value(Json::arrayValue);
+        json["systems"] = Json::Value(Json::arrayValue);
+        for (auto const &name : names) {
+            Json::Value jsonSystem;
+            jsonSystem["name"] = name;
+            json["systems"].append(jsonSystem);
+        }
+        return engine.LoadScene(json);
+    }
+
+    std::shared_ptr<cfl::SystemFactory> const &FactoryOf(std::string const &name) {
+        return cfl::SystemFactories.Find(name);
+    }
 };
 
 TEST_F(EngineTest, LoadScene_Function_Works) {
@@ -255,3 +304,70 @@ TEST_F(EngineTest, LoadScene_SaveScene_ReturnsSame) {
 
     EXPECT_EQ(jsonOriginal, jsonSerialized);
 }
+
+TEST_F(EngineTest, ComponentFactories_ForEachOf_VisitsRegisteredComponentsOfEntity) {
+    entityx::EventManager events;
+    entityx::EntityManager entities(events);
+
+    auto entity = entities.create();
+    entity.assign<CompB>();
+    entity.assign<CompUnregistered>();
+
+    auto const visited = [](entityx::Entity e) {
+        std::vector<std::string> names;
+        cfl::ComponentFactories.ForEachOf(e, [&](cfl::ComponentFactory const &factory) {
+            EXPECT_TRUE(factory.HasComponent(e));
+            names.push_back(factory.GetName());
+        });
+        std::sort(names.begin(), names.end());
+        return names;
+    };
+
+    EXPECT_EQ(std::vector<std::string>({"CompB"}), visited(entity));
+
+    entity.assign<CompA>();
+    EXPECT_EQ(std::vector<std::string>({"CompA", "CompB"}), visited(entity));
+
+    entity.remove<CompB>();
+    EXPECT_EQ(std::vector<std::string>({"CompA"}), visited(entity));
+
+    EXPECT_TRUE(visited(entities.create()).empty());
+}
+
+TEST_F(EngineTest, MoveSystem_ActiveRendererIsFirstRenderer) {
+    EXPECT_TRUE(LoadSystems({"SystemA", "RendererA", "RendererB"}));
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererA>());
+    EXPECT_FALSE(engine.IsActiveRenderer<RendererB>());
+    EXPECT_FALSE(engine.IsActiveRenderer<SystemA>());
+
+    engine.MoveSystem(FactoryOf("RendererB"), false);
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererB>());
+    EXPECT_FALSE(engine.IsActiveRenderer<RendererA>());
+
+    // moving past a system that is no renderer does not change the active renderer
+    engine.MoveSystem(FactoryOf("RendererB"), false);
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererB>());
+
+    engine.MoveSystem(FactoryOf("RendererA"), false);
+    engine.MoveSystem(FactoryOf("RendererA"), false);
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererA>());
+    EXPECT_FALSE(engine.IsActiveRenderer<RendererB>());
+
+    engine.MoveSystem(FactoryOf("RendererA"), true);
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererB>());
+}
+
+TEST_F(EngineTest, UnloadScene_ResetsActiveRenderer) {
+    EXPECT_TRUE(LoadSystems({"RendererA"}));
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererA>());
+
+    engine.UnloadScene();
+    EXPECT_FALSE(engine.IsActiveRenderer<RendererA>());
+
+    EXPECT_TRUE(LoadSystems({"SystemA", "RendererB"}));
+    EXPECT_TRUE(engine.IsActiveRenderer<RendererB>());
+    EXPECT_FALSE(engine.IsActiveRenderer<RendererA>());
+
+    EXPECT_TRUE(LoadSystems({"SystemA"}));
+    EXPECT_FALSE(engine.IsActiveRenderer<RendererB>());
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/RadixSort.hh>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+using cfl::RadixSort;
+
+namespace {
+/**
+ * @brief The expected result, from std::stable_sort.
+ */
+void StableSort(std::vector<uint32_t> &keys, std::vector<uint32_t> &values) {
+    std::vector<std::pair<uint32_t, uint32_t>> pairs(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        pairs[i] = {keys[i], values[i]};
+    }
+
+    std::stable_sort(pairs.begin(), pairs.end(), [](auto const &a, auto const &b) {
+        return a.first < b.first;
+    });
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = pairs[i].first;
+        values[i] = pairs[i].second;
+    }
+}
+
+std::vector<uint32_t> Iota(size_t count) {
+    std::vector<uint32_t> values(count);
+    std::iota(values.begin(), values.end(), 0);
+    return values;
+}
+} // namespace
+
+TEST(RadixSortTest, SortsRandomKeys) {
+    std::mt19937 random(7);
+    std::vector<uint32_t> keys(100000);
+    std::generate(keys.begin(), keys.end(), random);
+    auto values = Iota(keys.size());
+
+    auto expectedKeys = keys;
+    auto expectedValues = values;
+    StableSort(expectedKeys, expectedValues);
+
+    RadixSort(keys, values);
+    EXPECT_EQ(expectedKeys, keys);
+    EXPECT_EQ(expectedValues, values);
+}
+
+TEST(RadixSortTest, KeepsOrderOfEqualKeys) {
+    // few distinct keys, spread over several blocks, and digits that are the same for every key
+    std::mt19937 random(11);
+    std::uniform_int_distribution<uint32_t> distribution(0, 3);
+
+    std::vector<uint32_t> keys(50000);
+    for (auto &key : keys) {
+        key = 0xabcd0000u | (distribution(random) << 8);
+    }
+    auto values = Iota(keys.size());
+
+    auto expectedKeys = keys;
+    auto expectedValues = values;
+    StableSort(expectedKeys, expectedValues);
+
+    RadixSort(keys, values, 3);
+    EXPECT_EQ(expectedKeys, keys);
+    EXPECT_EQ(expectedValues, values);
+}
+
+TEST(RadixSortTest, ThreadsDoNotChangeResult) {
+    std::mt19937 random(13);
+    std::uniform_int_distribution<uint32_t> distribution(0, 1000);
+
+    std::vector<uint32_t> keys(70001);
+    std::generate(keys.begin(), keys.end(), [&]() { return distribution(random); });
+
+    auto singleKeys = keys, multiKeys = keys;
+    auto singleValues = Iota(keys.size()), multiValues = Iota(keys.size());
+
+    RadixSort(singleKeys, singleValues, 1);
+    RadixSort(multiKeys, multiValues, 8);
+    EXPECT_EQ(singleKeys, multiKeys);
+    EXPECT_EQ(singleValues, multiValues);
+}
+
+TEST(RadixSortTest, HandlesTinyInputs) {
+    std::vector<uint32_t> keys, values;
+    RadixSort(keys, values);
+    EXPECT_TRUE(keys.empty());
+
+    keys = {42};
+    values = {7};
+    RadixSort(keys, values);
+    EXPECT_EQ(42u, keys[0]);
+    EXPECT_EQ(7u, values[0]);
+
+    keys = {0xffffffffu, 0, 0x80000000u};
+    values = {0, 1, 2};
+    RadixSort(keys, values);
+    EXPECT_EQ((std::vector<uint32_t>{0, 0x80000000u, 0xffffffffu}), keys);
+    EXPECT_EQ((std::vector<uint32_t>{1, 2, 0}), values);
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include <EntitiesTest.hh>
+
+#include <conflagrant/RenderableStore.hh>
+#include <conflagrant/ComponentView.hh>
+
+using cfl::RenderableStore;
+using cfl::vec3;
+
+namespace {
+struct RenderableStoreTest : public CacheTest<RenderableStore> {
+
+    entityx::Entity CreateRenderable(vec3 const &position, float radius = 1) {
+        auto entity = entities.create();
+        entity.assign<cfl::comp::Transform>()->Position(position);
+        entity.assign<cfl::comp::Model>();
+        entity.assign<cfl::comp::BoundingSphere>()->sphere = cfl::geometry::Sphere{vec3(0, 0, 0), radius};
+        return entity;
+    }
+
+    // an axis aligned box from -halfSize to halfSize
+    static cfl::geometry::Frustum Box(float halfSize) {
+        vec3 const normals[] = {vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, 1, 0),
+                                vec3(1, 0, 0), vec3(0, -1, 0), vec3(-1, 0, 0)};
+
+        cfl::geometry::Frustum frustum{};
+        for (size_t i = 0; i < cfl::geometry::Frustum::NumSides; ++i) {
+            frustum.sides[i] = cfl::geometry::Plane{halfSize * normals[i], normals[i]};
+        }
+        return frustum;
+    }
+};
+} // namespace
+
+TEST_F(RenderableStoreTest, RemovingFromTheMiddleMovesTheLastSlot) {
+    auto a = CreateRenderable(vec3(1, 0, 0));
+    auto b = CreateRenderable(vec3(2, 0, 0));
+    auto c = CreateRenderable(vec3(3, 0, 0));
+    entities.create().assign<cfl::comp::Transform>();
+    cache.Update();
+    ASSERT_EQ(3u, cache.Size());
+
+    b.remove<cfl::comp::Model>();
+    ASSERT_EQ(2u, cache.Size());
+    EXPECT_EQ(a, cache.Entity(0));
+    EXPECT_EQ(c, cache.Entity(1));
+    EXPECT_EQ(vec3(3, 0, 0), cache.Position(1));
+    EXPECT_EQ(vec3(3, 0, 0), cache.Bounds(1).center);
+
+    a.destroy();
+    ASSERT_EQ(1u, cache.Size());
+    EXPECT_EQ(c, cache.Entity(0));
+
+    // the moved slot still follows its transform
+    c.component<cfl::comp::Transform>()->Position(vec3(4, 0, 0));
+    cache.Update();
+    EXPECT_EQ(vec3(4, 0, 0), cache.Bounds(0).center);
+
+    b.assign<cfl::comp::Model>();
+    ASSERT_EQ(2u, cache.Size());
+    EXPECT_EQ(b, cache.Entity(1));
+}
+
+TEST_F(RenderableStoreTest, ReaddingABoundingSphereRefreshesTheBounds) {
+    auto a = CreateRenderable(vec3(1, 0, 0));
+    cache.Update();
+    EXPECT_EQ(1, cache.Bounds(0).radius);
+
+    a.remove<cfl::comp::BoundingSphere>();
+    a.assign<cfl::comp::BoundingSphere>()->sphere = cfl::geometry::Sphere{vec3(0, 1, 0), 2};
+    cache.Update();
+    EXPECT_EQ(vec3(1, 1, 0), cache.Bounds(0).center);
+    EXPECT_EQ(2, cache.Bounds(0).radius);
+}
+
+TEST_F(RenderableStoreTest, TransformChangeRefreshesTheBounds) {
+    auto a = CreateRenderable(vec3(1, 0, 0));
+    CreateRenderable(vec3(2, 0, 0));
+    cache.Update();
+
+    auto transform = a.component<cfl::comp::Transform>();
+    transform->Position(vec3(0, 0, 5));
+    transform->Scale(2);
+    cache.Update();
+    EXPECT_EQ(vec3(0, 0, 5), cache.Position(0));
+    EXPECT_EQ(2, cache.Scale(0));
+    EXPECT_EQ(vec3(0, 0, 5), cache.Bounds(0).center);
+    EXPECT_EQ(2, cache.Bounds(0).radius);
+    EXPECT_EQ(vec3(2, 0, 0), cache.Bounds(1).center);
+    EXPECT_EQ(1, cache.Bounds(1).radius);
+}
+
+TEST_F(RenderableStoreTest, CullsOutsideTheFrustum) {
+    CreateRenderable(vec3(0, 0, 0));
+    CreateRenderable(vec3(10, 0, 0));
+    CreateRenderable(vec3(0, 2.5f, 0));
+    CreateRenderable(vec3(0, 0, -4));
+    cache.Update();
+
+    auto const frustum = Box(2);
+    std::vector<uint32_t> visible, culled;
+    cache.Cull(&frustum, visible, &culled);
+    EXPECT_EQ(std::vector<uint32_t>({0, 2}), visible);
+    EXPECT_EQ(std::vector<uint32_t>({1, 3}), culled);
+
+    // without a frustum, every slot is visible and the output is appended to
+    cache.Cull(nullptr, visible);
+    EXPECT_EQ(std::vector<uint32_t>({0, 2, 0, 1, 2, 3}), visible);
+}
+
+TEST_F(RenderableStoreTest, EditingTheBoundingSphereRefreshesTheCulling) {
+    auto a = CreateRenderable(vec3(0, 0, 0));
+    cache.Update();
+
+    auto const frustum = Box(2);
+    std::vector<uint32_t> visible, culled;
+    cache.Cull(&frustum, visible, &culled);
+    EXPECT_EQ(std::vector<uint32_t>({0}), visible);
+
+    // the way the entity editor edits it, the transform does not change
+    a.component<cfl::comp::BoundingSphere>()->sphere.center = vec3(10, 0, 0);
+    cfl::ChangeJournal::Of(entities).Record<cfl::comp::BoundingSphere>(a);
+    cache.Update();
+    EXPECT_EQ(vec3(10, 0, 0), cache.Bounds(0).center);
+
+    visible.clear();
+    cache.Cull(&frustum, visible, &culled);
+    EXPECT_TRUE(visible.empty());
+    EXPECT_EQ(std::vector<uint32_t>({0}), culled);
+}
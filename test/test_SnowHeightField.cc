@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/SnowHeightField.hh>
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+
+using cfl::SnowHeightField;
+using cfl::ivec2;
+using cfl::vec2;
+using cfl::vec3;
+
+namespace {
+/**
+ * @brief 64x64 texels in 8x8 tiles of 8x8 texels, covering [-4, 4) of x and z, so a tile is one unit wide.
+ */
+SnowHeightField CleanHeightField() {
+    SnowHeightField heightField;
+    heightField.Configure(64, 8, vec2(0, 0), 4);
+    heightField.TakeDirtyTiles();
+    return heightField;
+}
+
+bool Contains(std::vector<ivec2> const &tiles, ivec2 const &tile) {
+    return std::find(tiles.begin(), tiles.end(), tile) != tiles.end();
+}
+} // namespace
+
+TEST(SnowHeightFieldTest, ConfigureMakesEveryTileDirty) {
+    SnowHeightField heightField;
+    EXPECT_TRUE(heightField.Configure(64, 8, vec2(0, 0), 4));
+    EXPECT_EQ(64u, heightField.TakeDirtyTiles().size());
+    EXPECT_TRUE(heightField.TakeDirtyTiles().empty());
+
+    EXPECT_FALSE(heightField.Configure(64, 8, vec2(0, 0), 4));
+    EXPECT_TRUE(heightField.TakeDirtyTiles().empty());
+
+    EXPECT_TRUE(heightField.Configure(64, 16, vec2(0, 0), 4));
+    EXPECT_EQ(16u, heightField.TakeDirtyTiles().size());
+}
+
+TEST(SnowHeightFieldTest, TilesAreClampedToTheHeightField) {
+    auto const heightField = CleanHeightField();
+
+    auto const inside = heightField.Tiles(vec3(0.5f, 10, -0.5f), 0.25f);
+    EXPECT_EQ(ivec2(4, 3), inside.min);
+    EXPECT_EQ(ivec2(5, 4), inside.max);
+
+    auto const border = heightField.Tiles(vec3(-4, 0, 3.9f), 1.5f);
+    EXPECT_EQ(ivec2(0, 6), border.min);
+    EXPECT_EQ(ivec2(2, 8), border.max);
+
+    EXPECT_TRUE(heightField.Tiles(vec3(10, 0, 0), 1).IsEmpty());
+
+    auto const texels = heightField.Texels(ivec2(7, 2));
+    EXPECT_EQ(ivec2(56, 16), texels.min);
+    EXPECT_EQ(ivec2(64, 24), texels.max);
+}
+
+TEST(SnowHeightFieldTest, OnlyChangedCastersDirtyTiles) {
+    auto heightField = CleanHeightField();
+    auto const still = glm::translate(vec3(-2.5f, 0, -2.5f));
+    auto moving = glm::translate(vec3(2.5f, 0, 2.5f));
+
+    heightField.UpdateCaster(1, still, vec3(-2.5f, 0, -2.5f), 0.25f);
+    heightField.UpdateCaster(2, moving, vec3(2.5f, 0, 2.5f), 0.25f);
+    heightField.RemoveStaleCasters();
+    auto tiles = heightField.TakeDirtyTiles();
+    EXPECT_EQ(2u, tiles.size());
+    EXPECT_TRUE(Contains(tiles, ivec2(1, 1)));
+    EXPECT_TRUE(Contains(tiles, ivec2(6, 6)));
+    EXPECT_TRUE(heightField.IsCasterInTile(1, ivec2(1, 1)));
+    EXPECT_FALSE(heightField.IsCasterInTile(1, ivec2(6, 6)));
+
+    heightField.UpdateCaster(1, still, vec3(-2.5f, 0, -2.5f), 0.25f);
+    heightField.UpdateCaster(2, moving, vec3(2.5f, 0, 2.5f), 0.25f);
+    heightField.RemoveStaleCasters();
+    EXPECT_TRUE(heightField.TakeDirtyTiles().empty());
+
+    // the tile it left and the tile it entered
+    moving = glm::translate(vec3(3.5f, 0, 2.5f));
+    heightField.UpdateCaster(1, still, vec3(-2.5f, 0, -2.5f), 0.25f);
+    heightField.UpdateCaster(2, moving, vec3(3.5f, 0, 2.5f), 0.25f);
+    heightField.RemoveStaleCasters();
+    tiles = heightField.TakeDirtyTiles();
+    EXPECT_EQ(2u, tiles.size());
+    EXPECT_TRUE(Contains(tiles, ivec2(6, 6)));
+    EXPECT_TRUE(Contains(tiles, ivec2(7, 6)));
+    EXPECT_FALSE(heightField.IsCasterInTile(2, ivec2(6, 6)));
+}
+
+TEST(SnowHeightFieldTest, RemovedCastersDirtyTheirTiles) {
+    auto heightField = CleanHeightField();
+
+    heightField.UpdateCaster(1, cfl::mat4(1), vec3(0, 0, 0), 0.5f);
+    heightField.RemoveStaleCasters();
+    EXPECT_EQ(4u, heightField.TakeDirtyTiles().size());
+
+    heightField.RemoveStaleCasters();
+    auto const tiles = heightField.TakeDirtyTiles();
+    EXPECT_EQ(4u, tiles.size());
+    EXPECT_TRUE(Contains(tiles, ivec2(3, 3)));
+    EXPECT_TRUE(Contains(tiles, ivec2(4, 4)));
+    EXPECT_FALSE(heightField.IsCasterInTile(1, ivec2(3, 3)));
+}
+
+TEST(SnowHeightFieldTest, ProjectionLooksDown) {
+    auto const heightField = CleanHeightField();
+    auto const P = heightField.Projection(1);
+
+    auto const corner = P * cfl::vec4(-4, 1, -4, 1);
+    EXPECT_FLOAT_EQ(-1, corner.x);
+    EXPECT_FLOAT_EQ(-1, corner.y);
+    EXPECT_FLOAT_EQ(0, corner.z);
+
+    // z maps to the rows of the texture, and higher surfaces are nearer
+    auto const high = P * cfl::vec4(2, 3, 4, 1);
+    EXPECT_FLOAT_EQ(0.5f, high.x);
+    EXPECT_FLOAT_EQ(1, high.y);
+    EXPECT_FLOAT_EQ(-0.5f, high.z);
+    EXPECT_FLOAT_EQ(1, high.w);
+}
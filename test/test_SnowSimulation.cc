@@ -0,0 +1,309 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/SnowSimulation.hh>
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <random>
+
+using cfl::SnowParticles;
+using cfl::SnowSimulation;
+using cfl::SnowSimulationParameters;
+using cfl::SnowCover;
+using cfl::ivec2;
+using cfl::vec2;
+using cfl::vec3;
+
+namespace {
+/**
+ * @brief Particles spread over a 4x4x4 box around the origin, falling at random speeds and ages.
+ */
+SnowParticles RandomParticles(size_t count) {
+    SnowParticles particles;
+    particles.Resize(count);
+
+    std::mt19937 random(1337);
+    std::uniform_real_distribution<float> position(-2, 2), velocity(-0.2f, 0.2f), lifetime(0, 29);
+
+    for (size_t i = 0; i < count; ++i) {
+        particles.positionX[i] = position(random);
+        particles.positionY[i] = position(random) + 2;
+        particles.positionZ[i] = position(random);
+        particles.velocityX[i] = velocity(random);
+        particles.velocityY[i] = velocity(random);
+        particles.velocityZ[i] = velocity(random);
+        particles.angle[i] = lifetime(random);
+        particles.lifetime[i] = lifetime(random);
+    }
+    return particles;
+}
+
+SnowSimulationParameters Parameters(float time = 5, float timeDelta = 1.0f / 60) {
+    SnowSimulationParameters parameters;
+    parameters.emitterTransform = glm::translate(vec3(0, 3, 0)) * glm::scale(vec3(2, 0.5f, 2));
+    parameters.time = time;
+    parameters.timeDelta = timeDelta;
+    return parameters;
+}
+
+void ExpectRespawned(SnowParticles const &particles, size_t i, SnowSimulationParameters const &parameters) {
+    EXPECT_EQ(0, particles.lifetime[i]) << "particle " << i;
+    EXPECT_EQ(0, particles.angle[i]) << "particle " << i;
+    EXPECT_EQ(-parameters.emitterInitialFallSpeed, particles.velocityY[i]) << "particle " << i;
+}
+} // namespace
+
+TEST(SnowSimulationTest, NoiseGradientMatchesFiniteDifferences) {
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-50, 50);
+
+    float const h = 1e-3f;
+    for (int i = 0; i < 100; ++i) {
+        vec3 const v(coordinate(random), coordinate(random), coordinate(random));
+
+        vec3 gradient;
+        auto const value = SnowSimulation::Noise(v, gradient);
+        EXPECT_EQ(SnowSimulation::Noise(v), value);
+        EXPECT_LE(std::abs(value), 1.0f);
+
+        for (int axis = 0; axis < 3; ++axis) {
+            vec3 forward = v, backward = v;
+            forward[axis] += h;
+            backward[axis] -= h;
+
+            auto const difference = (SnowSimulation::Noise(forward) - SnowSimulation::Noise(backward)) / (2 * h);
+            EXPECT_NEAR(difference, gradient[axis], 0.05f) << "axis " << axis << " at sample " << i;
+        }
+    }
+}
+
+TEST(SnowSimulationTest, RespawnPlacesParticlesInEmitter) {
+    auto const parameters = Parameters();
+    SnowParticles particles;
+    particles.Resize(1000);
+
+    for (size_t i = 0; i < particles.Size(); ++i) {
+        SnowSimulation::Respawn(particles, parameters, i);
+
+        EXPECT_LE(std::abs(particles.positionX[i]), 2.0f);
+        EXPECT_LE(std::abs(particles.positionY[i] - 3), 0.5f);
+        EXPECT_LE(std::abs(particles.positionZ[i]), 2.0f);
+
+        EXPECT_GE(particles.velocityX[i], 0);
+        EXPECT_LT(particles.velocityX[i], parameters.emitterMaxHorizontalSpeed);
+        EXPECT_GE(particles.velocityZ[i], 0);
+        EXPECT_LT(particles.velocityZ[i], parameters.emitterMaxHorizontalSpeed);
+        ExpectRespawned(particles, i, parameters);
+    }
+}
+
+TEST(SnowSimulationTest, FirstFrameRespawnsEveryParticle) {
+    auto const parameters = Parameters(0.01f, 1.0f / 60);
+    auto particles = RandomParticles(100);
+
+    SnowSimulation::Simulate(particles, parameters, nullptr, 1, false);
+    for (size_t i = 0; i < particles.Size(); ++i) {
+        ExpectRespawned(particles, i, parameters);
+    }
+}
+
+TEST(SnowSimulationTest, StepClampsHorizontalSpeedAndAges) {
+    auto parameters = Parameters();
+    parameters.windStrength = 1000;
+
+    auto particles = RandomParticles(100);
+    auto const before = particles;
+
+    SnowSimulation::Simulate(particles, parameters, nullptr, 1, false);
+    for (size_t i = 0; i < particles.Size(); ++i) {
+        auto const speed = std::sqrt(particles.velocityX[i] * particles.velocityX[i] +
+                                     particles.velocityZ[i] * particles.velocityZ[i]);
+        EXPECT_LE(speed, parameters.maxSpeed * 1.0001f);
+
+        if (particles.lifetime[i] != 0) {
+            EXPECT_FLOAT_EQ(before.lifetime[i] + parameters.timeDelta, particles.lifetime[i]);
+            EXPECT_FLOAT_EQ(before.positionY[i] + before.velocityY[i] * parameters.timeDelta,
+                            particles.positionY[i]);
+        }
+    }
+}
+
+TEST(SnowSimulationTest, GroundAndOldAgeRespawn) {
+    auto const parameters = Parameters();
+    auto particles = RandomParticles(2);
+    particles.positionY[0] = -1;
+    particles.lifetime[1] = 31;
+
+    SnowSimulation::Simulate(particles, parameters, nullptr, 1, false);
+    ExpectRespawned(particles, 0, parameters);
+    ExpectRespawned(particles, 1, parameters);
+}
+
+TEST(SnowSimulationTest, ParticlesLandOnTheHeightField) {
+    // a 2x2 square around the origin, with a caster at height 1 over the texels with x >= 0
+    uint32_t const resolution = 4;
+    SnowCover cover(resolution, vec2(0, 0), 1, std::vector<float>(resolution * resolution, 0));
+    float const caster[2 * 4] = {1, 1, 1, 1, 1, 1, 1, 1};
+    cover.UpdateTexels(ivec2(2, 0), ivec2(4, 2), caster);
+    EXPECT_TRUE(cover.Land(vec3(0.1f, 0.5f, -0.9f)));
+    EXPECT_EQ(1u, cover.SnowDepth(ivec2(2, 0)));
+    EXPECT_FALSE(cover.Land(vec3(-0.1f, 0.5f, -0.9f)));
+    EXPECT_FALSE(cover.Land(vec3(1.1f, -1, 0)));
+    EXPECT_FALSE(SnowCover().Land(vec3(0, -1, 0)));
+
+    auto const parameters = Parameters();
+    auto particles = RandomParticles(3);
+    particles.positionX[0] = 0.6f;
+    particles.positionY[0] = 0.9f;
+    particles.positionZ[0] = -0.6f;
+    particles.positionX[1] = particles.positionZ[1] = -0.6f;
+    particles.positionY[1] = 0.9f;
+    particles.lifetime[1] = 1;
+    particles.positionX[2] = particles.positionZ[2] = 0.6f;
+    particles.positionY[2] = -0.05f;
+
+    SnowSimulation::Simulate(particles, parameters, &cover, 1, false);
+    ExpectRespawned(particles, 0, parameters);
+    EXPECT_LT(0, particles.lifetime[1]);
+    ExpectRespawned(particles, 2, parameters);
+    EXPECT_EQ(1u, cover.SnowDepth(ivec2(3, 0)));
+    EXPECT_EQ(1u, cover.SnowDepth(ivec2(3, 3)));
+}
+
+TEST(SnowSimulationTest, SnowPilesUpToTheMaximumDepth) {
+    SnowCover cover(1, vec2(0, 0), 1, std::vector<float>(1, 0));
+    cover.particleSnowDepth = 0.25f;
+    cover.maxSnowDepth = 0.5f;
+
+    // the snow raises the surface until it is as deep as allowed
+    EXPECT_FALSE(cover.Land(vec3(0, 0, 0)));
+    EXPECT_TRUE(cover.Land(vec3(0, -0.1f, 0)));
+    EXPECT_TRUE(cover.Land(vec3(0, 0.2f, 0)));
+    EXPECT_FALSE(cover.Land(vec3(0, 0.5f, 0)));
+    EXPECT_TRUE(cover.Land(vec3(0, 0.4f, 0)));
+    EXPECT_EQ(2u, cover.SnowDepth(ivec2(0, 0)));
+
+    // rendering the tile again clears the snow that lay on the old surface
+    float const height = -1;
+    cover.UpdateTexels(ivec2(0, 0), ivec2(1, 1), &height);
+    EXPECT_EQ(0u, cover.SnowDepth(ivec2(0, 0)));
+    EXPECT_FALSE(cover.Land(vec3(0, -1, 0)));
+}
+
+TEST(SnowSimulationTest, ThreadsDoNotChangeResult) {
+    auto const parameters = Parameters();
+    auto single = RandomParticles(3 * SnowSimulation::ChunkSize + 5);
+    auto multi = single;
+
+    for (int frame = 0; frame < 10; ++frame) {
+        SnowSimulation::Simulate(single, parameters, nullptr, 1);
+        SnowSimulation::Simulate(multi, parameters, nullptr, 4);
+    }
+
+    EXPECT_EQ(single.positionX, multi.positionX);
+    EXPECT_EQ(single.velocityZ, multi.velocityZ);
+    EXPECT_EQ(single.lifetime, multi.lifetime);
+}
+
+TEST(SnowSimulationTest, VectorizedMatchesScalar) {
+    if (!SnowSimulation::IsVectorized()) {
+        std::cout << "AVX2 kernel not available, skipping" << std::endl;
+        return;
+    }
+
+    auto parameters = Parameters();
+    // an odd count, so that the last chunk ends with the scalar remainder
+    auto scalar = RandomParticles(2 * SnowSimulation::ChunkSize + 13);
+    scalar.positionY[3] = -1;
+    scalar.lifetime[12] = 40;
+    auto vectorized = scalar;
+
+    for (int frame = 0; frame < 10; ++frame) {
+        parameters.time += parameters.timeDelta;
+        SnowSimulation::Simulate(scalar, parameters, nullptr, 0, false);
+        SnowSimulation::Simulate(vectorized, parameters, nullptr, 0, true);
+    }
+
+    for (size_t i = 0; i < scalar.Size(); ++i) {
+        ASSERT_NEAR(scalar.positionX[i], vectorized.positionX[i], 1e-4f) << "particle " << i;
+        ASSERT_NEAR(scalar.positionY[i], vectorized.positionY[i], 1e-4f) << "particle " << i;
+        ASSERT_NEAR(scalar.positionZ[i], vectorized.positionZ[i], 1e-4f) << "particle " << i;
+        ASSERT_NEAR(scalar.velocityX[i], vectorized.velocityX[i], 1e-4f) << "particle " << i;
+        ASSERT_NEAR(scalar.velocityZ[i], vectorized.velocityZ[i], 1e-4f) << "particle " << i;
+        ASSERT_NEAR(scalar.lifetime[i], vectorized.lifetime[i], 1e-4f) << "particle " << i;
+    }
+}
+
+TEST(SnowSimulationTest, PackedStreamsAreInterleaved) {
+    auto const particles = RandomParticles(17);
+
+    std::vector<float> positions(3 * 10, -1), velocities(3 * 10, -1);
+    particles.PackPositions(positions.data(), 5, 15);
+    particles.PackVelocities(velocities.data(), 5, 15);
+
+    for (size_t i = 5; i < 15; ++i) {
+        EXPECT_EQ(particles.positionX[i], positions[3 * (i - 5)]);
+        EXPECT_EQ(particles.positionY[i], positions[3 * (i - 5) + 1]);
+        EXPECT_EQ(particles.positionZ[i], positions[3 * (i - 5) + 2]);
+        EXPECT_EQ(particles.velocityX[i], velocities[3 * (i - 5)]);
+        EXPECT_EQ(particles.velocityY[i], velocities[3 * (i - 5) + 1]);
+        EXPECT_EQ(particles.velocityZ[i], velocities[3 * (i - 5) + 2]);
+    }
+}
+
+TEST(SnowSimulationTest, SortBackToFrontKeepsParticlesTogether) {
+    auto particles = RandomParticles(20000);
+    for (size_t i = 0; i < particles.Size(); ++i) {
+        // tags every particle, to check that its attributes move together
+        particles.lifetime[i] = static_cast<float>(i);
+        particles.angle[i] = particles.positionX[i] + particles.velocityZ[i];
+    }
+
+    vec3 const eye(1, 2, 3);
+    auto const before = particles;
+    SnowSimulation::SortBackToFront(particles, eye, 4);
+
+    auto const squaredDistance = [&](size_t i) {
+        vec3 const d(particles.positionX[i] - eye.x, particles.positionY[i] - eye.y, particles.positionZ[i] - eye.z);
+        return d.x * d.x + d.y * d.y + d.z * d.z;
+    };
+
+    std::vector<bool> isSeen(particles.Size(), false);
+    for (size_t i = 0; i < particles.Size(); ++i) {
+        if (i > 0) {
+            ASSERT_GE(squaredDistance(i - 1), squaredDistance(i)) << "particle " << i;
+        }
+
+        auto const original = static_cast<size_t>(particles.lifetime[i]);
+        ASSERT_FALSE(isSeen[original]);
+        isSeen[original] = true;
+
+        EXPECT_EQ(before.positionY[original], particles.positionY[i]);
+        EXPECT_EQ(before.velocityX[original], particles.velocityX[i]);
+        EXPECT_EQ(particles.positionX[i] + particles.velocityZ[i], particles.angle[i]);
+    }
+}
+
+TEST(SnowSimulationTest, LodConservesCoverage) {
+    cfl::SnowLodParameters parameters;
+    parameters.fullDetailDistance = 10;
+    parameters.minDetailFraction = 0.05f;
+
+    auto const near = SnowSimulation::ComputeLod(10000, 5, parameters);
+    EXPECT_EQ(10000, near.count);
+    EXPECT_EQ(1, near.radiusScale);
+
+    auto const far = SnowSimulation::ComputeLod(10000, 20, parameters);
+    EXPECT_EQ(2500, far.count);
+    EXPECT_FLOAT_EQ(2, far.radiusScale);
+
+    for (float distance = 10; distance < 200; distance += 7.5f) {
+        auto const lod = SnowSimulation::ComputeLod(10000, distance, parameters);
+        EXPECT_GE(lod.count, 500);
+        EXPECT_NEAR(10000, lod.count * lod.radiusScale * lod.radiusScale, 1e-2f) << "at distance " << distance;
+    }
+
+    EXPECT_EQ(0, SnowSimulation::ComputeLod(0, 100, parameters).count);
+    EXPECT_EQ(1, SnowSimulation::ComputeLod(3, 1000, parameters).count);
+}
@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/SparseVoxelOctree.hh>
+
+#include <random>
+
+using cfl::SparseVoxelOctree;
+using cfl::VoxelFragment;
+
+namespace {
+VoxelFragment MakeFragment(cfl::uvec3 const &voxel, cfl::vec3 const &color) {
+    return VoxelFragment{VoxelFragment::PackPosition(voxel),
+                         SparseVoxelOctree::PackColor(cfl::vec4(color, 1.0f / 255))};
+}
+
+void ExpectColorNear(cfl::vec4 const &expected, cfl::vec4 const &actual, float tolerance = 1.5f / 255) {
+    EXPECT_NEAR(expected.r, actual.r, tolerance);
+    EXPECT_NEAR(expected.g, actual.g, tolerance);
+    EXPECT_NEAR(expected.b, actual.b, tolerance);
+    EXPECT_NEAR(expected.a, actual.a, tolerance);
+}
+
+/**
+ * @brief Brute force dense mipmap pyramid with the same filtering as voxels/mipmap.comp.
+ */
+class DenseReference {
+    uint32_t levels;
+    std::vector<std::vector<cfl::vec4>> mipmaps;
+
+    size_t Index(cfl::uvec3 const &voxel, uint32_t level) const {
+        size_t const side = size_t(1) << (levels - level);
+        return voxel.x + side * (voxel.y + side * voxel.z);
+    }
+
+public:
+    DenseReference(uint32_t levels, std::vector<VoxelFragment> const &fragments)
+            : levels(levels) {
+        size_t const side = size_t(1) << levels;
+        std::vector<cfl::vec3> sums(side * side * side, cfl::vec3(0));
+        std::vector<uint32_t> counts(side * side * side, 0);
+
+        for (auto const &fragment : fragments) {
+            auto const index = Index(VoxelFragment::UnpackPosition(fragment.position), 0);
+            sums[index] += cfl::vec3(SparseVoxelOctree::UnpackColor(fragment.color));
+            counts[index]++;
+        }
+
+        mipmaps.emplace_back(side * side * side, cfl::vec4(0));
+        for (size_t i = 0; i < sums.size(); ++i) {
+            if (counts[i] > 0) {
+                mipmaps[0][i] = cfl::vec4(sums[i] / static_cast<float>(counts[i]),
+                                          std::min<uint32_t>(counts[i], 255) / 255.0f);
+            }
+        }
+
+        for (uint32_t level = 1; level <= levels; ++level) {
+            uint32_t const levelSide = 1u << (levels - level);
+            mipmaps.emplace_back(size_t(levelSide) * levelSide * levelSide, cfl::vec4(0));
+
+            for (uint32_t x = 0; x < levelSide; ++x) {
+                for (uint32_t y = 0; y < levelSide; ++y) {
+                    for (uint32_t z = 0; z < levelSide; ++z) {
+                        cfl::vec3 color(0);
+                        float alpha = 0;
+                        int count = 0;
+                        for (uint32_t i = 0; i < 8; ++i) {
+                            cfl::uvec3 const child(2 * x + (i & 1), 2 * y + ((i >> 1) & 1), 2 * z + ((i >> 2) & 1));
+                            auto const texel = mipmaps[level - 1][Index(child, level - 1)];
+                            if (texel.a > 0) {
+                                color += cfl::vec3(texel);
+                                alpha += level == 1 ? std::min(255 * texel.a, 1.0f) : texel.a;
+                                count++;
+                            }
+                        }
+
+                        if (count > 0) {
+                            mipmaps[level][Index(cfl::uvec3(x, y, z), level)] =
+                                    cfl::vec4(color / static_cast<float>(count), std::min(alpha, 1.0f));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    cfl::vec4 Lookup(cfl::uvec3 const &voxel, uint32_t level) const {
+        return mipmaps[level][Index(voxel >> level, level)];
+    }
+};
+} // namespace
+
+TEST(SparseVoxelOctreeTest, PackPositionRoundTrips) {
+    cfl::uvec3 const voxel(1023, 0, 517);
+    auto const unpacked = VoxelFragment::UnpackPosition(VoxelFragment::PackPosition(voxel));
+
+    EXPECT_EQ(voxel.x, unpacked.x);
+    EXPECT_EQ(voxel.y, unpacked.y);
+    EXPECT_EQ(voxel.z, unpacked.z);
+}
+
+TEST(SparseVoxelOctreeTest, EmptyOctreeOnlyHasRoot) {
+    SparseVoxelOctree octree(5);
+    octree.Build({});
+
+    EXPECT_EQ(1u, octree.Nodes().size());
+    for (uint32_t level = 0; level <= octree.Levels(); ++level) {
+        ExpectColorNear(cfl::vec4(0), octree.Lookup(cfl::uvec3(3, 1, 4), level), 0);
+    }
+}
+
+TEST(SparseVoxelOctreeTest, SingleFragmentSubdividesOnePath) {
+    SparseVoxelOctree octree(4);
+    cfl::uvec3 const voxel(5, 9, 14);
+    cfl::vec3 const color(0.2f, 0.4f, 0.6f);
+    octree.Build({MakeFragment(voxel, color)});
+
+    EXPECT_EQ(1u + 8 * 4, octree.Nodes().size());
+
+    ExpectColorNear(cfl::vec4(color, 1.0f / 255), octree.Lookup(voxel, 0));
+    for (uint32_t level = 1; level <= octree.Levels(); ++level) {
+        ExpectColorNear(cfl::vec4(color, 1), octree.Lookup(voxel, level));
+    }
+
+    // the neighbouring leaf exists, but is empty
+    ExpectColorNear(cfl::vec4(0), octree.Lookup(cfl::uvec3(4, 9, 14), 0), 0);
+    // the other half of the volume was never subdivided
+    ExpectColorNear(cfl::vec4(0), octree.Lookup(cfl::uvec3(15, 0, 0), 0), 0);
+}
+
+TEST(SparseVoxelOctreeTest, AveragesFragmentsOfTheSameVoxel) {
+    SparseVoxelOctree octree(3);
+    cfl::uvec3 const voxel(1, 2, 3);
+    octree.Build({MakeFragment(voxel, cfl::vec3(1, 0, 0)),
+                  MakeFragment(voxel, cfl::vec3(0, 0, 1))});
+
+    ExpectColorNear(cfl::vec4(0.5f, 0, 0.5f, 2.0f / 255), octree.Lookup(voxel, 0));
+}
+
+TEST(SparseVoxelOctreeTest, MatchesDenseMipmapPyramid) {
+    uint32_t const levels = 5;
+    uint32_t const side = 1u << levels;
+
+    std::mt19937 random(1337);
+    std::uniform_int_distribution<uint32_t> coordinate(0, side - 1);
+    std::uniform_real_distribution<float> channel(0, 1);
+
+    std::vector<VoxelFragment> fragments;
+    for (int i = 0; i < 500; ++i) {
+        cfl::uvec3 const voxel(coordinate(random), coordinate(random), coordinate(random));
+        fragments.push_back(MakeFragment(voxel, cfl::vec3(channel(random), channel(random), channel(random))));
+    }
+
+    SparseVoxelOctree octree(levels);
+    octree.Build(fragments);
+    DenseReference const dense(levels, fragments);
+
+    for (uint32_t level = 0; level <= levels; ++level) {
+        for (uint32_t x = 0; x < side; x += 1u << level) {
+            for (uint32_t y = 0; y < side; y += 1u << level) {
+                for (uint32_t z = 0; z < side; z += 1u << level) {
+                    cfl::uvec3 const voxel(x, y, z);
+                    // the octree filters already quantized colors, so allow some rounding per level
+                    ExpectColorNear(dense.Lookup(voxel, level), octree.Lookup(voxel, level), (1.5f + level) / 255);
+                }
+            }
+        }
+    }
+
+    EXPECT_LT(octree.SizeInBytes(), SparseVoxelOctree::DenseSizeInBytes(levels));
+}
+
+TEST(SparseVoxelOctreeTest, SampleInterpolatesBetweenLevels) {
+    SparseVoxelOctree octree(4);
+    cfl::uvec3 const voxel(3, 3, 3);
+    octree.Build({MakeFragment(voxel, cfl::vec3(1, 1, 1))});
+
+    cfl::vec3 const position = (cfl::vec3(voxel) + 0.5f) / 16.0f;
+    auto const expected = 0.5f * octree.Lookup(voxel, 0) + 0.5f * octree.Lookup(voxel, 1);
+
+    ExpectColorNear(expected, octree.Sample(position, 0.5f), 1e-5f);
+    ExpectColorNear(cfl::vec4(0), octree.Sample(cfl::vec3(-0.1f, 0.5f, 0.5f), 0), 0);
+}
+
+TEST(SparseVoxelOctreeTest, SparseSceneNeedsFarLessMemoryThanDense) {
+    SparseVoxelOctree octree(SparseVoxelOctree::MaxLevels);
+
+    // a 64x64 voxel floor at full resolution
+    std::vector<VoxelFragment> fragments;
+    for (uint32_t x = 0; x < 64; ++x) {
+        for (uint32_t z = 0; z < 64; ++z) {
+            fragments.push_back(MakeFragment(cfl::uvec3(x, 0, z), cfl::vec3(0.5f)));
+        }
+    }
+    octree.Build(fragments);
+
+    EXPECT_LT(octree.SizeInBytes() * 1000, SparseVoxelOctree::DenseSizeInBytes(SparseVoxelOctree::MaxLevels));
+}
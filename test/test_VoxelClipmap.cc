@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/VoxelClipmap.hh>
+
+#include <map>
+#include <tuple>
+
+using cfl::VoxelClipmap;
+using cfl::ivec3;
+using cfl::vec3;
+
+namespace {
+constexpr int Resolution = 16;
+
+typedef std::tuple<int, int, int> Voxel;
+
+std::vector<VoxelClipmap::Update> OfLevel(std::vector<VoxelClipmap::Update> const &updates, int level) {
+    std::vector<VoxelClipmap::Update> ofLevel;
+    for (auto const &update : updates) {
+        if (update.level == level) {
+            ofLevel.push_back(update);
+        }
+    }
+    return ofLevel;
+}
+
+/**
+ * @returns How often every voxel is covered by the boxes.
+ */
+std::map<Voxel, int> Coverage(std::vector<VoxelClipmap::Box> const &boxes) {
+    std::map<Voxel, int> coverage;
+    for (auto const &box : boxes) {
+        for (int x = box.min.x; x < box.max.x; ++x) {
+            for (int y = box.min.y; y < box.max.y; ++y) {
+                for (int z = box.min.z; z < box.max.z; ++z) {
+                    ++coverage[Voxel(x, y, z)];
+                }
+            }
+        }
+    }
+    return coverage;
+}
+
+std::vector<VoxelClipmap::Box> Boxes(std::vector<VoxelClipmap::Update> const &updates) {
+    std::vector<VoxelClipmap::Box> boxes;
+    for (auto const &update : updates) {
+        boxes.push_back(update.box);
+    }
+    return boxes;
+}
+
+bool IsInside(Voxel const &voxel, ivec3 const &origin) {
+    return std::get<0>(voxel) >= origin.x && std::get<0>(voxel) < origin.x + Resolution &&
+           std::get<1>(voxel) >= origin.y && std::get<1>(voxel) < origin.y + Resolution &&
+           std::get<2>(voxel) >= origin.z && std::get<2>(voxel) < origin.z + Resolution;
+}
+
+/**
+ * @brief Moves the clipmap and expects the updates of level 0 to cover every voxel that entered it exactly once, and
+ * no other voxel.
+ */
+void ExpectSlabsCoverEnteredVoxels(VoxelClipmap &clipmap, vec3 const &from, vec3 const &to) {
+    clipmap.Recenter(from);
+    auto const oldOrigin = clipmap.Origin(0);
+    auto const updates = OfLevel(clipmap.Recenter(to), 0);
+    auto const newOrigin = clipmap.Origin(0);
+
+    int entered = 0;
+    for (auto const &covered : Coverage(Boxes(updates))) {
+        EXPECT_EQ(1, covered.second);
+        EXPECT_TRUE(IsInside(covered.first, newOrigin));
+        EXPECT_FALSE(IsInside(covered.first, oldOrigin));
+        ++entered;
+    }
+
+    auto const shift = glm::abs(newOrigin - oldOrigin);
+    auto const kept = (Resolution - shift.x) * (Resolution - shift.y) * (Resolution - shift.z);
+    EXPECT_EQ(Resolution * Resolution * Resolution - kept, entered);
+}
+} // namespace
+
+TEST(VoxelClipmapTest, FirstRecenterRefreshesEveryLevel) {
+    VoxelClipmap clipmap;
+    clipmap.Configure(Resolution, 3, 1);
+
+    auto const updates = clipmap.Recenter(vec3(0.5f, 0.5f, 0.5f));
+    ASSERT_EQ(3u, updates.size());
+    for (int level = 0; level < 3; ++level) {
+        EXPECT_EQ(level, updates[level].level);
+        EXPECT_EQ(clipmap.Origin(level), updates[level].box.min);
+        EXPECT_EQ(clipmap.Origin(level) + ivec3(Resolution), updates[level].box.max);
+    }
+
+    EXPECT_TRUE(clipmap.Recenter(vec3(0.5f, 0.5f, 0.5f)).empty());
+}
+
+TEST(VoxelClipmapTest, SlabsOfOneAxisDoNotOverlap) {
+    VoxelClipmap clipmap;
+    clipmap.Configure(Resolution, 1, 1);
+
+    ExpectSlabsCoverEnteredVoxels(clipmap, vec3(0.5f, 0.5f, 0.5f), vec3(3.5f, 0.5f, 0.5f));
+    ExpectSlabsCoverEnteredVoxels(clipmap, vec3(0.5f, 0.5f, 0.5f), vec3(0.5f, -5.5f, 0.5f));
+}
+
+TEST(VoxelClipmapTest, SlabsOfSeveralAxesDoNotOverlap) {
+    VoxelClipmap clipmap;
+    clipmap.Configure(Resolution, 1, 1);
+
+    ExpectSlabsCoverEnteredVoxels(clipmap, vec3(0.5f, 0.5f, 0.5f), vec3(3.5f, -1.5f, 1.5f));
+    ExpectSlabsCoverEnteredVoxels(clipmap, vec3(0.5f, 0.5f, 0.5f), vec3(-7.5f, 9.5f, -15.5f));
+}
+
+TEST(VoxelClipmapTest, TexelBoxesSplitWhereTheyWrap) {
+    VoxelClipmap clipmap;
+    clipmap.Configure(Resolution, 2, 1);
+
+    // the slab of voxels 8 to 18 along x wraps past the last texel, along y and z it starts at texel 0
+    clipmap.Recenter(vec3(0.5f, 8.5f, 8.5f));
+    auto const updates = OfLevel(clipmap.Recenter(vec3(10.5f, 8.5f, 8.5f)), 0);
+    ASSERT_EQ(1u, updates.size());
+    EXPECT_EQ(8, updates[0].box.min.x);
+    EXPECT_EQ(18, updates[0].box.max.x);
+
+    auto const texels = clipmap.TexelBoxes(updates[0]);
+    ASSERT_EQ(2u, texels.size());
+    EXPECT_EQ(ivec3(8, 0, 0), texels[0].min);
+    EXPECT_EQ(ivec3(16, 16, 16), texels[0].max);
+    EXPECT_EQ(ivec3(0, 0, 0), texels[1].min);
+    EXPECT_EQ(ivec3(2, 16, 16), texels[1].max);
+
+    // every texel of the level once, and the voxels of level 1 start after the texels of level 0
+    VoxelClipmap::Update const wrapped{1, VoxelClipmap::Box{ivec3(-3, 5, 14), ivec3(13, 21, 30)}};
+    auto const coverage = Coverage(clipmap.TexelBoxes(wrapped));
+    EXPECT_EQ(static_cast<size_t>(Resolution * Resolution * Resolution), coverage.size());
+    for (auto const &covered : coverage) {
+        EXPECT_EQ(1, covered.second);
+        EXPECT_TRUE(IsInside(covered.first, ivec3(0, 0, Resolution)));
+    }
+}
+
+TEST(VoxelClipmapTest, MovingByTheResolutionRefreshesTheLevel) {
+    VoxelClipmap clipmap;
+    clipmap.Configure(Resolution, 2, 1);
+    clipmap.Recenter(vec3(0.5f, 0.5f, 0.5f));
+
+    // level 0 moves by 16 voxels, level 1 only by 8 of its larger voxels
+    auto const updates = clipmap.Recenter(vec3(16.5f, 0.5f, 0.5f));
+    auto const level0 = OfLevel(updates, 0);
+    ASSERT_EQ(1u, level0.size());
+    EXPECT_EQ(clipmap.Origin(0), level0[0].box.min);
+    EXPECT_EQ(clipmap.Origin(0) + ivec3(Resolution), level0[0].box.max);
+
+    auto const level1 = OfLevel(updates, 1);
+    ASSERT_EQ(1u, level1.size());
+    EXPECT_EQ(8, level1[0].box.max.x - level1[0].box.min.x);
+}
+
+TEST(VoxelClipmapTest, InvalidateRefreshesEveryLevel) {
+    VoxelClipmap clipmap;
+    clipmap.Configure(Resolution, 2, 1);
+    clipmap.Recenter(vec3(0.5f, 0.5f, 0.5f));
+
+    clipmap.Invalidate();
+    auto const updates = clipmap.Recenter(vec3(1.5f, 0.5f, 0.5f));
+    ASSERT_EQ(2u, updates.size());
+    for (auto const &update : updates) {
+        EXPECT_EQ(clipmap.Origin(update.level), update.box.min);
+        EXPECT_EQ(clipmap.Origin(update.level) + ivec3(Resolution), update.box.max);
+    }
+
+    EXPECT_FALSE(clipmap.Configure(Resolution, 2, 1));
+    EXPECT_TRUE(clipmap.Recenter(vec3(1.5f, 0.5f, 0.5f)).empty());
+}
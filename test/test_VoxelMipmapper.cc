@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <conflagrant/VoxelMipmapper.hh>
+
+#include <random>
+
+using cfl::VoxelMipmapper;
+using cfl::VoxelVolume;
+
+namespace {
+/**
+ * @brief A volume with random voxels in level 0, including fragment counts above 1 and empty space.
+ */
+VoxelVolume RandomVolume(uint32_t resolution) {
+    VoxelVolume volume(resolution, cfl::vec3(0, 0, 0), 1);
+
+    std::mt19937 random(1337);
+    std::uniform_int_distribution<uint32_t> channel(0, 255), count(1, 20);
+    std::bernoulli_distribution isFilled(0.1);
+
+    for (auto &voxel : volume.Level(0)) {
+        if (isFilled(random)) {
+            voxel = channel(random) | (channel(random) << 8) | (channel(random) << 16) | (count(random) << 24);
+        }
+    }
+    return volume;
+}
+} // namespace
+
+TEST(VoxelMipmapperTest, PlanCoversEveryLevelOnce) {
+    auto const dispatches = VoxelMipmapper::Plan(128, 8, 3);
+    ASSERT_EQ(3u, dispatches.size());
+
+    EXPECT_EQ(0u, dispatches[0].sourceLevel);
+    EXPECT_EQ(3u, dispatches[0].numLevels);
+    EXPECT_EQ(8u, dispatches[0].numGroups);
+
+    EXPECT_EQ(3u, dispatches[1].sourceLevel);
+    EXPECT_EQ(3u, dispatches[1].numLevels);
+    EXPECT_EQ(1u, dispatches[1].numGroups);
+
+    EXPECT_EQ(6u, dispatches[2].sourceLevel);
+    EXPECT_EQ(1u, dispatches[2].numLevels);
+    EXPECT_EQ(1u, dispatches[2].numGroups);
+}
+
+TEST(VoxelMipmapperTest, PlanStopsAtResolutionOne) {
+    auto const dispatches = VoxelMipmapper::Plan(16, 10, 3);
+    ASSERT_EQ(2u, dispatches.size());
+    EXPECT_EQ(4u, dispatches.back().sourceLevel + dispatches.back().numLevels);
+
+    EXPECT_TRUE(VoxelMipmapper::Plan(16, 1, 3).empty());
+}
+
+TEST(VoxelMipmapperTest, PlanClampsLevelsPerDispatch) {
+    EXPECT_EQ(7u, VoxelMipmapper::Plan(128, 8, 0).size());
+    EXPECT_EQ(3u, VoxelMipmapper::Plan(128, 8, 9).size());
+}
+
+TEST(VoxelMipmapperTest, RunMatchesReference) {
+    for (uint32_t resolution : {4u, 8u, 32u, 64u}) {
+        auto reference = RandomVolume(resolution);
+        reference.GenerateMipmaps(10);
+
+        for (uint32_t levelsPerDispatch = 1; levelsPerDispatch <= VoxelMipmapper::MaxLevelsPerDispatch;
+             ++levelsPerDispatch) {
+            auto volume = RandomVolume(resolution);
+            VoxelMipmapper::Run(volume, 11, levelsPerDispatch);
+
+            ASSERT_EQ(reference.NumLevels(), volume.NumLevels());
+            for (size_t level = 1; level < volume.NumLevels(); ++level) {
+                EXPECT_EQ(reference.Level(level), volume.Level(level))
+                                    << "resolution " << resolution << ", level " << level
+                                    << ", " << levelsPerDispatch << " levels per dispatch";
+            }
+        }
+    }
+}
+
+TEST(VoxelMipmapperTest, RunOnlyBuildsRequestedLevels) {
+    auto reference = RandomVolume(32);
+    reference.GenerateMipmaps(2);
+
+    auto volume = RandomVolume(32);
+    VoxelMipmapper::Run(volume, 3, 3);
+
+    ASSERT_EQ(3u, volume.NumLevels());
+    EXPECT_EQ(reference.Level(1), volume.Level(1));
+    EXPECT_EQ(reference.Level(2), volume.Level(2));
+}